@@ -0,0 +1,60 @@
+#ifndef COMMON_EXECUTOR_H
+#define COMMON_EXECUTOR_H
+
+#include "common/thread_pool.h"
+
+// libC++
+#include <cassert>
+#include <coroutine>
+
+namespace kvs {
+
+// Decide where a suspended coroutine is resumed, once what it waits for(disk
+// read, turn to write, ...) is done. Execute() is called from whatever thread
+// completed the wait, so a coroutine runtime plugs its own executor in to get
+// its coroutines back onto its event loop
+class Executor {
+public:
+  Executor() = default;
+
+  virtual ~Executor() = default;
+
+  // No copy allowed
+  Executor(const Executor &) = delete;
+  Executor &operator=(const Executor &) = delete;
+
+  // No move allowed
+  Executor(Executor &&) = delete;
+  Executor &operator=(Executor &&) = delete;
+
+  virtual void Execute(std::coroutine_handle<> handle) = 0;
+};
+
+// Resume coroutine right away, on thread that completed the wait
+class InlineExecutor : public Executor {
+public:
+  void Execute(std::coroutine_handle<> handle) override { handle.resume(); }
+};
+
+// Resume coroutine as a job of thread pool
+class ThreadPoolExecutor : public Executor {
+public:
+  explicit ThreadPoolExecutor(const ThreadPool *thread_pool,
+                              TaskPriority priority = TaskPriority::kHigh)
+      : thread_pool_(thread_pool), priority_(priority) {
+    assert(thread_pool_);
+  }
+
+  void Execute(std::coroutine_handle<> handle) override {
+    thread_pool_->Schedule(priority_, [handle]() { handle.resume(); });
+  }
+
+private:
+  const ThreadPool *const thread_pool_;
+
+  const TaskPriority priority_;
+};
+
+} // namespace kvs
+
+#endif // COMMON_EXECUTOR_H
\ No newline at end of file
@@ -1,6 +1,7 @@
 #ifndef COMMON_MACROS
 #define COMMON_MACROS
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
@@ -30,6 +31,9 @@ constexpr size_t kMaxKeySize = 4 * 1024; // 4 KB
 
 constexpr TxnId INVALID_TXN_ID = -1;
 
+// Largest valid transaction id. Reading at this bound sees every version
+constexpr TxnId kMaxTxnId = INVALID_TXN_ID - 1;
+
 } // namespace kvs
 
 #endif // COMMON_MACROS
\ No newline at end of file
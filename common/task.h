@@ -0,0 +1,311 @@
+#ifndef COMMON_TASK_H
+#define COMMON_TASK_H
+
+// libC++
+#include <atomic>
+#include <cassert>
+#include <coroutine>
+#include <exception>
+#include <latch>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace kvs {
+
+template <typename T = void> class Task;
+
+namespace detail {
+
+struct TaskPromiseBase {
+  // Hand control back to coroutine that awaits task
+  struct FinalAwaiter {
+    bool await_ready() noexcept { return false; }
+
+    template <typename Promise>
+    std::coroutine_handle<>
+    await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+      return handle.promise().continuation;
+    }
+
+    void await_resume() noexcept {}
+  };
+
+  // Task only starts once it is awaited
+  std::suspend_always initial_suspend() noexcept { return {}; }
+
+  FinalAwaiter final_suspend() noexcept { return {}; }
+
+  void unhandled_exception() { exception = std::current_exception(); }
+
+  std::coroutine_handle<> continuation{std::noop_coroutine()};
+
+  std::exception_ptr exception;
+};
+
+template <typename T> struct TaskPromise : TaskPromiseBase {
+  Task<T> get_return_object();
+
+  void return_value(T result) { value.emplace(std::move(result)); }
+
+  T GetResult() {
+    if (exception) {
+      std::rethrow_exception(exception);
+    }
+    return std::move(*value);
+  }
+
+  std::optional<T> value;
+};
+
+template <> struct TaskPromise<void> : TaskPromiseBase {
+  Task<void> get_return_object();
+
+  void return_void() {}
+
+  void GetResult() {
+    if (exception) {
+      std::rethrow_exception(exception);
+    }
+  }
+};
+
+} // namespace detail
+
+/*
+Lazily started coroutine that returns T.
+
+Task doesn't run until it is awaited(co_await task), then it runs on awaiting
+thread until it completes or suspends. Once it completes, awaiting coroutine is
+resumed on thread that completed it. Non-coroutine callers use SyncWait().
+
+Arguments that are references(string_view, span, ...) MUST outlive task.
+*/
+template <typename T> class Task {
+public:
+  using promise_type = detail::TaskPromise<T>;
+
+  explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+  ~Task() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  // No copy allowed
+  Task(const Task &) = delete;
+  Task &operator=(const Task &) = delete;
+
+  Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+
+  Task &operator=(Task &&other) noexcept {
+    if (this != &other) {
+      if (handle_) {
+        handle_.destroy();
+      }
+      handle_ = std::exchange(other.handle_, {});
+    }
+    return *this;
+  }
+
+  bool await_ready() const noexcept { return false; }
+
+  // Start task, awaiting coroutine is resumed once it completes
+  std::coroutine_handle<>
+  await_suspend(std::coroutine_handle<> awaiting) noexcept {
+    assert(handle_);
+    handle_.promise().continuation = awaiting;
+    return handle_;
+  }
+
+  T await_resume() { return handle_.promise().GetResult(); }
+
+private:
+  std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail {
+
+template <typename T> Task<T> TaskPromise<T>::get_return_object() {
+  return Task<T>(
+      std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+  return Task<void>(
+      std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+// Coroutine that awaits a task on behalf of a non-coroutine, or one of many
+// tasks awaited together. on_done is called once task is completed
+class DetachedTask {
+public:
+  struct promise_type {
+    struct FinalAwaiter {
+      bool await_ready() noexcept { return false; }
+
+      std::coroutine_handle<>
+      await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+        return handle.promise().on_done(handle.promise().context);
+      }
+
+      void await_resume() noexcept {}
+    };
+
+    DetachedTask get_return_object() {
+      return DetachedTask(
+          std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    FinalAwaiter final_suspend() noexcept { return {}; }
+
+    void return_void() {}
+
+    void unhandled_exception() { exception = std::current_exception(); }
+
+    // Return coroutine to resume next, noop_coroutine() if there is none
+    std::coroutine_handle<> (*on_done)(void *context) noexcept;
+
+    void *context;
+
+    std::exception_ptr exception;
+  };
+
+  explicit DetachedTask(std::coroutine_handle<promise_type> handle)
+      : handle_(handle) {}
+
+  ~DetachedTask() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  // No copy allowed
+  DetachedTask(const DetachedTask &) = delete;
+  DetachedTask &operator=(const DetachedTask &) = delete;
+
+  DetachedTask(DetachedTask &&other) noexcept
+      : handle_(std::exchange(other.handle_, {})) {}
+
+  DetachedTask &operator=(DetachedTask &&) = delete;
+
+  void Start(std::coroutine_handle<> (*on_done)(void *context) noexcept,
+             void *context) {
+    handle_.promise().on_done = on_done;
+    handle_.promise().context = context;
+    handle_.resume();
+  }
+
+  void RethrowIfFailed() const {
+    if (handle_.promise().exception) {
+      std::rethrow_exception(handle_.promise().exception);
+    }
+  }
+
+private:
+  std::coroutine_handle<promise_type> handle_;
+};
+
+template <typename T>
+DetachedTask AwaitAndStore(Task<T> &task, std::optional<T> *result) {
+  result->emplace(co_await task);
+}
+
+inline DetachedTask AwaitAndStore(Task<void> &task, std::optional<bool> *) {
+  co_await task;
+}
+
+} // namespace detail
+
+// Block calling thread until task completes, then return its result
+template <typename T> T SyncWait(Task<T> task) {
+  using Result = std::conditional_t<std::is_void_v<T>, bool, T>;
+  std::optional<Result> result;
+  std::latch done(1);
+
+  detail::DetachedTask waiter = detail::AwaitAndStore(task, &result);
+  waiter.Start(
+      [](void *context) noexcept -> std::coroutine_handle<> {
+        static_cast<std::latch *>(context)->count_down();
+        return std::noop_coroutine();
+      },
+      &done);
+  done.wait();
+
+  waiter.RethrowIfFailed();
+  if constexpr (!std::is_void_v<T>) {
+    return std::move(*result);
+  }
+}
+
+// Run all tasks concurrently: each one runs until it suspends, before next one
+// is started. Awaiting coroutine is resumed once the last of them completes,
+// and gets their results in the same order as tasks
+template <typename T>
+Task<std::vector<T>> WhenAll(std::vector<Task<T>> tasks) {
+  struct Awaiter {
+    explicit Awaiter(std::vector<detail::DetachedTask> &waiters)
+        : waiters(waiters), remaining(0) {}
+
+    bool await_ready() noexcept { return waiters.empty(); }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+      awaiting = handle;
+      // One more, so that tasks completing while they are started don't
+      // resume awaiting coroutine before all of them are started
+      remaining.store(waiters.size() + 1, std::memory_order_relaxed);
+      for (auto &waiter : waiters) {
+        waiter.Start(
+            [](void *context) noexcept -> std::coroutine_handle<> {
+              auto *self = static_cast<Awaiter *>(context);
+              return self->OnDone();
+            },
+            this);
+      }
+
+      // Keep running inline if every task has completed already
+      return remaining.fetch_sub(1, std::memory_order_acq_rel) != 1;
+    }
+
+    void await_resume() noexcept {}
+
+    std::coroutine_handle<> OnDone() noexcept {
+      if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        return awaiting;
+      }
+      return std::noop_coroutine();
+    }
+
+    std::vector<detail::DetachedTask> &waiters;
+
+    std::atomic<size_t> remaining;
+
+    std::coroutine_handle<> awaiting;
+  };
+
+  std::vector<std::optional<T>> results(tasks.size());
+  std::vector<detail::DetachedTask> waiters;
+  waiters.reserve(tasks.size());
+  for (size_t i = 0; i < tasks.size(); i++) {
+    waiters.push_back(detail::AwaitAndStore(tasks[i], &results[i]));
+  }
+
+  co_await Awaiter(waiters);
+
+  std::vector<T> values;
+  values.reserve(results.size());
+  for (size_t i = 0; i < results.size(); i++) {
+    waiters[i].RethrowIfFailed();
+    values.push_back(std::move(*results[i]));
+  }
+
+  co_return values;
+}
+
+} // namespace kvs
+
+#endif // COMMON_TASK_H
\ No newline at end of file
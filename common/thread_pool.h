@@ -1,11 +1,18 @@
 #ifndef COMMON_THREAD_POOL_H
 #define COMMON_THREAD_POOL_H
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <future>
+#include <memory>
 #include <mutex>
-#include <queue>
+#include <stdexcept>
+#include <thread>
 #include <vector>
 
 namespace {
@@ -16,10 +23,32 @@ constexpr unsigned int kDefaultNumThreadsInThreadPool = 8;
 
 namespace kvs {
 
+// Jobs of higher priority(lower value) are always picked first
+enum class TaskPriority {
+  // Flushes, and work that a foreground request is waiting for
+  kHigh = 0,
+  kL0Compaction,
+  // Compactions of deeper levels
+  kCompaction,
+  // Housekeeping, e.g. removing obsolete versions
+  kLow
+};
+
+/*
+Each worker owns a deque of jobs per priority. Jobs scheduled by a worker go to
+its own deques, other jobs are spread round robin. A worker takes jobs from
+the front of its own deques, and steals from the back of other workers' deques
+once its own are empty. Before going down to next priority, all deques of a
+priority are checked, so that a flush never waits behind compaction subtasks.
+
+Long-running loops don't occupy workers, they are run by service threads
+(see StartService).
+*/
 class ThreadPool {
 public:
   inline explicit ThreadPool(int num_threads);
 
+  // Shutdown() if it hasn't been done yet
   inline ~ThreadPool();
 
   // No copy allowed
@@ -30,79 +59,254 @@ public:
   ThreadPool(ThreadPool &&) = delete;
   ThreadPool &operator=(ThreadPool &&) = delete;
 
+  // Stop taking jobs from outside of pool, finish remaining jobs(and the ones
+  // they schedule), then join service threads. Services MUST have been told to
+  // stop by their owner
+  inline void Shutdown();
+
+  // Fire and forget, no future is created
+  inline void Schedule(TaskPriority priority, std::function<void()> job) const;
+
+  // Return future of result of functor(args...)
   template <typename Functor, typename... Args>
-  inline decltype(auto) Enqueue(Functor &&functor, Args &&...args) const;
+  inline decltype(auto) Enqueue(TaskPriority priority, Functor &&functor,
+                                Args &&...args) const;
+
+  // Run queued jobs on calling worker until done() returns true, so that a job
+  // waiting for its subtasks never holds a worker idle. Calling thread only
+  // polls done() if it isn't a worker of this pool
+  inline void RunPendingJobsUntil(const std::function<bool()> &done) const;
+
+  // Run service on a dedicated thread, until it returns
+  inline void StartService(std::function<void()> service) const;
+
+  // Only first max_active_threads workers take jobs, others sleep until limit
+  // is raised again. Limit is clamped to [1, number of workers]
+  inline void SetMaxActiveThreads(unsigned int max_active_threads) const;
+
+  inline unsigned int GetMaxActiveThreads() const;
+
+  inline unsigned int GetTotalThreads() const;
+
+  // True once Shutdown() has started, new jobs can only come from workers
+  inline bool IsShutdown() const;
 
 private:
-  mutable std::condition_variable cv_;
+  static constexpr int kTotalPriorities =
+      static_cast<int>(TaskPriority::kLow) + 1;
 
-  mutable std::mutex mutex_;
+  struct WorkerQueue {
+    std::mutex mutex;
+
+    std::array<std::deque<std::function<void()>>, kTotalPriorities> jobs;
+  };
+
+  inline void WorkerLoop(size_t index);
+
+  // Take next job for worker at index, own jobs first then stolen ones
+  inline bool TryPop(size_t index, std::function<void()> *job) const;
+
+  // Worker(if any) of this pool that calling thread is
+  static inline thread_local const ThreadPool *current_pool_ = nullptr;
+
+  static inline thread_local size_t current_index_ = 0;
 
   unsigned int num_threads_;
 
-  std::atomic<bool> shutdown_;
+  mutable std::atomic<unsigned int> max_active_threads_;
+
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
+
+  // Number of jobs scheduled and not taken yet. Increased under mutex_, so
+  // that idle workers never miss it
+  mutable std::atomic<int64_t> pending_jobs_;
 
-  mutable std::queue<std::function<void()>> jobs_;
+  // Next queue of a job scheduled from outside of pool
+  mutable std::atomic<uint64_t> next_queue_;
+
+  // Idle workers wait on it
+  mutable std::condition_variable cv_;
+
+  mutable std::mutex mutex_;
+
+  std::atomic<bool> shutdown_;
 
   std::vector<std::thread> workers_;
+
+  mutable std::vector<std::thread> services_;
+
+  mutable std::mutex services_mutex_;
 };
 
 ThreadPool::ThreadPool(int num_threads)
-    : num_threads_(num_threads), shutdown_(false) {
-  for (int i = 0; i < num_threads_; i++) {
-    workers_.emplace_back([this]() {
-      while (!shutdown_) {
-        std::function<void()> job;
-        {
-          std::unique_lock lock(mutex_);
-          cv_.wait(lock, [this]() {
-            return this->shutdown_ || !this->jobs_.empty();
-          });
-
-          if (this->shutdown_ && this->jobs_.empty()) {
-            return;
-          }
-
-          job = std::move(jobs_.front());
-          jobs_.pop();
-        }
-        job();
-      }
-    });
+    : num_threads_(num_threads > 0 ? num_threads
+                                   : kDefaultNumThreadsInThreadPool),
+      max_active_threads_(num_threads_), pending_jobs_(0), next_queue_(0),
+      shutdown_(false) {
+  for (unsigned int i = 0; i < num_threads_; i++) {
+    queues_.push_back(std::make_unique<WorkerQueue>());
+  }
+
+  for (unsigned int i = 0; i < num_threads_; i++) {
+    workers_.emplace_back(&ThreadPool::WorkerLoop, this, i);
   }
 }
 
-ThreadPool::~ThreadPool() {
-  shutdown_ = true;
+ThreadPool::~ThreadPool() { Shutdown(); }
+
+void ThreadPool::Shutdown() {
+  {
+    std::scoped_lock lock(mutex_);
+    shutdown_ = true;
+  }
 
   // Finish remaining jobs
   cv_.notify_all();
 
-  for (int i = 0; i < num_threads_; i++) {
-    workers_[i].join();
+  for (auto &worker : workers_) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+
+  std::scoped_lock lock(services_mutex_);
+  for (auto &service : services_) {
+    if (service.joinable()) {
+      service.join();
+    }
+  }
+}
+
+void ThreadPool::Schedule(TaskPriority priority,
+                          std::function<void()> job) const {
+  // A job being finished on shutdown may still schedule its follow-ups
+  if (shutdown_.load() && current_pool_ != this) {
+    throw std::runtime_error(
+        "Couldn't ask new task because threadpool was shut down");
+  }
+
+  // Jobs from outside go to active workers only
+  const size_t index = (current_pool_ == this)
+                           ? current_index_
+                           : next_queue_.fetch_add(1) % max_active_threads_;
+  {
+    std::scoped_lock lock(queues_[index]->mutex);
+    queues_[index]->jobs[static_cast<int>(priority)].push_back(std::move(job));
+  }
+
+  {
+    std::scoped_lock lock(mutex_);
+    pending_jobs_.fetch_add(1);
+  }
+
+  // An inactive worker that is woken up waits again without taking the job, so
+  // every worker is woken up while some of them are inactive
+  if (max_active_threads_.load() < num_threads_) {
+    cv_.notify_all();
+  } else {
+    cv_.notify_one();
   }
 }
 
 template <typename Functor, typename... Args>
-decltype(auto) ThreadPool::Enqueue(Functor &&functor, Args &&...args) const {
+decltype(auto) ThreadPool::Enqueue(TaskPriority priority, Functor &&functor,
+                                   Args &&...args) const {
   using ReturnType = std::invoke_result_t<Functor, Args...>;
   auto task = std::make_shared<std::packaged_task<ReturnType()>>(
       std::bind(std::forward<Functor>(functor), std::forward<Args>(args)...));
   std::future<ReturnType> result = task->get_future();
-  std::function<void()> job = [task]() { return (*task)(); };
 
-  if (shutdown_.load()) {
-    throw std::runtime_error(
-        "Couldn't ask new task because threadpool was shut down");
+  Schedule(priority, [task]() { (*task)(); });
+  return result;
+}
+
+void ThreadPool::RunPendingJobsUntil(
+    const std::function<bool()> &done) const {
+  while (!done()) {
+    std::function<void()> job;
+    if (current_pool_ == this && TryPop(current_index_, &job)) {
+      job();
+    } else {
+      // Jobs being waited for are running on other workers
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
   }
+}
+
+void ThreadPool::StartService(std::function<void()> service) const {
+  std::scoped_lock lock(services_mutex_);
+  services_.emplace_back(std::move(service));
+}
 
+void ThreadPool::SetMaxActiveThreads(unsigned int max_active_threads) const {
   {
     std::scoped_lock lock(mutex_);
-    jobs_.emplace(std::move(job));
+    max_active_threads_ = std::clamp(max_active_threads, 1U, num_threads_);
   }
 
-  cv_.notify_one();
-  return result;
+  cv_.notify_all();
+}
+
+unsigned int ThreadPool::GetMaxActiveThreads() const {
+  return max_active_threads_.load();
+}
+
+unsigned int ThreadPool::GetTotalThreads() const { return num_threads_; }
+
+bool ThreadPool::IsShutdown() const { return shutdown_.load(); }
+
+void ThreadPool::WorkerLoop(size_t index) {
+  current_pool_ = this;
+  current_index_ = index;
+
+  while (true) {
+    std::function<void()> job;
+    // Inactive workers still help to finish remaining jobs on shutdown
+    if ((index < max_active_threads_.load() || shutdown_) &&
+        TryPop(index, &job)) {
+      job();
+      continue;
+    }
+
+    std::unique_lock lock(mutex_);
+    cv_.wait(lock, [this, index]() {
+      return this->shutdown_ || (index < this->max_active_threads_.load() &&
+                                 this->pending_jobs_.load() > 0);
+    });
+
+    if (shutdown_ && pending_jobs_.load() == 0) {
+      return;
+    }
+  }
+}
+
+bool ThreadPool::TryPop(size_t index, std::function<void()> *job) const {
+  for (int priority = 0; priority < kTotalPriorities; priority++) {
+    for (unsigned int i = 0; i < num_threads_; i++) {
+      const size_t victim = (index + i) % num_threads_;
+      WorkerQueue &queue = *queues_[victim];
+
+      std::scoped_lock lock(queue.mutex);
+      auto &jobs = queue.jobs[priority];
+      if (jobs.empty()) {
+        continue;
+      }
+
+      if (victim == index) {
+        *job = std::move(jobs.front());
+        jobs.pop_front();
+      } else {
+        // Steal the newest job, owner keeps its oldest ones
+        *job = std::move(jobs.back());
+        jobs.pop_back();
+      }
+
+      pending_jobs_.fetch_sub(1);
+      return true;
+    }
+  }
+
+  return false;
 }
 
 } // namespace kvs
@@ -2,6 +2,7 @@
 #define DB_BASE_MEMTABLE_H
 
 #include "common/macros.h"
+#include "db/pinnable_value.h"
 #include "db/status.h"
 
 #include <optional>
@@ -28,6 +29,14 @@ public:
 
   virtual GetStatus Get(std::string_view key, TxnId txn_id) = 0;
 
+  virtual ValueType Get(std::string_view key, TxnId txn_id,
+                        PinnableValue *value) = 0;
+
+  // keys MUST be sorted in ascending order. Only keys whose status is still
+  // NOT_FOUND are looked up
+  virtual void MultiGet(std::span<const std::string_view> keys, TxnId txn_id,
+                        std::span<GetStatus> statuses) = 0;
+
   virtual void
   BatchPut(std::span<std::pair<std::string_view, std::string_view>> keys,
            TxnId txn_id) = 0;
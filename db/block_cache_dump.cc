@@ -0,0 +1,256 @@
+#include "db/block_cache_dump.h"
+
+#include "db/manifest.h"
+#include "db/version_edit.h"
+#include "io/linux_file.h"
+#include "io/prefetch_buffer.h"
+#include "sstable/block_reader.h"
+#include "sstable/block_reader_cache.h"
+#include "sstable/lru_block_item.h"
+#include "sstable/lru_table_item.h"
+#include "sstable/table_reader.h"
+#include "sstable/table_reader_cache.h"
+
+// libC++
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char kBlockCacheDumpMagic[] = "KVSBCDMP";
+
+constexpr size_t kMagicSize = 8;
+
+constexpr size_t kHeaderSize = kMagicSize + 2 * sizeof(uint32_t);
+
+constexpr size_t kEntrySize = 3 * sizeof(uint64_t);
+
+// Dump is written in chunks of that size
+constexpr size_t kDumpWriteBufferSize = 1024 * 1024; // 1MB
+
+// Number of blocks of a table read together, when blocks are dumped without
+// contents
+constexpr size_t kReloadBatchSize = 64;
+
+// Sanity bound of a dumped block, larger sizes are treated as corruption
+constexpr uint64_t kMaxDumpedBlockSize = 64 * 1024 * 1024; // 64MB
+
+template <typename T> void PutFixed(T value, kvs::DynamicBuffer *buffer) {
+  const kvs::Byte *const value_buff =
+      reinterpret_cast<const kvs::Byte *const>(&value);
+  buffer->insert(buffer->end(), value_buff, value_buff + sizeof(T));
+}
+
+template <typename T> T GetFixed(const kvs::Byte *data) {
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+bool WriteAll(kvs::io::AppendOnlyFile *file, kvs::DynamicBuffer *buffer) {
+  if (file->Append(*buffer) != static_cast<ssize_t>(buffer->size())) {
+    return false;
+  }
+
+  buffer->clear();
+  return true;
+}
+
+} // namespace
+
+namespace kvs {
+
+namespace db {
+
+bool DumpBlockCache(const sstable::BlockReaderCache *block_reader_cache,
+                    std::string_view path, bool with_contents) {
+  if (!block_reader_cache) {
+    return false;
+  }
+
+  const std::string temp_path = std::string(path) + ".tmp";
+  std::error_code error_code;
+  fs::remove(temp_path, error_code);
+
+  auto dump_object = std::make_unique<io::LinuxAppendOnlyFile>(temp_path);
+  if (!dump_object->Open()) {
+    return false;
+  }
+
+  DynamicBuffer buffer;
+  buffer.insert(buffer.end(), kBlockCacheDumpMagic,
+                kBlockCacheDumpMagic + kMagicSize);
+  PutFixed<uint32_t>(kBlockCacheDumpFormatVersion, &buffer);
+  PutFixed<uint32_t>(with_contents ? kBlockCacheDumpWithContents : 0, &buffer);
+
+  for (const auto &[block_info, lru_block_item] :
+       block_reader_cache->GetResidentBlocks()) {
+    std::span<const Byte> block = lru_block_item->GetBlockReader()->GetData();
+    PutFixed<uint64_t>(block_info.first, &buffer);
+    PutFixed<uint64_t>(block_info.second, &buffer);
+    PutFixed<uint64_t>(block.size(), &buffer);
+    if (with_contents) {
+      PutFixed<uint32_t>(Crc32c(block), &buffer);
+      buffer.insert(buffer.end(), block.begin(), block.end());
+    }
+
+    if (buffer.size() >= kDumpWriteBufferSize &&
+        !WriteAll(dump_object.get(), &buffer)) {
+      return false;
+    }
+  }
+
+  if (!WriteAll(dump_object.get(), &buffer) || !dump_object->Flush()) {
+    return false;
+  }
+  dump_object.reset();
+
+  fs::rename(temp_path, path, error_code);
+  return !error_code;
+}
+
+uint64_t LoadBlockCacheDump(
+    std::string_view path,
+    const std::unordered_map<SSTId, std::shared_ptr<SSTMetadata>> &live_tables,
+    const sstable::TableReaderCache *table_reader_cache,
+    const sstable::BlockReaderCache *block_reader_cache) {
+  std::error_code error_code;
+  const uint64_t dump_size = fs::file_size(path, error_code);
+  if (error_code || dump_size < kHeaderSize || !block_reader_cache) {
+    return 0;
+  }
+
+  auto dump_object = std::make_unique<io::LinuxReadOnlyFile>(path);
+  if (!dump_object->Open()) {
+    return 0;
+  }
+  dump_object->Hint(io::AccessPattern::kSequential);
+  io::PrefetchBuffer prefetch_buffer(io::kDefaultCompactionReadaheadSize,
+                                     io::kDefaultCompactionReadaheadSize);
+
+  Byte header[kHeaderSize];
+  if (!prefetch_buffer.Read(dump_object.get(), 0 /*offset*/, header) ||
+      std::memcmp(header, kBlockCacheDumpMagic, kMagicSize) != 0 ||
+      GetFixed<uint32_t>(header + kMagicSize) > kBlockCacheDumpFormatVersion) {
+    return 0;
+  }
+  const bool with_contents =
+      GetFixed<uint32_t>(header + kMagicSize + sizeof(uint32_t)) &
+      kBlockCacheDumpWithContents;
+
+  uint64_t total_loaded_blocks = 0;
+  // Blocks to read from each table, when contents aren't dumped
+  std::unordered_map<SSTId, std::vector<std::pair<BlockOffset, BlockSize>>>
+      blocks_to_read;
+
+  uint64_t offset = kHeaderSize;
+  Byte entry[kEntrySize + sizeof(uint32_t)];
+  const size_t entry_size = kEntrySize + (with_contents ? sizeof(uint32_t) : 0);
+  while (offset + entry_size <= dump_size) {
+    if (!prefetch_buffer.Read(dump_object.get(), offset,
+                              std::span<Byte>(entry, entry_size))) {
+      break;
+    }
+    offset += entry_size;
+
+    const SSTId table_id = GetFixed<uint64_t>(entry);
+    const BlockOffset block_offset =
+        GetFixed<uint64_t>(entry + sizeof(uint64_t));
+    const BlockSize block_size =
+        GetFixed<uint64_t>(entry + 2 * sizeof(uint64_t));
+    if (block_size == 0 || block_size > kMaxDumpedBlockSize) {
+      // Corrupted, nothing after it can be trusted
+      break;
+    }
+
+    if (!with_contents) {
+      if (live_tables.contains(table_id)) {
+        blocks_to_read[table_id].emplace_back(block_offset, block_size);
+      }
+      continue;
+    }
+
+    if (offset + block_size > dump_size) {
+      break;
+    }
+    const uint64_t block_offset_in_dump = offset;
+    offset += block_size;
+
+    // Table has been deleted since dump was written
+    if (!live_tables.contains(table_id) ||
+        block_reader_cache->Contains({table_id, block_offset})) {
+      continue;
+    }
+
+    auto block_reader_data =
+        std::make_unique<sstable::BlockReaderData>(block_size);
+    if (!prefetch_buffer.Read(dump_object.get(), block_offset_in_dump,
+                              block_reader_data->buffer)) {
+      break;
+    }
+
+    if (Crc32c(block_reader_data->buffer) !=
+        GetFixed<uint32_t>(entry + kEntrySize)) {
+      continue;
+    }
+
+    block_reader_cache->AddNewBlockReader(
+        {table_id, block_offset},
+        sstable::SetupDataForBlockReader(std::move(block_reader_data)));
+    total_loaded_blocks++;
+  }
+
+  for (auto &[table_id, blocks] : blocks_to_read) {
+    const std::shared_ptr<SSTMetadata> &sst = live_tables.at(table_id);
+    std::shared_ptr<sstable::LRUTableItem> lru_table_item =
+        table_reader_cache->GetLRUTableItem(table_id);
+    if (!lru_table_item &&
+        table_reader_cache->OpenTable(table_id, sst->file_size, sst->level)) {
+      lru_table_item = table_reader_cache->GetLRUTableItem(table_id);
+    }
+
+    if (!lru_table_item) {
+      continue;
+    }
+
+    // Blocks are read in file order
+    std::sort(blocks.begin(), blocks.end());
+    const sstable::TableReader *table_reader =
+        lru_table_item->GetTableReader();
+    std::vector<sstable::BlockToRead> batch;
+    for (size_t i = 0; i < blocks.size(); i += kReloadBatchSize) {
+      batch.clear();
+      for (size_t j = i; j < std::min(i + kReloadBatchSize, blocks.size());
+           j++) {
+        const auto [block_offset, block_size] = blocks[j];
+        if (block_offset + block_size <= sst->file_size &&
+            !block_reader_cache->Contains({table_id, block_offset})) {
+          batch.push_back({table_reader, block_offset, block_size});
+        }
+      }
+
+      std::vector<std::unique_ptr<sstable::BlockReader>> block_readers =
+          sstable::CreateAndSetupDataForBlockReaders(batch);
+      for (size_t j = 0; j < batch.size(); j++) {
+        if (block_readers[j]) {
+          block_reader_cache->AddNewBlockReader({table_id, batch[j].offset},
+                                                std::move(block_readers[j]));
+          total_loaded_blocks++;
+        }
+      }
+    }
+
+    lru_table_item->Unref();
+  }
+
+  return total_loaded_blocks;
+}
+
+} // namespace db
+
+} // namespace kvs
\ No newline at end of file
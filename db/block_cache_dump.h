@@ -0,0 +1,58 @@
+#ifndef DB_BLOCK_CACHE_DUMP_H
+#define DB_BLOCK_CACHE_DUMP_H
+
+#include "common/macros.h"
+
+// libC++
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+
+namespace kvs {
+
+namespace sstable {
+class BlockReaderCache;
+class TableReaderCache;
+} // namespace sstable
+
+namespace db {
+
+struct SSTMetadata;
+
+/*
+Dump of the data blocks that are in block cache, so that block cache can be
+filled again after a restart.
+
+  header : magic(8 bytes) | format version(4 bytes) | flags(4 bytes)
+  entry  : table id(8 bytes) | block offset(8 bytes) | block size(8 bytes)
+  entry with contents : entry | crc32c of block(4 bytes) | block
+
+Entries have contents only if kBlockCacheDumpWithContents is set in flags.
+Without contents, dump is small, and blocks are read again from their tables
+when it is loaded.
+*/
+constexpr uint32_t kBlockCacheDumpFormatVersion = 1;
+
+constexpr uint32_t kBlockCacheDumpWithContents = 1;
+
+// Write data blocks that are in block_reader_cache into file at path. Dump is
+// written aside then renamed, so that it is either complete or missing
+bool DumpBlockCache(const sstable::BlockReaderCache *block_reader_cache,
+                    std::string_view path, bool with_contents);
+
+// Add blocks of dump at path back into block_reader_cache. Blocks of tables
+// that aren't in live_tables(table id -> metadata) are skipped. Blocks that are
+// dumped without contents are read from their tables, in batches. Return
+// number of blocks added
+uint64_t LoadBlockCacheDump(
+    std::string_view path,
+    const std::unordered_map<SSTId, std::shared_ptr<SSTMetadata>> &live_tables,
+    const sstable::TableReaderCache *table_reader_cache,
+    const sstable::BlockReaderCache *block_reader_cache);
+
+} // namespace db
+
+} // namespace kvs
+
+#endif // DB_BLOCK_CACHE_DUMP_H
\ No newline at end of file
@@ -22,13 +22,13 @@ namespace kvs {
 
 namespace db {
 
-Compact::Compact(const std::vector<std::unique_ptr<sstable::BlockReaderCache>>
-                     &block_reader_cache,
+Compact::Compact(const sstable::BlockReaderCache *const block_reader_cache,
                  const sstable::TableReaderCache *const table_reader_cache,
                  const Version *version, VersionEdit *version_edit, DBImpl *db)
     : block_reader_cache_(block_reader_cache),
       table_reader_cache_(table_reader_cache), version_(version),
-      version_edit_(version_edit), db_(db) {
+      version_edit_(version_edit), db_(db), smallest_snapshot_(0),
+      has_current_key_(false), last_txn_id_for_key_(INVALID_TXN_ID) {
   assert(table_reader_cache_ && version_ && db_);
 }
 
@@ -199,8 +199,8 @@ std::unique_ptr<MergeIterator> Compact::CreateMergeIterator() {
       if (lru_table_item && lru_table_item->GetTableReader()) {
         // If table reader had already been in cache, just create table iterator
         table_reader_iterators.emplace_back(
-            std::make_unique<sstable::TableReaderIterator>(block_reader_cache_,
-                                                           lru_table_item));
+            std::make_unique<sstable::TableReaderIterator>(
+                block_reader_cache_, lru_table_item, true /*for_compaction*/));
         continue;
       }
 
@@ -208,13 +208,14 @@ std::unique_ptr<MergeIterator> Compact::CreateMergeIterator() {
       std::string filename = files_need_compaction_[level][i]->filename;
       uint64_t file_size = files_need_compaction_[level][i]->file_size;
       auto new_table_reader = sstable::CreateAndSetupDataForTableReader(
-          std::move(filename), table_id, file_size);
+          std::move(filename), table_id, file_size, false /*use_mmap*/,
+          block_reader_cache_, level_to_compact_ + level == 0 /*pin_index*/);
       if (!new_table_reader) {
         return nullptr;
       }
 
       auto new_lru_table_item = std::make_shared<sstable::LRUTableItem>(
-          table_id, std::move(new_table_reader), table_reader_cache_);
+          table_id, std::move(new_table_reader));
       std::shared_ptr<sstable::LRUTableItem> table_reader_inserted =
           table_reader_cache_->AddNewTableReaderThenGet(
               table_id, new_lru_table_item, true /*add_then_get*/);
@@ -222,7 +223,8 @@ std::unique_ptr<MergeIterator> Compact::CreateMergeIterator() {
       // create iterator for new table
       table_reader_iterators.emplace_back(
           std::make_unique<sstable::TableReaderIterator>(
-              block_reader_cache_, table_reader_inserted));
+              block_reader_cache_, table_reader_inserted,
+              true /*for_compaction*/));
     }
   }
 
@@ -247,9 +249,8 @@ bool Compact::DoCompactJob() {
     return false;
   }
 
-  std::string_view last_current_key = std::string_view{};
-  TxnId last_txn_id = INVALID_TXN_ID;
-  db::ValueType last_type = db::ValueType::NOT_FOUND;
+  // Versions that live snapshots may still read must survive compaction
+  smallest_snapshot_ = db_->GetSmallestSnapshot();
 
   for (iterator->SeekToFirst(); iterator->IsValid(); iterator->Next()) {
     std::string_view key = iterator->GetKey();
@@ -261,17 +262,27 @@ bool Compact::DoCompactJob() {
            txn_id != INVALID_TXN_ID);
 
     // Filter
-    bool should_keep_entry =
-        ShouldKeepEntry(last_current_key, key, last_txn_id, txn_id, type);
-    if (last_current_key != key) {
-      // When a new key shows up, keep the first (newest) version.
-      last_current_key = key;
-      last_txn_id = txn_id;
-      last_type = type;
+    if (!ShouldKeepEntry(key, txn_id, type)) {
+      continue;
     }
 
-    if (!should_keep_entry) {
-      continue;
+    if (new_sst &&
+        new_sst->GetDataSize() >= db_->GetConfig()->GetPerMemTableSizeLimit() &&
+        new_sst->GetLargestKey() != key) {
+      // Only switch to new SST at key boundary, so that all versions of a key
+      // are in one SST and SSTs at level >= 1 never overlap
+      new_sst->Finish();
+      std::string filename =
+          db_->GetDBPath() + std::to_string(new_sst_id) + ".sst";
+      version_edit_->AddNewFiles(new_sst_id, 1 /*level*/,
+                                 new_sst->GetFileSize(),
+                                 new_sst->GetSmallestKey(),
+                                 new_sst->GetLargestKey(), std::move(filename),
+                                 new_sst->GetMinTxnId(),
+                                 new_sst->GetMaxTxnId());
+      // TableBuilder finishes it job. Free to prepare for another TableBuilder
+      // if need
+      new_sst.reset();
     }
 
     if (!new_sst) {
@@ -287,18 +298,6 @@ bool Compact::DoCompactJob() {
     }
 
     new_sst->AddEntry(key, value, txn_id, type);
-    if (new_sst->GetDataSize() >= db_->GetConfig()->GetPerMemTableSizeLimit()) {
-      new_sst->Finish();
-      std::string filename =
-          db_->GetDBPath() + std::to_string(new_sst_id) + ".sst";
-      version_edit_->AddNewFiles(new_sst_id, 1 /*level*/,
-                                 new_sst->GetFileSize(),
-                                 new_sst->GetSmallestKey(),
-                                 new_sst->GetLargestKey(), std::move(filename));
-      // TableBuilder finishes it job. Free to prepare for another TableBuilder
-      // if need
-      new_sst.reset();
-    }
   }
 
   if (new_sst) {
@@ -307,7 +306,8 @@ bool Compact::DoCompactJob() {
     filename = db_->GetDBPath() + std::to_string(new_sst_id) + ".sst";
     version_edit_->AddNewFiles(new_sst_id, 1 /*level*/, new_sst->GetFileSize(),
                                new_sst->GetSmallestKey(),
-                               new_sst->GetLargestKey(), std::move(filename));
+                               new_sst->GetLargestKey(), std::move(filename),
+                               new_sst->GetMinTxnId(), new_sst->GetMaxTxnId());
   }
 
   // All files that need to be compacted should be deleted after all
@@ -321,56 +321,46 @@ bool Compact::DoCompactJob() {
   return true;
 }
 
-bool Compact::ShouldKeepEntry(std::string_view last_current_key,
-                              std::string_view key, TxnId last_txn_id,
-                              TxnId txn_id, ValueType type) {
+bool Compact::ShouldKeepEntry(std::string_view key, TxnId txn_id,
+                              ValueType type) {
   // Logic to pick a key
-  // 1. If it is the first key of mergeIterator, keep
-  // 2. If there are multiple same keys, keep the one with highest Transaction
-  // Id
-  // 3. If key shows first time and type of key = DELETED
-  // 3.1 If this key still show up at higher level, it should be kept as
-  // tombstone
-  // 3.2 Else we can remove this key
-
-  if (last_current_key.empty()) {
-    // First key of mergeIterator
-    return true;
-  }
-
-  if (last_current_key != key) {
+  // 1. The first (newest) version of a key is kept
+  // 2. An older version is dropped if a newer version of the same key is
+  // visible to every reader(its txn_id <= smallest snapshot). Otherwise, some
+  // snapshot may still read it, so keep
+  // 3. A tombstone visible to every reader is dropped if no higher level
+  // contains the key. Otherwise, keep it to hide older versions at higher
+  // levels
+  if (!has_current_key_ || current_key_ != key) {
     // New key
-    if (type == db::ValueType::PUT) {
-      // just keep if type is PUT
-      return true;
-    } else if (type == db::ValueType::DELETED) {
-      if (!IsBaseLevelForKey(key)) {
-        // If this key exist at higher level, keep it as tombstone
-        return true;
-      } else {
-        return false;
-      }
-    }
+    current_key_ = std::string(key);
+    has_current_key_ = true;
+    last_txn_id_for_key_ = INVALID_TXN_ID;
   }
 
-  // Cases that meet duplicate key
-  if (last_txn_id > txn_id) {
-    // Only keep the one that have largest txn_id(or sequence number now)
-    return false;
+  bool should_keep = true;
+  if (last_txn_id_for_key_ != INVALID_TXN_ID &&
+      last_txn_id_for_key_ <= smallest_snapshot_) {
+    // Hidden by a newer version of the same key
+    should_keep = false;
+  } else if (type == db::ValueType::DELETED && txn_id <= smallest_snapshot_ &&
+             IsBaseLevelForKey(key)) {
+    should_keep = false;
   }
 
-  return true;
+  last_txn_id_for_key_ = txn_id;
+  return should_keep;
 }
 
 bool Compact::IsBaseLevelForKey(std::string_view key) {
-  const std::vector<std::vector<std::shared_ptr<SSTMetadata>>>
-      &list_sst_metadata = version_->GetImmutableSSTMetadata();
+  const std::vector<LevelFiles> &list_sst_metadata =
+      version_->GetImmutableSSTMetadata();
 
   for (int level = level_to_compact_ + 2;
        level < db_->GetConfig()->GetSSTNumLvels(); level++) {
     for (const auto &sst_metadata : list_sst_metadata[level]) {
       if (sst_metadata->smallest_key <= key &&
-          key <= sst_metadata->smallest_key) {
+          key <= sst_metadata->largest_key) {
         return false;
       }
     }
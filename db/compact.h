@@ -5,6 +5,7 @@
 #include "version_edit.h"
 
 #include <cstdint>
+#include <string>
 #include <string_view>
 #include <vector>
 
@@ -26,8 +27,7 @@ class DBImpl;
 // KEY RULE: Compact is only triggerd by LATEST version
 class Compact {
 public:
-  Compact(const std::vector<std::unique_ptr<sstable::BlockReaderCache>>
-              &block_reader_cache,
+  Compact(const sstable::BlockReaderCache *const block_reader_cache,
           const sstable::TableReaderCache *const table_reader_cache,
           const Version *version, VersionEdit *version_edit, DBImpl *db);
 
@@ -67,16 +67,15 @@ private:
   // Execute compaction based on compact info
   bool DoCompactJob();
 
-  // Decide that a key should be kept or skipped
-  bool ShouldKeepEntry(std::string_view last_current_key, std::string_view key,
-                       TxnId last_txn_id, TxnId txn_id, ValueType type);
+  // Decide that a key should be kept or skipped. Entries MUST be passed in
+  // (key asc, txn_id desc) order
+  bool ShouldKeepEntry(std::string_view key, TxnId txn_id, ValueType type);
 
   // Check that if there are higher level(from level_to_compact_+ 2) have key or
   // not
   bool IsBaseLevelForKey(std::string_view key);
 
-  const std::vector<std::unique_ptr<sstable::BlockReaderCache>>
-      &block_reader_cache_;
+  const sstable::BlockReaderCache *const block_reader_cache_;
 
   const sstable::TableReaderCache *const table_reader_cache_;
 
@@ -93,6 +92,18 @@ private:
   int level_to_compact_;
 
   VersionEdit *version_edit_;
+
+  // Versions hidden by a newer version whose txn_id <= smallest_snapshot_ are
+  // not visible to any reader, and can be dropped
+  TxnId smallest_snapshot_;
+
+  // Key of entry that ShouldKeepEntry() was last called with
+  std::string current_key_;
+
+  bool has_current_key_;
+
+  // txn_id of last entry of current_key_ that ShouldKeepEntry() was called with
+  TxnId last_txn_id_for_key_;
 };
 
 } // namespace db
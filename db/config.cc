@@ -19,6 +19,12 @@ constexpr int kDefaultSSTNumLevels = 7;
 
 constexpr int kDefaultTotalTablesInMem = 1000;
 
+constexpr double kDefaultHighPriorityPoolRatio = 0.1;
+
+constexpr uint64_t kDefaultMaxManifestFileSize = 64 * 1024 * 1024; // 64MB
+
+constexpr int kDefaultTotalFlushThreads = 2;
+
 } // namespace
 
 namespace kvs {
@@ -151,10 +157,15 @@ bool Config::LoadConfigFromPath() {
     return false;
   }
 
-  total_blocks_in_each_cache_ = static_cast<int>(
-      result["cache"]["TOTAL_BLOCKS_EACH_CACHE"].as_integer()->get());
-  if (total_blocks_in_each_cache_ <= 0) {
-    std::cout << "TOTAL_BLOCK_EACH_CACHE isn't valid(must be larger than 0)"
+  if (!result["cache"]["BLOCK_CACHE_SIZE"].as_integer()) {
+    std::cout << "BLOCK_CACHE_SIZE is not integer" << std::endl;
+    return false;
+  }
+
+  block_cache_size_ = static_cast<size_t>(
+      result["cache"]["BLOCK_CACHE_SIZE"].as_integer()->get());
+  if (result["cache"]["BLOCK_CACHE_SIZE"].as_integer()->get() <= 0) {
+    std::cout << "BLOCK_CACHE_SIZE isn't valid(must be larger than 0)"
               << std::endl;
     return false;
   }
@@ -171,6 +182,157 @@ bool Config::LoadConfigFromPath() {
     return false;
   }
 
+  // Optional
+  high_priority_pool_ratio_ = kDefaultHighPriorityPoolRatio;
+  if (result["cache"]["HIGH_PRIORITY_POOL_RATIO"]) {
+    if (!result["cache"]["HIGH_PRIORITY_POOL_RATIO"].as_floating_point()) {
+      std::cout << "HIGH_PRIORITY_POOL_RATIO is not floating point"
+                << std::endl;
+      return false;
+    }
+
+    high_priority_pool_ratio_ =
+        result["cache"]["HIGH_PRIORITY_POOL_RATIO"].as_floating_point()->get();
+    if (high_priority_pool_ratio_ < 0 || high_priority_pool_ratio_ >= 1) {
+      std::cout << "HIGH_PRIORITY_POOL_RATIO isn't valid(0-1)" << std::endl;
+      return false;
+    }
+  }
+
+  // Optional, secondary block cache is disabled by default
+  secondary_cache_path_.clear();
+  secondary_cache_size_ = 0;
+  if (result["cache"]["SECONDARY_CACHE_PATH"]) {
+    if (!result["cache"]["SECONDARY_CACHE_PATH"].as_string()) {
+      std::cout << "SECONDARY_CACHE_PATH is not string" << std::endl;
+      return false;
+    }
+
+    secondary_cache_path_ =
+        result["cache"]["SECONDARY_CACHE_PATH"].as_string()->get();
+  }
+
+  if (!secondary_cache_path_.empty()) {
+    if (!result["cache"]["SECONDARY_CACHE_SIZE"].as_integer()) {
+      std::cout << "SECONDARY_CACHE_SIZE is not integer" << std::endl;
+      return false;
+    }
+
+    if (result["cache"]["SECONDARY_CACHE_SIZE"].as_integer()->get() <= 0) {
+      std::cout << "SECONDARY_CACHE_SIZE isn't valid(must be larger than 0)"
+                << std::endl;
+      return false;
+    }
+    secondary_cache_size_ = static_cast<size_t>(
+        result["cache"]["SECONDARY_CACHE_SIZE"].as_integer()->get());
+
+    if (fs::path(secondary_cache_path_).is_relative()) {
+      secondary_cache_path_ =
+          (project_dir / secondary_cache_path_).string();
+    }
+  }
+
+  // Optional, row cache is disabled by default
+  row_cache_size_ = 0;
+  if (result["cache"]["ROW_CACHE_SIZE"]) {
+    if (!result["cache"]["ROW_CACHE_SIZE"].as_integer()) {
+      std::cout << "ROW_CACHE_SIZE is not integer" << std::endl;
+      return false;
+    }
+
+    if (result["cache"]["ROW_CACHE_SIZE"].as_integer()->get() < 0) {
+      std::cout << "ROW_CACHE_SIZE is not valid(>=0)" << std::endl;
+      return false;
+    }
+    row_cache_size_ = static_cast<size_t>(
+        result["cache"]["ROW_CACHE_SIZE"].as_integer()->get());
+  }
+
+  // Optional, tables are opened lazily by default
+  warm_open_tables_ = false;
+  if (result["cache"]["WARM_OPEN_TABLES"]) {
+    if (!result["cache"]["WARM_OPEN_TABLES"].as_boolean()) {
+      std::cout << "WARM_OPEN_TABLES is not boolean" << std::endl;
+      return false;
+    }
+    warm_open_tables_ = result["cache"]["WARM_OPEN_TABLES"].as_boolean()->get();
+  }
+
+  // Optional, block cache isn't dumped by default
+  dump_block_cache_on_close_ = false;
+  if (result["cache"]["DUMP_BLOCK_CACHE_ON_CLOSE"]) {
+    if (!result["cache"]["DUMP_BLOCK_CACHE_ON_CLOSE"].as_boolean()) {
+      std::cout << "DUMP_BLOCK_CACHE_ON_CLOSE is not boolean" << std::endl;
+      return false;
+    }
+    dump_block_cache_on_close_ =
+        result["cache"]["DUMP_BLOCK_CACHE_ON_CLOSE"].as_boolean()->get();
+  }
+
+  // Optional
+  dump_block_cache_contents_ = false;
+  if (result["cache"]["DUMP_BLOCK_CACHE_CONTENTS"]) {
+    if (!result["cache"]["DUMP_BLOCK_CACHE_CONTENTS"].as_boolean()) {
+      std::cout << "DUMP_BLOCK_CACHE_CONTENTS is not boolean" << std::endl;
+      return false;
+    }
+    dump_block_cache_contents_ =
+        result["cache"]["DUMP_BLOCK_CACHE_CONTENTS"].as_boolean()->get();
+  }
+
+  // Optional
+  max_manifest_file_size_ = kDefaultMaxManifestFileSize;
+  if (result["lsm"]["MAX_MANIFEST_FILE_SIZE"]) {
+    if (!result["lsm"]["MAX_MANIFEST_FILE_SIZE"].as_integer()) {
+      std::cout << "MAX_MANIFEST_FILE_SIZE is not integer" << std::endl;
+      return false;
+    }
+
+    if (result["lsm"]["MAX_MANIFEST_FILE_SIZE"].as_integer()->get() <= 0) {
+      std::cout << "MAX_MANIFEST_FILE_SIZE is not valid(>0)" << std::endl;
+      return false;
+    }
+    max_manifest_file_size_ = static_cast<uint64_t>(
+        result["lsm"]["MAX_MANIFEST_FILE_SIZE"].as_integer()->get());
+  }
+
+  // Optional
+  total_flush_threads_ = kDefaultTotalFlushThreads;
+  if (result["cache"]["TOTAL_FLUSH_THREADS"]) {
+    if (!result["cache"]["TOTAL_FLUSH_THREADS"].as_integer()) {
+      std::cout << "TOTAL_FLUSH_THREADS is not integer" << std::endl;
+      return false;
+    }
+
+    total_flush_threads_ = static_cast<int>(
+        result["cache"]["TOTAL_FLUSH_THREADS"].as_integer()->get());
+    if (total_flush_threads_ <= 0) {
+      std::cout << "TOTAL_FLUSH_THREADS is not valid(>=1)" << std::endl;
+      return false;
+    }
+  }
+
+  // Optional, every level is read through pread by default
+  mmap_read_levels_.assign(lsm_sst_num_levels_, false);
+  if (result["io"]["MMAP_READ_LEVELS"]) {
+    const toml::array *mmap_read_levels =
+        result["io"]["MMAP_READ_LEVELS"].as_array();
+    if (!mmap_read_levels) {
+      std::cout << "MMAP_READ_LEVELS is not array" << std::endl;
+      return false;
+    }
+
+    for (const auto &level : *mmap_read_levels) {
+      if (!level.is_integer() || level.as_integer()->get() < 0 ||
+          level.as_integer()->get() >= lsm_sst_num_levels_) {
+        std::cout << "MMAP_READ_LEVELS isn't valid(0-LSM_SST_NUM_LEVELS)"
+                  << std::endl;
+        return false;
+      }
+      mmap_read_levels_[level.as_integer()->get()] = true;
+    }
+  }
+
   return true;
 }
 
@@ -196,14 +358,45 @@ int Config::GetTotalBackGroundThreads() const {
   return total_background_threads_;
 }
 
+int Config::GetTotalFlushThreads() const { return total_flush_threads_; }
+
 int Config::GetTotalTablesCache() const { return total_tables_in_mem_; }
 
-int Config::GetTotalBlocksEachCache() const {
-  return total_blocks_in_each_cache_;
-}
+size_t Config::GetBlockCacheSize() const { return block_cache_size_; }
 
 int Config::GetTotalBlocksCache() const { return total_block_caches_; }
 
+double Config::GetHighPriorityPoolRatio() const {
+  return high_priority_pool_ratio_;
+}
+
+std::string Config::GetSecondaryCachePath() const {
+  return secondary_cache_path_;
+}
+
+size_t Config::GetSecondaryCacheSize() const { return secondary_cache_size_; }
+
+size_t Config::GetRowCacheSize() const { return row_cache_size_; }
+
+bool Config::IsWarmOpenEnabled() const { return warm_open_tables_; }
+
+bool Config::IsBlockCacheDumpedOnClose() const {
+  return dump_block_cache_on_close_;
+}
+
+bool Config::IsBlockCacheDumpedWithContents() const {
+  return dump_block_cache_contents_;
+}
+
+uint64_t Config::GetMaxManifestFileSize() const {
+  return max_manifest_file_size_;
+}
+
+bool Config::IsMmapReadEnabled(int level) const {
+  return 0 <= level && level < mmap_read_levels_.size() &&
+         mmap_read_levels_[level];
+}
+
 } // namespace db
 
 } // namespace kvs
\ No newline at end of file
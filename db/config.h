@@ -2,6 +2,7 @@
 #define DB_CONFIG_H
 
 #include <string>
+#include <vector>
 
 namespace kvs {
 
@@ -38,14 +39,49 @@ public:
 
   std::string GetSavedDataPath() const;
 
+  // Workers of background pool that runs compactions and housekeeping. Only
+  // part of them are active while compactions keep up
   int GetTotalBackGroundThreads() const;
 
+  // Workers dedicated to flushing memtables
+  int GetTotalFlushThreads() const;
+
   int GetTotalTablesCache() const;
 
-  int GetTotalBlocksEachCache() const;
+  // Capacity(in bytes) of block cache, shared by all of its shards
+  size_t GetBlockCacheSize() const;
 
   int GetTotalBlocksCache() const;
 
+  // Part of block cache capacity reserved for indexes of tables
+  double GetHighPriorityPoolRatio() const;
+
+  // File of secondary block cache. Empty if secondary cache is disabled
+  std::string GetSecondaryCachePath() const;
+
+  // Capacity(in bytes) of secondary block cache
+  size_t GetSecondaryCacheSize() const;
+
+  // Capacity(in bytes) of row cache. 0 if row cache is disabled
+  size_t GetRowCacheSize() const;
+
+  // Whether tables are opened in background when DB is loaded, instead of on
+  // their first lookup
+  bool IsWarmOpenEnabled() const;
+
+  // Whether blocks that are in block cache are dumped when DB is closed, so
+  // that they are loaded back when DB is loaded again
+  bool IsBlockCacheDumpedOnClose() const;
+
+  // Whether dump holds contents of blocks, instead of only where they are
+  bool IsBlockCacheDumpedWithContents() const;
+
+  // MANIFEST is rolled over to a new one once it grows above that size
+  uint64_t GetMaxManifestFileSize() const;
+
+  // Whether SSTs at level are read through mmap instead of pread
+  bool IsMmapReadEnabled(int level) const;
+
 private:
   bool LoadConfigFromPath();
 
@@ -63,12 +99,33 @@ private:
 
   int total_background_threads_;
 
+  int total_flush_threads_;
+
   int total_tables_in_mem_;
 
-  int total_blocks_in_each_cache_;
+  size_t block_cache_size_;
 
   int total_block_caches_;
 
+  double high_priority_pool_ratio_;
+
+  std::string secondary_cache_path_;
+
+  size_t secondary_cache_size_;
+
+  size_t row_cache_size_;
+
+  bool warm_open_tables_;
+
+  bool dump_block_cache_on_close_;
+
+  bool dump_block_cache_contents_;
+
+  uint64_t max_manifest_file_size_;
+
+  // Indexed by level
+  std::vector<bool> mmap_read_levels_;
+
   // For testing
   bool is_testing_;
   bool invalid_config_;
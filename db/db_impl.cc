@@ -1,31 +1,36 @@
 #include "db/db_impl.h"
 
 #include "common/base_iterator.h"
+#include "common/executor.h"
 #include "common/macros.h"
 #include "common/thread_pool.h"
+#include "db/block_cache_dump.h"
 #include "db/compact.h"
 #include "db/config.h"
+#include "db/manifest.h"
 #include "db/memtable.h"
 #include "db/memtable_iterator.h"
+#include "db/row_cache.h"
 #include "db/skiplist.h"
 #include "db/skiplist_iterator.h"
 #include "db/status.h"
+#include "db/super_version.h"
 #include "db/version.h"
 #include "db/version_edit.h"
 #include "db/version_manager.h"
 #include "io/base_file.h"
+#include "io/io_completion_queue.h"
 #include "io/linux_file.h"
 #include "mvcc/transaction.h"
 #include "mvcc/transaction_manager.h"
 #include "rapidjson/document.h"
 #include "rapidjson/filereadstream.h"
-#include "rapidjson/stringbuffer.h"
-#include "rapidjson/writer.h"
 #include "sstable/block_builder.h"
 #include "sstable/block_reader.h"
 #include "sstable/block_reader_cache.h"
 #include "sstable/lru_block_item.h"
 #include "sstable/lru_table_item.h"
+#include "sstable/secondary_block_cache.h"
 #include "sstable/table_builder.h"
 #include "sstable/table_reader.h"
 #include "sstable/table_reader_cache.h"
@@ -33,18 +38,115 @@
 // libC++
 #include <algorithm>
 #include <cassert>
+#include <charconv>
 #include <cmath>
 #include <filesystem>
 #include <fstream>
 #include <numeric>
 #include <ranges>
+#include <utility>
 
 namespace fs = std::filesystem;
 
 namespace {
 constexpr std::string kManifestFileName = "MANIFEST";
 
+constexpr std::string kCurrentFileName = "CURRENT";
+
+constexpr char kBlockCacheDumpFileName[] = "BLOCK_CACHE_DUMP";
+
 constexpr int kDefaultParseManifestBufferSize = 8192; // 8KB buffer
+
+// Upper bound of total key/value bytes that a write group leader commits on
+// behalf of followers
+constexpr size_t kMaxWriteGroupBytes = 1 << 20; // 1MB
+
+// Release reference that a read holds on super version while it is suspended
+struct SuperVersionUnref {
+  void operator()(const kvs::db::SuperVersion *super_version) const {
+    super_version->Unref();
+  }
+};
+
+using SuperVersionRef =
+    std::unique_ptr<const kvs::db::SuperVersion, SuperVersionUnref>;
+
+// Look up key in memtables of super_version, newest first
+kvs::db::ValueType
+GetFromMemTables(const kvs::db::SuperVersion *super_version,
+                 std::string_view key, kvs::TxnId snapshot,
+                 kvs::db::PinnableValue *value) {
+  using kvs::db::ValueType;
+
+  ValueType type = super_version->GetMemTable()->Get(key, snapshot, value);
+  if (type == ValueType::PUT || type == ValueType::DELETED) {
+    return type;
+  }
+
+  // If key is not found, continue finding from immutable memtables
+  for (const auto &immu_memtable :
+       super_version->GetImmutableMemTables() | std::views::reverse) {
+    type = immu_memtable->Get(key, snapshot, value);
+    if (type == ValueType::PUT || type == ValueType::DELETED) {
+      return type;
+    }
+  }
+
+  return type;
+}
+
+bool HasPendingKeys(std::span<const kvs::db::GetStatus> statuses) {
+  return std::any_of(statuses.begin(), statuses.end(),
+                     [](const kvs::db::GetStatus &status) {
+                       return status.type == kvs::db::ValueType::NOT_FOUND;
+                     });
+}
+
+// Look up sorted keys in memtables of super_version, newest first
+void MultiGetFromMemTables(const kvs::db::SuperVersion *super_version,
+                           std::span<const std::string_view> sorted_keys,
+                           kvs::TxnId snapshot,
+                           std::span<kvs::db::GetStatus> sorted_statuses) {
+  super_version->GetMemTable()->MultiGet(sorted_keys, snapshot,
+                                         sorted_statuses);
+
+  // Keys that are not found continue to be looked up in immutable memtables
+  for (const auto &immu_memtable :
+       super_version->GetImmutableMemTables() | std::views::reverse) {
+    if (!HasPendingKeys(sorted_statuses)) {
+      break;
+    }
+    immu_memtable->MultiGet(sorted_keys, snapshot, sorted_statuses);
+  }
+}
+
+// Sort keys, so that each layer can serve whole batch in one ordered pass
+std::vector<std::string_view>
+SortKeys(std::span<const std::string_view> keys) {
+  std::vector<std::string_view> sorted_keys(keys.begin(), keys.end());
+  std::sort(sorted_keys.begin(), sorted_keys.end());
+  sorted_keys.erase(std::unique(sorted_keys.begin(), sorted_keys.end()),
+                    sorted_keys.end());
+
+  return sorted_keys;
+}
+
+// Return statuses in order of keys given by caller
+std::vector<kvs::db::GetStatus>
+RestoreOrder(std::span<const std::string_view> keys,
+             std::span<const std::string_view> sorted_keys,
+             std::span<const kvs::db::GetStatus> sorted_statuses) {
+  std::vector<kvs::db::GetStatus> statuses;
+  statuses.reserve(keys.size());
+  for (std::string_view key : keys) {
+    auto iterator =
+        std::lower_bound(sorted_keys.begin(), sorted_keys.end(), key);
+    statuses.push_back(sorted_statuses[iterator - sorted_keys.begin()]);
+  }
+
+  return statuses;
+}
+
 } // namespace
 
 namespace kvs {
@@ -53,33 +155,74 @@ namespace db {
 
 DBImpl::DBImpl(bool is_testing)
     : next_sstable_id_(1), memtable_version_(1), sequence_number_(0),
-      memtable_(std::make_unique<MemTable>(memtable_version_)),
+      last_visible_sequence_(0),
+      memtable_(std::make_shared<MemTable>(memtable_version_)),
       txn_manager_(std::make_unique<mvcc::TransactionManager>(this)),
       config_(std::make_unique<Config>(is_testing)),
       background_compaction_scheduled_(false),
       thread_pool_(std::make_unique<kvs::ThreadPool>(
           config_->GetTotalBackGroundThreads())),
-      table_reader_cache_(std::make_unique<sstable::TableReaderCache>(
-          this, thread_pool_.get())),
-      block_cache_thread_pool_(
-          std::make_unique<kvs::ThreadPool>(config_->GetTotalBlocksCache())),
+      flush_thread_pool_(
+          std::make_unique<kvs::ThreadPool>(config_->GetTotalFlushThreads())),
+      read_thread_pool_(std::make_unique<kvs::ThreadPool>(
+          static_cast<int>(std::thread::hardware_concurrency()))),
+      table_reader_cache_(std::make_unique<sstable::TableReaderCache>(this)),
+      block_reader_cache_(
+          (config_->GetTotalBlocksCache() > 0)
+              ? std::make_unique<sstable::BlockReaderCache>(
+                    config_->GetBlockCacheSize(),
+                    config_->GetTotalBlocksCache(),
+                    config_->GetSSTBlockSize(),
+                    config_->GetHighPriorityPoolRatio(),
+                    config_->GetSecondaryCachePath().empty()
+                        ? nullptr
+                        : sstable::CreateSecondaryBlockCache(
+                              config_->GetSecondaryCachePath(),
+                              config_->GetSecondaryCacheSize()))
+              : nullptr),
+      row_cache_(config_->GetRowCacheSize() > 0
+                     ? std::make_unique<RowCache>(config_->GetRowCacheSize())
+                     : nullptr),
       version_manager_(
-          std::make_unique<VersionManager>(this, thread_pool_.get())) {
-  for (int i = 0; i < config_->GetTotalBlocksCache(); i++) {
-    block_reader_cache_.emplace_back(
-        std::make_unique<sstable::BlockReaderCache>(
-            config_->GetTotalBlocksCache(), block_cache_thread_pool_.get()));
+          std::make_unique<VersionManager>(this, thread_pool_.get())),
+      super_version_cache_(std::make_unique<SuperVersionCache>()),
+      executor_(std::make_shared<InlineExecutor>()),
+      io_queue_(std::make_unique<io::IoCompletionQueue>()),
+      manifest_number_(0), manifest_size_(0), total_warm_opened_tables_(0),
+      total_warm_open_tables_(0) {
+  {
+    std::scoped_lock lock(mutex_);
+    InstallSuperVersion();
   }
 
-  thread_pool_->Enqueue(&DBImpl::CleanupTrashFiles, this);
+  thread_pool_->StartService([this]() { CleanupTrashFiles(); });
 }
 
 DBImpl::~DBImpl() {
-  block_reader_cache_.clear();
-  table_reader_cache_.reset();
+  // In-flight flushes install new versions and super versions
+  flush_thread_pool_->Shutdown();
+
+  // Warm open and reload jobs use caches
+  WaitForWarmOpen();
+  WaitForBlockCacheReload();
+
+  if (!db_path_.empty() && config_->IsBlockCacheDumpedOnClose()) {
+    DumpBlockCache(config_->IsBlockCacheDumpedWithContents());
+  }
 
   shutdown_ = true;
   trash_files_cv_.notify_one();
+
+  // Running compaction finishes, it may still install a super version
+  thread_pool_->Shutdown();
+
+  // Versions cached by reads are released, then obsolete versions and files
+  // are reclaimed on this thread now that background threads are gone
+  super_version_cache_.reset();
+  version_manager_->ReclaimObsoleteVersions();
+
+  block_reader_cache_.reset();
+  table_reader_cache_.reset();
 }
 
 bool DBImpl::LoadDB(std::string_view dbname) {
@@ -92,31 +235,286 @@ bool DBImpl::LoadDB(std::string_view dbname) {
     }
   }
 
-  // Load MANIFEST
-  std::string manifest_path = db_path_ + kManifestFileName;
-  manifest_write_object_ =
-      std::make_unique<io::LinuxAppendOnlyFile>(manifest_path);
-  if (!manifest_write_object_->Open()) {
-    return false;
-  }
-
   // Recover
-  std::unique_ptr<VersionEdit> version_edit = Recover(manifest_path);
+  std::unique_ptr<VersionEdit> version_edit = Recover();
   if (!version_edit) {
     return false;
   }
 
   // Apply version edit to create new version
   version_manager_->ApplyNewChanges(std::move(version_edit));
+  {
+    std::scoped_lock lock(mutex_);
+    InstallSuperVersion();
+  }
+
+  if (config_->IsWarmOpenEnabled()) {
+    WarmOpenTables();
+  }
+
+  if (block_reader_cache_ && fs::exists(db_path_ + kBlockCacheDumpFileName)) {
+    ReloadBlockCache();
+  }
 
   return true;
 }
 
-std::unique_ptr<VersionEdit> DBImpl::Recover(std::string_view manifest_path) {
-  if (manifest_path.empty()) {
+void DBImpl::WarmOpenTables() {
+  // Tables stay alive until the last one is opened, even if a compaction
+  // deletes them meanwhile
+  const Version *version = version_manager_->AcquireLatestVersion();
+
+  std::vector<std::shared_ptr<SSTMetadata>> tables;
+  const size_t max_tables = config_->GetTotalTablesCache();
+  for (const auto &level_tables : version->GetImmutableSSTMetadata()) {
+    for (const auto &sst : level_tables) {
+      if (tables.size() == max_tables) {
+        break;
+      }
+      tables.push_back(sst);
+    }
+  }
+
+  total_warm_open_tables_ = tables.size();
+  warm_open_done_ = std::make_unique<std::latch>(tables.size());
+  if (tables.empty()) {
+    version->DecreaseRefCount();
+    return;
+  }
+
+  for (auto &sst : tables) {
+    thread_pool_->Schedule(TaskPriority::kLow, [this, version,
+                                                sst = std::move(sst)]() {
+      if (!table_reader_cache_->OpenTable(sst->table_id, sst->file_size,
+                                          sst->level)) {
+        // Table is opened again on its first lookup
+        std::cerr << "Can't open " << sst->filename << std::endl;
+      }
+
+      if (total_warm_opened_tables_.fetch_add(1) + 1 ==
+          total_warm_open_tables_) {
+        version->DecreaseRefCount();
+      }
+      warm_open_done_->count_down();
+    });
+  }
+}
+
+void DBImpl::WaitForWarmOpen() const {
+  if (warm_open_done_) {
+    warm_open_done_->wait();
+  }
+}
+
+std::pair<uint64_t, uint64_t> DBImpl::GetWarmOpenProgress() const {
+  return {total_warm_opened_tables_.load(), total_warm_open_tables_};
+}
+
+void DBImpl::ReloadBlockCache() {
+  // Tables stay alive until dump is loaded
+  const Version *version = version_manager_->AcquireLatestVersion();
+
+  // Blocks of tables that have been deleted since dump was written are skipped
+  std::unordered_map<SSTId, std::shared_ptr<SSTMetadata>> live_tables;
+  for (const auto &level_tables : version->GetImmutableSSTMetadata()) {
+    for (const auto &sst : level_tables) {
+      live_tables.insert({sst->table_id, sst});
+    }
+  }
+
+  auto reload_job = [this, version, live_tables = std::move(live_tables)]() {
+    const std::string dump_path = db_path_ + kBlockCacheDumpFileName;
+    uint64_t total_loaded_blocks =
+        LoadBlockCacheDump(dump_path, live_tables, table_reader_cache_.get(),
+                           block_reader_cache_.get());
+    version->DecreaseRefCount();
+
+    // Dump is only valid right after the DB that wrote it is closed
+    std::error_code error_code;
+    fs::remove(dump_path, error_code);
+
+    return total_loaded_blocks;
+  };
+  block_cache_reload_ =
+      thread_pool_->Enqueue(TaskPriority::kLow, std::move(reload_job)).share();
+}
+
+bool DBImpl::DumpBlockCache(bool with_contents) const {
+  return db::DumpBlockCache(block_reader_cache_.get(),
+                            db_path_ + kBlockCacheDumpFileName, with_contents);
+}
+
+uint64_t DBImpl::WaitForBlockCacheReload() const {
+  return block_cache_reload_.valid() ? block_cache_reload_.get() : 0;
+}
+
+std::unique_ptr<VersionEdit> DBImpl::Recover() {
+  const std::string current_path = db_path_ + kCurrentFileName;
+  if (fs::exists(current_path)) {
+    std::ifstream current_file(current_path);
+    std::string manifest_name;
+    std::getline(current_file, manifest_name);
+
+    const std::string prefix = kManifestFileName + "-";
+    const char *number_end = manifest_name.data() + manifest_name.size();
+    if (!manifest_name.starts_with(prefix) ||
+        std::from_chars(manifest_name.data() + prefix.size(), number_end,
+                        manifest_number_)
+                .ptr != number_end) {
+      std::cerr << "CURRENT is corrupted" << std::endl;
+      return nullptr;
+    }
+    manifest_path_ = db_path_ + manifest_name;
+
+    std::unique_ptr<VersionEdit> version_edit =
+        RecoverFromManifest(manifest_path_);
+    if (!version_edit) {
+      return nullptr;
+    }
+    RemoveObsoleteManifests();
+
+    // Keep appending to recovered MANIFEST
+    manifest_write_object_ =
+        std::make_unique<io::LinuxAppendOnlyFile>(manifest_path_);
+    if (!manifest_write_object_->Open()) {
+      return nullptr;
+    }
+    manifest_size_ = fs::file_size(manifest_path_);
+
+    return version_edit;
+  }
+
+  std::unique_ptr<VersionEdit> version_edit;
+  const std::string legacy_manifest_path = db_path_ + kManifestFileName;
+  if (fs::exists(legacy_manifest_path)) {
+    manifest_path_ = legacy_manifest_path;
+  }
+
+  if (!manifest_path_.empty() && fs::file_size(manifest_path_) > 0) {
+    version_edit = RecoverFromManifest(manifest_path_);
+  } else {
+    // New DB
+    version_edit = std::make_unique<VersionEdit>(config_->GetSSTNumLvels());
+  }
+
+  if (!version_edit) {
+    return nullptr;
+  }
+
+  std::vector<std::shared_ptr<SSTMetadata>> live_files;
+  for (const auto &files : version_edit->GetImmutableNewFiles()) {
+    live_files.insert(live_files.end(), files.begin(), files.end());
+  }
+  if (!CreateManifest(live_files)) {
+    return nullptr;
+  }
+
+  return version_edit;
+}
+
+std::unique_ptr<VersionEdit>
+DBImpl::RecoverFromManifest(std::string_view manifest_path) {
+  // Whole MANIFEST is read at once, it is replayed from memory
+  const uint64_t manifest_size = fs::file_size(manifest_path);
+  auto manifest_read_object =
+      std::make_unique<io::LinuxReadOnlyFile>(manifest_path);
+  if (!manifest_read_object->Open()) {
     return nullptr;
   }
+  manifest_read_object->Hint(io::AccessPattern::kSequential);
+
+  DynamicBuffer data(manifest_size);
+  uint64_t offset = 0;
+  while (offset < manifest_size) {
+    ssize_t bytes_read = manifest_read_object->RandomRead(
+        std::span<Byte>(data).subspan(offset), offset);
+    if (bytes_read <= 0) {
+      return nullptr;
+    }
+    offset += bytes_read;
+  }
+  manifest_read_object.reset();
+
+  std::optional<uint32_t> format_version = DecodeManifestHeader(data);
+  if (format_version) {
+    if (*format_version > kManifestFormatVersion) {
+      std::cerr << "MANIFEST format version " << *format_version
+                << " isn't supported" << std::endl;
+      return nullptr;
+    }
+
+    return RecoverFromBinaryManifest(manifest_path, data);
+  }
+
+  // MANIFEST written as JSON records by older versions
+  return RecoverFromJsonManifest(manifest_path);
+}
+
+std::unique_ptr<VersionEdit>
+DBImpl::RecoverFromBinaryManifest(std::string_view manifest_path,
+                                  std::span<const Byte> data) {
+  const int num_levels = config_->GetSSTNumLvels();
+  auto version_edit = std::make_unique<VersionEdit>(num_levels);
+
+  // Tables that are added then deleted by later records are filtered out, the
+  // same as RecoverFromJsonManifest does
+  std::unordered_map<SSTId, std::shared_ptr<SSTMetadata>> filter_add_files;
+
+  uint64_t offset = kManifestHeaderSize;
+  while (true) {
+    VersionEdit record(num_levels);
+    ManifestReadStatus status =
+        ReadManifestRecord(data, &offset, db_path_, &record);
+    if (status == ManifestReadStatus::kEndOfFile) {
+      break;
+    }
+
+    if (status == ManifestReadStatus::kTruncated) {
+      // Drop torn record, so that next records are appended right after the
+      // last valid one
+      std::error_code error_code;
+      fs::resize_file(manifest_path, offset, error_code);
+      if (error_code) {
+        return nullptr;
+      }
+      break;
+    }
+
+    if (status == ManifestReadStatus::kCorruption) {
+      std::cerr << "MANIFEST is corrupted at offset " << offset << std::endl;
+      return nullptr;
+    }
+
+    if (record.GetNextTableId() > next_sstable_id_) {
+      next_sstable_id_ = record.GetNextTableId();
+    }
+
+    if (record.GetSequenceNumber() > sequence_number_) {
+      sequence_number_ = record.GetSequenceNumber();
+      last_visible_sequence_ = sequence_number_.load();
+    }
+
+    for (const auto &new_files : record.GetImmutableNewFiles()) {
+      for (const auto &new_file : new_files) {
+        filter_add_files.insert({new_file->table_id, new_file});
+      }
+    }
+
+    for (const auto &[table_id, level] : record.GetImmutableDeletedFiles()) {
+      filter_add_files.erase(table_id);
+      version_edit->RemoveFiles(table_id, level);
+    }
+  }
+
+  for (const auto &sst_metadata : filter_add_files) {
+    version_edit->AddNewFiles(sst_metadata.second);
+  }
+
+  return version_edit;
+}
 
+std::unique_ptr<VersionEdit>
+DBImpl::RecoverFromJsonManifest(std::string_view manifest_path) {
   FILE *fp = fopen(manifest_path.data(), "r");
   if (!fp) {
     return nullptr;
@@ -128,6 +526,7 @@ std::unique_ptr<VersionEdit> DBImpl::Recover(std::string_view manifest_path) {
 
   auto version_edit = std::make_unique<VersionEdit>(config_->GetSSTNumLvels());
   uint64_t table_id = 0, file_size = 0;
+  TxnId min_txn_id = 0, max_txn_id = kMaxTxnId;
   int level = 0;
   std::string smallest_key, largest_key, filename;
 
@@ -160,6 +559,7 @@ std::unique_ptr<VersionEdit> DBImpl::Recover(std::string_view manifest_path) {
       // Update next id used for new table
       if (doc["sequence_number"].GetInt64() > sequence_number_) {
         sequence_number_ = doc["sequence_number"].GetInt64();
+        last_visible_sequence_ = sequence_number_.load();
       }
     }
 
@@ -171,12 +571,21 @@ std::unique_ptr<VersionEdit> DBImpl::Recover(std::string_view manifest_path) {
         file_size = file["size"].GetInt64();
         smallest_key = file["smallest_key"].GetString();
         largest_key = file["largest_key"].GetString();
+        // Records written before txn id range was tracked don't have it
+        min_txn_id = (file.HasMember("min_txn_id") &&
+                      file["min_txn_id"].IsUint64())
+                         ? file["min_txn_id"].GetUint64()
+                         : 0;
+        max_txn_id = (file.HasMember("max_txn_id") &&
+                      file["max_txn_id"].IsUint64())
+                         ? file["max_txn_id"].GetUint64()
+                         : kMaxTxnId;
         // Build filename
         filename = db_path_ + std::to_string(table_id) + ".sst";
 
         auto sst_metadata = std::make_shared<SSTMetadata>(
             table_id, level, file_size, smallest_key, largest_key,
-            std::move(filename));
+            std::move(filename), min_txn_id, max_txn_id);
         filter_add_files.insert({table_id, sst_metadata});
       }
     }
@@ -212,6 +621,100 @@ std::unique_ptr<VersionEdit> DBImpl::Recover(std::string_view manifest_path) {
   return version_edit;
 }
 
+bool DBImpl::CreateManifest(
+    const std::vector<std::shared_ptr<SSTMetadata>> &live_files) {
+  VersionEdit snapshot(config_->GetSSTNumLvels());
+  for (const auto &file : live_files) {
+    snapshot.AddNewFiles(file);
+  }
+  snapshot.SetNextTableId(next_sstable_id_);
+  snapshot.SetSequenceNumber(last_visible_sequence_);
+
+  DynamicBuffer buffer;
+  EncodeManifestHeader(&buffer);
+  EncodeManifestRecord(&snapshot, &buffer);
+
+  // Maybe left by a rollover that crashed before switching CURRENT
+  const uint64_t manifest_number = manifest_number_ + 1;
+  const std::string manifest_path =
+      db_path_ + kManifestFileName + "-" + std::to_string(manifest_number);
+  std::error_code error_code;
+  fs::remove(manifest_path, error_code);
+
+  auto manifest_object =
+      std::make_unique<io::LinuxAppendOnlyFile>(manifest_path);
+  if (!manifest_object->Open() ||
+      manifest_object->Append(buffer) != static_cast<ssize_t>(buffer.size()) ||
+      !manifest_object->Flush() || !SetCurrentFile(manifest_number)) {
+    manifest_object.reset();
+    fs::remove(manifest_path, error_code);
+    return false;
+  }
+
+  // From now on, new MANIFEST is the one in use
+  const std::string old_manifest_path =
+      std::exchange(manifest_path_, manifest_path);
+  manifest_number_ = manifest_number;
+  manifest_write_object_ = std::move(manifest_object);
+  manifest_size_ = buffer.size();
+
+  if (!old_manifest_path.empty()) {
+    fs::remove(old_manifest_path, error_code);
+  }
+
+  return true;
+}
+
+bool DBImpl::RollOverManifest() {
+  // Every edit logged so far has been applied, so latest version is the whole
+  // state of DB
+  std::vector<std::shared_ptr<SSTMetadata>> live_files;
+  const Version *latest_version = version_manager_->GetLatestVersion();
+  if (latest_version) {
+    for (const auto &files : latest_version->GetImmutableSSTMetadata()) {
+      live_files.insert(live_files.end(), files.begin(), files.end());
+    }
+  }
+
+  return CreateManifest(live_files);
+}
+
+bool DBImpl::SetCurrentFile(uint64_t manifest_number) {
+  const std::string content =
+      kManifestFileName + "-" + std::to_string(manifest_number) + "\n";
+
+  // Written aside then renamed, so that CURRENT is never seen half written
+  const std::string temp_current_path = db_path_ + kCurrentFileName + ".tmp";
+  std::error_code error_code;
+  fs::remove(temp_current_path, error_code);
+
+  auto current_object =
+      std::make_unique<io::LinuxAppendOnlyFile>(temp_current_path);
+  if (!current_object->Open() ||
+      current_object->Append(std::span<const Byte>(
+          reinterpret_cast<const Byte *>(content.data()), content.size())) !=
+          static_cast<ssize_t>(content.size()) ||
+      !current_object->Flush()) {
+    return false;
+  }
+  current_object.reset();
+
+  fs::rename(temp_current_path, db_path_ + kCurrentFileName, error_code);
+  return !error_code;
+}
+
+void DBImpl::RemoveObsoleteManifests() {
+  const std::string manifest_name = fs::path(manifest_path_).filename();
+  for (const auto &entry : fs::directory_iterator(db_path_)) {
+    const std::string filename = entry.path().filename();
+    if (entry.is_regular_file() && filename.starts_with(kManifestFileName) &&
+        filename != manifest_name) {
+      std::error_code error_code;
+      fs::remove(entry.path(), error_code);
+    }
+  }
+}
+
 void DBImpl::CleanupTrashFiles() {
   while (!shutdown_) {
     {
@@ -245,55 +748,347 @@ void DBImpl::WakeupBgThreadToCleanupFiles(std::string_view filename) const {
 }
 
 GetStatus DBImpl::Get(std::string_view key, TxnId txn_id) {
+  // TODO(namnh) : Change when transaction is supported
+  if (txn_id == 0) {
+    txn_id = last_visible_sequence_.load(std::memory_order_acquire);
+  }
+
+  return Get_(key, txn_id, true /*fill_cache*/);
+}
+
+GetStatus DBImpl::Get(const ReadOptions &options, std::string_view key) {
+  const TxnId snapshot =
+      options.snapshot ? options.snapshot->GetSequenceNumber()
+                       : last_visible_sequence_.load(std::memory_order_acquire);
+
+  return Get_(key, snapshot, options.fill_cache);
+}
+
+ValueType DBImpl::Get(const ReadOptions &options, std::string_view key,
+                      PinnableValue *value) {
+  const TxnId snapshot =
+      options.snapshot ? options.snapshot->GetSequenceNumber()
+                       : last_visible_sequence_.load(std::memory_order_acquire);
+
+  return Get_(key, snapshot, value, options.fill_cache);
+}
+
+GetStatus DBImpl::Get_(std::string_view key, TxnId snapshot,
+                       bool fill_cache) {
   GetStatus status;
+  PinnableValue value;
+
+  // Value is copied once, when it is handed to caller
+  status.type = Get_(key, snapshot, &value, fill_cache);
+  if (status.type == ValueType::PUT) {
+    status.value = value.ToString();
+  }
+
+  return status;
+}
+
+ValueType DBImpl::Get_(std::string_view key, TxnId snapshot,
+                       PinnableValue *value, bool fill_cache) {
+  assert(value);
+  value->Reset();
+
+  // Memtables and version stay alive until read is done
+  SuperVersionHandle super_version(super_version_cache_.get());
+
+  const ValueType type =
+      GetFromMemTables(super_version.Get(), key, snapshot, value);
+  if (type == ValueType::PUT || type == ValueType::DELETED) {
+    return type;
+  }
+
+  const Version *version = super_version->GetVersion();
+  if (!version) {
+    return type;
+  }
+
+  return version->Get(key, snapshot, value, fill_cache);
+}
+
+std::vector<GetStatus>
+DBImpl::MultiGet(std::span<const std::string_view> keys,
+                 const ReadOptions &options) {
+  const TxnId snapshot =
+      options.snapshot ? options.snapshot->GetSequenceNumber()
+                       : last_visible_sequence_.load(std::memory_order_acquire);
+
+  const std::vector<std::string_view> sorted_keys = SortKeys(keys);
+  std::vector<GetStatus> sorted_statuses(sorted_keys.size());
 
   {
-    std::shared_lock rlock(mutex_);
+    SuperVersionHandle super_version(super_version_cache_.get());
+
+    MultiGetFromMemTables(super_version.Get(), sorted_keys, snapshot,
+                          sorted_statuses);
 
-    // Find data from Memtable
-    status = memtable_->Get(key, txn_id);
-    if (status.type == ValueType::PUT || status.type == ValueType::DELETED) {
-      return status;
+    const Version *version = super_version->GetVersion();
+    if (version && HasPendingKeys(sorted_statuses)) {
+      version->MultiGet(sorted_keys, snapshot, sorted_statuses,
+                        options.fill_cache);
     }
+  }
+
+  return RestoreOrder(keys, sorted_keys, sorted_statuses);
+}
+
+Task<GetStatus> DBImpl::AsyncGet(ReadOptions options, std::string_view key) {
+  const TxnId snapshot =
+      options.snapshot ? options.snapshot->GetSequenceNumber()
+                       : last_visible_sequence_.load(std::memory_order_acquire);
 
-    // If key is not found, continue finding from immutable memtables
-    for (const auto &immu_memtable :
-         immutable_memtables_ | std::views::reverse) {
-      status = immu_memtable->Get(key, txn_id);
-      if (status.type == ValueType::PUT || status.type == ValueType::DELETED) {
-        return status;
+  SuperVersionRef super_version;
+  {
+    SuperVersionHandle handle(super_version_cache_.get());
+
+    GetStatus status;
+    PinnableValue value;
+    status.type = GetFromMemTables(handle.Get(), key, snapshot, &value);
+    if (status.type == ValueType::PUT || status.type == ValueType::DELETED ||
+        !handle->GetVersion()) {
+      if (status.type == ValueType::PUT) {
+        status.value = value.ToString();
       }
+      co_return status;
     }
+
+    // Read may be resumed on another thread, so it holds its own reference
+    // instead of keeping slot of calling thread busy
+    handle->Ref();
+    super_version.reset(handle.Get());
   }
 
-  // TODO(nanmh) : Does it need to acquire lock when looking up key in SSTs?
-  const Version *version = version_manager_->GetLatestVersion();
-  if (!version) {
-    return status;
+  co_return co_await AsyncGetFromVersion(super_version->GetVersion(), key,
+                                         snapshot, options.fill_cache);
+}
+
+Task<std::vector<GetStatus>>
+DBImpl::AsyncMultiGet(std::span<const std::string_view> keys,
+                      ReadOptions options) {
+  const TxnId snapshot =
+      options.snapshot ? options.snapshot->GetSequenceNumber()
+                       : last_visible_sequence_.load(std::memory_order_acquire);
+
+  const std::vector<std::string_view> sorted_keys = SortKeys(keys);
+  std::vector<GetStatus> sorted_statuses(sorted_keys.size());
+
+  SuperVersionRef super_version;
+  {
+    SuperVersionHandle handle(super_version_cache_.get());
+
+    MultiGetFromMemTables(handle.Get(), sorted_keys, snapshot,
+                          sorted_statuses);
+
+    if (handle->GetVersion() && HasPendingKeys(sorted_statuses)) {
+      handle->Ref();
+      super_version.reset(handle.Get());
+    }
   }
 
-  version->IncreaseRefCount();
-  status = version->Get(key, txn_id);
-  version->DecreaseRefCount();
+  if (super_version) {
+    // Keys left are looked up concurrently, so that blocks they miss are read
+    // together
+    std::vector<size_t> pending_indexes;
+    std::vector<Task<GetStatus>> lookups;
+    for (size_t i = 0; i < sorted_keys.size(); i++) {
+      if (sorted_statuses[i].type != ValueType::NOT_FOUND) {
+        continue;
+      }
 
-  return status;
+      pending_indexes.push_back(i);
+      lookups.push_back(AsyncGetFromVersion(super_version->GetVersion(),
+                                            sorted_keys[i], snapshot,
+                                            options.fill_cache));
+    }
+
+    std::vector<GetStatus> pending_statuses =
+        co_await WhenAll(std::move(lookups));
+    for (size_t i = 0; i < pending_indexes.size(); i++) {
+      sorted_statuses[pending_indexes[i]] = std::move(pending_statuses[i]);
+    }
+  }
+
+  co_return RestoreOrder(keys, sorted_keys, sorted_statuses);
+}
+
+Task<GetStatus> DBImpl::AsyncGetFromVersion(const Version *version,
+                                            std::string_view key,
+                                            TxnId snapshot, bool fill_cache) {
+  GetStatus status;
+  PinnableValue value;
+
+  status.type = co_await version->AsyncGet(
+      key, snapshot, &value, fill_cache, io_queue_.get(), executor_.get());
+  if (status.type == ValueType::PUT) {
+    status.value = value.ToString();
+  }
+
+  co_return status;
+}
+
+void DBImpl::SetExecutor(std::shared_ptr<Executor> executor) {
+  assert(executor);
+  executor_ = std::move(executor);
+}
+
+const Snapshot *DBImpl::GetSnapshot() {
+  std::scoped_lock lock(snapshots_mutex_);
+  return snapshots_.New(last_visible_sequence_.load(std::memory_order_acquire));
+}
+
+void DBImpl::ReleaseSnapshot(const Snapshot *snapshot) {
+  std::scoped_lock lock(snapshots_mutex_);
+  snapshots_.Release(snapshot);
+}
+
+TxnId DBImpl::GetSmallestSnapshot() {
+  // Snapshots are created under the same lock, so no snapshot older than
+  // returned value can show up later
+  std::scoped_lock lock(snapshots_mutex_);
+  std::optional<TxnId> oldest_snapshot = snapshots_.GetOldestSequenceNumber();
+  if (oldest_snapshot) {
+    return oldest_snapshot.value();
+  }
+
+  return last_visible_sequence_.load(std::memory_order_acquire);
 }
 
 void DBImpl::Put(std::string_view key, std::string_view value, TxnId txn_id) {
   // TODO(namnh) : // Change when transaction is supported
-  sequence_number_++;
-  Put_(key, value, sequence_number_.load());
+  Writer writer(ValueType::PUT, key, value);
+  Write(&writer);
 }
 
 void DBImpl::Delete(std::string_view key, TxnId txn_id) {
   // TODO(namnh) : // Change when transaction is supported
-  sequence_number_++;
-  Put_(key, std::string_view{}, sequence_number_.load());
+  Writer writer(ValueType::DELETED, key, std::string_view{});
+  Write(&writer);
 }
 
-void DBImpl::Put_(std::string_view key, std::string_view value, TxnId txn_id) {
-  std::scoped_lock rwlock(mutex_);
-  if (value == std::string_view{}) {
+Task<> DBImpl::AsyncPut(std::string_view key, std::string_view value) {
+  return AsyncWrite(ValueType::PUT, key, value);
+}
+
+Task<> DBImpl::AsyncDelete(std::string_view key) {
+  return AsyncWrite(ValueType::DELETED, key, std::string_view{});
+}
+
+struct DBImpl::WriterAwaiter {
+  bool await_ready() const { return false; }
+
+  // Return false if writer is leader right away, so coroutine keeps running
+  bool await_suspend(std::coroutine_handle<> handle) {
+    std::scoped_lock lock(db->writers_mutex_);
+    writer->handle = handle;
+    db->writers_.push_back(writer);
+    return writer != db->writers_.front();
+  }
+
+  void await_resume() const {}
+
+  DBImpl *db;
+
+  Writer *writer;
+};
+
+void DBImpl::Write(Writer *writer) {
+  std::unique_lock lock(writers_mutex_);
+  writers_.push_back(writer);
+  writer->cv.wait(lock, [this, writer]() {
+    return writer->done || writer == writers_.front();
+  });
+
+  if (writer->done) {
+    // A leader has already committed this write on our behalf
+    return;
+  }
+
+  CommitWriteGroup(writer, lock);
+}
+
+Task<> DBImpl::AsyncWrite(ValueType type, std::string_view key,
+                          std::string_view value) {
+  Writer writer(type, key, value);
+  co_await WriterAwaiter{this, &writer};
+
+  std::unique_lock lock(writers_mutex_);
+  if (writer.done) {
+    // A leader has already committed this write on our behalf
+    co_return;
+  }
+
+  CommitWriteGroup(&writer, lock);
+}
+
+void DBImpl::CommitWriteGroup(Writer *leader,
+                              std::unique_lock<std::mutex> &lock) {
+  assert(lock.owns_lock() && writers_.front() == leader);
+
+  // Collect followers queued behind leader into one write group. Writers that
+  // arrive after this point wait for next group
+  std::vector<Writer *> group;
+  size_t group_bytes = 0;
+  for (Writer *w : writers_) {
+    if (!group.empty() && group_bytes >= kMaxWriteGroupBytes) {
+      break;
+    }
+    group.push_back(w);
+    group_bytes += w->key.size() + w->value.size();
+  }
+  lock.unlock();
+
+  // Reserve a contiguous range of sequence numbers for whole group. Only leader
+  // allocates, so sequence order is the same as memtable insertion order
+  const TxnId first_sequence =
+      sequence_number_.fetch_add(group.size(), std::memory_order_relaxed) + 1;
+  {
+    std::scoped_lock rwlock(mutex_);
+    for (size_t i = 0; i < group.size(); i++) {
+      Put_(group[i]->key, group[i]->value, first_sequence + i, group[i]->type);
+    }
+
+    // Publish group. Any read starting after this point sees all of its writes
+    last_visible_sequence_.store(first_sequence + group.size() - 1,
+                                 std::memory_order_release);
+  }
+
+  // Coroutines are resumed out of lock, since they may write again
+  std::vector<std::coroutine_handle<>> to_resume;
+  auto wake_up = [&to_resume](Writer *w) {
+    if (w->handle) {
+      to_resume.push_back(w->handle);
+    } else {
+      w->cv.notify_one();
+    }
+  };
+
+  lock.lock();
+  for (Writer *w : group) {
+    assert(writers_.front() == w);
+    writers_.pop_front();
+    if (w != leader) {
+      w->done = true;
+      wake_up(w);
+    }
+  }
+
+  // Hand leadership over to the first writer of next group
+  if (!writers_.empty()) {
+    wake_up(writers_.front());
+  }
+  lock.unlock();
+
+  for (std::coroutine_handle<> handle : to_resume) {
+    executor_->Execute(handle);
+  }
+}
+
+void DBImpl::Put_(std::string_view key, std::string_view value, TxnId txn_id,
+                  ValueType type) {
+  if (type == ValueType::DELETED) {
     memtable_->Delete(key, txn_id);
   } else {
     memtable_->Put(key, value, txn_id);
@@ -311,13 +1106,17 @@ void DBImpl::Put_(std::string_view key, std::string_view value, TxnId txn_id) {
 
     if (num_flush_memtables >= config_->GetMaxImmuMemTablesInMem()) {
       // Flush thread to flush memtable to disk
-      thread_pool_->Enqueue(&DBImpl::FlushMemTableJob, this,
-                            memtable_version_.load(), num_flush_memtables);
+      flush_thread_pool_->Schedule(
+          TaskPriority::kHigh,
+          [this, version = memtable_version_.load(), num_flush_memtables]() {
+            FlushMemTableJob(version, num_flush_memtables);
+          });
       memtable_version_.fetch_add(1);
     }
 
     // Create new empty mutable memtable
-    memtable_ = std::make_unique<MemTable>(memtable_version_);
+    memtable_ = std::make_shared<MemTable>(memtable_version_);
+    InstallSuperVersion();
   }
 }
 
@@ -335,12 +1134,16 @@ void DBImpl::ForceFlushMemTable() {
                       return elem->GetVersion() == version;
                     });
   // FlushMemTableJob(memtable_version_.load(), num_flush_memtables);
-  thread_pool_->Enqueue(&DBImpl::FlushMemTableJob, this,
-                        memtable_version_.load(), num_flush_memtables);
+  flush_thread_pool_->Schedule(
+      TaskPriority::kHigh,
+      [this, version = memtable_version_.load(), num_flush_memtables]() {
+        FlushMemTableJob(version, num_flush_memtables);
+      });
   memtable_version_.fetch_add(1);
 
   // Create new memtable
-  memtable_ = std::make_unique<MemTable>(memtable_version_.load());
+  memtable_ = std::make_shared<MemTable>(memtable_version_.load());
+  InstallSuperVersion();
 }
 
 void DBImpl::FlushMemTableJob(uint64_t version, int num_flush_memtables) {
@@ -355,36 +1158,45 @@ void DBImpl::FlushMemTableJob(uint64_t version, int num_flush_memtables) {
 
       if (immutable_memtable->GetVersion() == version) {
         total_flushed_memtable++;
-        thread_pool_->Enqueue(&DBImpl::CreateNewSST, this,
-                              std::cref(immutable_memtable), version_edit.get(),
-                              std::ref(all_done));
+        // Memtable is shared, immutable_memtables_ may grow meanwhile
+        flush_thread_pool_->Schedule(
+            TaskPriority::kHigh, [this, immutable_memtable,
+                                  version_edit = version_edit.get(),
+                                  &all_done]() {
+              CreateNewSST(immutable_memtable, version_edit, all_done);
+            });
       }
     }
   }
 
-  // Wait until all workers have finished
-  all_done.wait();
+  // Wait until all workers have finished. Flush pool is small, so this worker
+  // runs queued SST jobs itself instead of blocking one of its threads
+  flush_thread_pool_->RunPendingJobsUntil(
+      [&all_done]() { return all_done.try_wait(); });
 
   if (total_flushed_memtable > version_edit->GetImmutableNewFiles().size()) {
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    thread_pool_->Enqueue(&DBImpl::FlushMemTableJob, this, version,
-                          num_flush_memtables);
+    flush_thread_pool_->Schedule(
+        TaskPriority::kHigh, [this, version, num_flush_memtables]() {
+          FlushMemTableJob(version, num_flush_memtables);
+        });
     return;
   }
 
   version_edit->SetNextTableId(GetNextSSTId());
-  version_edit->SetSequenceNumber(sequence_number_);
+  version_edit->SetSequenceNumber(last_visible_sequence_.load());
 
-  // Apply versionEdit to manifest and fsync to persist data
-  if (!AddChangesToManifest(version_edit.get())) {
+  // Apply versionEdit to manifest and fsync to persist data. Not until this
+  // point that latest version is visible
+  if (!LogAndApply(std::move(version_edit))) {
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    thread_pool_->Enqueue(&DBImpl::FlushMemTableJob, this, version,
-                          num_flush_memtables);
+    flush_thread_pool_->Schedule(
+        TaskPriority::kHigh, [this, version, num_flush_memtables]() {
+          FlushMemTableJob(version, num_flush_memtables);
+        });
+    return;
   }
 
-  // Not until this point that latest version is visible
-  version_manager_->ApplyNewChanges(std::move(version_edit));
-
   // Notify to let writing continues.
   // NOTE: new writes are only allowed after new version is VISIBLE
   {
@@ -395,13 +1207,14 @@ void DBImpl::FlushMemTableJob(uint64_t version, int num_flush_memtables) {
                          return elem->GetVersion() == version;
                        }),
         immutable_memtables_.end());
+    InstallSuperVersion();
   }
 
   MaybeScheduleCompaction();
 }
 
 void DBImpl::CreateNewSST(
-    const std::unique_ptr<BaseMemTable> &immutable_memtable,
+    const std::shared_ptr<BaseMemTable> &immutable_memtable,
     VersionEdit *version_edit, std::latch &work_done) {
   assert(version_edit);
 
@@ -432,109 +1245,76 @@ void DBImpl::CreateNewSST(
     std::string filename = db_path_ + std::to_string(sst_id) + ".sst";
     version_edit->AddNewFiles(sst_id, 0 /*level*/, new_sst.GetFileSize(),
                               new_sst.GetSmallestKey(), new_sst.GetLargestKey(),
-                              std::move(filename));
+                              std::move(filename), new_sst.GetMinTxnId(),
+                              new_sst.GetMaxTxnId());
   }
 
   // Signal that this worker is done
   work_done.count_down();
 }
 
-bool DBImpl::AddChangesToManifest(const VersionEdit *version_edit) {
-  rapidjson::Document doc;
-  doc.SetObject();
-
-  rapidjson::Document::AllocatorType &allocator = doc.GetAllocator();
-
-  // Encode next table id
-  doc.AddMember("next_table_id", version_edit->GetNextTableId(), allocator);
-
-  // Encode sequence number
-  doc.AddMember("sequence_number", version_edit->GetSequenceNumber(),
-                allocator);
-
-  // List of new files created
-  rapidjson::Value new_files_array(rapidjson::kArrayType);
-  // List of delete files
-  rapidjson::Value delete_files_array(rapidjson::kArrayType);
-
-  const std::vector<std::vector<std::shared_ptr<SSTMetadata>>> &new_files_list =
-      version_edit->GetImmutableNewFiles();
-  const std::set<std::pair<SSTId, int>> &delete_files_list =
-      version_edit->GetImmutableDeletedFiles();
-
-  for (int level = 0; level < new_files_list.size(); level++) {
-    for (const auto &new_file : new_files_list[level]) {
-      rapidjson::Value new_file_obj(rapidjson::kObjectType);
-
-      // Encode table id
-      new_file_obj.AddMember("id", new_file->table_id, allocator);
-
-      // Encode file level
-      new_file_obj.AddMember("level", new_file->level, allocator);
-
-      // Encode file size
-      new_file_obj.AddMember("size", new_file->file_size, allocator);
-
-      // Encode smallest key
-      rapidjson::Value smallest_key_value;
-      smallest_key_value.SetString(
-          new_file->smallest_key.data(),
-          static_cast<rapidjson::SizeType>(new_file->smallest_key.size()),
-          allocator);
-      new_file_obj.AddMember("smallest_key", smallest_key_value, allocator);
-
-      // Encode largest key
-      rapidjson::Value largest_key_value;
-      largest_key_value.SetString(
-          new_file->largest_key.data(),
-          static_cast<rapidjson::SizeType>(new_file->largest_key.size()),
-          allocator);
-      new_file_obj.AddMember("largest_key", largest_key_value, allocator);
-
-      // Add file object to array
-      new_files_array.PushBack(new_file_obj, allocator);
-    }
+void DBImpl::InstallSuperVersion() {
+  if (!super_version_cache_) {
+    // DB is being closed
+    return;
   }
 
-  for (const auto &delete_file : delete_files_list) {
-    rapidjson::Value delete_file_obj(rapidjson::kObjectType);
-
-    // Encode table id
-    delete_file_obj.AddMember("id", delete_file.first, allocator);
-    // Encode file level
-    delete_file_obj.AddMember("level", delete_file.second, allocator);
+  super_version_cache_->Install(
+      new SuperVersion(memtable_, immutable_memtables_,
+                       version_manager_->AcquireLatestVersion()));
+}
 
-    // Add file object to array
-    delete_files_array.PushBack(delete_file_obj, allocator);
+bool DBImpl::AddChangesToManifest(const VersionEdit *version_edit) {
+  DynamicBuffer buffer;
+  EncodeManifestRecord(version_edit, &buffer);
+
+  if (manifest_write_object_->Append(buffer) ==
+          static_cast<ssize_t>(buffer.size()) &&
+      manifest_write_object_->Flush()) {
+    manifest_size_ += buffer.size();
+    return true;
   }
 
-  // Add new_files_array to root
-  if (!new_files_array.Empty()) {
-    doc.AddMember("new_files", new_files_array, allocator);
+  // Drop part of record that may have been written, so that next records are
+  // appended right after the last valid one. If it can't be dropped, continue
+  // with a new MANIFEST, that doesn't contain this edit
+  std::error_code error_code;
+  fs::resize_file(manifest_path_, manifest_size_, error_code);
+  if (error_code && !RollOverManifest()) {
+    std::cerr << "Can't drop torn record of " << manifest_path_ << std::endl;
   }
 
-  if (!delete_files_array.Empty()) {
-    // Add delete_files_array to root
-    doc.AddMember("delete_files", delete_files_array, allocator);
-  }
+  return false;
+}
 
-  // Serialize to string
-  rapidjson::StringBuffer buffer;
-  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-  doc.Accept(writer);
+bool DBImpl::LogAndApply(std::unique_ptr<VersionEdit> version_edit) {
+  std::scoped_lock lock(manifest_mutex_);
 
-  std::span<const Byte> bytes(
-      reinterpret_cast<const uint8_t *>(buffer.GetString()), buffer.GetSize());
+  if (manifest_size_ >= config_->GetMaxManifestFileSize() &&
+      !RollOverManifest()) {
+    // Keep appending to current MANIFEST
+    std::cerr << "Can't roll over " << manifest_path_ << std::endl;
+  }
 
-  // TODO(namnh, IMPORTANT) : What if append fail ?
-  if (manifest_write_object_->Append(bytes) == -1) {
+  if (!AddChangesToManifest(version_edit.get())) {
     return false;
   }
 
-  return manifest_write_object_->Flush();
+  // Not until this point that latest version is visible
+  version_manager_->ApplyNewChanges(std::move(version_edit));
+  {
+    std::shared_lock rlock(mutex_);
+    InstallSuperVersion();
+  }
+
+  return true;
 }
 
 void DBImpl::MaybeScheduleCompaction() {
+  if (shutdown_) {
+    return;
+  }
+
   if (background_compaction_scheduled_.load()) {
     // only 1 compaction happens at a moment. This condition is highest
     // privilege
@@ -546,21 +1326,24 @@ void DBImpl::MaybeScheduleCompaction() {
   }
 
   if (!background_compaction_scheduled_.exchange(true)) {
-    thread_pool_->Enqueue(&DBImpl::ExecuteBackgroundCompaction, this);
+    // Compaction of level 0 unblocks flushes, so it goes first
+    const std::optional<int> level = version_manager_->GetLevelToCompact();
+    thread_pool_->Schedule(level == 0 ? TaskPriority::kL0Compaction
+                                      : TaskPriority::kCompaction,
+                           [this]() { ExecuteBackgroundCompaction(); });
   }
 }
 
 void DBImpl::ExecuteBackgroundCompaction() {
-  const Version *version = version_manager_->GetLatestVersion();
+  const Version *version = version_manager_->AcquireLatestVersion();
   if (!version) {
     return;
   }
 
-  version->IncreaseRefCount();
   auto version_edit = std::make_unique<VersionEdit>(config_->GetSSTNumLvels());
-  auto compact =
-      std::make_unique<Compact>(block_reader_cache_, table_reader_cache_.get(),
-                                version, version_edit.get(), this);
+  auto compact = std::make_unique<Compact>(block_reader_cache_.get(),
+                                           table_reader_cache_.get(), version,
+                                           version_edit.get(), this);
   bool compact_success = compact->PickCompact();
   if (!compact_success) {
     version->DecreaseRefCount();
@@ -575,12 +1358,11 @@ void DBImpl::ExecuteBackgroundCompaction() {
   version->DecreaseRefCount();
 
   version_edit->SetNextTableId(GetNextSSTId());
-  version_edit->SetSequenceNumber(sequence_number_);
-
-  // Apply versionEdit to manifest and fsync to persist data
-  if (!AddChangesToManifest(version_edit.get())) {
-    version->DecreaseRefCount();
+  version_edit->SetSequenceNumber(last_visible_sequence_.load());
 
+  // Apply versionEdit to manifest and fsync to persist data, then apply
+  // compact version edit(changes) to create new version
+  if (!LogAndApply(std::move(version_edit))) {
     background_compaction_scheduled_.store(false);
     std::this_thread::sleep_for(std::chrono::milliseconds(200));
     MaybeScheduleCompaction();
@@ -588,17 +1370,30 @@ void DBImpl::ExecuteBackgroundCompaction() {
     return;
   }
 
-  // Apply compact version edit(changes) to create new version
-  version_manager_->ApplyNewChanges(std::move(version_edit));
-
   // Compaction can create many files, so maybe we need another compaction
   // round
   background_compaction_scheduled_.store(false);
   MaybeScheduleCompaction();
 }
 
+void DBImpl::SetBackgroundThreads(int total_flush_threads,
+                                  int total_compaction_threads) {
+  flush_thread_pool_->SetMaxActiveThreads(std::max(1, total_flush_threads));
+  thread_pool_->SetMaxActiveThreads(std::max(1, total_compaction_threads));
+}
+
+std::pair<unsigned int, unsigned int>
+DBImpl::GetActiveBackgroundThreads() const {
+  return {flush_thread_pool_->GetMaxActiveThreads(),
+          thread_pool_->GetMaxActiveThreads()};
+}
+
 uint64_t DBImpl::GetNextSSTId() { return next_sstable_id_.fetch_add(1); }
 
+uint64_t DBImpl::GetLastVisibleSequence() const {
+  return last_visible_sequence_.load(std::memory_order_acquire);
+}
+
 const Config *DBImpl::GetConfig() const { return config_.get(); }
 
 const VersionManager *DBImpl::GetVersionManager() const {
@@ -607,22 +1402,29 @@ const VersionManager *DBImpl::GetVersionManager() const {
 
 std::string DBImpl::GetDBPath() const { return db_path_; }
 
+std::string DBImpl::GetManifestPath() const { return manifest_path_; }
+
 const BaseMemTable *DBImpl::GetCurrentMemtable() { return memtable_.get(); }
 
-const std::vector<std::unique_ptr<BaseMemTable>> &
+const std::vector<std::shared_ptr<BaseMemTable>> &
 DBImpl::GetImmutableMemTables() {
   return immutable_memtables_;
 }
 
-const std::vector<std::unique_ptr<sstable::BlockReaderCache>> &
-DBImpl::GetBlockReaderCache() const {
-  return block_reader_cache_;
+const sstable::BlockReaderCache *DBImpl::GetBlockReaderCache() const {
+  return block_reader_cache_.get();
 }
 
 const sstable::TableReaderCache *DBImpl::GetTableReaderCache() const {
   return table_reader_cache_.get();
 }
 
+const RowCache *DBImpl::GetRowCache() const { return row_cache_.get(); }
+
+const kvs::ThreadPool *DBImpl::GetReadThreadPool() const {
+  return read_thread_pool_.get();
+}
+
 } // namespace db
 
 } // namespace kvs
\ No newline at end of file
@@ -2,6 +2,10 @@
 #define DB_LSM_H
 
 #include "common/macros.h"
+#include "common/task.h"
+#include "db/options.h"
+#include "db/pinnable_value.h"
+#include "db/snapshot.h"
 #include "db/version.h"
 
 // libC++
@@ -9,15 +13,20 @@
 #include <cassert>
 #include <cmath>
 #include <condition_variable>
+#include <coroutine>
+#include <deque>
 #include <fstream>
 #include <functional>
+#include <future>
 #include <iostream>
+#include <latch>
 #include <memory>
 #include <numeric>
 #include <optional>
 #include <queue>
 #include <ranges>
 #include <shared_mutex>
+#include <span>
 #include <string>
 #include <string_view>
 #include <thread>
@@ -28,6 +37,7 @@
 
 namespace kvs {
 
+class Executor;
 class ThreadPool;
 
 namespace mvcc {
@@ -36,6 +46,7 @@ class TransactionManager;
 
 namespace io {
 class AppendOnlyFile;
+class IoCompletionQueue;
 } // namespace io
 
 namespace sstable {
@@ -49,6 +60,8 @@ namespace db {
 class BaseIterator;
 class BaseMemTable;
 class Config;
+class RowCache;
+class SuperVersionCache;
 class VersionManager;
 
 class DBImpl {
@@ -65,32 +78,119 @@ public:
   DBImpl(DBImpl &&) = default;
   DBImpl &operator=(DBImpl &&) = default;
 
+  // Return newest version of key whose sequence number <= txn_id. txn_id = 0
+  // means reading latest published state
   GetStatus Get(std::string_view key, TxnId txn_id = 0);
 
+  GetStatus Get(const ReadOptions &options, std::string_view key);
+
+  // Same as above, but value isn't copied. It references memtable node or
+  // block that contains it, which are kept alive until value is
+  // reset/destroyed
+  ValueType Get(const ReadOptions &options, std::string_view key,
+                PinnableValue *value);
+
+  // Get many keys at once. Statuses are returned in the same order as keys.
+  // Lock and version are acquired once for the whole batch
+  std::vector<GetStatus> MultiGet(std::span<const std::string_view> keys,
+                                  const ReadOptions &options = ReadOptions{});
+
   void Put(std::string_view key, std::string_view value, TxnId txn_id = 0);
 
   void Delete(std::string_view key, TxnId txn_id = 0);
 
+  // Coroutine versions of Get/MultiGet/Put/Delete, for callers that run on a
+  // coroutine runtime. Reads answered by memtables or caches complete inline.
+  // Blocks missing from block cache are read through io_uring, and read
+  // suspends until they are loaded instead of blocking calling thread. Keys of
+  // AsyncMultiGet that go to SSTs are looked up concurrently. A write suspends
+  // until its write group is committed. Suspended calls are resumed through
+  // executor(see SetExecutor). keys and values MUST outlive returned task
+  Task<GetStatus> AsyncGet(ReadOptions options, std::string_view key);
+
+  Task<std::vector<GetStatus>>
+  AsyncMultiGet(std::span<const std::string_view> keys,
+                ReadOptions options = ReadOptions{});
+
+  Task<> AsyncPut(std::string_view key, std::string_view value);
+
+  Task<> AsyncDelete(std::string_view key);
+
+  // Executor that suspended async calls are resumed through. Default one
+  // resumes them on thread that completed their wait(thread that reaps
+  // io_uring completions, or leader of write group). MUST be set before any
+  // async call is made
+  void SetExecutor(std::shared_ptr<Executor> executor);
+
+  // Pin current published state. Returned snapshot MUST be released by
+  // ReleaseSnapshot() before DB is destroyed
+  const Snapshot *GetSnapshot();
+
+  void ReleaseSnapshot(const Snapshot *snapshot);
+
   uint64_t GetNextSSTId();
 
+  // Return sequence number of the newest write group that is fully inserted
+  // into memtable. Reads use it as their snapshot bound
+  uint64_t GetLastVisibleSequence() const;
+
   bool LoadDB(std::string_view dbname);
 
+  // Block until tables opened in background by LoadDB are ready. Return at
+  // once if warm open is disabled
+  void WaitForWarmOpen() const;
+
+  // Number of tables processed so far by warm open, and number of tables it
+  // opens in total
+  std::pair<uint64_t, uint64_t> GetWarmOpenProgress() const;
+
+  // Write data blocks that are in block cache into DB directory. Next time DB
+  // is loaded, they are added back into block cache in background
+  bool DumpBlockCache(bool with_contents) const;
+
+  // Block until block cache dump found by LoadDB is loaded. Return number of
+  // blocks added back into block cache, 0 if there was no dump
+  uint64_t WaitForBlockCacheReload() const;
+
   void ForceFlushMemTable();
 
+  // Limit number of active flush workers and of background workers, that run
+  // compactions and housekeeping. Limits are clamped to number of threads
+  // created when DB is opened(TOTAL_FLUSH_THREADS, TOTAL_BG_THREADS)
+  void SetBackgroundThreads(int total_flush_threads,
+                            int total_compaction_threads);
+
+  // Number of flush workers and background workers that are active now
+  std::pair<unsigned int, unsigned int> GetActiveBackgroundThreads() const;
+
+  // Append version_edit to MANIFEST. If it fails, part of version_edit that
+  // may have been written is dropped from MANIFEST.
+  // REQUIRES: manifest_mutex_ is held, or no other thread changes version
   bool AddChangesToManifest(const VersionEdit *version_edit);
 
+  // Persist version_edit into MANIFEST, then install it as latest version.
+  // MANIFEST is rolled over first if it has grown above its size limit
+  bool LogAndApply(std::unique_ptr<VersionEdit> version_edit);
+
   const Config *GetConfig() const;
 
   const VersionManager *GetVersionManager() const;
 
-  // const sstable::BlockReaderCache *GetBlockReaderCache() const;
-  const std::vector<std::unique_ptr<sstable::BlockReaderCache>> &
-  GetBlockReaderCache() const;
+  // nullptr if block cache is disabled
+  const sstable::BlockReaderCache *GetBlockReaderCache() const;
 
   const sstable::TableReaderCache *GetTableReaderCache() const;
 
+  // nullptr if row cache is disabled
+  const RowCache *GetRowCache() const;
+
+  const kvs::ThreadPool *GetReadThreadPool() const;
+
   std::string GetDBPath() const;
 
+  // MANIFEST that CURRENT points to
+  std::string GetManifestPath() const;
+
   void CleanupTrashFiles();
 
   void WakeupBgThreadToCleanupFiles(std::string_view filename) const;
@@ -100,18 +200,110 @@ public:
   // For testing
   const BaseMemTable *GetCurrentMemtable();
 
-  const std::vector<std::unique_ptr<BaseMemTable>> &GetImmutableMemTables();
+  const std::vector<std::shared_ptr<BaseMemTable>> &GetImmutableMemTables();
 
 private:
-  void Put_(std::string_view key, std::string_view value, TxnId txn_id);
+  // A pending Put/Delete request. Writers are queued in writers_, the one at
+  // the front becomes leader and commits a group of queued writers at once
+  struct Writer {
+    Writer(ValueType type, std::string_view key, std::string_view value)
+        : type(type), key(key), value(value) {}
+
+    ValueType type;
+
+    std::string_view key;
+
+    std::string_view value;
+
+    // Set by the group leader once this write is visible in memtable
+    bool done{false};
+
+    std::condition_variable cv;
+
+    // Set if writer is a suspended coroutine, it is resumed through executor_
+    // instead of being notified through cv
+    std::coroutine_handle<> handle;
+  };
+
+  // Suspend coroutine of writer until it becomes leader or is committed
+  struct WriterAwaiter;
+
+  void Write(Writer *writer);
+
+  Task<> AsyncWrite(ValueType type, std::string_view key,
+                    std::string_view value);
+
+  // Commit group of writers that starts with leader, then hand leadership
+  // over to next writer.
+  // REQUIRES: lock holds writers_mutex_, it is released on return
+  void CommitWriteGroup(Writer *leader, std::unique_lock<std::mutex> &lock);
+
+  // version MUST stay referenced until returned task completes
+  Task<GetStatus> AsyncGetFromVersion(const Version *version,
+                                      std::string_view key, TxnId snapshot,
+                                      bool fill_cache);
 
-  std::unique_ptr<VersionEdit> Recover(std::string_view manifest_path);
+  GetStatus Get_(std::string_view key, TxnId snapshot, bool fill_cache);
+
+  ValueType Get_(std::string_view key, TxnId snapshot, PinnableValue *value,
+                 bool fill_cache);
+
+  // Return smallest sequence number that may still be read, either by oldest
+  // live snapshot or by latest published state. Versions hidden by a newer
+  // version at or below it are no longer needed
+  TxnId GetSmallestSnapshot();
+
+  // REQUIRES: mutex_ is held exclusively
+  void Put_(std::string_view key, std::string_view value, TxnId txn_id,
+            ValueType type);
+
+  // Replay MANIFEST that CURRENT points to. DB without CURRENT keeps all of
+  // its history in a single MANIFEST(maybe as JSON records), it is replaced
+  // by a new MANIFEST once recovered
+  std::unique_ptr<VersionEdit> Recover();
+
+  std::unique_ptr<VersionEdit>
+  RecoverFromManifest(std::string_view manifest_path);
+
+  std::unique_ptr<VersionEdit>
+  RecoverFromBinaryManifest(std::string_view manifest_path,
+                            std::span<const Byte> data);
+
+  std::unique_ptr<VersionEdit>
+  RecoverFromJsonManifest(std::string_view manifest_path);
+
+  // Write a new MANIFEST that starts with a snapshot of live_files, point
+  // CURRENT to it, then delete the previous one.
+  // REQUIRES: manifest_mutex_ is held, or DB is being loaded
+  bool CreateManifest(
+      const std::vector<std::shared_ptr<SSTMetadata>> &live_files);
+
+  // Replace MANIFEST by a new one that starts with a snapshot of latest version
+  // REQUIRES: manifest_mutex_ is held
+  bool RollOverManifest();
+
+  // Atomically replace CURRENT by one that points to MANIFEST-manifest_number
+  bool SetCurrentFile(uint64_t manifest_number);
+
+  // Delete MANIFESTs left by rollovers that were interrupted
+  void RemoveObsoleteManifests();
+
+  // Open tables of latest version and load their indexes on thread_pool_,
+  // upper levels first, at most TOTAL_TABLES_CACHE of them
+  void WarmOpenTables();
+
+  // Load block cache dump on thread_pool_, then delete it
+  void ReloadBlockCache();
 
   void FlushMemTableJob(uint64_t version, int num_flush_memtables);
 
-  void CreateNewSST(const std::unique_ptr<BaseMemTable> &immutable_memtable,
+  void CreateNewSST(const std::shared_ptr<BaseMemTable> &immutable_memtable,
                     VersionEdit *version_edit, std::latch &work_done);
 
+  // Make current memtables and latest version visible to reads.
+  // REQUIRES: mutex_ is held
+  void InstallSuperVersion();
+
   // void AddChangesToManifest(const VersionEdit *version_edit);
 
   void MaybeScheduleCompaction();
@@ -137,9 +329,14 @@ private:
   // it will be used until transaction module is supported
   std::atomic<uint64_t> sequence_number_;
 
-  std::unique_ptr<BaseMemTable> memtable_;
+  // Last sequence number whose write group is completely in memtable. Always
+  // <= sequence_number_, and only advanced by write group leader
+  std::atomic<uint64_t> last_visible_sequence_;
 
-  std::vector<std::unique_ptr<BaseMemTable>> immutable_memtables_;
+  // Shared with super versions that reads are still using
+  std::shared_ptr<BaseMemTable> memtable_;
+
+  std::vector<std::shared_ptr<BaseMemTable>> immutable_memtables_;
 
   std::vector<const BaseMemTable *> flushing_memtables_;
 
@@ -149,18 +346,55 @@ private:
 
   std::atomic<bool> background_compaction_scheduled_;
 
+  // Compactions and housekeeping
   std::unique_ptr<kvs::ThreadPool> thread_pool_;
 
+  // Flushes only. Destroyed first, because flushes schedule into thread_pool_
+  std::unique_ptr<kvs::ThreadPool> flush_thread_pool_;
+
+  // Lookups that a read fans out(e.g. MultiGet batches), so that they never
+  // wait behind compactions
+  std::unique_ptr<kvs::ThreadPool> read_thread_pool_;
+
   std::unique_ptr<sstable::TableReaderCache> table_reader_cache_;
 
-  std::unique_ptr<kvs::ThreadPool> block_cache_thread_pool_;
+  std::unique_ptr<sstable::BlockReaderCache> block_reader_cache_;
 
-  std::vector<std::unique_ptr<sstable::BlockReaderCache>> block_reader_cache_;
+  std::unique_ptr<RowCache> row_cache_;
 
   std::unique_ptr<VersionManager> version_manager_;
 
+  // Reads take memtables and version from here, without locking mutex_
+  std::unique_ptr<SuperVersionCache> super_version_cache_;
+
+  // Resume async calls
+  std::shared_ptr<Executor> executor_;
+
+  // Reads of async calls
+  std::unique_ptr<io::IoCompletionQueue> io_queue_;
+
+  // Serialize writers of MANIFEST, so that every edit logged is applied
+  // before next one is logged
+  std::mutex manifest_mutex_;
+
   std::unique_ptr<io::AppendOnlyFile> manifest_write_object_;
 
+  std::string manifest_path_;
+
+  uint64_t manifest_number_;
+
+  uint64_t manifest_size_;
+
+  // Counted down once per table opened in background by LoadDB
+  std::unique_ptr<std::latch> warm_open_done_;
+
+  std::atomic<uint64_t> total_warm_opened_tables_;
+
+  uint64_t total_warm_open_tables_;
+
+  // Number of blocks loaded back from block cache dump
+  std::shared_future<uint64_t> block_cache_reload_;
+
   // Mutex to protect some critical data structures
   // (immutable_memtables_ list, levels_sst_info_)
   // std::shared_mutex immutable_memtables_mutex_;
@@ -168,6 +402,16 @@ private:
 
   std::condition_variable_any cv_;
 
+  // Queue of writers waiting to be committed. Protected by writers_mutex_
+  std::deque<Writer *> writers_;
+
+  std::mutex writers_mutex_;
+
+  // List of live snapshots. Protected by snapshots_mutex_
+  SnapshotList snapshots_;
+
+  std::mutex snapshots_mutex_;
+
   mutable std::queue<std::string> trash_files_;
 
   mutable std::mutex trash_files_mutex_;
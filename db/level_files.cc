@@ -0,0 +1,210 @@
+#include "db/level_files.h"
+
+// libC++
+#include <algorithm>
+#include <cassert>
+#include <map>
+#include <unordered_set>
+#include <utility>
+
+namespace kvs {
+
+namespace db {
+
+LevelFiles::LevelFiles(std::shared_ptr<const Index> index)
+    : index_(std::move(index)) {}
+
+size_t LevelFiles::size() const {
+  return index_ ? index_->ends.back() : 0;
+}
+
+bool LevelFiles::empty() const { return !index_; }
+
+const std::shared_ptr<SSTMetadata> &
+LevelFiles::operator[](size_t index) const {
+  assert(index < size());
+  const size_t chunk =
+      std::upper_bound(index_->ends.begin(), index_->ends.end(), index) -
+      index_->ends.begin();
+  const size_t chunk_begin = (chunk == 0) ? 0 : index_->ends[chunk - 1];
+  return (*index_->chunks[chunk])[index - chunk_begin];
+}
+
+LevelFiles::ConstIterator LevelFiles::begin() const {
+  return index_ ? ConstIterator(index_.get(), 0, 0) : ConstIterator();
+}
+
+LevelFiles::ConstIterator LevelFiles::end() const {
+  return index_ ? ConstIterator(index_.get(), index_->chunks.size(), 0)
+                : ConstIterator();
+}
+
+std::shared_ptr<SSTMetadata> LevelFiles::FindFile(std::string_view key) const {
+  if (!index_) {
+    return nullptr;
+  }
+
+  // First chunk, then first file in it, whose largest key >= key
+  auto chunk = std::lower_bound(
+      index_->chunks.begin(), index_->chunks.end(), key,
+      [](const auto &chunk, std::string_view key) {
+        return chunk->back()->largest_key < key;
+      });
+  if (chunk == index_->chunks.end()) {
+    return nullptr;
+  }
+
+  auto file = std::lower_bound((*chunk)->begin(), (*chunk)->end(), key,
+                               [](const auto &file, std::string_view key) {
+                                 return file->largest_key < key;
+                               });
+  assert(file != (*chunk)->end());
+
+  return (*file)->smallest_key <= key ? *file : nullptr;
+}
+
+LevelFiles
+LevelFiles::Apply(const std::vector<std::shared_ptr<SSTMetadata>> &added,
+                  const std::vector<std::shared_ptr<SSTMetadata>> &removed,
+                  bool sorted) const {
+  if (added.empty() && removed.empty()) {
+    return *this;
+  }
+
+  const size_t total_chunks = index_ ? index_->chunks.size() : 0;
+
+  // Files added to and removed from each chunk that is touched. Files of an
+  // empty level go to its first chunk
+  std::map<size_t, std::pair<Chunk, std::unordered_set<SSTId>>> changes;
+
+  for (const auto &sst : removed) {
+    size_t chunk = total_chunks;
+    if (sorted && index_) {
+      chunk = FindChunk(sst->smallest_key);
+    } else {
+      // Level 0 only has a few files
+      for (size_t i = 0; i < total_chunks && chunk == total_chunks; i++) {
+        if (std::any_of(index_->chunks[i]->begin(), index_->chunks[i]->end(),
+                        [&sst](const auto &file) {
+                          return file->table_id == sst->table_id;
+                        })) {
+          chunk = i;
+        }
+      }
+    }
+
+    if (chunk < total_chunks) {
+      changes[chunk].second.insert(sst->table_id);
+    }
+  }
+
+  for (const auto &sst : added) {
+    const size_t chunk = (total_chunks == 0) ? 0
+                         : sorted            ? FindChunk(sst->smallest_key)
+                                             : total_chunks - 1;
+    changes[chunk].first.push_back(sst);
+  }
+
+  auto new_index = std::make_shared<Index>();
+  new_index->chunks.reserve(total_chunks + changes.size());
+  auto change = changes.begin();
+  for (size_t i = 0; i < std::max<size_t>(total_chunks, 1); i++) {
+    if (change == changes.end() || change->first != i) {
+      // Untouched chunk is shared with this list
+      if (i < total_chunks) {
+        new_index->chunks.push_back(index_->chunks[i]);
+      }
+      continue;
+    }
+
+    const auto &[added_files, removed_ids] = change->second;
+    Chunk files;
+    if (i < total_chunks) {
+      for (const auto &file : *index_->chunks[i]) {
+        if (!removed_ids.contains(file->table_id)) {
+          files.push_back(file);
+        }
+      }
+    }
+    files.insert(files.end(), added_files.begin(), added_files.end());
+
+    if (sorted) {
+      std::sort(files.begin(), files.end(), [](const auto &a, const auto &b) {
+        return a->smallest_key < b->smallest_key;
+      });
+    }
+
+    // Oversized chunk is split into half-full ones, so that next files added
+    // to them don't split them again right away
+    const size_t files_per_chunk = (files.size() > kMaxFilesPerChunk)
+                                       ? kMaxFilesPerChunk / 2
+                                       : kMaxFilesPerChunk;
+    for (size_t begin = 0; begin < files.size(); begin += files_per_chunk) {
+      const size_t end = std::min(begin + files_per_chunk, files.size());
+      new_index->chunks.push_back(std::make_shared<const Chunk>(
+          files.begin() + begin, files.begin() + end));
+    }
+
+    ++change;
+  }
+
+  if (new_index->chunks.empty()) {
+    return LevelFiles();
+  }
+
+  size_t total_files = 0;
+  new_index->ends.reserve(new_index->chunks.size());
+  for (const auto &chunk : new_index->chunks) {
+    total_files += chunk->size();
+    new_index->ends.push_back(total_files);
+  }
+
+  return LevelFiles(std::move(new_index));
+}
+
+size_t LevelFiles::FindChunk(std::string_view smallest_key) const {
+  assert(index_);
+  // Last chunk whose first file doesn't start after smallest_key
+  auto chunk = std::upper_bound(
+      index_->chunks.begin(), index_->chunks.end(), smallest_key,
+      [](std::string_view smallest_key, const auto &chunk) {
+        return smallest_key < chunk->front()->smallest_key;
+      });
+
+  return (chunk == index_->chunks.begin())
+             ? 0
+             : (chunk - index_->chunks.begin()) - 1;
+}
+
+LevelFiles::ConstIterator::ConstIterator(const Index *index, size_t chunk,
+                                         size_t offset)
+    : index_(index), chunk_(chunk), offset_(offset) {}
+
+LevelFiles::ConstIterator::reference
+LevelFiles::ConstIterator::operator*() const {
+  return (*index_->chunks[chunk_])[offset_];
+}
+
+LevelFiles::ConstIterator::pointer
+LevelFiles::ConstIterator::operator->() const {
+  return &**this;
+}
+
+LevelFiles::ConstIterator &LevelFiles::ConstIterator::operator++() {
+  if (++offset_ == index_->chunks[chunk_]->size()) {
+    chunk_++;
+    offset_ = 0;
+  }
+
+  return *this;
+}
+
+LevelFiles::ConstIterator LevelFiles::ConstIterator::operator++(int) {
+  ConstIterator old = *this;
+  ++*this;
+  return old;
+}
+
+} // namespace db
+
+} // namespace kvs
\ No newline at end of file
@@ -0,0 +1,123 @@
+#ifndef DB_LEVEL_FILES_H
+#define DB_LEVEL_FILES_H
+
+#include "db/version_edit.h"
+
+// libC++
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace kvs {
+
+namespace db {
+
+/*
+Files of a level, as a persistent list that versions share.
+
+Files are stored in chunks of at most kMaxFilesPerChunk files, that are never
+modified once built. Copying a LevelFiles only copies a pointer, and Apply()
+returns a new list that rebuilds chunks touched by a version edit and shares
+others with the old one. So creating a new version costs about
+O(changed files * kMaxFilesPerChunk + number of chunks), instead of copying
+every file of the level.
+
+Files of level >= 1 are sorted by smallest key, files of level 0 are kept in
+order they were added.
+*/
+class LevelFiles {
+public:
+  static constexpr size_t kMaxFilesPerChunk = 64;
+
+  class ConstIterator;
+
+  LevelFiles() = default;
+
+  ~LevelFiles() = default;
+
+  // Copy constructor/assignment. Chunks are shared
+  LevelFiles(const LevelFiles &) = default;
+  LevelFiles &operator=(const LevelFiles &) = default;
+
+  // Move constructor/assignment
+  LevelFiles(LevelFiles &&) = default;
+  LevelFiles &operator=(LevelFiles &&) = default;
+
+  size_t size() const;
+
+  bool empty() const;
+
+  // O(log(number of chunks))
+  const std::shared_ptr<SSTMetadata> &operator[](size_t index) const;
+
+  ConstIterator begin() const;
+
+  ConstIterator end() const;
+
+  // Only for sorted levels(level >= 1). Return file whose key range contains
+  // key, nullptr if there is none
+  std::shared_ptr<SSTMetadata> FindFile(std::string_view key) const;
+
+  // Return new list with added files and without removed ones. If sorted,
+  // files are ordered by smallest key, otherwise added files are appended
+  LevelFiles Apply(const std::vector<std::shared_ptr<SSTMetadata>> &added,
+                   const std::vector<std::shared_ptr<SSTMetadata>> &removed,
+                   bool sorted) const;
+
+private:
+  using Chunk = std::vector<std::shared_ptr<SSTMetadata>>;
+
+  struct Index {
+    // Never empty
+    std::vector<std::shared_ptr<const Chunk>> chunks;
+
+    // Total number of files up to the end of each chunk
+    std::vector<size_t> ends;
+  };
+
+  explicit LevelFiles(std::shared_ptr<const Index> index);
+
+  // Chunk that file with smallest_key belongs to, in a sorted level
+  size_t FindChunk(std::string_view smallest_key) const;
+
+  // nullptr if level is empty
+  std::shared_ptr<const Index> index_;
+};
+
+class LevelFiles::ConstIterator {
+public:
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = std::shared_ptr<SSTMetadata>;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const std::shared_ptr<SSTMetadata> *;
+  using reference = const std::shared_ptr<SSTMetadata> &;
+
+  ConstIterator() = default;
+
+  ConstIterator(const Index *index, size_t chunk, size_t offset);
+
+  reference operator*() const;
+
+  pointer operator->() const;
+
+  ConstIterator &operator++();
+
+  ConstIterator operator++(int);
+
+  bool operator==(const ConstIterator &other) const = default;
+
+private:
+  const Index *index_ = nullptr;
+
+  size_t chunk_ = 0;
+
+  size_t offset_ = 0;
+};
+
+} // namespace db
+
+} // namespace kvs
+
+#endif // DB_LEVEL_FILES_H
\ No newline at end of file
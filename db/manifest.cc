@@ -0,0 +1,264 @@
+#include "db/manifest.h"
+
+#include "db/version_edit.h"
+
+// libC++
+#include <array>
+#include <cstring>
+#include <string>
+
+namespace {
+
+constexpr char kManifestMagic[] = "KVSMANIF";
+
+enum ManifestTag : uint32_t {
+  kNextTableId = 1,
+  kSequenceNumber = 2,
+  kNewFile = 3,
+  kDeletedFile = 4
+};
+
+// Reflected polynomial of CRC-32C(Castagnoli)
+constexpr uint32_t kCrc32cPolynomial = 0x82F63B78;
+
+constexpr std::array<uint32_t, 256> BuildCrc32cTable() {
+  std::array<uint32_t, 256> table{};
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 1) ? (crc >> 1) ^ kCrc32cPolynomial : crc >> 1;
+    }
+    table[i] = crc;
+  }
+
+  return table;
+}
+
+constexpr std::array<uint32_t, 256> kCrc32cTable = BuildCrc32cTable();
+
+void PutFixed32(uint32_t value, kvs::DynamicBuffer *buffer) {
+  const kvs::Byte *const value_buff =
+      reinterpret_cast<const kvs::Byte *const>(&value);
+  buffer->insert(buffer->end(), value_buff, value_buff + sizeof(uint32_t));
+}
+
+uint32_t GetFixed32(const kvs::Byte *data) {
+  uint32_t value;
+  std::memcpy(&value, data, sizeof(uint32_t));
+  return value;
+}
+
+void PutVarint(uint64_t value, kvs::DynamicBuffer *buffer) {
+  while (value >= 0x80) {
+    buffer->push_back(static_cast<kvs::Byte>(value | 0x80));
+    value >>= 7;
+  }
+  buffer->push_back(static_cast<kvs::Byte>(value));
+}
+
+void PutLengthPrefixed(std::string_view value, kvs::DynamicBuffer *buffer) {
+  PutVarint(value.size(), buffer);
+  buffer->insert(buffer->end(), value.begin(), value.end());
+}
+
+// Decode fields of a record payload. Every getter returns false once input
+// is malformed
+class PayloadDecoder {
+public:
+  explicit PayloadDecoder(std::span<const kvs::Byte> payload)
+      : payload_(payload), offset_(0) {}
+
+  bool Done() const { return offset_ == payload_.size(); }
+
+  bool GetVarint(uint64_t *value) {
+    *value = 0;
+    for (int shift = 0; shift < 64 && offset_ < payload_.size(); shift += 7) {
+      const kvs::Byte byte = payload_[offset_++];
+      *value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+      if (!(byte & 0x80)) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  bool GetLengthPrefixed(std::string_view *value) {
+    uint64_t length;
+    if (!GetVarint(&length) || length > payload_.size() - offset_) {
+      return false;
+    }
+
+    *value = std::string_view(
+        reinterpret_cast<const char *>(payload_.data() + offset_), length);
+    offset_ += length;
+    return true;
+  }
+
+private:
+  std::span<const kvs::Byte> payload_;
+
+  size_t offset_;
+};
+
+bool DecodePayload(std::span<const kvs::Byte> payload,
+                   std::string_view db_path,
+                   kvs::db::VersionEdit *version_edit) {
+  const uint64_t num_levels = version_edit->GetImmutableNewFiles().size();
+  PayloadDecoder decoder(payload);
+  uint64_t tag, value, table_id, level, file_size, min_txn_id, max_txn_id;
+  std::string_view smallest_key, largest_key;
+
+  while (!decoder.Done()) {
+    if (!decoder.GetVarint(&tag)) {
+      return false;
+    }
+
+    switch (tag) {
+    case kNextTableId:
+      if (!decoder.GetVarint(&value)) {
+        return false;
+      }
+      version_edit->SetNextTableId(value);
+      break;
+    case kSequenceNumber:
+      if (!decoder.GetVarint(&value)) {
+        return false;
+      }
+      version_edit->SetSequenceNumber(value);
+      break;
+    case kNewFile:
+      if (!decoder.GetVarint(&table_id) || !decoder.GetVarint(&level) ||
+          !decoder.GetVarint(&file_size) ||
+          !decoder.GetLengthPrefixed(&smallest_key) ||
+          !decoder.GetLengthPrefixed(&largest_key) ||
+          !decoder.GetVarint(&min_txn_id) || !decoder.GetVarint(&max_txn_id) ||
+          level >= num_levels) {
+        return false;
+      }
+      version_edit->AddNewFiles(
+          table_id, static_cast<int>(level), file_size, smallest_key,
+          largest_key,
+          std::string(db_path) + std::to_string(table_id) + ".sst",
+          min_txn_id, max_txn_id);
+      break;
+    case kDeletedFile:
+      if (!decoder.GetVarint(&table_id) || !decoder.GetVarint(&level) ||
+          level >= num_levels) {
+        return false;
+      }
+      version_edit->RemoveFiles(table_id, static_cast<int>(level));
+      break;
+    default:
+      // Unknown field, written by a newer format
+      return false;
+    }
+  }
+
+  return true;
+}
+
+} // namespace
+
+namespace kvs {
+
+namespace db {
+
+void EncodeManifestHeader(DynamicBuffer *buffer) {
+  buffer->insert(buffer->end(), kManifestMagic,
+                 kManifestMagic + kManifestHeaderSize - sizeof(uint32_t));
+  PutFixed32(kManifestFormatVersion, buffer);
+}
+
+std::optional<uint32_t> DecodeManifestHeader(std::span<const Byte> data) {
+  const size_t magic_size = kManifestHeaderSize - sizeof(uint32_t);
+  if (data.size() < kManifestHeaderSize ||
+      std::memcmp(data.data(), kManifestMagic, magic_size) != 0) {
+    return std::nullopt;
+  }
+
+  return GetFixed32(data.data() + magic_size);
+}
+
+void EncodeManifestRecord(const VersionEdit *version_edit,
+                          DynamicBuffer *buffer) {
+  DynamicBuffer payload;
+
+  PutVarint(kNextTableId, &payload);
+  PutVarint(version_edit->GetNextTableId(), &payload);
+
+  PutVarint(kSequenceNumber, &payload);
+  PutVarint(version_edit->GetSequenceNumber(), &payload);
+
+  for (const auto &new_files : version_edit->GetImmutableNewFiles()) {
+    for (const auto &new_file : new_files) {
+      PutVarint(kNewFile, &payload);
+      PutVarint(new_file->table_id, &payload);
+      PutVarint(new_file->level, &payload);
+      PutVarint(new_file->file_size, &payload);
+      PutLengthPrefixed(new_file->smallest_key, &payload);
+      PutLengthPrefixed(new_file->largest_key, &payload);
+      PutVarint(new_file->min_txn_id, &payload);
+      PutVarint(new_file->max_txn_id, &payload);
+    }
+  }
+
+  for (const auto &[table_id, level] :
+       version_edit->GetImmutableDeletedFiles()) {
+    PutVarint(kDeletedFile, &payload);
+    PutVarint(table_id, &payload);
+    PutVarint(level, &payload);
+  }
+
+  PutFixed32(Crc32c(payload), buffer);
+  PutFixed32(static_cast<uint32_t>(payload.size()), buffer);
+  buffer->insert(buffer->end(), payload.begin(), payload.end());
+}
+
+ManifestReadStatus ReadManifestRecord(std::span<const Byte> data,
+                                      uint64_t *offset,
+                                      std::string_view db_path,
+                                      VersionEdit *version_edit) {
+  if (*offset == data.size()) {
+    return ManifestReadStatus::kEndOfFile;
+  }
+
+  if (data.size() - *offset < kManifestRecordHeaderSize) {
+    return ManifestReadStatus::kTruncated;
+  }
+
+  const uint32_t crc = GetFixed32(data.data() + *offset);
+  const uint32_t length = GetFixed32(data.data() + *offset + sizeof(uint32_t));
+  const uint64_t payload_offset = *offset + kManifestRecordHeaderSize;
+  if (data.size() - payload_offset < length) {
+    return ManifestReadStatus::kTruncated;
+  }
+
+  std::span<const Byte> payload = data.subspan(payload_offset, length);
+  if (Crc32c(payload) != crc) {
+    // Garbage in the last record is what a torn append leaves behind
+    return (payload_offset + length == data.size())
+               ? ManifestReadStatus::kTruncated
+               : ManifestReadStatus::kCorruption;
+  }
+
+  if (!DecodePayload(payload, db_path, version_edit)) {
+    return ManifestReadStatus::kCorruption;
+  }
+
+  *offset = payload_offset + length;
+  return ManifestReadStatus::kOk;
+}
+
+uint32_t Crc32c(std::span<const Byte> data) {
+  uint32_t crc = 0xFFFFFFFF;
+  for (Byte byte : data) {
+    crc = kCrc32cTable[(crc ^ byte) & 0xFF] ^ (crc >> 8);
+  }
+
+  return crc ^ 0xFFFFFFFF;
+}
+
+} // namespace db
+
+} // namespace kvs
\ No newline at end of file
@@ -0,0 +1,72 @@
+#ifndef DB_MANIFEST_H
+#define DB_MANIFEST_H
+
+#include "common/macros.h"
+
+// libC++
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+
+namespace kvs {
+
+namespace db {
+
+class VersionEdit;
+
+/*
+Binary MANIFEST layout:
+
+  header : magic(8 bytes) | format version(4 bytes)
+  record : crc32c of payload(4 bytes) | payload length(4 bytes) | payload
+
+Payload of a record is a list of fields, each field starts with a varint tag:
+  kNextTableId    : varint64
+  kSequenceNumber : varint64
+  kNewFile        : varint64 id | varint32 level | varint64 size |
+                    varint32 length + smallest key | varint32 length +
+                    largest key | varint64 min txn id | varint64 max txn id
+  kDeletedFile    : varint64 id | varint32 level
+
+Keys are length prefixed, so they can contain any byte.
+*/
+constexpr uint32_t kManifestFormatVersion = 1;
+
+constexpr size_t kManifestHeaderSize = 12;
+
+constexpr size_t kManifestRecordHeaderSize = 8;
+
+enum class ManifestReadStatus {
+  kOk,
+  // No record left
+  kEndOfFile,
+  // Last record was only partially written, e.g. crash while appending it
+  kTruncated,
+  kCorruption
+};
+
+// Append header that starts every binary MANIFEST
+void EncodeManifestHeader(DynamicBuffer *buffer);
+
+// Return format version if data starts with a binary MANIFEST header
+std::optional<uint32_t> DecodeManifestHeader(std::span<const Byte> data);
+
+// Append version_edit as one record
+void EncodeManifestRecord(const VersionEdit *version_edit,
+                          DynamicBuffer *buffer);
+
+// Decode record that starts at offset of data into version_edit, then move
+// offset to the next record. Filename of new files is built from db_path
+ManifestReadStatus ReadManifestRecord(std::span<const Byte> data,
+                                      uint64_t *offset,
+                                      std::string_view db_path,
+                                      VersionEdit *version_edit);
+
+uint32_t Crc32c(std::span<const Byte> data);
+
+} // namespace db
+
+} // namespace kvs
+
+#endif // DB_MANIFEST_H
\ No newline at end of file
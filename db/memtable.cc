@@ -17,6 +17,7 @@ void MemTable::BatchDelete(std::span<std::string_view> keys, TxnId txn_id) {
     std::exit(EXIT_FAILURE);
   }
 
+  std::unique_lock lock(mutex_);
   table_->BatchDelete(keys, txn_id);
 }
 
@@ -25,6 +26,7 @@ void MemTable::Delete(std::string_view key, TxnId txn_id) {
     std::exit(EXIT_FAILURE);
   }
 
+  std::unique_lock lock(mutex_);
   table_->Delete(key, txn_id);
 }
 
@@ -63,6 +65,24 @@ GetStatus MemTable::Get(std::string_view key, TxnId txn_id) {
   return table_->Get(key, txn_id);
 }
 
+ValueType MemTable::Get(std::string_view key, TxnId txn_id,
+                        PinnableValue *value) {
+  if (!table_) {
+    std::exit(EXIT_FAILURE);
+  }
+
+  return table_->Get(key, txn_id, value);
+}
+
+void MemTable::MultiGet(std::span<const std::string_view> keys, TxnId txn_id,
+                        std::span<GetStatus> statuses) {
+  if (!table_) {
+    std::exit(EXIT_FAILURE);
+  }
+
+  table_->MultiGet(keys, txn_id, statuses);
+}
+
 void MemTable::BatchPut(
     std::span<std::pair<std::string_view, std::string_view>> keys,
     TxnId txn_id) {
@@ -70,6 +90,7 @@ void MemTable::BatchPut(
     std::exit(EXIT_FAILURE);
   }
 
+  std::unique_lock lock(mutex_);
   table_->BatchPut(keys, txn_id);
 }
 
@@ -78,6 +99,7 @@ void MemTable::Put(std::string_view key, std::string_view value, TxnId txn_id) {
     std::exit(EXIT_FAILURE);
   }
 
+  std::unique_lock lock(mutex_);
   table_->Put(key, value, txn_id);
 }
 
@@ -8,7 +8,6 @@
 #include <atomic>
 #include <memory>
 #include <mutex>
-#include <shared_mutex>
 #include <span>
 #include <string_view>
 
@@ -44,6 +43,12 @@ public:
 
   GetStatus Get(std::string_view key, TxnId txn_id) override;
 
+  ValueType Get(std::string_view key, TxnId txn_id,
+                PinnableValue *value) override;
+
+  void MultiGet(std::span<const std::string_view> keys, TxnId txn_id,
+                std::span<GetStatus> statuses) override;
+
   void BatchPut(std::span<std::pair<std::string_view, std::string_view>> keys,
                 TxnId txn_id) override;
 
@@ -58,6 +63,9 @@ public:
 private:
   std::atomic<bool> is_flushing_;
 
+  // Serialize writers. Readers go to SkipList without lock
+  std::mutex mutex_;
+
   const uint64_t version_;
 
   std::unique_ptr<SkipList> table_;
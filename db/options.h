@@ -0,0 +1,25 @@
+#ifndef DB_OPTIONS_H
+#define DB_OPTIONS_H
+
+namespace kvs {
+
+namespace db {
+
+class Snapshot;
+
+struct ReadOptions {
+  // If non-null, read as of the state pinned by this snapshot. Otherwise, read
+  // the latest published state.
+  const Snapshot *snapshot{nullptr};
+
+  // If false, blocks read from disk by this read aren't added into block
+  // cache. Scans and batch jobs should set it, so that blocks they read once
+  // don't take the place of hot blocks.
+  bool fill_cache{true};
+};
+
+} // namespace db
+
+} // namespace kvs
+
+#endif // DB_OPTIONS_H
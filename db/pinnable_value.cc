@@ -0,0 +1,59 @@
+#include "db/pinnable_value.h"
+
+namespace kvs {
+
+namespace db {
+
+PinnableValue::PinnableValue(PinnableValue &&other) noexcept {
+  *this = std::move(other);
+}
+
+PinnableValue &PinnableValue::operator=(PinnableValue &&other) noexcept {
+  if (this == &other) {
+    return *this;
+  }
+
+  pin_ = std::move(other.pin_);
+  if (pin_) {
+    buffer_.clear();
+    value_ = other.value_;
+  } else {
+    // Moving a short string doesn't keep its address, so view must be rebuilt
+    buffer_ = std::move(other.buffer_);
+    value_ = buffer_;
+  }
+
+  other.Reset();
+  return *this;
+}
+
+void PinnableValue::PinSlice(std::string_view value,
+                             std::shared_ptr<const void> pin) {
+  buffer_.clear();
+  pin_ = std::move(pin);
+  value_ = value;
+}
+
+void PinnableValue::PinSelf(std::string_view value) {
+  pin_.reset();
+  buffer_.assign(value.data(), value.size());
+  value_ = buffer_;
+}
+
+void PinnableValue::Reset() {
+  pin_.reset();
+  buffer_.clear();
+  value_ = std::string_view{};
+}
+
+bool PinnableValue::IsPinned() const { return pin_ != nullptr; }
+
+std::string_view PinnableValue::GetView() const { return value_; }
+
+std::string PinnableValue::ToString() const { return std::string(value_); }
+
+size_t PinnableValue::size() const { return value_.size(); }
+
+} // namespace db
+
+} // namespace kvs
\ No newline at end of file
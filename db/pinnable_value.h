@@ -0,0 +1,62 @@
+#ifndef DB_PINNABLE_VALUE_H
+#define DB_PINNABLE_VALUE_H
+
+// libC++
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace kvs {
+
+namespace db {
+
+// Value returned by Get without being copied. It either references memory
+// owned by someone else(memtable node, cached block, ...), which is kept alive
+// by pin until PinnableValue is reset/destroyed, or owns a copy of value when
+// nothing can be pinned.
+class PinnableValue {
+public:
+  PinnableValue() = default;
+
+  ~PinnableValue() = default;
+
+  // No copy allowed
+  PinnableValue(const PinnableValue &) = delete;
+  PinnableValue &operator=(PinnableValue &) = delete;
+
+  // Move constructor/assignment
+  PinnableValue(PinnableValue &&other) noexcept;
+  PinnableValue &operator=(PinnableValue &&other) noexcept;
+
+  // Reference value directly. pin MUST keep memory of value alive
+  void PinSlice(std::string_view value, std::shared_ptr<const void> pin);
+
+  // Make a copy of value
+  void PinSelf(std::string_view value);
+
+  // Release pin and drop value
+  void Reset();
+
+  // True if value references memory that isn't owned by this object
+  bool IsPinned() const;
+
+  std::string_view GetView() const;
+
+  std::string ToString() const;
+
+  size_t size() const;
+
+private:
+  std::string buffer_;
+
+  // Either view over buffer_ or over memory kept alive by pin_
+  std::string_view value_;
+
+  std::shared_ptr<const void> pin_;
+};
+
+} // namespace db
+
+} // namespace kvs
+
+#endif // DB_PINNABLE_VALUE_H
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include "db/row_cache.h"
+
+// libC++
+#include <cassert>
+#include <functional>
+
+namespace {
+
+// Used to size hash table of cache
+constexpr size_t kEstimatedRowSize = 128; // Bytes
+
+} // namespace
+
+namespace kvs {
+
+namespace db {
+
+RowItem::RowItem(ValueType type, std::string_view value)
+    : ref_count_(0), type_(type), value_(value) {}
+
+void RowItem::IncRef() const {
+  ref_count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RowItem::Unref() const {
+  assert(ref_count_ > 0);
+  ref_count_.fetch_sub(1, std::memory_order_release);
+}
+
+uint64_t RowItem::GetRefCount() const {
+  return ref_count_.load(std::memory_order_acquire);
+}
+
+ValueType RowItem::GetType() const { return type_; }
+
+std::string_view RowItem::GetValue() const { return value_; }
+
+RowCache::RowCache(size_t capacity)
+    : cache_(capacity, capacity / kEstimatedRowSize, true /*admission*/) {}
+
+std::shared_ptr<RowItem> RowCache::Lookup(SSTId table_id,
+                                          std::string_view key) const {
+  return cache_.Lookup({table_id, std::string(key)});
+}
+
+bool RowCache::Contains(SSTId table_id, std::string_view key) const {
+  return cache_.Contains({table_id, std::string(key)});
+}
+
+std::shared_ptr<RowItem> RowCache::Insert(SSTId table_id,
+                                          std::string_view key, ValueType type,
+                                          std::string_view value) const {
+  assert(type == ValueType::PUT || type == ValueType::DELETED ||
+         type == ValueType::NOT_FOUND);
+  const size_t charge =
+      sizeof(RowItem) + sizeof(RowKey) + key.size() + value.size();
+
+  return cache_.Insert({table_id, std::string(key)},
+                       std::make_shared<RowItem>(type, value), charge);
+}
+
+void RowCache::EraseTables(const std::set<SSTId> &table_ids) const {
+  if (table_ids.empty()) {
+    return;
+  }
+
+  cache_.EraseIf([&table_ids](const RowKey &row_key) {
+    return table_ids.contains(row_key.first);
+  });
+}
+
+size_t RowCache::GetCapacity() const { return cache_.GetCapacity(); }
+
+size_t RowCache::GetUsage() const { return cache_.GetUsage(); }
+
+uint64_t RowCache::RowKeyHash::operator()(const RowKey &row_key) const {
+  uint64_t hash = std::hash<std::string>{}(row_key.second) ^
+                  (row_key.first * 0x9E3779B97F4A7C15ULL);
+  hash ^= hash >> 33;
+  hash *= 0xFF51AFD7ED558CCDULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+} // namespace db
+
+} // namespace kvs
\ No newline at end of file
@@ -0,0 +1,116 @@
+#ifndef DB_ROW_CACHE_H
+#define DB_ROW_CACHE_H
+
+#include "common/macros.h"
+#include "db/status.h"
+#include "sstable/clock_cache.h"
+
+// libC++
+#include <atomic>
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+
+namespace kvs {
+
+namespace db {
+
+// Result of looking up a key in a table
+class RowItem {
+public:
+  RowItem(ValueType type, std::string_view value);
+
+  ~RowItem() = default;
+
+  // No copy allowed
+  RowItem(const RowItem &) = delete;
+  RowItem &operator=(RowItem &) = delete;
+
+  // No move allowed
+  RowItem(RowItem &&) = delete;
+  RowItem &operator=(RowItem &&) = delete;
+
+  void IncRef() const;
+
+  // It must be called each time an operation is finished
+  void Unref() const;
+
+  uint64_t GetRefCount() const;
+
+  // PUT, DELETED or NOT_FOUND(key isn't in table)
+  ValueType GetType() const;
+
+  // Empty if type isn't PUT
+  std::string_view GetValue() const;
+
+private:
+  mutable std::atomic<int64_t> ref_count_;
+
+  const ValueType type_;
+
+  const std::string value_;
+};
+
+/*
+Cache of final results of point lookups, keyed by (table id, user key). A hit
+replaces the lookups in table cache, index, block cache and block.
+
+A table is immutable, so the newest version of a key in it never changes. Only
+reads that can see every entry of table(txn_id >= max txn id of table) get that
+version, so only those reads use the cache. Older snapshots always go to
+table.
+
+New tables don't invalidate anything: entries of older tables stay right for
+those tables, and newer tables are looked up first. Entries of tables deleted
+by compaction are erased, so that they don't hold memory until being evicted.
+*/
+class RowCache {
+public:
+  explicit RowCache(size_t capacity);
+
+  ~RowCache() = default;
+
+  // No copy allowed
+  RowCache(const RowCache &) = delete;
+  RowCache &operator=(RowCache &) = delete;
+
+  // No move allowed
+  RowCache(RowCache &&) = delete;
+  RowCache &operator=(RowCache &&) = delete;
+
+  // Return result with its ref count increased, caller MUST call Unref() once
+  // finished with it. nullptr if key of table isn't in cache
+  std::shared_ptr<RowItem> Lookup(SSTId table_id, std::string_view key) const;
+
+  // Check whether key of table is in cache, without taking a reference to it
+  bool Contains(SSTId table_id, std::string_view key) const;
+
+  // Return result that is in cache after insertion, with its ref count
+  // increased. nullptr if it can't be inserted
+  std::shared_ptr<RowItem> Insert(SSTId table_id, std::string_view key,
+                                  ValueType type, std::string_view value) const;
+
+  // Erase entries of tables
+  void EraseTables(const std::set<SSTId> &table_ids) const;
+
+  size_t GetCapacity() const;
+
+  // Bytes held by cached entries
+  size_t GetUsage() const;
+
+private:
+  using RowKey = std::pair<SSTId, std::string>;
+
+  struct RowKeyHash {
+    uint64_t operator()(const RowKey &row_key) const;
+  };
+
+  sstable::ClockCache<RowKey, RowItem, RowKeyHash> cache_;
+};
+
+} // namespace db
+
+} // namespace kvs
+
+#endif // DB_ROW_CACHE_H
\ No newline at end of file
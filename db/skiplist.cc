@@ -2,6 +2,9 @@
 
 #include "db/skiplist_node.h"
 
+// libC++
+#include <cassert>
+
 namespace kvs {
 
 namespace db {
@@ -11,7 +14,7 @@ SkipList::SkipList(int max_level)
       gen_(std::mt19937(std::random_device()())), current_size_(0),
       dist_level_(std::uniform_int_distribution<>(0, 1)),
       head_(std::make_shared<SkipListNode>("" /*key*/, "" /*value*/,
-                                           0 /*txn_id*/, current_level_,
+                                           0 /*txn_id*/, max_level,
                                            ValueType::NOT_FOUND)) {}
 
 // Return random number of levels that a node is inserted
@@ -34,7 +37,6 @@ void SkipList::BatchDelete(std::span<std::string_view> keys, TxnId txn_id) {
 std::vector<std::pair<std::string, GetStatus>>
 SkipList::BatchGet(std::span<std::string_view> keys, TxnId txn_id) {
   std::vector<std::pair<std::string, GetStatus>> values;
-  std::shared_ptr<SkipListNode> current{nullptr};
 
   GetStatus status;
   for (std::string_view key : keys) {
@@ -45,9 +47,10 @@ SkipList::BatchGet(std::span<std::string_view> keys, TxnId txn_id) {
   return values;
 }
 
-// TODO(namnh) : update when transaction is implemented.
 GetStatus SkipList::Get(std::string_view key, TxnId txn_id) {
-  std::shared_ptr<SkipListNode> current = FindLowerBoundNode(key);
+  // Versions of the same key are sorted from newest to oldest, so the first
+  // node at or after (key, txn_id) is the newest one visible to txn_id
+  const SkipListNode *current = FindLowerBoundNode(key, txn_id);
   GetStatus status;
 
   if (!current || current->key_ != key) {
@@ -63,15 +66,61 @@ GetStatus SkipList::Get(std::string_view key, TxnId txn_id) {
   return status;
 }
 
+ValueType SkipList::Get(std::string_view key, TxnId txn_id,
+                        PinnableValue *value) {
+  assert(value);
+  value->Reset();
+
+  SkipListNode *current = FindLowerBoundNode(key, txn_id);
+  if (!current || current->key_ != key) {
+    return ValueType::NOT_FOUND;
+  }
+
+  if (current->value_type_ == ValueType::PUT && current->value_) {
+    const std::string_view found_value = current->value_.value();
+    value->PinSlice(found_value, current->shared_from_this());
+    return ValueType::PUT;
+  }
+
+  return current->value_type_;
+}
+
+void SkipList::MultiGet(std::span<const std::string_view> keys, TxnId txn_id,
+                        std::span<GetStatus> statuses) {
+  assert(keys.size() == statuses.size());
+
+  // Nodes found at each level by previous search. Because keys are sorted,
+  // they are always before the next searched key
+  std::vector<SkipListNode *> finger(max_level_, nullptr);
+  const SkipListNode *current;
+
+  for (size_t i = 0; i < keys.size(); i++) {
+    assert(i == 0 || keys[i - 1] <= keys[i]);
+    if (statuses[i].type != ValueType::NOT_FOUND) {
+      continue;
+    }
+
+    current = FindLowerBoundNode(keys[i], txn_id, &finger);
+    if (!current || current->key_ != keys[i]) {
+      continue;
+    }
+
+    statuses[i].type = current->value_type_;
+    statuses[i].value = (current->value_type_ == ValueType::PUT)
+                            ? current->value_
+                            : std::nullopt;
+  }
+}
+
 std::vector<std::optional<std::string>>
 SkipList::GetAllPrefixes(std::string_view key, TxnId txn_id) {
   std::vector<std::optional<std::string>> values;
-  std::shared_ptr<SkipListNode> current = FindLowerBoundNode(key);
+  const SkipListNode *current = FindLowerBoundNode(key);
 
   // Traverse while key starts with prefix
   while (current && current->key_.starts_with(key)) {
     values.push_back(current->value_);
-    current = current->forward_[0];
+    current = current->GetNext(0);
   }
 
   return values;
@@ -98,8 +147,8 @@ void SkipList::Delete(std::string_view key, TxnId txn_id) {
 
 void SkipList::Put_(std::string_view key, std::optional<std::string_view> value,
                     TxnId txn_id, ValueType value_type) {
-  std::vector<std::shared_ptr<SkipListNode>> updates(max_level_, nullptr);
-  std::shared_ptr<SkipListNode> current = FindLowerBoundNode(key, &updates);
+  std::vector<SkipListNode *> updates(max_level_, nullptr);
+  FindLowerBoundNode(key, txn_id, &updates);
 
   if (value_type == ValueType::PUT) {
     // Update new size of skiplist
@@ -110,38 +159,56 @@ void SkipList::Put_(std::string_view key, std::optional<std::string_view> value,
   }
 
   int new_level = GetRandomLevel();
-  auto new_node =
-      std::make_shared<SkipListNode>(key, value, txn_id, new_level, value_type);
-  if (new_level > current_level_) {
-    for (int level = current_level_; level < new_level; ++level) {
-      updates[level] = head_;
-      // We need to rechange size.
-      updates[level]->forward_.resize(new_level, nullptr);
-      updates[level]->backward_.resize(new_level);
+  nodes_.push_back(std::make_shared<SkipListNode>(key, value, txn_id,
+                                                  new_level, value_type));
+  SkipListNode *new_node = nodes_.back().get();
+
+  const int current_level = current_level_.load(std::memory_order_relaxed);
+  if (new_level > current_level) {
+    for (int level = current_level; level < new_level; ++level) {
+      updates[level] = head_.get();
     }
-    current_level_ = new_level;
+    // Reader that sees new level before new node is linked just finds null
+    // link of head_ at that level and moves down
+    current_level_.store(new_level, std::memory_order_relaxed);
   }
 
-  // Insert!!!
+  // Insert!!! New node is completely linked before it is published at each
+  // level, so readers always walk through a valid list
   for (int level = 0; level < new_level; ++level) {
-    new_node->forward_[level] = updates[level]->forward_[level];
-    if (new_node->forward_[level]) {
-      new_node->forward_[level]->backward_[level] = new_node;
+    SkipListNode *next = updates[level]->GetNext(level);
+    new_node->SetNext(level, next);
+    new_node->SetPrev(level, updates[level]);
+    updates[level]->SetNext(level, new_node);
+    if (next) {
+      next->SetPrev(level, new_node);
     }
-
-    updates[level]->forward_[level] = new_node;
-    new_node->backward_[level] = updates[level];
   }
 }
 
-std::shared_ptr<SkipListNode> SkipList::FindLowerBoundNode(
-    std::string_view key,
-    std::vector<std::shared_ptr<SkipListNode>> *updates) const {
-  std::shared_ptr<SkipListNode> current = head_;
+SkipListNode *
+SkipList::FindLowerBoundNode(std::string_view key, TxnId txn_id,
+                             std::vector<SkipListNode *> *updates) const {
+  SkipListNode *const head = head_.get();
+  SkipListNode *current = head;
+
+  auto is_before = [key, txn_id](const SkipListNode *node) {
+    return node->key_ < key || (node->key_ == key && node->txn_id_ > txn_id);
+  };
+
+  SkipListNode *next;
+  for (int level = current_level_.load(std::memory_order_relaxed) - 1;
+       level >= 0; --level) {
+    if (updates && (*updates)[level] && (*updates)[level] != head &&
+        (current == head || current->key_ < (*updates)[level]->key_ ||
+         (current->key_ == (*updates)[level]->key_ &&
+          current->txn_id_ > (*updates)[level]->txn_id_))) {
+      // Node found by previous search is closer to key than current node
+      current = (*updates)[level];
+    }
 
-  for (int level = current_level_ - 1; level >= 0; --level) {
-    while (current->forward_[level] && current->forward_[level]->key_ < key) {
-      current = current->forward_[level];
+    while ((next = current->GetNext(level)) && is_before(next)) {
+      current = next;
     }
     if (updates) {
       (*updates)[level] = current;
@@ -149,8 +216,7 @@ std::shared_ptr<SkipListNode> SkipList::FindLowerBoundNode(
   }
 
   // Move to next node in level 0
-  current = current->forward_[0];
-  return current;
+  return current->GetNext(0);
 }
 
 size_t SkipList::GetCurrentSize() { return current_size_; }
@@ -158,7 +224,7 @@ size_t SkipList::GetCurrentSize() { return current_size_; }
 void SkipList::PrintSkipList() {
   for (int level = 0; level < current_level_; level++) {
     std::cout << "Level " << level << ": ";
-    std::shared_ptr<SkipListNode> current = head_->forward_[level];
+    const SkipListNode *current = head_->GetNext(level);
     while (current) {
       if (current->value_) {
         std::cout << "( " << static_cast<int>(current->value_type_) << " "
@@ -167,7 +233,7 @@ void SkipList::PrintSkipList() {
         std::cout << "( " << static_cast<int>(current->value_type_) << " "
                   << current->key_ << " )";
       }
-      current = current->forward_[level];
+      current = current->GetNext(level);
       if (current) {
         std::cout << " -> ";
       }
@@ -2,8 +2,10 @@
 #define DB_SKIPLIST_H
 
 #include "common/macros.h"
+#include "db/pinnable_value.h"
 #include "db/status.h"
 
+#include <atomic>
 #include <iostream>
 #include <memory>
 #include <optional>
@@ -11,6 +13,7 @@
 #include <span>
 #include <string>
 #include <string_view>
+#include <vector>
 
 namespace kvs {
 
@@ -19,9 +22,9 @@ namespace db {
 class SkipListIterator;
 class SkipListNode;
 
-// ALL methods in this class ARE NOT THREAD-SAFE.
-// It means that lock MUST be acquired in memtable
-// before calling those below methods.
+// Writes MUST be serialized by memtable. Reads need no lock, they can run
+// concurrently with the single writer(same as LevelDB's skiplist). Nodes are
+// never removed until skiplist is freed
 class SkipList {
 public:
   explicit SkipList(int max_level = 16);
@@ -32,9 +35,9 @@ public:
   SkipList(const SkipList &) = delete;
   SkipList &operator=(const SkipList &) = delete;
 
-  // Move constructor/assignment
-  SkipList(SkipList &&) = default;
-  SkipList &operator=(SkipList &&) = default;
+  // No move allowed
+  SkipList(SkipList &&) = delete;
+  SkipList &operator=(SkipList &&) = delete;
 
   void BatchDelete(std::span<std::string_view> keys, TxnId txn_id);
 
@@ -43,8 +46,19 @@ public:
   std::vector<std::pair<std::string, GetStatus>>
   BatchGet(std::span<std::string_view> keys, TxnId txn_id);
 
+  // Return newest version of key whose txn_id <= given txn_id
   GetStatus Get(std::string_view key, TxnId txn_id);
 
+  // Same as above, but value isn't copied. It references node that contains
+  // it, and node is kept alive by value even after memtable is freed
+  ValueType Get(std::string_view key, TxnId txn_id, PinnableValue *value);
+
+  // keys MUST be sorted in ascending order. Each search resumes from where
+  // search of previous key stopped(finger search). Only keys whose status is
+  // still NOT_FOUND are looked up
+  void MultiGet(std::span<const std::string_view> keys, TxnId txn_id,
+                std::span<GetStatus> statuses);
+
   std::vector<std::optional<std::string>> GetAllPrefixes(std::string_view key,
                                                          TxnId txn_id);
 
@@ -69,15 +83,19 @@ private:
   void Put_(std::string_view key, std::optional<std::string_view> value,
             TxnId txn_id, ValueType value_type);
 
-  // Get node at current 0 whose value is less than key.
+  // Nodes are ordered by (key asc, txn_id desc). Get first node at level 0
+  // that is not less than (key, txn_id) in that order.
   // Also, if the operation is PUT or DELETE, each node whose key < key needed
   // to find at each level needed to be found and be added into "updates" list
-  std::shared_ptr<SkipListNode> FindLowerBoundNode(
-      std::string_view key,
-      std::vector<std::shared_ptr<SkipListNode>> *updates = nullptr) const;
+  // If "updates" already holds nodes found by a search for a smaller key,
+  // search resumes from those nodes instead of head
+  SkipListNode *
+  FindLowerBoundNode(std::string_view key, TxnId txn_id = kMaxTxnId,
+                     std::vector<SkipListNode *> *updates = nullptr) const;
 
-  // adaptive number of current levels
-  int current_level_;
+  // adaptive number of current levels. Reader may see a stale one, that is
+  // still correct because head_ links all levels from the beginning
+  std::atomic<int> current_level_;
 
   // TODO(namnh) Change when support config
   uint8_t max_level_;
@@ -88,6 +106,9 @@ private:
 
   std::shared_ptr<SkipListNode> head_;
 
+  // Own all inserted nodes. Only writer touches it
+  std::vector<std::shared_ptr<SkipListNode>> nodes_;
+
   size_t current_size_; // bytes unit
 
   // For testing mem leak
@@ -45,27 +45,27 @@ TxnId SkipListIterator::GetTransactionId() {
 
 bool SkipListIterator::IsValid() { return node_ != nullptr; }
 
-void SkipListIterator::Next() { node_ = node_->forward_[0]; }
+void SkipListIterator::Next() { SetNode(node_->GetNext(0)); }
 
-void SkipListIterator::Prev() { node_ = node_->backward_[0].lock(); }
+void SkipListIterator::Prev() { SetNode(node_->GetPrev(0)); }
 
 void SkipListIterator::Seek(std::string_view key) {
   if (!skiplist_) {
     return;
   }
 
-  node_ = skiplist_->FindLowerBoundNode(key);
+  SetNode(skiplist_->FindLowerBoundNode(key));
   if (node_ && node_->key_ == key) {
     return;
   }
-  node_ = node_->forward_[0];
+  SetNode(node_->GetNext(0));
 }
 
 void SkipListIterator::SeekToFirst() {
   if (!skiplist_) {
     return;
   }
-  node_ = skiplist_->head_->forward_[0];
+  SetNode(skiplist_->head_->GetNext(0));
 }
 
 void SkipListIterator::SeekToLast() {
@@ -73,10 +73,15 @@ void SkipListIterator::SeekToLast() {
     return;
   }
 
-  node_ = skiplist_->head_->forward_[0];
-  while (node_->forward_[0]) {
-    node_ = node_->forward_[0];
+  const SkipListNode *node = skiplist_->head_->GetNext(0);
+  while (node->GetNext(0)) {
+    node = node->GetNext(0);
   }
+  SetNode(node);
+}
+
+void SkipListIterator::SetNode(const SkipListNode *node) {
+  node_ = node ? node->shared_from_this() : nullptr;
 }
 
 } // namespace db
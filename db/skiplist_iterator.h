@@ -44,6 +44,9 @@ public:
   void SeekToLast() override;
 
 private:
+  // Node is kept alive by iterator, even after skiplist is freed
+  void SetNode(const SkipListNode *node);
+
   // NOTE: DONT free this pointer.
   // This pointer is taken by unique_ptr GET API .It will be auto-released.
   // Releasing memory can cause undefined behaviour.
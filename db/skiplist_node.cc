@@ -9,9 +9,24 @@ SkipListNode::SkipListNode(std::string_view key,
                            int num_level, ValueType value_type)
     : key_(key),
       value_(value ? std::make_optional<std::string>(*value) : std::nullopt),
-      txn_id_(txn_id), num_level_(num_level), forward_(num_level, nullptr),
-      value_type_(value_type),
-      backward_(num_level, std::weak_ptr<SkipListNode>()) {}
+      txn_id_(txn_id), num_level_(num_level), forward_(num_level),
+      value_type_(value_type), backward_(num_level) {}
+
+SkipListNode *SkipListNode::GetNext(int level) const {
+  return forward_[level].load(std::memory_order_acquire);
+}
+
+void SkipListNode::SetNext(int level, SkipListNode *node) {
+  forward_[level].store(node, std::memory_order_release);
+}
+
+SkipListNode *SkipListNode::GetPrev(int level) const {
+  return backward_[level].load(std::memory_order_acquire);
+}
+
+void SkipListNode::SetPrev(int level, SkipListNode *node) {
+  backward_[level].store(node, std::memory_order_release);
+}
 
 } // namespace db
 
@@ -4,6 +4,7 @@
 #include "common/macros.h"
 #include "db/status.h"
 
+#include <atomic>
 #include <memory>
 #include <optional>
 #include <string>
@@ -23,6 +24,17 @@ public:
 
   bool operator==(const SkipListNode &other);
 
+  // Readers traverse nodes while the single writer links new ones. Links are
+  // published with release stores, so a reader that loads a node with acquire
+  // sees it fully initialized
+  SkipListNode *GetNext(int level) const;
+
+  void SetNext(int level, SkipListNode *node);
+
+  SkipListNode *GetPrev(int level) const;
+
+  void SetPrev(int level, SkipListNode *node);
+
   friend class SkipList;
   friend class SkipListIterator;
 
@@ -38,11 +50,10 @@ private:
 
   ValueType value_type_;
 
-  // Travel from high level to low level
-  std::vector<std::shared_ptr<SkipListNode>> forward_;
+  // Travel from high level to low level. Nodes are owned by skiplist
+  std::vector<std::atomic<SkipListNode *>> forward_;
 
-  // Use weak_ptr to avoid circular
-  std::vector<std::weak_ptr<SkipListNode>> backward_;
+  std::vector<std::atomic<SkipListNode *>> backward_;
 };
 
 } // namespace db
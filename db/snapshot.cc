@@ -0,0 +1,43 @@
+#include "db/snapshot.h"
+
+// libC++
+#include <cassert>
+
+namespace kvs {
+
+namespace db {
+
+Snapshot::Snapshot(TxnId sequence_number) : sequence_number_(sequence_number) {}
+
+TxnId Snapshot::GetSequenceNumber() const { return sequence_number_; }
+
+const Snapshot *SnapshotList::New(TxnId sequence_number) {
+  sequence_numbers_.insert(sequence_number);
+  return new Snapshot(sequence_number);
+}
+
+void SnapshotList::Release(const Snapshot *snapshot) {
+  assert(snapshot);
+
+  auto iterator = sequence_numbers_.find(snapshot->GetSequenceNumber());
+  assert(iterator != sequence_numbers_.end());
+  if (iterator != sequence_numbers_.end()) {
+    sequence_numbers_.erase(iterator);
+  }
+
+  delete snapshot;
+}
+
+bool SnapshotList::Empty() const { return sequence_numbers_.empty(); }
+
+std::optional<TxnId> SnapshotList::GetOldestSequenceNumber() const {
+  if (sequence_numbers_.empty()) {
+    return std::nullopt;
+  }
+
+  return *sequence_numbers_.begin();
+}
+
+} // namespace db
+
+} // namespace kvs
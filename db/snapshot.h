@@ -0,0 +1,77 @@
+#ifndef DB_SNAPSHOT_H
+#define DB_SNAPSHOT_H
+
+#include "common/macros.h"
+
+// libC++
+#include <optional>
+#include <set>
+
+namespace kvs {
+
+namespace db {
+
+class SnapshotList;
+
+// A snapshot pins the sequence number that was last visible when it was
+// taken. Reads through a snapshot return the newest version of each key whose
+// sequence number <= that pinned sequence number.
+class Snapshot {
+public:
+  ~Snapshot() = default;
+
+  // No copy allowed
+  Snapshot(const Snapshot &) = delete;
+  Snapshot &operator=(Snapshot &) = delete;
+
+  // No move allowed
+  Snapshot(Snapshot &&) = delete;
+  Snapshot &operator=(Snapshot &&) = delete;
+
+  TxnId GetSequenceNumber() const;
+
+  friend class SnapshotList;
+
+private:
+  explicit Snapshot(TxnId sequence_number);
+
+  const TxnId sequence_number_;
+};
+
+// ALL methods in this class ARE NOT THREAD-SAFE. Lock MUST be acquired by
+// DBImpl before calling those below methods.
+class SnapshotList {
+public:
+  SnapshotList() = default;
+
+  ~SnapshotList() = default;
+
+  // No copy allowed
+  SnapshotList(const SnapshotList &) = delete;
+  SnapshotList &operator=(SnapshotList &) = delete;
+
+  // No move allowed
+  SnapshotList(SnapshotList &&) = delete;
+  SnapshotList &operator=(SnapshotList &&) = delete;
+
+  // Create new snapshot. Caller MUST return it by calling Release()
+  const Snapshot *New(TxnId sequence_number);
+
+  void Release(const Snapshot *snapshot);
+
+  bool Empty() const;
+
+  // Return sequence number of oldest live snapshot, if any
+  std::optional<TxnId> GetOldestSequenceNumber() const;
+
+private:
+  // Sequence numbers of all live snapshots. Many snapshots can pin the same
+  // sequence number
+  std::multiset<TxnId> sequence_numbers_;
+};
+
+} // namespace db
+
+} // namespace kvs
+
+#endif // DB_SNAPSHOT_H
@@ -0,0 +1,182 @@
+#include "db/super_version.h"
+
+#include "db/base_memtable.h"
+#include "db/version.h"
+
+// libC++
+#include <cassert>
+#include <utility>
+
+namespace {
+
+// Marks slot of a thread that is reading with super version taken from it
+char super_version_in_use;
+
+const kvs::db::SuperVersion *const kSuperVersionInUse =
+    reinterpret_cast<const kvs::db::SuperVersion *>(&super_version_in_use);
+
+std::atomic<uint64_t> next_super_version_cache_id{0};
+
+// Slots of calling thread, keyed by id of cache
+thread_local std::unordered_map<
+    uint64_t, std::shared_ptr<kvs::db::SuperVersionCache::Slot>>
+    local_slots;
+
+// Most reads go to the same DB as the previous one
+thread_local uint64_t last_cache_id = UINT64_MAX;
+
+thread_local kvs::db::SuperVersionCache::Slot *last_slot = nullptr;
+
+} // namespace
+
+namespace kvs {
+
+namespace db {
+
+SuperVersion::SuperVersion(
+    std::shared_ptr<BaseMemTable> memtable,
+    std::vector<std::shared_ptr<BaseMemTable>> immutable_memtables,
+    const Version *version)
+    : ref_count_(1), memtable_(std::move(memtable)),
+      immutable_memtables_(std::move(immutable_memtables)), version_(version) {
+  assert(memtable_);
+}
+
+SuperVersion::~SuperVersion() {
+  if (version_) {
+    version_->DecreaseRefCount();
+  }
+}
+
+void SuperVersion::Ref() const {
+  ref_count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SuperVersion::Unref() const {
+  if (ref_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete this;
+  }
+}
+
+BaseMemTable *SuperVersion::GetMemTable() const {
+  return memtable_.get();
+}
+
+const std::vector<std::shared_ptr<BaseMemTable>> &
+SuperVersion::GetImmutableMemTables() const {
+  return immutable_memtables_;
+}
+
+const Version *SuperVersion::GetVersion() const { return version_; }
+
+SuperVersionCache::SuperVersionCache()
+    : id_(next_super_version_cache_id.fetch_add(1)), current_(nullptr) {}
+
+SuperVersionCache::~SuperVersionCache() {
+  // No read is running anymore
+  for (const auto &slot : slots_) {
+    const SuperVersion *cached = slot->super_version.exchange(nullptr);
+    assert(cached != kSuperVersionInUse);
+    if (cached) {
+      cached->Unref();
+    }
+  }
+
+  if (current_) {
+    current_->Unref();
+  }
+}
+
+const SuperVersion *SuperVersionCache::Acquire(Slot **slot) const {
+  *slot = GetLocalSlot();
+  const SuperVersion *super_version = (*slot)->super_version.exchange(
+      kSuperVersionInUse, std::memory_order_acquire);
+  assert(super_version != kSuperVersionInUse);
+
+  if (!super_version) {
+    // Emptied by Install(), or first read of this thread
+    std::scoped_lock lock(mutex_);
+    super_version = current_;
+    super_version->Ref();
+  }
+
+  return super_version;
+}
+
+void SuperVersionCache::Release(Slot *slot,
+                                const SuperVersion *super_version) const {
+  const SuperVersion *expected = kSuperVersionInUse;
+  if (!slot->super_version.compare_exchange_strong(
+          expected, super_version, std::memory_order_release)) {
+    // Install() happened during read, so super version is outdated
+    super_version->Unref();
+  }
+}
+
+void SuperVersionCache::Install(const SuperVersion *super_version) {
+  assert(super_version);
+  std::vector<const SuperVersion *> obsolete_super_versions;
+  {
+    std::scoped_lock lock(mutex_);
+    if (current_) {
+      obsolete_super_versions.push_back(current_);
+    }
+    current_ = super_version;
+
+    // Drop slots of threads that have exited
+    std::erase_if(slots_, [&obsolete_super_versions](const auto &slot) {
+      const SuperVersion *cached = slot->super_version.exchange(nullptr);
+      if (cached && cached != kSuperVersionInUse) {
+        obsolete_super_versions.push_back(cached);
+      }
+
+      return slot.use_count() == 1;
+    });
+  }
+
+  // Memtables or version may be freed here, so it is done out of lock
+  for (const SuperVersion *obsolete_super_version : obsolete_super_versions) {
+    obsolete_super_version->Unref();
+  }
+}
+
+const SuperVersion *SuperVersionCache::GetCurrent() const {
+  std::scoped_lock lock(mutex_);
+  current_->Ref();
+  return current_;
+}
+
+SuperVersionCache::Slot *SuperVersionCache::GetLocalSlot() const {
+  if (last_cache_id == id_) {
+    return last_slot;
+  }
+
+  std::shared_ptr<Slot> &slot = local_slots[id_];
+  if (!slot) {
+    slot = std::make_shared<Slot>();
+    std::scoped_lock lock(mutex_);
+    slots_.push_back(slot);
+  }
+
+  last_cache_id = id_;
+  last_slot = slot.get();
+  return last_slot;
+}
+
+SuperVersionHandle::SuperVersionHandle(const SuperVersionCache *cache)
+    : cache_(cache), slot_(nullptr),
+      super_version_(cache_->Acquire(&slot_)) {}
+
+SuperVersionHandle::~SuperVersionHandle() {
+  cache_->Release(slot_, super_version_);
+}
+
+const SuperVersion *SuperVersionHandle::operator->() const {
+  return super_version_;
+}
+
+const SuperVersion *SuperVersionHandle::Get() const { return super_version_; }
+
+} // namespace db
+
+} // namespace kvs
\ No newline at end of file
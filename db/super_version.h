@@ -0,0 +1,155 @@
+#ifndef DB_SUPER_VERSION_H
+#define DB_SUPER_VERSION_H
+
+// libC++
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace kvs {
+
+namespace db {
+
+class BaseMemTable;
+class Version;
+
+// Everything a read looks at: mutable memtable, immutable memtables and
+// version of SSTs, kept alive together by one refcount. A new one is installed
+// each time any of them changes(memtable switch, flush, compaction)
+class SuperVersion {
+public:
+  // version MUST have been referenced for this super version, reference is
+  // released when super version is destroyed
+  SuperVersion(std::shared_ptr<BaseMemTable> memtable,
+               std::vector<std::shared_ptr<BaseMemTable>> immutable_memtables,
+               const Version *version);
+
+  ~SuperVersion();
+
+  // No copy allowed
+  SuperVersion(const SuperVersion &) = delete;
+  SuperVersion &operator=(SuperVersion &) = delete;
+
+  // No move allowed
+  SuperVersion(SuperVersion &&) = delete;
+  SuperVersion &operator=(SuperVersion &&) = delete;
+
+  void Ref() const;
+
+  // Super version is destroyed by the last Unref()
+  void Unref() const;
+
+  BaseMemTable *GetMemTable() const;
+
+  // Oldest first
+  const std::vector<std::shared_ptr<BaseMemTable>> &
+  GetImmutableMemTables() const;
+
+  // nullptr if DB hasn't been loaded yet
+  const Version *GetVersion() const;
+
+private:
+  mutable std::atomic<uint64_t> ref_count_;
+
+  const std::shared_ptr<BaseMemTable> memtable_;
+
+  const std::vector<std::shared_ptr<BaseMemTable>> immutable_memtables_;
+
+  const Version *const version_;
+};
+
+/*
+Current super version of a DB, cached by each thread that reads it.
+
+A thread keeps a reference to the super version it used last in its own slot,
+so a read only swaps its slot, and takes no lock nor touches any shared
+counter while super version doesn't change. Install() empties every slot, so
+next read of each thread picks new super version up.
+
+A slot holds:
+  - nullptr, if thread has no cached super version
+  - kSuperVersionInUse, while thread is reading with it
+  - cached super version, that slot holds a reference to
+*/
+class SuperVersionCache {
+public:
+  struct Slot {
+    std::atomic<const SuperVersion *> super_version{nullptr};
+  };
+
+  SuperVersionCache();
+
+  // Release current super version and the ones cached by threads
+  ~SuperVersionCache();
+
+  // No copy allowed
+  SuperVersionCache(const SuperVersionCache &) = delete;
+  SuperVersionCache &operator=(SuperVersionCache &) = delete;
+
+  // No move allowed
+  SuperVersionCache(SuperVersionCache &&) = delete;
+  SuperVersionCache &operator=(SuperVersionCache &&) = delete;
+
+  // Return super version that calling thread can read with, until it is
+  // given back by Release()
+  const SuperVersion *Acquire(Slot **slot) const;
+
+  void Release(Slot *slot, const SuperVersion *super_version) const;
+
+  // Make super_version current. Reference of caller is handed over
+  void Install(const SuperVersion *super_version);
+
+  // Reference current super version. Caller MUST Unref() it
+  const SuperVersion *GetCurrent() const;
+
+private:
+  // Slot of calling thread, created on first use
+  Slot *GetLocalSlot() const;
+
+  // Distinguish caches whose address is reused
+  const uint64_t id_;
+
+  // Protect current_ and slots_
+  mutable std::mutex mutex_;
+
+  const SuperVersion *current_;
+
+  // Slots of all threads that have read this DB. A slot outlives its thread,
+  // so that super version cached in it is released on next Install()
+  mutable std::vector<std::shared_ptr<Slot>> slots_;
+};
+
+// Hold super version of a read, and give it back once read is done
+class SuperVersionHandle {
+public:
+  explicit SuperVersionHandle(const SuperVersionCache *cache);
+
+  ~SuperVersionHandle();
+
+  // No copy allowed
+  SuperVersionHandle(const SuperVersionHandle &) = delete;
+  SuperVersionHandle &operator=(SuperVersionHandle &) = delete;
+
+  // No move allowed
+  SuperVersionHandle(SuperVersionHandle &&) = delete;
+  SuperVersionHandle &operator=(SuperVersionHandle &&) = delete;
+
+  const SuperVersion *operator->() const;
+
+  const SuperVersion *Get() const;
+
+private:
+  const SuperVersionCache *cache_;
+
+  SuperVersionCache::Slot *slot_;
+
+  const SuperVersion *super_version_;
+};
+
+} // namespace db
+
+} // namespace kvs
+
+#endif // DB_SUPER_VERSION_H
\ No newline at end of file
@@ -2,35 +2,29 @@
 
 #include "common/thread_pool.h"
 #include "db/db_impl.h"
+#include "db/row_cache.h"
 #include "db/version_manager.h"
 #include "io/base_file.h"
+#include "io/io_completion_queue.h"
+#include "io/io_uring.h"
 #include "sstable/block_reader_cache.h"
 #include "sstable/table_reader.h"
 #include "sstable/table_reader_cache.h"
 
 #include <algorithm>
+#include <atomic>
+#include <memory>
 
 namespace {
 
-uint64_t HashKey(std::string_view key, uint64_t table_size) {
-  const uint64_t p = 31;
-  const uint64_t m = 1000000009ULL;
-  uint64_t hash = 0;
-  uint64_t p_pow = 1;
-
-  for (unsigned char c : key) {
-    hash += static_cast<uint64_t>(c) * p_pow;
-    p_pow *= p;
-
-    // Only reduce when approaching overflow (~2^61)
-    if (hash > (1ULL << 61))
-      hash %= m;
-    if (p_pow > (1ULL << 61))
-      p_pow %= m;
+// SSTs lvl0 of one flush job are built concurrently, so table_id doesn't follow
+// memtable order. Sequence numbers do, newest memtable has largest max_txn_id
+bool IsNewerLevel0SST(const kvs::db::SSTMetadata &a,
+                      const kvs::db::SSTMetadata &b) {
+  if (a.max_txn_id != b.max_txn_id) {
+    return a.max_txn_id > b.max_txn_id;
   }
-
-  hash %= m;
-  return hash % table_size;
+  return a.table_id > b.table_id;
 }
 
 } // namespace
@@ -46,7 +40,8 @@ Version::Version(uint64_t version_id, int num_sst_levels,
       levels_score_(num_sst_levels, 0), thread_pool_(thread_pool),
       version_manager_(db->GetVersionManager()),
       block_reader_cache_(db->GetBlockReaderCache()),
-      table_reader_cache_(db->GetTableReaderCache()) {
+      table_reader_cache_(db->GetTableReaderCache()),
+      row_cache_(db->GetRowCache()) {
   assert(thread_pool_ && version_manager_ && table_reader_cache_);
 }
 
@@ -55,48 +50,57 @@ void Version::IncreaseRefCount() const { ref_count_.fetch_add(1); }
 void Version::DecreaseRefCount() const {
   assert(ref_count_ >= 1);
   if (ref_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
-    thread_pool_->Enqueue(&VersionManager::RemoveObsoleteVersion,
-                          version_manager_, version_id_);
+    version_manager_->MaybeScheduleReclamation();
   }
 }
 
 GetStatus Version::Get(std::string_view key, TxnId txn_id) const {
   GetStatus status;
-  std::vector<std::shared_ptr<SSTMetadata>> sst_lvl0_candidates_;
+  PinnableValue value;
 
-  std::optional<uint64_t> block_reader_bucket;
-  if (!block_reader_cache_.empty()) {
-    block_reader_bucket = HashKey(key, block_reader_cache_.size());
+  status.type = Get(key, txn_id, &value, true /*fill_cache*/);
+  if (status.type == ValueType::PUT) {
+    status.value = value.ToString();
   }
 
-  for (const auto &sst : levels_sst_info_[0]) {
-    // With SSTs lvl0, because of overlapping, we need to lookup in all SSTs
-    // that maybe contain the key
-    if (key < sst->smallest_key || key > sst->largest_key) {
-      continue;
+  return status;
+}
+
+ValueType Version::Get(std::string_view key, TxnId txn_id,
+                       PinnableValue *value, bool fill_cache) const {
+  assert(value);
+  value->Reset();
+  ValueType type = ValueType::NOT_FOUND;
+  std::vector<std::shared_ptr<SSTMetadata>> sst_lvl0_candidates_ =
+      GetLevel0Candidates(key, txn_id);
+
+  // With io_uring, blocks of all candidates are read in parallel, instead of
+  // waiting for disk once for each candidate. Blocks are handed over through
+  // block cache, so it is only done if read can fill cache
+  if (sst_lvl0_candidates_.size() > 1 && block_reader_cache_ && fill_cache &&
+      io::IoUring::GetThreadLocal()) {
+    std::vector<std::pair<SSTId, uint64_t>> tables;
+    tables.reserve(sst_lvl0_candidates_.size());
+    for (const auto &candidate : sst_lvl0_candidates_) {
+      if (IsInRowCache(candidate.get(), key, txn_id)) {
+        // Answered by row cache, no block is needed
+        continue;
+      }
+      tables.push_back({candidate->table_id, candidate->file_size});
     }
 
-    // TODO(namnh) : Implement bloom filter for level = 0
-    sst_lvl0_candidates_.push_back(sst);
+    if (tables.size() > 1) {
+      table_reader_cache_->PrefetchBlocks(key, tables, 0 /*level*/,
+                                          block_reader_cache_);
+    }
   }
 
-  // Sort in descending order based on table_id. Because we need to search from
-  // newset to oldest
-  std::sort(
-      sst_lvl0_candidates_.begin(), sst_lvl0_candidates_.end(),
-      [](const auto &a, const auto &b) { return a->table_id > b->table_id; });
-
   for (const auto &candidate : sst_lvl0_candidates_) {
-    status = table_reader_cache_->GetValue(
-        key, txn_id, candidate->table_id, candidate->file_size,
-        (block_reader_bucket)
-            ? block_reader_cache_[block_reader_bucket.value()].get()
-            : nullptr);
+    type = GetFromSST(candidate.get(), key, txn_id, value, fill_cache);
 
-    if (status.type == db::ValueType::PUT ||
-        status.type == db::ValueType::DELETED ||
-        status.type == db::ValueType::kTooManyOpenFiles) {
-      return status;
+    if (type == db::ValueType::PUT || type == db::ValueType::DELETED ||
+        type == db::ValueType::kTooManyOpenFiles) {
+      return type;
     }
   }
 
@@ -106,49 +110,307 @@ GetStatus Version::Get(std::string_view key, TxnId txn_id) const {
     // sorted based on smallest key(and largest key), we can use binary search
     // to quickly determine the file candidate to lookup
     std::shared_ptr<SSTMetadata> file_candidate = FindFilesAtLevel(level, key);
-    if (!file_candidate) {
+    if (!file_candidate || file_candidate->min_txn_id > txn_id) {
       continue;
     }
 
     // TODO(namnh) : Implement bloom filter for level >= 1
-    status = table_reader_cache_->GetValue(
-        key, txn_id, file_candidate->table_id, file_candidate->file_size,
-        (block_reader_bucket)
-            ? block_reader_cache_[block_reader_bucket.value()].get()
-            : nullptr);
+    type = GetFromSST(file_candidate.get(), key, txn_id, value, fill_cache);
 
-    if (status.type == db::ValueType::PUT ||
-        status.type == db::ValueType::DELETED ||
-        status.type == db::ValueType::kTooManyOpenFiles) {
-      return status;
+    if (type == db::ValueType::PUT || type == db::ValueType::DELETED ||
+        type == db::ValueType::kTooManyOpenFiles) {
+      return type;
     }
   }
 
-  return status;
+  return type;
 }
 
-std::shared_ptr<SSTMetadata>
-Version::FindFilesAtLevel(int level, std::string_view key) const {
-  int64_t left = 0;
-  int64_t right = levels_sst_info_[level].size() - 1;
+Task<ValueType> Version::AsyncGet(std::string_view key, TxnId txn_id,
+                                  PinnableValue *value, bool fill_cache,
+                                  io::IoCompletionQueue *io_queue,
+                                  Executor *executor) const {
+  assert(value && io_queue && executor);
+  value->Reset();
+  ValueType type = ValueType::NOT_FOUND;
+
+  // Same lookup as Get(), with blocks loaded before each step reads them
+  const bool load_blocks = block_reader_cache_ && fill_cache;
+
+  const std::vector<std::shared_ptr<SSTMetadata>> sst_lvl0_candidates =
+      GetLevel0Candidates(key, txn_id);
+
+  if (load_blocks) {
+    // Blocks of all candidates are read together
+    std::vector<std::pair<SSTId, uint64_t>> tables;
+    for (const auto &candidate : sst_lvl0_candidates) {
+      if (!IsInRowCache(candidate.get(), key, txn_id)) {
+        tables.push_back({candidate->table_id, candidate->file_size});
+      }
+    }
+
+    if (!tables.empty()) {
+      co_await LoadBlocks(key, std::move(tables), 0 /*level*/, io_queue,
+                          executor);
+    }
+  }
+
+  for (const auto &candidate : sst_lvl0_candidates) {
+    type = GetFromSST(candidate.get(), key, txn_id, value, fill_cache);
 
-  while (left < right) {
-    int64_t mid = left + (right - left) / 2;
-    if (levels_sst_info_[level][mid]->largest_key >= key) {
-      right = mid;
-    } else {
-      left = mid + 1;
+    if (type == db::ValueType::PUT || type == db::ValueType::DELETED ||
+        type == db::ValueType::kTooManyOpenFiles) {
+      co_return type;
     }
   }
 
-  if (right < 0) {
-    return nullptr;
+  for (int level = 1; level < levels_sst_info_.size(); level++) {
+    std::shared_ptr<SSTMetadata> file_candidate = FindFilesAtLevel(level, key);
+    if (!file_candidate || file_candidate->min_txn_id > txn_id) {
+      continue;
+    }
+
+    if (load_blocks && !IsInRowCache(file_candidate.get(), key, txn_id)) {
+      std::vector<std::pair<SSTId, uint64_t>> tables{
+          {file_candidate->table_id, file_candidate->file_size}};
+      co_await LoadBlocks(key, std::move(tables), level, io_queue, executor);
+    }
+
+    type = GetFromSST(file_candidate.get(), key, txn_id, value, fill_cache);
+
+    if (type == db::ValueType::PUT || type == db::ValueType::DELETED ||
+        type == db::ValueType::kTooManyOpenFiles) {
+      co_return type;
+    }
   }
 
-  return levels_sst_info_[level][right]->smallest_key <= key &&
-                 key <= levels_sst_info_[level][right]->largest_key
-             ? levels_sst_info_[level][right]
-             : nullptr;
+  co_return type;
+}
+
+std::vector<std::shared_ptr<SSTMetadata>>
+Version::GetLevel0Candidates(std::string_view key, TxnId txn_id) const {
+  std::vector<std::shared_ptr<SSTMetadata>> sst_lvl0_candidates_;
+
+  for (const auto &sst : levels_sst_info_[0]) {
+    // With SSTs lvl0, because of overlapping, we need to lookup in all SSTs
+    // that maybe contain the key
+    if (key < sst->smallest_key || key > sst->largest_key) {
+      continue;
+    }
+
+    if (sst->min_txn_id > txn_id) {
+      // Every entry in this SST is newer than the read, no need to open it
+      continue;
+    }
+
+    // TODO(namnh) : Implement bloom filter for level = 0
+    sst_lvl0_candidates_.push_back(sst);
+  }
+
+  // Sort from newest to oldest, because we need to search in that order
+  std::sort(sst_lvl0_candidates_.begin(), sst_lvl0_candidates_.end(),
+            [](const auto &a, const auto &b) {
+              return IsNewerLevel0SST(*a, *b);
+            });
+
+  return sst_lvl0_candidates_;
+}
+
+bool Version::IsInRowCache(const SSTMetadata *sst, std::string_view key,
+                           TxnId txn_id) const {
+  // Same condition as GetFromSST() uses row cache with
+  return row_cache_ && txn_id >= sst->max_txn_id &&
+         row_cache_->Contains(sst->table_id, key);
+}
+
+Task<> Version::LoadBlocks(std::string_view key,
+                           std::vector<std::pair<SSTId, uint64_t>> tables,
+                           int level, io::IoCompletionQueue *io_queue,
+                           Executor *executor) const {
+  std::unique_ptr<sstable::PendingBlocks> pending =
+      table_reader_cache_->StartPrefetch(key, tables, level,
+                                         block_reader_cache_);
+
+  // Completes inline if every block is cached already
+  co_await io_queue->Read(pending->reads.requests, executor);
+
+  table_reader_cache_->FinishPrefetch(pending.get(), block_reader_cache_);
+}
+
+ValueType Version::GetFromSST(const SSTMetadata *sst, std::string_view key,
+                              TxnId txn_id, PinnableValue *value,
+                              bool fill_cache) const {
+  // Older snapshots may not see the newest version of key in SST, which is
+  // what row cache holds
+  const bool use_row_cache = row_cache_ && txn_id >= sst->max_txn_id;
+  if (use_row_cache) {
+    std::shared_ptr<RowItem> row_item = row_cache_->Lookup(sst->table_id, key);
+    if (row_item) {
+      const ValueType type = row_item->GetType();
+      if (type == ValueType::PUT) {
+        // Value keeps entry alive, even if it is evicted in the meantime
+        value->PinSlice(row_item->GetValue(), row_item);
+      }
+      row_item->Unref();
+      return type;
+    }
+  }
+
+  const ValueType type = table_reader_cache_->GetValue(
+      key, txn_id, sst->table_id, sst->file_size, sst->level,
+      block_reader_cache_, value, fill_cache);
+
+  if (use_row_cache && fill_cache && type != ValueType::kTooManyOpenFiles) {
+    std::shared_ptr<RowItem> row_item = row_cache_->Insert(
+        sst->table_id, key, type,
+        type == ValueType::PUT ? value->GetView() : std::string_view());
+    if (row_item) {
+      row_item->Unref();
+    }
+  }
+
+  return type;
+}
+
+void Version::MultiGet(std::span<const std::string_view> keys, TxnId txn_id,
+                       std::span<GetStatus> statuses, bool fill_cache) const {
+  assert(keys.size() == statuses.size());
+
+  auto is_pending = [](const GetStatus &status) {
+    return status.type == ValueType::NOT_FOUND;
+  };
+
+  // Return keys in range [smallest_key, largest_key] of sst
+  auto keys_range_of_sst = [&keys](const SSTMetadata *sst) {
+    auto begin = std::lower_bound(keys.begin(), keys.end(),
+                                  std::string_view(sst->smallest_key));
+    auto end = std::upper_bound(begin, keys.end(),
+                                std::string_view(sst->largest_key));
+    return std::pair<size_t, size_t>(begin - keys.begin(), end - keys.begin());
+  };
+
+  // With SSTs lvl0, because of overlapping, look up from newest to oldest
+  std::vector<const SSTMetadata *> sst_lvl0_candidates;
+  for (const auto &sst : levels_sst_info_[0]) {
+    if (sst->min_txn_id <= txn_id) {
+      sst_lvl0_candidates.push_back(sst.get());
+    }
+  }
+  std::sort(sst_lvl0_candidates.begin(), sst_lvl0_candidates.end(),
+            [](const auto &a, const auto &b) {
+              return IsNewerLevel0SST(*a, *b);
+            });
+
+  for (const SSTMetadata *candidate : sst_lvl0_candidates) {
+    auto [begin, end] = keys_range_of_sst(candidate);
+    if (std::none_of(statuses.begin() + begin, statuses.begin() + end,
+                     is_pending)) {
+      continue;
+    }
+
+    MultiGetFromSST(candidate, keys.subspan(begin, end - begin), txn_id,
+                    statuses.subspan(begin, end - begin), fill_cache);
+  }
+
+  // With level >= 1, SSTs don't overlap. So keys are split into disjoint
+  // batches, one for each SST, that can be looked up in parallel. Caller and
+  // helpers on read thread pool take batches one at a time, so caller only
+  // ever waits for batches that are running
+  struct Batch {
+    const SSTMetadata *sst;
+
+    size_t begin;
+
+    size_t end;
+  };
+
+  // Helpers may only start once caller has returned, so they share ownership
+  struct LevelBatches {
+    std::vector<Batch> batches;
+
+    // Next batch to be taken
+    std::atomic<size_t> next{0};
+
+    std::atomic<size_t> finished{0};
+  };
+
+  auto run_batches = [this, keys, txn_id, statuses,
+                      fill_cache](LevelBatches *level_batches) {
+    const size_t total = level_batches->batches.size();
+    for (size_t i = level_batches->next.fetch_add(1); i < total;
+         i = level_batches->next.fetch_add(1)) {
+      const Batch &batch = level_batches->batches[i];
+      MultiGetFromSST(batch.sst,
+                      keys.subspan(batch.begin, batch.end - batch.begin),
+                      txn_id,
+                      statuses.subspan(batch.begin, batch.end - batch.begin),
+                      fill_cache);
+
+      if (level_batches->finished.fetch_add(1, std::memory_order_acq_rel) ==
+          total - 1) {
+        level_batches->finished.notify_all();
+      }
+    }
+  };
+
+  for (int level = 1; level < levels_sst_info_.size(); level++) {
+    if (std::none_of(statuses.begin(), statuses.end(), is_pending)) {
+      return;
+    }
+
+    auto level_batches = std::make_shared<LevelBatches>();
+    for (const auto &sst : levels_sst_info_[level]) {
+      if (sst->min_txn_id > txn_id) {
+        continue;
+      }
+
+      auto [begin, end] = keys_range_of_sst(sst.get());
+      if (std::any_of(statuses.begin() + begin, statuses.begin() + end,
+                      is_pending)) {
+        level_batches->batches.push_back({sst.get(), begin, end});
+      }
+    }
+
+    const size_t total = level_batches->batches.size();
+    if (total == 0) {
+      continue;
+    }
+
+    const size_t total_helpers = std::min<size_t>(
+        total - 1, thread_pool_->GetTotalThreads());
+    for (size_t i = 0; i < total_helpers; i++) {
+      // Caller is waiting for batches
+      thread_pool_->Schedule(TaskPriority::kHigh,
+                             [run_batches, level_batches]() {
+                               run_batches(level_batches.get());
+                             });
+    }
+
+    run_batches(level_batches.get());
+
+    // Batches that are left are being run by helpers
+    size_t finished = level_batches->finished.load(std::memory_order_acquire);
+    while (finished < total) {
+      level_batches->finished.wait(finished, std::memory_order_acquire);
+      finished = level_batches->finished.load(std::memory_order_acquire);
+    }
+  }
+}
+
+void Version::MultiGetFromSST(const SSTMetadata *sst,
+                              std::span<const std::string_view> keys,
+                              TxnId txn_id, std::span<GetStatus> statuses,
+                              bool fill_cache) const {
+  assert(!keys.empty());
+
+  table_reader_cache_->MultiGetValue(keys, txn_id, sst->table_id,
+                                     sst->file_size, sst->level,
+                                     block_reader_cache_, statuses, fill_cache);
+}
+
+std::shared_ptr<SSTMetadata>
+Version::FindFilesAtLevel(int level, std::string_view key) const {
+  return levels_sst_info_[level].FindFile(key);
 }
 
 bool Version::NeedCompaction() const {
@@ -176,14 +438,12 @@ std::optional<int> Version::GetLevelToCompact() const {
   return level_to_compact;
 }
 
-const std::vector<std::vector<std::shared_ptr<SSTMetadata>>> &
-Version::GetImmutableSSTMetadata() const {
+const std::vector<LevelFiles> &Version::GetImmutableSSTMetadata() const {
   return levels_sst_info_;
 }
 
 // This methos is ONLY called when building data for new version
-std::vector<std::vector<std::shared_ptr<SSTMetadata>>> &
-Version::GetSSTMetadata() {
+std::vector<LevelFiles> &Version::GetSSTMetadata() {
   return levels_sst_info_;
 }
 
@@ -204,8 +464,7 @@ uint64_t Version::GetVersionId() const { return version_id_; }
 uint64_t Version::GetRefCount() const { return ref_count_.load(); }
 
 // For testing
-const std::vector<std::vector<std::shared_ptr<SSTMetadata>>> &
-Version::GetSSTMetadata() const {
+const std::vector<LevelFiles> &Version::GetSSTMetadata() const {
   return levels_sst_info_;
 }
 
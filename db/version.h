@@ -2,6 +2,9 @@
 #define DB_VERSION_H
 
 #include "common/macros.h"
+#include "common/task.h"
+#include "db/level_files.h"
+#include "db/pinnable_value.h"
 #include "db/status.h"
 #include "db/version_edit.h"
 
@@ -11,12 +14,18 @@
 #include <latch>
 #include <memory>
 #include <ranges>
+#include <span>
 #include <vector>
 
 namespace kvs {
 
+class Executor;
 class ThreadPool;
 
+namespace io {
+class IoCompletionQueue;
+} // namespace io
+
 namespace sstable {
 class BlockReaderCache;
 class Table;
@@ -28,6 +37,7 @@ namespace db {
 class BaseMemTable;
 class Compact;
 class DBImpl;
+class RowCache;
 class ThreadPool;
 class VersionEdit;
 class VersionManager;
@@ -59,20 +69,43 @@ public:
 
   void IncreaseRefCount() const;
 
+  // Last reference makes version obsolete, it is freed in bulk later by
+  // VersionManager
   void DecreaseRefCount() const;
 
   // Get Key from version
   GetStatus Get(std::string_view key, TxnId txn_id) const;
 
+  // Same as above, but if type is PUT, value pins block that contains it
+  // instead of being copied. If fill_cache is false, blocks read from disk
+  // aren't added into block cache
+  ValueType Get(std::string_view key, TxnId txn_id, PinnableValue *value,
+                bool fill_cache) const;
+
+  // Same as above, but blocks that lookup reads from disk are read through
+  // io_queue, and lookup suspends until they are loaded instead of blocking.
+  // It is resumed through executor. Blocks are handed over to lookup through
+  // block cache, so lookup blocks as Get() does if block cache is disabled or
+  // fill_cache is false. Opening a table still blocks
+  Task<ValueType> AsyncGet(std::string_view key, TxnId txn_id,
+                           PinnableValue *value, bool fill_cache,
+                           io::IoCompletionQueue *io_queue,
+                           Executor *executor) const;
+
+  // Get many keys from version. keys MUST be sorted in ascending order and
+  // unique. Only keys whose status is still NOT_FOUND are looked up. Batches
+  // of keys that go to different SSTs at the same level are read in parallel
+  void MultiGet(std::span<const std::string_view> keys, TxnId txn_id,
+                std::span<GetStatus> statuses, bool fill_cache) const;
+
   bool NeedCompaction() const;
 
   std::optional<int> GetLevelToCompact() const;
 
-  const std::vector<std::vector<std::shared_ptr<SSTMetadata>>> &
-  GetImmutableSSTMetadata() const;
+  const std::vector<LevelFiles> &GetImmutableSSTMetadata() const;
 
   // ALL NON-CONST methods are only called when building new version
-  std::vector<std::vector<std::shared_ptr<SSTMetadata>>> &GetSSTMetadata();
+  std::vector<LevelFiles> &GetSSTMetadata();
 
   const std::vector<double> &GetImmutableLevelsScore() const;
 
@@ -88,15 +121,42 @@ public:
   friend class Compact;
 
   // For testing
-  const std::vector<std::vector<std::shared_ptr<SSTMetadata>>> &
-  GetSSTMetadata() const;
+  const std::vector<LevelFiles> &GetSSTMetadata() const;
 
 private:
   std::shared_ptr<SSTMetadata> FindFilesAtLevel(int level,
                                                 std::string_view key) const;
+
+  // SSTs of level 0 whose key range contains key and that have entries
+  // visible to txn_id, newest first
+  std::vector<std::shared_ptr<SSTMetadata>>
+  GetLevel0Candidates(std::string_view key, TxnId txn_id) const;
+
+  // True if looking up key in SST is answered by row cache, without reading
+  // any block
+  bool IsInRowCache(const SSTMetadata *sst, std::string_view key,
+                    TxnId txn_id) const;
+
+  // Load blocks that may contain key from tables(table id, file size) at level
+  // into block cache, reading the ones that aren't cached through io_queue
+  Task<> LoadBlocks(std::string_view key,
+                    std::vector<std::pair<SSTId, uint64_t>> tables, int level,
+                    io::IoCompletionQueue *io_queue, Executor *executor) const;
+
+  // Look up key in SST. Row cache is used if it is enabled, and if read can
+  // see every entry of SST
+  ValueType GetFromSST(const SSTMetadata *sst, std::string_view key,
+                       TxnId txn_id, PinnableValue *value,
+                       bool fill_cache) const;
+
+  // Look up keys that are in key range of one SST
+  void MultiGetFromSST(const SSTMetadata *sst,
+                       std::span<const std::string_view> keys, TxnId txn_id,
+                       std::span<GetStatus> statuses, bool fill_cache) const;
   const uint64_t version_id_;
 
-  std::vector<std::vector<std::shared_ptr<SSTMetadata>>> levels_sst_info_;
+  // Shared with other versions, see LevelFiles
+  std::vector<LevelFiles> levels_sst_info_;
 
   // Level that need to compact
   uint8_t compaction_level_;
@@ -112,14 +172,18 @@ private:
   // allocate/deallocate, etc... these objects.
   const Config *config_;
 
+  // Runs lookups that MultiGet fans out
   const kvs::ThreadPool *const thread_pool_;
 
   const VersionManager *const version_manager_;
 
-  const std::vector<std::unique_ptr<sstable::BlockReaderCache>>
-      &block_reader_cache_;
+  // nullptr if block cache is disabled
+  const sstable::BlockReaderCache *const block_reader_cache_;
 
   const sstable::TableReaderCache *const table_reader_cache_;
+
+  // nullptr if row cache is disabled
+  const RowCache *const row_cache_;
 };
 
 } // namespace db
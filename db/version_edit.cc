@@ -8,18 +8,21 @@ VersionEdit::VersionEdit(int num_levels) : new_files_(num_levels) {}
 
 SSTMetadata::SSTMetadata(SSTId table_id_, int level_, uint64_t file_size_,
                          std::string_view smallest_key_,
-                         std::string_view largest_key_, std::string &&filename_)
+                         std::string_view largest_key_, std::string &&filename_,
+                         TxnId min_txn_id_, TxnId max_txn_id_)
     : table_id(table_id_), level(level_), file_size(file_size_),
       smallest_key(std::string(smallest_key_)),
-      largest_key(std::string(largest_key_)), filename(std::move(filename_)) {}
+      largest_key(std::string(largest_key_)), filename(std::move(filename_)),
+      min_txn_id(min_txn_id_), max_txn_id(max_txn_id_) {}
 
 void VersionEdit::AddNewFiles(SSTId table_id, int level, uint64_t file_size,
                               std::string_view smallest_key,
                               std::string_view largest_key,
-                              std::string &&filename) {
-  auto sst_metadata =
-      std::make_shared<SSTMetadata>(table_id, level, file_size, smallest_key,
-                                    largest_key, std::move(filename));
+                              std::string &&filename, TxnId min_txn_id,
+                              TxnId max_txn_id) {
+  auto sst_metadata = std::make_shared<SSTMetadata>(
+      table_id, level, file_size, smallest_key, largest_key,
+      std::move(filename), min_txn_id, max_txn_id);
   new_files_[sst_metadata->level].push_back(std::move(sst_metadata));
 }
 
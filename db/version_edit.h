@@ -19,9 +19,12 @@ namespace kvs {
 namespace db {
 
 struct SSTMetadata {
+  // Metadata recovered from old MANIFEST records has no txn id range. Default
+  // range covers every txn id, so that such table is never skipped
   SSTMetadata(SSTId table_id_, int level_, uint64_t file_size_,
               std::string_view smallest_key_, std::string_view largest_key_,
-              std::string &&filename_);
+              std::string &&filename_, TxnId min_txn_id_ = 0,
+              TxnId max_txn_id_ = kMaxTxnId);
 
   ~SSTMetadata() = default;
 
@@ -45,7 +48,10 @@ struct SSTMetadata {
 
   const std::string largest_key;
 
-  std::atomic<uint64_t> ref_count;
+  // Smallest and largest txn id of entries in SST
+  const TxnId min_txn_id;
+
+  const TxnId max_txn_id;
 };
 
 class VersionEdit {
@@ -64,7 +70,8 @@ public:
 
   void AddNewFiles(SSTId table_id, int level, uint64_t file_size,
                    std::string_view smallest_key, std::string_view largest_key,
-                   std::string &&filename);
+                   std::string &&filename, TxnId min_txn_id = 0,
+                   TxnId max_txn_id = kMaxTxnId);
 
   void AddNewFiles(std::shared_ptr<SSTMetadata> sst_metadata);
 
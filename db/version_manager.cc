@@ -3,6 +3,7 @@
 #include "common/thread_pool.h"
 #include "db/config.h"
 #include "db/db_impl.h"
+#include "db/row_cache.h"
 #include "db/version.h"
 #include "sstable/block_reader_cache.h"
 #include "sstable/table_reader_cache.h"
@@ -11,6 +12,7 @@
 #include <algorithm>
 #include <cassert>
 #include <filesystem>
+#include <set>
 
 namespace fs = std::filesystem;
 
@@ -24,33 +26,67 @@ VersionManager::VersionManager(const DBImpl *db,
   assert(db_ && config_ && thread_pool_);
 }
 
-void VersionManager::RemoveObsoleteVersion(uint64_t version_id) const {
-  std::scoped_lock lock(mutex_);
-  auto it = versions_.find(version_id);
-  if (it == versions_.end()) {
+void VersionManager::MaybeScheduleReclamation() const {
+  if (thread_pool_->IsShutdown()) {
+    // DB reclaims what is left once it is closed
     return;
   }
 
-  const std::vector<std::vector<std::shared_ptr<SSTMetadata>>> &sst_metadata =
-      it->second->GetSSTMetadata();
-  for (int level = 0; level < sst_metadata.size(); level++) {
-    for (int file_index = 0; file_index < sst_metadata[level].size();
-         file_index++) {
-      // Decrease number of version that is refering to a file when an obsolete
-      // version is deleted
-      if (sst_metadata[level][file_index]->ref_count.fetch_sub(
-              1, std::memory_order_acq_rel) == 1) {
-        // If ref count of a SST file = 0, it means that versions refer to it no
-        // more. Time to say goodbye!
-        fs::path file_path(sst_metadata[level][file_index]->filename);
-        if (fs::exists(file_path) && fs::is_regular_file(file_path)) {
-          fs::remove(file_path);
-        }
+  if (!reclamation_scheduled_.exchange(true)) {
+    thread_pool_->Schedule(TaskPriority::kLow,
+                           [this]() { ReclaimObsoleteVersions(); });
+  }
+}
+
+void VersionManager::ReclaimObsoleteVersions() const {
+  // Versions that become obsolete from now on are picked up by next round
+  reclamation_scheduled_.store(false);
+
+  std::vector<std::unique_ptr<Version>> obsolete_versions;
+  std::vector<std::shared_ptr<SSTMetadata>> obsolete_files;
+  {
+    std::scoped_lock lock(mutex_);
+    // An obsolete version is never referenced again, only latest version can
+    // be acquired
+    uint64_t oldest_live_version_id =
+        latest_version_ ? latest_version_->GetVersionId() : UINT64_MAX;
+    for (auto it = versions_.begin(); it != versions_.end();) {
+      if (it->second->GetRefCount() == 0) {
+        obsolete_versions.push_back(std::move(it->second));
+        it = versions_.erase(it);
+        continue;
       }
+
+      oldest_live_version_id = std::min(oldest_live_version_id, it->first);
+      it++;
     }
+
+    while (!obsolete_files_.empty() &&
+           obsolete_files_.front().first <= oldest_live_version_id) {
+      obsolete_files.push_back(std::move(obsolete_files_.front().second));
+      obsolete_files_.pop_front();
+    }
+  }
+
+  obsolete_versions.clear();
+  if (obsolete_files.empty()) {
+    return;
   }
 
-  versions_.erase(it);
+  // No live version can read these tables, so their entries are never filled
+  // again
+  if (const RowCache *row_cache = db_->GetRowCache()) {
+    std::set<SSTId> obsolete_tables;
+    for (const auto &sst : obsolete_files) {
+      obsolete_tables.insert(sst->table_id);
+    }
+    row_cache->EraseTables(obsolete_tables);
+  }
+
+  for (const auto &sst : obsolete_files) {
+    std::error_code error_code;
+    fs::remove(sst->filename, error_code);
+  }
 }
 
 void VersionManager::ApplyNewChanges(
@@ -71,11 +107,12 @@ void VersionManager::InitVersionWhenLoadingDb(
     std::unique_ptr<VersionEdit> version_edit) {
   next_version_id_.fetch_add(1, std::memory_order_relaxed);
   uint64_t new_verions_id = next_version_id_;
-  auto new_version = std::make_unique<Version>(
-      new_verions_id, config_->GetSSTNumLvels(), thread_pool_, db_);
+  auto new_version =
+      std::make_unique<Version>(new_verions_id, config_->GetSSTNumLvels(),
+                                db_->GetReadThreadPool(), db_);
 
-  std::vector<std::vector<std::shared_ptr<SSTMetadata>>>
-      &latest_version_sst_info = new_version->GetSSTMetadata();
+  std::vector<LevelFiles> &latest_version_sst_info =
+      new_version->GetSSTMetadata();
   std::vector<double> &latest_levels_score = new_version->GetLevelsScore();
 
   const std::vector<std::vector<std::shared_ptr<SSTMetadata>>> &add_files =
@@ -83,28 +120,19 @@ void VersionManager::InitVersionWhenLoadingDb(
 
   for (int level = 0; level < add_files.size(); level++) {
     for (const auto &sst_info : add_files[level]) {
-      // Increase refcount of SST metadata each time a new version is
-      // created
-      sst_info->ref_count.fetch_add(1, std::memory_order_relaxed);
-
-      latest_version_sst_info[level].push_back(sst_info);
+      live_files_.insert({sst_info->table_id, sst_info});
     }
 
+    // All SST files level >=1 must be sorted base on smallest key.
+    // Note : Because files levels >= 1 don't overlap with each other, so use
+    // smallest_key for condition to sort is enough
+    latest_version_sst_info[level] = latest_version_sst_info[level].Apply(
+        add_files[level], {} /*removed*/, level >= 1 /*sorted*/);
+
     // Calcuate score ranking of each level
     latest_levels_score[level] =
         static_cast<double>(latest_version_sst_info[0].size()) /
         static_cast<double>(config_->GetLvl0SSTCompactionTrigger());
-
-    if (level >= 1) {
-      // All SST files level >=1 must be sorted base on smallest key.
-      // Note : Because files levels >= 1 don't overlap with each other, so use
-      // smallest_key for condition to sort is enough
-      std::sort(latest_version_sst_info[level].begin(),
-                latest_version_sst_info[level].end(),
-                [](const auto &a, const auto &b) {
-                  return a->smallest_key < b->smallest_key;
-                });
-    }
   }
 
   latest_version_ = std::move(new_version);
@@ -112,109 +140,82 @@ void VersionManager::InitVersionWhenLoadingDb(
   latest_version_->IncreaseRefCount();
 
   // Remove obsolete SST files
-  thread_pool_->Enqueue([version_edit_ = std::move(version_edit),
-                         config_ = this->config_, db_ = this->db_]() {
-    const std::set<std::pair<SSTId, int>> deleted_files =
-        version_edit_->GetImmutableDeletedFiles();
-    for (const auto &file : deleted_files) {
-      std::string filename =
-          db_->GetDBPath() + std::to_string(file.first) + ".sst";
-      fs::path file_path(filename);
-      if (fs::exists(file_path) && fs::is_regular_file(file_path)) {
-        fs::remove(file_path);
-      }
-    }
-  });
+  thread_pool_->Schedule(
+      TaskPriority::kLow,
+      [version_edit_ = std::shared_ptr<VersionEdit>(std::move(version_edit)),
+       config_ = this->config_, db_ = this->db_]() {
+        const std::set<std::pair<SSTId, int>> deleted_files =
+            version_edit_->GetImmutableDeletedFiles();
+        for (const auto &file : deleted_files) {
+          std::string filename =
+              db_->GetDBPath() + std::to_string(file.first) + ".sst";
+          fs::path file_path(filename);
+          if (fs::exists(file_path) && fs::is_regular_file(file_path)) {
+            fs::remove(file_path);
+          }
+        }
+      });
 }
 
 void VersionManager::CreateNewVersion(
     std::unique_ptr<VersionEdit> version_edit) {
   next_version_id_.fetch_add(1, std::memory_order_relaxed);
   uint64_t new_verions_id = next_version_id_.load();
-  auto new_version = std::make_unique<Version>(
-      new_verions_id, config_->GetSSTNumLvels(), thread_pool_, db_);
+  auto new_version =
+      std::make_unique<Version>(new_verions_id, config_->GetSSTNumLvels(),
+                                db_->GetReadThreadPool(), db_);
 
   // Get info of SST from previous version
-  const std::vector<std::vector<std::shared_ptr<SSTMetadata>>>
-      &old_version_sst_info = latest_version_->GetImmutableSSTMetadata();
+  const std::vector<LevelFiles> &old_version_sst_info =
+      latest_version_->GetImmutableSSTMetadata();
   const std::vector<double> &old_levels_score =
       latest_version_->GetLevelsScore();
 
-  // Prepare for latest version
-  std::vector<std::vector<std::shared_ptr<SSTMetadata>>>
-      &latest_version_sst_info = new_version->GetSSTMetadata();
+  // Prepare for latest version. Levels(and chunks of them) that edit doesn't
+  // touch are shared with previous version
+  std::vector<LevelFiles> &latest_version_sst_info =
+      new_version->GetSSTMetadata();
   std::vector<double> &latest_levels_score = new_version->GetLevelsScore();
+  latest_version_sst_info = old_version_sst_info;
 
-  // Get info of deleted files
-  const std::set<std::pair<SSTId, int>> &deleted_files =
-      version_edit->GetImmutableDeletedFiles();
-
-  // Apply all ssts info of previous version
+  // Get score ranking from previous version(to know which level should be
+  // compacted)
   for (int level = 0; level < config_->GetSSTNumLvels(); level++) {
-    for (const auto &sst_info : old_version_sst_info[level]) {
-      // Get score ranking from previous version(to know which level should
-      // be compacted)
+    if (!old_version_sst_info[level].empty()) {
       latest_levels_score[level] = old_levels_score[level];
+    }
+  }
 
-      // If file are in list of should be deleted file, skip
-      if (deleted_files.find({sst_info->table_id, sst_info->level}) !=
-          deleted_files.end()) {
-        continue;
-      }
-
-      // Increase refcount of SST metadata each time a new version is
-      // created
-      sst_info->ref_count.fetch_add(1, std::memory_order_relaxed);
-
-      latest_version_sst_info[level].push_back(sst_info);
+  // Files that are deleted are looked up by id, instead of scanning every file
+  // of previous version. They are deleted from disk once older versions are
+  // gone
+  std::vector<std::vector<std::shared_ptr<SSTMetadata>>> removed_files(
+      config_->GetSSTNumLvels());
+  for (const auto &[table_id, level] :
+       version_edit->GetImmutableDeletedFiles()) {
+    auto it = live_files_.find(table_id);
+    if (it == live_files_.end() || it->second->level != level) {
+      continue;
     }
+
+    obsolete_files_.emplace_back(new_verions_id, it->second);
+    removed_files[level].push_back(std::move(it->second));
+    live_files_.erase(it);
   }
 
   // Apply new SST files that are created for new verison
   const std::vector<std::vector<std::shared_ptr<SSTMetadata>>> &added_files =
       version_edit->GetImmutableNewFiles();
 
-  // Merge two sorted file
   for (int level = 0; level < config_->GetSSTNumLvels(); level++) {
-    if (added_files[level].empty()) {
-      continue;
-    }
-
-    std::for_each(added_files[level].begin(), added_files[level].end(),
-                  [](const auto &elem) {
-                    return elem->ref_count.fetch_add(1,
-                                                     std::memory_order_relaxed);
-                  });
-
-    if (level == 0) {
-      latest_version_sst_info[level].insert(
-          latest_version_sst_info[level].end(), added_files[level].begin(),
-          added_files[level].end());
-      continue;
+    for (const auto &sst_info : added_files[level]) {
+      live_files_.insert({sst_info->table_id, sst_info});
     }
 
-    // With level >= 1. add new file and sort based on smallest key in
-    // ascending order
-    const std::vector<std::shared_ptr<SSTMetadata>> &added_files_at_level =
-        added_files[level];
-    std::vector<std::shared_ptr<SSTMetadata>> new_sst_files;
-    new_sst_files.reserve(latest_version_sst_info[level].size() +
-                          added_files_at_level.size());
-
-    // Merge 2 sorted vector
-    std::merge(latest_version_sst_info[level].begin(),
-               latest_version_sst_info[level].end(), added_files[level].begin(),
-               added_files[level].end(), std::back_inserter(new_sst_files),
-               [](const auto &a, const auto &b) {
-                 return a->smallest_key < b->smallest_key;
-               });
-    // Assign back
-    latest_version_sst_info[level] = std::move(new_sst_files);
-
-    // // Update level's score
-    // latest_levels_score[level] =
-    //     static_cast<double>(latest_version_sst_info[level].size()) /
-    //     static_cast<double>(config_->GetLvl0SSTCompactionTrigger());
+    // With level >= 1, files are kept sorted based on smallest key in
+    // ascending order. New files of level 0 go after older ones
+    latest_version_sst_info[level] = latest_version_sst_info[level].Apply(
+        added_files[level], removed_files[level], level >= 1 /*sorted*/);
   }
 
   // Update level 0' score
@@ -242,6 +243,25 @@ bool VersionManager::NeedSSTCompaction() const {
   return latest_version_->NeedCompaction();
 }
 
+std::optional<int> VersionManager::GetLevelToCompact() const {
+  std::scoped_lock lock(mutex_);
+  if (!latest_version_) {
+    return std::nullopt;
+  }
+
+  return latest_version_->GetLevelToCompact();
+}
+
+const Version *VersionManager::AcquireLatestVersion() const {
+  std::scoped_lock lock(mutex_);
+  if (latest_version_) {
+    // Under lock, so that latest version can't become obsolete meanwhile
+    latest_version_->IncreaseRefCount();
+  }
+
+  return latest_version_.get();
+}
+
 const Version *VersionManager::GetLatestVersion() const {
   std::scoped_lock lock(mutex_);
   return latest_version_.get();
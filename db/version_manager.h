@@ -6,6 +6,7 @@
 #include <deque>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <unordered_map>
 #include <vector>
 
@@ -39,16 +40,30 @@ public:
   VersionManager(VersionManager &&) = default;
   VersionManager &operator=(VersionManager &&) = default;
 
-  void RemoveObsoleteVersion(uint64_t version_id) const;
+  // Schedule a reclamation round on thread pool, unless one is pending or
+  // thread pool is shut down
+  void MaybeScheduleReclamation() const;
+
+  // Free every obsolete version at once, then delete files that none of live
+  // versions refers to anymore, along with their row cache entries. Files are
+  // removed out of lock
+  void ReclaimObsoleteVersions() const;
 
   // Create latest version and apply new SSTs metadata
   void ApplyNewChanges(std::unique_ptr<VersionEdit> version_edit);
 
   bool NeedSSTCompaction() const;
 
+  // Level that next compaction of latest version takes files from
+  std::optional<int> GetLevelToCompact() const;
+
   const std::unordered_map<uint64_t, std::unique_ptr<Version>> &
   GetVersions() const;
 
+  // Referenced latest version(nullptr if there is none), caller MUST
+  // DecreaseRefCount() it
+  const Version *AcquireLatestVersion() const;
+
   // For testing
   const Version *GetLatestVersion() const;
 
@@ -65,6 +80,18 @@ private:
 
   std::unique_ptr<Version> latest_version_;
 
+  // Files deleted by version edits, with id of first version that doesn't
+  // contain them(its epoch). Ordered by epoch, a file can be deleted once
+  // every version older than its epoch has been freed
+  mutable std::deque<std::pair<uint64_t, std::shared_ptr<SSTMetadata>>>
+      obsolete_files_;
+
+  // Files of latest version by id, so that a version edit finds files it
+  // deletes without scanning every level
+  std::unordered_map<SSTId, std::shared_ptr<SSTMetadata>> live_files_;
+
+  mutable std::atomic<bool> reclamation_scheduled_{false};
+
   // Below are objects that VersionManager does NOT own lifetime. So, DO NOT
   // modify, including change memory that it is pointing to,
   // allocate/deallocate, etc... these objects.
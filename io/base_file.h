@@ -4,6 +4,7 @@
 #include "common/macros.h"
 
 // libC++
+#include <memory>
 #include <span>
 
 // libC
@@ -15,6 +16,8 @@ namespace io {
 
 class Buffer;
 
+enum class AccessPattern { kNormal, kRandom, kSequential };
+
 class AppendOnlyFile {
 public:
   virtual ~AppendOnlyFile() {}
@@ -57,6 +60,33 @@ public:
   virtual bool Open() = 0;
 
   virtual ssize_t RandomRead(std::span<Byte> buffer, uint64_t offset) = 0;
+
+  // File descriptor used to issue asynchronous reads. -1 if file isn't backed
+  // by a file descriptor
+  virtual Fd GetFd() const { return -1; }
+
+  // Tell OS how file is going to be read. Hints are best effort
+  virtual void Hint(AccessPattern /*pattern*/) {}
+
+  // Ask OS to start loading range into page cache, without waiting for it
+  virtual void Prefetch(uint64_t /*offset*/, size_t /*length*/) {}
+
+  // Start of whole file mapped into memory. nullptr if file isn't memory
+  // mapped. Mapping stays valid while a reference to it is held, even after
+  // file is closed
+  virtual std::shared_ptr<const Byte> GetMapping() const { return nullptr; }
+};
+
+// A read of buffer.size() bytes, starting at offset of file
+struct ReadRequest {
+  ReadOnlyFile *file{nullptr};
+
+  uint64_t offset{0};
+
+  std::span<Byte> buffer;
+
+  // Number of bytes read, or -1 if read failed
+  ssize_t result{-1};
 };
 
 } // namespace io
@@ -0,0 +1,218 @@
+#include "io/io_completion_queue.h"
+
+#include "common/executor.h"
+
+// libC++
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+namespace {
+
+// user_data of operation that stops reaper thread. Operations are never at
+// address 0
+constexpr uint64_t kStopReaper = 0;
+
+// Wait between attempts to reap submitted reads, once waiting for them fails
+constexpr std::chrono::microseconds kReapRetryInterval(100);
+
+} // namespace
+
+namespace kvs {
+
+namespace io {
+
+IoCompletionQueue::IoCompletionQueue(unsigned int queue_depth)
+    : ring_(queue_depth), in_flight_(0), ring_failed_(false) {
+  if (ring_.IsValid()) {
+    reaper_ = std::thread(&IoCompletionQueue::ReapCompletions, this);
+  }
+}
+
+IoCompletionQueue::~IoCompletionQueue() {
+  if (!reaper_.joinable()) {
+    return;
+  }
+
+  {
+    std::scoped_lock lock(mutex_);
+    assert(in_flight_ == 0 && pending_.empty());
+    // Otherwise reaper stops by itself once there is nothing to reap
+    if (!ring_failed_) {
+      // Ring is empty, so there is room for it
+      ring_.PrepareNop(kStopReaper);
+      ring_.Submit();
+    }
+  }
+
+  reaper_.join();
+}
+
+bool IoCompletionQueue::IsValid() const {
+  return ring_.IsValid() && !ring_failed_.load();
+}
+
+IoCompletionQueue::ReadAwaiter
+IoCompletionQueue::Read(std::span<ReadRequest> requests, Executor *executor) {
+  return ReadAwaiter(this, requests, executor);
+}
+
+std::vector<IoCompletionQueue::Operation *>
+IoCompletionQueue::Enqueue(std::span<Operation *> operations) {
+  if (!ring_.IsValid()) {
+    return {operations.begin(), operations.end()};
+  }
+
+  std::vector<Operation *> failed;
+  std::scoped_lock lock(mutex_);
+  if (ring_failed_) {
+    return {operations.begin(), operations.end()};
+  }
+
+  pending_.insert(pending_.end(), operations.begin(), operations.end());
+  SubmitPending(&failed);
+
+  return failed;
+}
+
+void IoCompletionQueue::SubmitPending(std::vector<Operation *> *failed) {
+  std::vector<Operation *> prepared;
+  while (!pending_.empty() &&
+         in_flight_ + prepared.size() < ring_.GetQueueDepth()) {
+    Operation *operation = pending_.front();
+    ReadRequest &request = operation->awaiter->requests_[operation->index];
+    if (!ring_.PrepareRead(request.file->GetFd(), request.buffer,
+                           request.offset,
+                           reinterpret_cast<uint64_t>(operation))) {
+      break;
+    }
+
+    pending_.pop_front();
+    prepared.push_back(operation);
+  }
+
+  if (prepared.empty()) {
+    return;
+  }
+
+  const int submitted = std::max(ring_.Submit(), 0);
+  in_flight_ += submitted;
+
+  // Reads that weren't submitted are the last prepared ones
+  failed->insert(failed->end(), prepared.begin() + submitted, prepared.end());
+}
+
+void IoCompletionQueue::ReapCompletions() {
+  while (true) {
+    uint64_t user_data;
+    int32_t result;
+    if (!ring_.WaitCompletion(&user_data, &result)) {
+      if (!FailRing()) {
+        break;
+      }
+
+      // Submitted reads still complete, poll for them
+      std::this_thread::sleep_for(kReapRetryInterval);
+      continue;
+    }
+
+    if (user_data == kStopReaper) {
+      break;
+    }
+
+    std::vector<Operation *> failed;
+    bool all_reaped;
+    {
+      std::scoped_lock lock(mutex_);
+      in_flight_--;
+      SubmitPending(&failed);
+      // Nothing is submitted once ring has failed
+      all_reaped = ring_failed_ && in_flight_ == 0;
+    }
+
+    // Coroutines may be resumed here, so it is done out of lock
+    Complete(reinterpret_cast<Operation *>(user_data), result);
+    for (Operation *operation : failed) {
+      Complete(operation, -1);
+    }
+
+    if (all_reaped) {
+      break;
+    }
+  }
+}
+
+bool IoCompletionQueue::FailRing() {
+  std::deque<Operation *> failed;
+  bool has_in_flight;
+  {
+    std::scoped_lock lock(mutex_);
+    ring_failed_ = true;
+    failed.swap(pending_);
+    has_in_flight = in_flight_ > 0;
+  }
+
+  for (Operation *operation : failed) {
+    Complete(operation, -1);
+  }
+
+  return has_in_flight;
+}
+
+void IoCompletionQueue::Complete(Operation *operation, int32_t result) {
+  ReadAwaiter *awaiter = operation->awaiter;
+  ReadRequest &request = awaiter->requests_[operation->index];
+  request.result = (result < 0) ? -1 : result;
+  if (request.result < 0 ||
+      static_cast<size_t>(request.result) < request.buffer.size()) {
+    request.result = request.file->RandomRead(request.buffer, request.offset);
+  }
+
+  if (awaiter->remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    // Awaiter lives in coroutine frame, which may be gone once resumed
+    awaiter->executor_->Execute(awaiter->handle_);
+  }
+}
+
+IoCompletionQueue::ReadAwaiter::ReadAwaiter(IoCompletionQueue *queue,
+                                            std::span<ReadRequest> requests,
+                                            Executor *executor)
+    : queue_(queue), requests_(requests), executor_(executor),
+      remaining_(0) {
+  assert(queue_ && executor_);
+}
+
+bool IoCompletionQueue::ReadAwaiter::await_ready() const {
+  return requests_.empty();
+}
+
+bool IoCompletionQueue::ReadAwaiter::await_suspend(
+    std::coroutine_handle<> handle) {
+  handle_ = handle;
+  remaining_.store(requests_.size() + 1, std::memory_order_relaxed);
+
+  operations_.reserve(requests_.size());
+  std::vector<Operation *> to_submit;
+  std::vector<Operation *> failed;
+  for (size_t i = 0; i < requests_.size(); i++) {
+    operations_.push_back({this, i});
+    (requests_[i].file->GetFd() < 0 ? failed : to_submit)
+        .push_back(&operations_.back());
+  }
+
+  if (!to_submit.empty()) {
+    std::vector<Operation *> not_submitted = queue_->Enqueue(to_submit);
+    failed.insert(failed.end(), not_submitted.begin(), not_submitted.end());
+  }
+
+  for (Operation *operation : failed) {
+    Complete(operation, -1);
+  }
+
+  // Once it is released, coroutine may be resumed by reaper thread at any time
+  return remaining_.fetch_sub(1, std::memory_order_acq_rel) != 1;
+}
+
+} // namespace io
+
+} // namespace kvs
\ No newline at end of file
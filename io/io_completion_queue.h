@@ -0,0 +1,156 @@
+#ifndef IO_IO_COMPLETION_QUEUE_H
+#define IO_IO_COMPLETION_QUEUE_H
+
+#include "io/base_file.h"
+#include "io/io_uring.h"
+
+// libC++
+#include <atomic>
+#include <coroutine>
+#include <deque>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace kvs {
+
+class Executor;
+
+namespace io {
+
+constexpr unsigned int kDefaultIoCompletionQueueDepth = 128;
+
+/*
+Reads issued by coroutines, that suspend until their reads are done instead of
+blocking calling thread.
+
+All reads go through a single io_uring ring, that any thread can submit to.
+A dedicated thread waits for completions and resumes each coroutine through
+executor given with its reads, once all of them are done. At most queue_depth
+reads are in flight, further ones are queued and submitted as others complete.
+
+If io_uring isn't available, reads are done with a blocking RandomRead and
+coroutine doesn't suspend.
+
+Usage:
+  std::vector<ReadRequest> requests = ...;
+  co_await queue->Read(requests, executor);
+*/
+class IoCompletionQueue {
+public:
+  class ReadAwaiter;
+
+  explicit IoCompletionQueue(
+      unsigned int queue_depth = kDefaultIoCompletionQueueDepth);
+
+  // Every read MUST have been completed
+  ~IoCompletionQueue();
+
+  // No copy allowed
+  IoCompletionQueue(const IoCompletionQueue &) = delete;
+  IoCompletionQueue &operator=(IoCompletionQueue &) = delete;
+
+  // No move allowed
+  IoCompletionQueue(IoCompletionQueue &&) = delete;
+  IoCompletionQueue &operator=(IoCompletionQueue &&) = delete;
+
+  // False if reads are done with blocking RandomRead, which is also the case
+  // once ring has failed
+  bool IsValid() const;
+
+  // Awaitable that issues all requests together. Once it is resumed, result
+  // of each request is set as io::MultiRead does. requests MUST outlive it
+  ReadAwaiter Read(std::span<ReadRequest> requests, Executor *executor);
+
+private:
+  // A request of ReadAwaiter, user_data of its io_uring read points to it
+  struct Operation {
+    ReadAwaiter *awaiter;
+
+    size_t index;
+  };
+
+  // Queue operations. Return ones that couldn't be handed to kernel, caller
+  // MUST complete them
+  std::vector<Operation *> Enqueue(std::span<Operation *> operations);
+
+  // Submit pending operations, as long as there is room in ring. Operations
+  // that couldn't be submitted are added to failed.
+  // REQUIRES: mutex_ is held
+  void SubmitPending(std::vector<Operation *> *failed);
+
+  // Wait for completions and complete their operations, until queue is
+  // destroyed or ring fails and every submitted read is reaped
+  void ReapCompletions();
+
+  // Stop using ring once waiting for completions fails. Pending operations
+  // and later ones are completed with RandomRead. Return whether submitted
+  // reads are left to be reaped
+  bool FailRing();
+
+  // Set result of operation, then resume its coroutine if it is the last one
+  // that is done. Failed or partial reads are retried with RandomRead
+  static void Complete(Operation *operation, int32_t result);
+
+  IoUring ring_;
+
+  // Protect submission side of ring_, pending_ and in_flight_
+  std::mutex mutex_;
+
+  // Operations waiting for room in ring
+  std::deque<Operation *> pending_;
+
+  // Number of reads submitted and not reaped yet
+  unsigned int in_flight_;
+
+  // Set under mutex_ once ring can't be waited on anymore
+  std::atomic<bool> ring_failed_;
+
+  // Only started if ring is valid
+  std::thread reaper_;
+};
+
+class IoCompletionQueue::ReadAwaiter {
+public:
+  ReadAwaiter(IoCompletionQueue *queue, std::span<ReadRequest> requests,
+              Executor *executor);
+
+  // No copy allowed
+  ReadAwaiter(const ReadAwaiter &) = delete;
+  ReadAwaiter &operator=(ReadAwaiter &) = delete;
+
+  // No move allowed
+  ReadAwaiter(ReadAwaiter &&) = delete;
+  ReadAwaiter &operator=(ReadAwaiter &&) = delete;
+
+  bool await_ready() const;
+
+  // Return false if every read is done already, so coroutine keeps running
+  bool await_suspend(std::coroutine_handle<> handle);
+
+  void await_resume() const {}
+
+private:
+  friend class IoCompletionQueue;
+
+  IoCompletionQueue *const queue_;
+
+  const std::span<ReadRequest> requests_;
+
+  Executor *const executor_;
+
+  std::coroutine_handle<> handle_;
+
+  std::vector<Operation> operations_;
+
+  // Number of operations that aren't done yet, plus one held by
+  // await_suspend() until all operations are queued
+  std::atomic<size_t> remaining_;
+};
+
+} // namespace io
+
+} // namespace kvs
+
+#endif // IO_IO_COMPLETION_QUEUE_H
\ No newline at end of file
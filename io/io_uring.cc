@@ -0,0 +1,358 @@
+#include "io/io_uring.h"
+
+// libC++
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#if defined(KVS_HAVE_IO_URING)
+// linux
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr unsigned int kDefaultIoUringQueueDepth = 64;
+
+// Wait between attempts to reap submitted reads, once waiting for them fails
+constexpr std::chrono::microseconds kReapRetryInterval(100);
+
+#if defined(KVS_HAVE_IO_URING)
+// Set to false once setting up a ring failed, so that other threads don't
+// retry
+std::atomic<bool> io_uring_supported{true};
+
+unsigned *RingPointer(void *ring, uint32_t offset) {
+  return reinterpret_cast<unsigned *>(static_cast<uint8_t *>(ring) + offset);
+}
+#endif
+
+} // namespace
+
+namespace kvs {
+
+namespace io {
+
+IoUring::IoUring(unsigned int queue_depth)
+    : ring_fd_(-1), queue_depth_(0), to_submit_(0), sq_ring_(nullptr),
+      sq_ring_size_(0), sq_head_(nullptr), sq_tail_(nullptr),
+      sq_mask_(nullptr), sq_array_(nullptr), sqes_(nullptr), sqes_size_(0),
+      cq_ring_(nullptr), cq_ring_size_(0), cq_head_(nullptr),
+      cq_tail_(nullptr), cq_mask_(nullptr), cqes_(nullptr) {
+  // On failure, resources that were already set up are released by destructor
+  Setup(queue_depth);
+}
+
+#if defined(KVS_HAVE_IO_URING)
+
+IoUring::~IoUring() {
+  if (sqes_) {
+    ::munmap(sqes_, sqes_size_);
+  }
+  if (cq_ring_ && cq_ring_ != sq_ring_) {
+    ::munmap(cq_ring_, cq_ring_size_);
+  }
+  if (sq_ring_) {
+    ::munmap(sq_ring_, sq_ring_size_);
+  }
+  if (ring_fd_ >= 0) {
+    ::close(ring_fd_);
+  }
+}
+
+bool IoUring::Setup(unsigned int queue_depth) {
+  io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+
+  ring_fd_ =
+      static_cast<Fd>(::syscall(__NR_io_uring_setup, queue_depth, &params));
+  if (ring_fd_ < 0) {
+    return false;
+  }
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+  // Since 5.4, both rings can be mapped with a single mmap
+  const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    sq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    cq_ring_size_ = sq_ring_size_;
+  }
+
+  void *sq_ring =
+      ::mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ring == MAP_FAILED) {
+    return false;
+  }
+  sq_ring_ = sq_ring;
+
+  if (single_mmap) {
+    cq_ring_ = sq_ring_;
+  } else {
+    void *cq_ring =
+        ::mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+    if (cq_ring == MAP_FAILED) {
+      return false;
+    }
+    cq_ring_ = cq_ring;
+  }
+
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  void *sqes = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    return false;
+  }
+  sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+  sq_head_ = RingPointer(sq_ring_, params.sq_off.head);
+  sq_tail_ = RingPointer(sq_ring_, params.sq_off.tail);
+  sq_mask_ = RingPointer(sq_ring_, params.sq_off.ring_mask);
+  sq_array_ = RingPointer(sq_ring_, params.sq_off.array);
+
+  cq_head_ = RingPointer(cq_ring_, params.cq_off.head);
+  cq_tail_ = RingPointer(cq_ring_, params.cq_off.tail);
+  cq_mask_ = RingPointer(cq_ring_, params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe *>(
+      RingPointer(cq_ring_, params.cq_off.cqes));
+
+  queue_depth_ = params.sq_entries;
+
+  return true;
+}
+
+bool IoUring::PrepareRead(Fd fd, std::span<Byte> buffer, uint64_t offset,
+                          uint64_t user_data) {
+  assert(IsValid());
+
+  // Only this thread updates tail. Head is updated by kernel
+  const unsigned tail = *sq_tail_;
+  const unsigned head =
+      std::atomic_ref<unsigned>(*sq_head_).load(std::memory_order_acquire);
+  if (tail - head >= queue_depth_) {
+    return false;
+  }
+
+  const unsigned index = tail & *sq_mask_;
+  io_uring_sqe *sqe = &sqes_[index];
+  std::memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = IORING_OP_READ;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uint64_t>(buffer.data());
+  sqe->len = static_cast<uint32_t>(buffer.size());
+  sqe->off = offset;
+  sqe->user_data = user_data;
+  sq_array_[index] = index;
+
+  // Publish entry to kernel
+  std::atomic_ref<unsigned>(*sq_tail_).store(tail + 1,
+                                             std::memory_order_release);
+  to_submit_++;
+
+  return true;
+}
+
+bool IoUring::PrepareNop(uint64_t user_data) {
+  assert(IsValid());
+
+  const unsigned tail = *sq_tail_;
+  const unsigned head =
+      std::atomic_ref<unsigned>(*sq_head_).load(std::memory_order_acquire);
+  if (tail - head >= queue_depth_) {
+    return false;
+  }
+
+  const unsigned index = tail & *sq_mask_;
+  io_uring_sqe *sqe = &sqes_[index];
+  std::memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = IORING_OP_NOP;
+  sqe->user_data = user_data;
+  sq_array_[index] = index;
+
+  std::atomic_ref<unsigned>(*sq_tail_).store(tail + 1,
+                                             std::memory_order_release);
+  to_submit_++;
+
+  return true;
+}
+
+int IoUring::Submit() {
+  assert(IsValid());
+
+  int total_submitted = 0;
+  while (to_submit_ > 0) {
+    int submitted = static_cast<int>(
+        ::syscall(__NR_io_uring_enter, ring_fd_, to_submit_, 0, 0, nullptr, 0));
+    if (submitted < 0) {
+      if (errno == EINTR) {
+        continue; // Retry
+      }
+
+      // Without SQPOLL, kernel only consumes entries inside io_uring_enter. So
+      // entries that weren't submitted can be safely taken back
+      std::atomic_ref<unsigned>(*sq_tail_).store(*sq_tail_ - to_submit_,
+                                                 std::memory_order_release);
+      to_submit_ = 0;
+      return (total_submitted > 0) ? total_submitted : -1;
+    }
+
+    to_submit_ -= submitted;
+    total_submitted += submitted;
+  }
+
+  return total_submitted;
+}
+
+bool IoUring::WaitCompletion(uint64_t *user_data, int32_t *result) {
+  assert(IsValid() && user_data && result);
+
+  while (true) {
+    // Only this thread updates head. Tail is updated by kernel
+    const unsigned head = *cq_head_;
+    const unsigned tail =
+        std::atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire);
+    if (head != tail) {
+      const io_uring_cqe *cqe = &cqes_[head & *cq_mask_];
+      *user_data = cqe->user_data;
+      *result = cqe->res;
+
+      // Hand entry back to kernel
+      std::atomic_ref<unsigned>(*cq_head_).store(head + 1,
+                                                 std::memory_order_release);
+      return true;
+    }
+
+    if (::syscall(__NR_io_uring_enter, ring_fd_, 0, 1, IORING_ENTER_GETEVENTS,
+                  nullptr, 0) < 0 &&
+        errno != EINTR) {
+      return false;
+    }
+  }
+}
+
+IoUring *IoUring::GetThreadLocal() {
+  thread_local std::unique_ptr<IoUring> ring = []() {
+    std::unique_ptr<IoUring> new_ring;
+    if (io_uring_supported.load(std::memory_order_relaxed)) {
+      new_ring = std::make_unique<IoUring>(kDefaultIoUringQueueDepth);
+      if (!new_ring->IsValid()) {
+        io_uring_supported.store(false, std::memory_order_relaxed);
+        new_ring.reset();
+      }
+    }
+    return new_ring;
+  }();
+
+  return ring.get();
+}
+
+#else
+
+IoUring::~IoUring() = default;
+
+bool IoUring::Setup(unsigned int queue_depth) { return false; }
+
+bool IoUring::PrepareRead(Fd fd, std::span<Byte> buffer, uint64_t offset,
+                          uint64_t user_data) {
+  return false;
+}
+
+bool IoUring::PrepareNop(uint64_t user_data) { return false; }
+
+int IoUring::Submit() { return -1; }
+
+bool IoUring::WaitCompletion(uint64_t *user_data, int32_t *result) {
+  return false;
+}
+
+IoUring *IoUring::GetThreadLocal() { return nullptr; }
+
+#endif // KVS_HAVE_IO_URING
+
+// queue_depth_ is only set once ring is completely set up
+bool IoUring::IsValid() const { return queue_depth_ > 0; }
+
+unsigned int IoUring::GetQueueDepth() const { return queue_depth_; }
+
+void MultiRead(std::span<ReadRequest> requests) {
+  for (auto &request : requests) {
+    request.result = -1;
+  }
+
+  // A single read gains nothing from io_uring
+  IoUring *ring = (requests.size() > 1) ? IoUring::GetThreadLocal() : nullptr;
+
+  size_t next = 0;
+  while (ring && next < requests.size()) {
+    // Queue as many reads as ring can hold
+    size_t total_prepared = 0;
+    for (; next < requests.size(); next++) {
+      const Fd fd = requests[next].file->GetFd();
+      if (fd < 0) {
+        continue;
+      }
+
+      if (!ring->PrepareRead(fd, requests[next].buffer, requests[next].offset,
+                             next)) {
+        break;
+      }
+      total_prepared++;
+    }
+
+    if (total_prepared == 0) {
+      break;
+    }
+
+    int submitted = ring->Submit();
+    if (submitted < 0) {
+      // Let remaining requests be read by RandomRead
+      break;
+    }
+
+    // Every submitted read is reaped before returning, kernel writes into its
+    // buffer until it completes. Its completion also mustn't be left in ring
+    // for next call
+    bool wait_failed = false;
+    for (int remaining = submitted; remaining > 0;) {
+      uint64_t index;
+      int32_t result;
+      if (!ring->WaitCompletion(&index, &result)) {
+        // Completions are still posted to ring, poll for them
+        wait_failed = true;
+        std::this_thread::sleep_for(kReapRetryInterval);
+        continue;
+      }
+
+      requests[index].result = (result < 0) ? -1 : result;
+      remaining--;
+    }
+
+    if (wait_failed) {
+      // Stop using ring, remaining requests are read by RandomRead
+      ring = nullptr;
+    }
+  }
+
+  // Requests that failed, were read partially, or couldn't be sent to ring
+  for (auto &request : requests) {
+    if (request.result < 0 ||
+        static_cast<size_t>(request.result) < request.buffer.size()) {
+      request.result = request.file->RandomRead(request.buffer, request.offset);
+    }
+  }
+}
+
+} // namespace io
+
+} // namespace kvs
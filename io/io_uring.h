@@ -0,0 +1,111 @@
+#ifndef IO_IO_URING_H
+#define IO_IO_URING_H
+
+#include "common/macros.h"
+#include "io/base_file.h"
+
+// libC++
+#include <span>
+
+struct io_uring_cqe;
+struct io_uring_sqe;
+
+namespace kvs {
+
+namespace io {
+
+/*
+Minimal io_uring wrapper that only supports reads. It is built directly on top
+of io_uring_setup/io_uring_enter syscalls, so liburing isn't required.
+
+Usage:
+  PrepareRead() -> ... -> PrepareRead() -> Submit() -> WaitCompletion() * N
+
+NOT THREAD-SAFE. Each thread should use its own ring(GetThreadLocal()). The
+only exception is that completions may be waited for by one thread, while
+reads are prepared and submitted by another one(under a lock, if there are
+many of them), since both sides don't share any state
+*/
+class IoUring {
+public:
+  explicit IoUring(unsigned int queue_depth);
+
+  ~IoUring();
+
+  // No copy allowed
+  IoUring(const IoUring &) = delete;
+  IoUring &operator=(IoUring &) = delete;
+
+  // No move allowed
+  IoUring(IoUring &&) = delete;
+  IoUring &operator=(IoUring &&) = delete;
+
+  // False if ring can't be set up(kernel doesn't support io_uring, ...)
+  bool IsValid() const;
+
+  // Max number of reads that can be queued before Submit() is called
+  unsigned int GetQueueDepth() const;
+
+  // Queue a read of buffer.size() bytes at offset of fd. Nothing is sent to
+  // kernel until Submit() is called. Return false if queue is full
+  bool PrepareRead(Fd fd, std::span<Byte> buffer, uint64_t offset,
+                   uint64_t user_data);
+
+  // Queue an operation that does nothing, its completion only wakes up thread
+  // that waits for completions. Return false if queue is full
+  bool PrepareNop(uint64_t user_data);
+
+  // Send all queued reads to kernel. Return number of submitted reads, or -1
+  // if none of them could be submitted
+  int Submit();
+
+  // Block until a submitted read is completed. result is number of bytes
+  // read, or -errno
+  bool WaitCompletion(uint64_t *user_data, int32_t *result);
+
+  // Ring owned by calling thread. nullptr if io_uring isn't available
+  static IoUring *GetThreadLocal();
+
+private:
+  bool Setup(unsigned int queue_depth);
+
+  Fd ring_fd_;
+
+  // 0 if ring isn't set up
+  unsigned int queue_depth_;
+
+  // Number of reads queued but not submitted yet
+  unsigned int to_submit_;
+
+  // Submission queue ring, shared with kernel
+  void *sq_ring_;
+  size_t sq_ring_size_;
+  unsigned *sq_head_;
+  unsigned *sq_tail_;
+  unsigned *sq_mask_;
+  unsigned *sq_array_;
+
+  io_uring_sqe *sqes_;
+  size_t sqes_size_;
+
+  // Completion queue ring, shared with kernel. Maybe the same mapping as
+  // submission queue ring
+  void *cq_ring_;
+  size_t cq_ring_size_;
+  unsigned *cq_head_;
+  unsigned *cq_tail_;
+  unsigned *cq_mask_;
+
+  io_uring_cqe *cqes_;
+};
+
+// Issue all read requests together through io_uring of calling thread.
+// Requests can target different files. Requests that can't be served by
+// io_uring fall back to a blocking RandomRead
+void MultiRead(std::span<ReadRequest> requests);
+
+} // namespace io
+
+} // namespace kvs
+
+#endif // IO_IO_URING_H
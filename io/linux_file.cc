@@ -4,12 +4,14 @@
 #include "io/buffer.h"
 
 // C++ libs
+#include <algorithm>
 #include <cerrno>
 #include <cstring>
 #include <iostream>
 
 // C libs
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -194,8 +196,142 @@ ssize_t LinuxReadOnlyFile::RandomRead(std::span<Byte> buffer, uint64_t offset) {
   return read_bytes;
 }
 
+Fd LinuxReadOnlyFile::GetFd() const { return fd_; }
+
+void LinuxReadOnlyFile::Hint(AccessPattern pattern) {
+  int advice = POSIX_FADV_NORMAL;
+  switch (pattern) {
+  case AccessPattern::kNormal:
+    advice = POSIX_FADV_NORMAL;
+    break;
+  case AccessPattern::kRandom:
+    advice = POSIX_FADV_RANDOM;
+    break;
+  case AccessPattern::kSequential:
+    advice = POSIX_FADV_SEQUENTIAL;
+    break;
+  }
+
+  // Whole file
+  ::posix_fadvise(fd_, 0, 0, advice);
+}
+
+void LinuxReadOnlyFile::Prefetch(uint64_t offset, size_t length) {
+  ::readahead(fd_, static_cast<off64_t>(offset), length);
+}
+
 // ===========================End LinuxReadOnlyFile===========================
 
+// ========================Start LinuxMmapReadOnlyFile=========================
+
+LinuxMmapReadOnlyFile::LinuxMmapReadOnlyFile(std::string_view filename)
+    : filename_(std::string(filename)), fd_(-1), file_size_(0) {}
+
+LinuxMmapReadOnlyFile::~LinuxMmapReadOnlyFile() { Close(); }
+
+bool LinuxMmapReadOnlyFile::Open() {
+  fd_ = ::open(filename_.c_str(), O_RDONLY);
+  if (fd_ == -1) {
+    std::cerr << "LinuxMmapReadOnlyFile Error message: "
+              << std::strerror(errno) << " " << filename_ << std::endl;
+    return false;
+  }
+
+  struct stat file_stat;
+  if (::fstat(fd_, &file_stat) == -1 || file_stat.st_size == 0) {
+    return false;
+  }
+  file_size_ = static_cast<size_t>(file_stat.st_size);
+
+  void *addr = ::mmap(nullptr, file_size_, PROT_READ, MAP_SHARED, fd_, 0);
+  if (addr == MAP_FAILED) {
+    std::cerr << "LinuxMmapReadOnlyFile Error message: "
+              << std::strerror(errno) << " " << filename_ << std::endl;
+    return false;
+  }
+
+  // Unmapped once the last reference(file or block readers) is released
+  const size_t file_size = file_size_;
+  mapping_ = std::shared_ptr<const Byte>(
+      static_cast<const Byte *>(addr), [file_size](const Byte *addr) {
+        ::munmap(const_cast<Byte *>(addr), file_size);
+      });
+
+  return true;
+}
+
+bool LinuxMmapReadOnlyFile::Close() {
+  mapping_.reset();
+
+  if (fd_ == -1) {
+    return true;
+  }
+
+  if (::close(fd_) == -1) {
+    std::cerr << "Error message: " << std::strerror(errno) << std::endl;
+    return false;
+  }
+  fd_ = -1;
+
+  return true;
+}
+
+ssize_t LinuxMmapReadOnlyFile::RandomRead(std::span<Byte> buffer,
+                                          uint64_t offset) {
+  if (!mapping_ || offset > file_size_) {
+    return -1;
+  }
+
+  size_t read_bytes = std::min(buffer.size(), file_size_ - offset);
+  std::memcpy(buffer.data(), mapping_.get() + offset, read_bytes);
+
+  return static_cast<ssize_t>(read_bytes);
+}
+
+Fd LinuxMmapReadOnlyFile::GetFd() const { return fd_; }
+
+void LinuxMmapReadOnlyFile::Hint(AccessPattern pattern) {
+  if (!mapping_) {
+    return;
+  }
+
+  int advice = MADV_NORMAL;
+  switch (pattern) {
+  case AccessPattern::kNormal:
+    advice = MADV_NORMAL;
+    break;
+  case AccessPattern::kRandom:
+    advice = MADV_RANDOM;
+    break;
+  case AccessPattern::kSequential:
+    advice = MADV_SEQUENTIAL;
+    break;
+  }
+
+  ::madvise(const_cast<Byte *>(mapping_.get()), file_size_, advice);
+}
+
+void LinuxMmapReadOnlyFile::Prefetch(uint64_t offset, size_t length) {
+  if (!mapping_ || offset >= file_size_) {
+    return;
+  }
+
+  // madvise requires a page aligned address
+  const uint64_t page_size = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+  const uint64_t aligned_offset = offset - offset % page_size;
+  length = std::min<uint64_t>(length + offset - aligned_offset,
+                              file_size_ - aligned_offset);
+
+  ::madvise(const_cast<Byte *>(mapping_.get()) + aligned_offset, length,
+            MADV_WILLNEED);
+}
+
+std::shared_ptr<const Byte> LinuxMmapReadOnlyFile::GetMapping() const {
+  return mapping_;
+}
+
+// =========================End LinuxMmapReadOnlyFile==========================
+
 } // namespace io
 
 } // namespace kvs
\ No newline at end of file
@@ -92,10 +92,56 @@ public:
 
   ssize_t RandomRead(std::span<Byte> buffer, uint64_t offset) override;
 
+  Fd GetFd() const override;
+
+  void Hint(AccessPattern pattern) override;
+
+  void Prefetch(uint64_t offset, size_t length) override;
+
+private:
+  std::string filename_;
+
+  Fd fd_;
+};
+
+// Read only file that is mapped into memory as a whole when opened
+class LinuxMmapReadOnlyFile : public ReadOnlyFile {
+public:
+  explicit LinuxMmapReadOnlyFile(std::string_view filename);
+
+  ~LinuxMmapReadOnlyFile();
+
+  // No copy allowed
+  LinuxMmapReadOnlyFile(const LinuxMmapReadOnlyFile &) = delete;
+  LinuxMmapReadOnlyFile &operator=(LinuxMmapReadOnlyFile &) = delete;
+
+  // Move constructor/assignment
+  LinuxMmapReadOnlyFile(LinuxMmapReadOnlyFile &&) = default;
+  LinuxMmapReadOnlyFile &operator=(LinuxMmapReadOnlyFile &&) = default;
+
+  bool Open() override;
+
+  bool Close() override;
+
+  // Copy from mapping
+  ssize_t RandomRead(std::span<Byte> buffer, uint64_t offset) override;
+
+  Fd GetFd() const override;
+
+  void Hint(AccessPattern pattern) override;
+
+  void Prefetch(uint64_t offset, size_t length) override;
+
+  std::shared_ptr<const Byte> GetMapping() const override;
+
 private:
   std::string filename_;
 
   Fd fd_;
+
+  size_t file_size_;
+
+  std::shared_ptr<const Byte> mapping_;
 };
 
 } // namespace io
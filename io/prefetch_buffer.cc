@@ -0,0 +1,75 @@
+#include "io/prefetch_buffer.h"
+
+#include "io/base_file.h"
+
+// libC++
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+
+namespace kvs {
+
+namespace io {
+
+PrefetchBuffer::PrefetchBuffer(size_t initial_readahead_size,
+                               size_t max_readahead_size)
+    : initial_readahead_size_(initial_readahead_size),
+      max_readahead_size_(std::max(initial_readahead_size, max_readahead_size)),
+      readahead_size_(initial_readahead_size), window_offset_(0),
+      window_length_(0),
+      next_sequential_offset_(std::numeric_limits<uint64_t>::max()) {}
+
+bool PrefetchBuffer::Read(ReadOnlyFile *file, uint64_t offset,
+                          std::span<Byte> buffer) {
+  assert(file);
+
+  const bool in_window =
+      window_offset_ <= offset &&
+      offset + buffer.size() <= window_offset_ + window_length_;
+  if (!in_window) {
+    if (offset == next_sequential_offset_) {
+      // Sequential access, read further ahead each time window is exhausted
+      readahead_size_ = std::min(readahead_size_ * 2, max_readahead_size_);
+    } else {
+      readahead_size_ = initial_readahead_size_;
+    }
+
+    if (!Refill(file, offset, buffer.size())) {
+      return false;
+    }
+  }
+
+  std::memcpy(buffer.data(), &window_[offset - window_offset_], buffer.size());
+  next_sequential_offset_ = offset + buffer.size();
+
+  return true;
+}
+
+bool PrefetchBuffer::Refill(ReadOnlyFile *file, uint64_t offset,
+                            size_t length) {
+  // Capacity of window_ is kept, only grows when readahead size grows
+  window_.resize(std::max(length, readahead_size_));
+  window_length_ = 0;
+
+  ssize_t bytes_read = file->RandomRead(window_, offset);
+  if (bytes_read < 0 || static_cast<size_t>(bytes_read) < length) {
+    return false;
+  }
+
+  window_offset_ = offset;
+  window_length_ = static_cast<size_t>(bytes_read);
+
+  // Let kernel start loading next window while current one is consumed
+  if (readahead_size_ == max_readahead_size_) {
+    file->Prefetch(offset + window_length_, readahead_size_);
+  }
+
+  return true;
+}
+
+size_t PrefetchBuffer::GetReadaheadSize() const { return readahead_size_; }
+
+} // namespace io
+
+} // namespace kvs
@@ -0,0 +1,80 @@
+#ifndef IO_PREFETCH_BUFFER_H
+#define IO_PREFETCH_BUFFER_H
+
+#include "common/macros.h"
+
+// libC++
+#include <span>
+#include <vector>
+
+namespace kvs {
+
+namespace io {
+
+class ReadOnlyFile;
+
+// Readahead of iterators starts at 8KB(2 blocks) and doubles on sequential
+// access, up to 256KB
+constexpr size_t kDefaultInitialReadaheadSize = 8 * 1024; // 8KB
+constexpr size_t kDefaultMaxReadaheadSize = 256 * 1024;   // 256KB
+
+// Compaction reads whole files, so it uses a fixed large readahead
+constexpr size_t kDefaultCompactionReadaheadSize = 2 * 1024 * 1024; // 2MB
+
+/*
+Buffer that serves reads of a file from a window loaded ahead of time.
+Each time a read misses the window, a new window starting at the read is
+loaded. If the read continues where the previous one ended, window size is
+doubled(up to max_readahead_size). Otherwise it is reset to
+initial_readahead_size.
+NOT THREAD-SAFE.
+*/
+class PrefetchBuffer {
+public:
+  PrefetchBuffer(size_t initial_readahead_size, size_t max_readahead_size);
+
+  ~PrefetchBuffer() = default;
+
+  // No copy allowed
+  PrefetchBuffer(const PrefetchBuffer &) = delete;
+  PrefetchBuffer &operator=(PrefetchBuffer &) = delete;
+
+  // Move constructor/assignment
+  PrefetchBuffer(PrefetchBuffer &&) = default;
+  PrefetchBuffer &operator=(PrefetchBuffer &&) = default;
+
+  // Copy buffer.size() bytes starting at offset of file into buffer. Return
+  // false if file can't be read
+  bool Read(ReadOnlyFile *file, uint64_t offset, std::span<Byte> buffer);
+
+  size_t GetReadaheadSize() const;
+
+private:
+  // Load window starting at offset, that contains at least length bytes
+  bool Refill(ReadOnlyFile *file, uint64_t offset, size_t length);
+
+  const size_t initial_readahead_size_;
+
+  const size_t max_readahead_size_;
+
+  // Size of next window
+  size_t readahead_size_;
+
+  // Reused by every window
+  std::vector<Byte> window_;
+
+  // Offset in file of window_[0]
+  uint64_t window_offset_;
+
+  // Number of valid bytes in window_
+  size_t window_length_;
+
+  // Offset right after the previous read
+  uint64_t next_sequential_offset_;
+};
+
+} // namespace io
+
+} // namespace kvs
+
+#endif // IO_PREFETCH_BUFFER_H
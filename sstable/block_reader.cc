@@ -13,104 +13,154 @@ namespace sstable {
 BlockReader::BlockReader(std::unique_ptr<BlockReaderData> block_reader_data)
     : total_data_entries_(block_reader_data->total_data_entries),
       offset_section_(block_reader_data->offset_section),
-      data_entries_offset_info_(
-          std::move(block_reader_data->data_entries_offset_info)),
-      buffer_(std::move(block_reader_data->buffer)) {}
+      buffer_(std::move(block_reader_data->buffer)),
+      mapping_(std::move(block_reader_data->mapping)),
+      data_(mapping_ ? block_reader_data->mapped_block
+                     : std::span<const Byte>(buffer_)) {}
+
+db::ValueType BlockReader::GetValue(std::string_view key, TxnId txn_id,
+                                   std::string_view *value) const {
+  assert(value);
+
+  const int64_t index = FindEntry(key, txn_id, 0 /*left*/);
+  if (index == static_cast<int64_t>(total_data_entries_)) {
+    return db::ValueType::NOT_FOUND;
+  }
 
-db::GetStatus BlockReader::GetValue(std::string_view key, TxnId txn_id) const {
-  db::GetStatus status;
+  DataEntry data_entry = ParseDataEntry(GetDataEntryOffset(index));
+  if (data_entry.key != key) {
+    return db::ValueType::NOT_FOUND;
+  }
+
+  *value = data_entry.value;
+  return data_entry.type;
+}
+
+void BlockReader::MultiGetValue(std::span<const std::string_view> keys,
+                                TxnId txn_id,
+                                std::span<db::GetStatus> statuses) const {
+  assert(keys.size() == statuses.size());
 
-  // Binary search key in block based on offset
   int64_t left = 0;
-  int64_t right = total_data_entries_ - 1;
+  for (size_t i = 0; i < keys.size(); i++) {
+    if (statuses[i].type != db::ValueType::NOT_FOUND) {
+      continue;
+    }
 
-  while (left <= right) {
+    // Keys are sorted, so entry of this key can't be before entry of previous
+    // key
+    left = FindEntry(keys[i], txn_id, left);
+    statuses[i] = GetStatusFromEntry(left, keys[i]);
+  }
+}
+
+size_t BlockReader::GetCharge() const {
+  return sizeof(BlockReader) + buffer_.capacity();
+}
+
+std::span<const Byte> BlockReader::GetData() const { return data_; }
+
+int64_t BlockReader::FindEntry(std::string_view key, TxnId txn_id,
+                               int64_t left) const {
+  // Binary search the first entry that is not less than (key, txn_id)
+  int64_t right = total_data_entries_;
+
+  while (left < right) {
     int64_t mid = left + (right - left) / 2;
 
-    // Get value type of data entry
-    uint64_t data_entry_offset = data_entries_offset_info_[mid];
-    // assert(data_entry_offset == data_entries_offset_info_[mid]);
-    db::ValueType value_type = GetValueTypeFromDataEntry(data_entry_offset);
-    assert(value_type == db::ValueType::PUT ||
-           value_type == db::ValueType::DELETED);
-
-    // Get key and(or) value of data entry
-    auto key_in_block = GetKeyFromDataEntry(data_entry_offset);
-    if (key_in_block == key) {
-      status.type = value_type;
-      if (status.type == db::ValueType::DELETED) {
-        // entry is deleted, value of entry is empty
-        status.value = std::nullopt;
-        return status;
-      }
-
-      status.value = GetValueFromDataEntry(data_entry_offset);
-      return status;
-    } else if (key_in_block < key) {
+    DataEntry data_entry = ParseDataEntry(GetDataEntryOffset(mid));
+    if (data_entry.key < key ||
+        (data_entry.key == key && data_entry.txn_id > txn_id)) {
       left = mid + 1;
     } else {
-      right = mid - 1;
+      right = mid;
     }
   }
 
-  return status;
+  return left;
 }
 
-db::ValueType
-BlockReader::GetValueTypeFromDataEntry(uint64_t data_entry_offset) const {
-  assert(data_entry_offset < buffer_.size());
-
-  Byte value_type_byte = buffer_[data_entry_offset];
-  db::ValueType value_type =
-      *reinterpret_cast<const db::ValueType *>(&value_type_byte);
+db::GetStatus BlockReader::GetStatusFromEntry(int64_t index,
+                                              std::string_view key) const {
+  db::GetStatus status;
 
-  return value_type;
-}
+  if (index == static_cast<int64_t>(total_data_entries_)) {
+    return status;
+  }
 
-std::string_view
-BlockReader::GetKeyFromDataEntry(uint64_t data_entry_offset) const {
-  const uint32_t key_len = *reinterpret_cast<const uint32_t *>(
-      &buffer_[data_entry_offset + sizeof(uint8_t)]);
+  DataEntry data_entry = ParseDataEntry(GetDataEntryOffset(index));
+  if (data_entry.key != key) {
+    return status;
+  }
 
-  uint64_t start_offset_key =
-      data_entry_offset + sizeof(uint8_t) + sizeof(uint32_t);
+  assert(data_entry.type == db::ValueType::PUT ||
+         data_entry.type == db::ValueType::DELETED);
 
-  std::string_view key(
-      reinterpret_cast<const char *>(&buffer_[start_offset_key]), key_len);
+  status.type = data_entry.type;
+  if (status.type == db::ValueType::DELETED) {
+    // entry is deleted, value of entry is empty
+    status.value = std::nullopt;
+    return status;
+  }
 
-  return key;
+  status.value = data_entry.value;
+  return status;
 }
 
-std::string_view
-BlockReader::GetValueFromDataEntry(uint64_t data_entry_offset) const {
-  if (GetValueTypeFromDataEntry(data_entry_offset) == db::ValueType::DELETED) {
-    return std::string_view{};
-  }
+uint64_t BlockReader::GetDataEntryOffset(uint64_t index) const {
+  assert(index < total_data_entries_);
 
-  std::string_view key = GetKeyFromDataEntry(data_entry_offset);
+  // Starting offset of offset entry at index (th)
+  uint64_t offset_entry = offset_section_ + index * 2 * sizeof(uint64_t);
 
-  uint64_t start_offset_value_len =
-      data_entry_offset + sizeof(uint8_t) + sizeof(uint32_t) + key.size();
-  const uint32_t value_len =
-      *reinterpret_cast<const uint32_t *>(&buffer_[start_offset_value_len]);
+  return *reinterpret_cast<const uint64_t *>(&data_[offset_entry]);
+}
 
-  uint64_t start_offset_value = start_offset_value_len + sizeof(uint32_t);
-  std::string_view value(
-      reinterpret_cast<const char *>(&buffer_[start_offset_value]), value_len);
+DataEntry BlockReader::ParseDataEntry(uint64_t data_entry_offset) const {
+  assert(data_entry_offset < data_.size());
+
+  DataEntry data_entry;
+
+  uint64_t current_offset = data_entry_offset;
+  data_entry.type =
+      *reinterpret_cast<const db::ValueType *>(&data_[current_offset]);
+  current_offset += sizeof(uint8_t);
+
+  const uint32_t key_len =
+      *reinterpret_cast<const uint32_t *>(&data_[current_offset]);
+  current_offset += sizeof(uint32_t);
+  data_entry.key = std::string_view(
+      reinterpret_cast<const char *>(&data_[current_offset]), key_len);
+  current_offset += key_len;
+
+  // DELETED entry doesn't have value_len field. PUT entry always has it, even
+  // if value is empty
+  if (data_entry.type != db::ValueType::DELETED) {
+    const uint32_t value_len =
+        *reinterpret_cast<const uint32_t *>(&data_[current_offset]);
+    current_offset += sizeof(uint32_t);
+    data_entry.value = std::string_view(
+        reinterpret_cast<const char *>(&data_[current_offset]), value_len);
+    current_offset += value_len;
+  }
+
+  data_entry.txn_id = *reinterpret_cast<const TxnId *>(&data_[current_offset]);
 
-  return value;
+  return data_entry;
 }
 
-TxnId BlockReader::GetTransactionIdFromDataEntry(
-    uint64_t data_entry_offset) const {
-  std::string_view key = GetKeyFromDataEntry(data_entry_offset);
-  std::string_view value = GetValueFromDataEntry(data_entry_offset);
+std::string_view
+BlockReader::GetKeyFromDataEntry(uint64_t data_entry_offset) const {
+  const uint32_t key_len = *reinterpret_cast<const uint32_t *>(
+      &data_[data_entry_offset + sizeof(uint8_t)]);
+
+  uint64_t start_offset_key =
+      data_entry_offset + sizeof(uint8_t) + sizeof(uint32_t);
 
-  uint64_t start_txnid_offset =
-      data_entry_offset + sizeof(uint8_t) + sizeof(uint32_t) + key.size() +
-      (value.empty() ? 0 : sizeof(uint32_t) + value.size());
+  std::string_view key(
+      reinterpret_cast<const char *>(&data_[start_offset_key]), key_len);
 
-  return *reinterpret_cast<const TxnId *>(&buffer_[start_txnid_offset]);
+  return key;
 }
 
 } // namespace sstable
@@ -27,6 +27,14 @@ struct BlockReaderData {
     buffer.resize(block_size);
   }
 
+  // Block is a view over file mapped into memory, no copy is made
+  BlockReaderData(std::shared_ptr<const Byte> file_mapping, uint64_t offset,
+                  uint64_t block_size)
+      : mapping(std::move(file_mapping)),
+        mapped_block(mapping.get() + offset, block_size) {
+    assert(mapping && block_size > 0);
+  }
+
   // Move constructor/assignment
   BlockReaderData(BlockReaderData &&) = default;
   BlockReaderData &operator=(BlockReaderData &&) = default;
@@ -37,11 +45,18 @@ struct BlockReaderData {
   // Starting offset of offset section
   uint64_t offset_section;
 
-  // Contain starting offset of each data entries
-  std::vector<uint64_t> data_entries_offset_info;
-
   // Buffer that data from block is written into
   std::vector<Byte> buffer;
+
+  // Keep mapping of file alive while block is in use. nullptr if block is
+  // copied into buffer
+  std::shared_ptr<const Byte> mapping;
+
+  std::span<const Byte> mapped_block;
+
+  std::span<const Byte> GetData() const {
+    return mapping ? mapped_block : std::span<const Byte>(buffer);
+  }
 };
 
 /*
@@ -88,35 +103,70 @@ Extra format
 --------------------------------------------------------------------------
 */
 
+// View over a data entry in block. All fields are decoded in a single pass
+struct DataEntry {
+  db::ValueType type;
+
+  std::string_view key;
+
+  // Empty if type is DELETED
+  std::string_view value;
+
+  TxnId txn_id;
+};
+
 class BlockReader {
 public:
   explicit BlockReader(std::unique_ptr<BlockReaderData> block_reader_data);
   ~BlockReader() = default;
 
   // No copy allowed
-  BlockReader(const BlockReader &) = default;
-  BlockReader &operator=(BlockReader &) = default;
+  BlockReader(const BlockReader &) = delete;
+  BlockReader &operator=(BlockReader &) = delete;
 
   // No move allowed
   BlockReader(BlockReader &&other) = delete;
   BlockReader &operator=(BlockReader &&other) = delete;
 
-  db::GetStatus GetValue(std::string_view key, TxnId txn_id) const;
+  // Return newest version of key whose txn_id <= given txn_id. Entries in a
+  // block are sorted by (key asc, txn_id desc). If type is PUT, value is set
+  // to a view over block's data, which is valid as long as this BlockReader
+  db::ValueType GetValue(std::string_view key, TxnId txn_id,
+                         std::string_view *value) const;
+
+  // keys MUST be sorted in ascending order. Each search starts from entry
+  // found by search of previous key. Only keys whose status is still NOT_FOUND
+  // are looked up
+  void MultiGetValue(std::span<const std::string_view> keys, TxnId txn_id,
+                     std::span<db::GetStatus> statuses) const;
+
+  // Memory held by this block reader. A memory mapped block only holds a view
+  // over page cache
+  size_t GetCharge() const;
+
+  // Data of block, as it is stored in table
+  std::span<const Byte> GetData() const;
 
   friend class BlockReaderIterator;
 
 private:
-  // Get type of key base on data_entry_offset(starting offset of data entry)
-  // See block data format above
-  db::ValueType GetValueTypeFromDataEntry(uint64_t data_entry_offset) const;
+  // Return index of first entry at or after index "left" that is not less
+  // than (key, txn_id)
+  int64_t FindEntry(std::string_view key, TxnId txn_id, int64_t left) const;
 
-  // Get key of data entry that start at data_entry_offset
-  std::string_view GetKeyFromDataEntry(uint64_t data_entry_offset) const;
+  // Build status from entry at index, if that entry belongs to key
+  db::GetStatus GetStatusFromEntry(int64_t index, std::string_view key) const;
 
-  // Get value of data entry that start at data_entry_offset
-  std::string_view GetValueFromDataEntry(uint64_t data_entry_offset) const;
+  // Get starting offset of data entry at index by reading offset entry
+  // directly from block's data. See block data format above
+  uint64_t GetDataEntryOffset(uint64_t index) const;
 
-  TxnId GetTransactionIdFromDataEntry(uint64_t data_entry_offset) const;
+  // Decode type, key, value and txn_id of data entry that start at
+  // data_entry_offset
+  DataEntry ParseDataEntry(uint64_t data_entry_offset) const;
+
+  // Get key of data entry that start at data_entry_offset
+  std::string_view GetKeyFromDataEntry(uint64_t data_entry_offset) const;
 
   // Total data entries in a block
   const uint64_t total_data_entries_;
@@ -124,11 +174,14 @@ private:
   // Starting offset of offset section
   const uint64_t offset_section_;
 
-  // Contain starting offset of each data entries
-  const std::vector<uint64_t> data_entries_offset_info_;
-
-  // Buffer containing block's data
+  // Buffer containing block's data. Empty if block is memory mapped
   const std::vector<Byte> buffer_;
+
+  // Keep memory mapped file alive. nullptr if block is copied into buffer_
+  const std::shared_ptr<const Byte> mapping_;
+
+  // Block's data, either buffer_ or a view over memory mapped file
+  const std::span<const Byte> data_;
 };
 
 } // namespace sstable
@@ -1,177 +1,288 @@
 #include "sstable/block_reader_cache.h"
 
-#include "common/thread_pool.h"
 #include "sstable/block_reader.h"
 #include "sstable/lru_block_item.h"
-#include "sstable/lru_table_item.h"
+#include "sstable/lru_index_item.h"
+#include "sstable/secondary_block_cache.h"
 #include "sstable/table_reader.h"
-#include "sstable/table_reader_cache.h"
+
+namespace {
+
+// Mix bits of table id and block offset, so that blocks of the same table
+// (whose offsets only differ in a few bits) are spread over all shards and
+// slots
+uint64_t HashBlockInfo(std::pair<kvs::SSTId, kvs::BlockOffset> block_info) {
+  uint64_t hash = block_info.first * 0x9E3779B97F4A7C15ULL ^ block_info.second;
+  hash ^= hash >> 33;
+  hash *= 0xFF51AFD7ED558CCDULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+} // namespace
 
 namespace kvs {
 
 namespace sstable {
 
-BlockReaderCache::BlockReaderCache(int capacity,
-                                   const kvs::ThreadPool *const thread_pool)
-    : capacity_(capacity), thread_pool_(thread_pool), shutdown_(false) {
-  thread_pool_->Enqueue(&BlockReaderCache::ExecuteBgThread, this);
-}
-
-BlockReaderCache::~BlockReaderCache() {
-  shutdown_.store(true);
+BlockReaderCache::BlockReaderCache(
+    size_t capacity, int total_shards, size_t estimated_block_size,
+    double high_priority_ratio,
+    std::unique_ptr<SecondaryBlockCache> secondary_cache)
+    : capacity_(capacity), secondary_cache_(std::move(secondary_cache)) {
+  assert(total_shards > 0 && estimated_block_size > 0);
+  assert(0 <= high_priority_ratio && high_priority_ratio < 1);
+  const size_t index_shard_capacity =
+      static_cast<size_t>(capacity * high_priority_ratio) / total_shards;
+  const size_t shard_capacity =
+      capacity / total_shards - index_shard_capacity;
+
+  Shard::EvictCallback evict_callback = nullptr;
+  if (secondary_cache_) {
+    evict_callback = [this](const std::pair<SSTId, BlockOffset> &block_info,
+                            std::shared_ptr<LRUBlockItem> lru_block_item) {
+      secondary_cache_->Insert(block_info, std::move(lru_block_item));
+    };
+  }
 
-  bg_cv_.notify_one();
+  shards_.reserve(total_shards);
+  index_shards_.reserve(total_shards);
+  for (int i = 0; i < total_shards; i++) {
+    shards_.emplace_back(std::make_unique<Shard>(
+        shard_capacity, shard_capacity / estimated_block_size,
+        true /*admission*/, evict_callback));
+    // Indexes are few and expensive to rebuild, so they are always admitted
+    index_shards_.emplace_back(std::make_unique<IndexShard>(
+        index_shard_capacity, index_shard_capacity / estimated_block_size,
+        false /*admission*/));
+  }
 }
 
+BlockReaderCache::~BlockReaderCache() = default;
+
 std::shared_ptr<LRUBlockItem> BlockReaderCache::GetLRUBlockItem(
     std::pair<SSTId, BlockOffset> block_info) const {
-  std::shared_lock rlock(mutex_);
-  auto iterator = block_reader_cache_.find(block_info);
-  if (iterator == block_reader_cache_.end()) {
-    return nullptr;
-  }
+  return GetShard(block_info)->Lookup(block_info);
+}
 
-  // Increase ref count
-  iterator->second->IncRef();
+bool BlockReaderCache::Contains(
+    std::pair<SSTId, BlockOffset> block_info) const {
+  return GetShard(block_info)->Contains(block_info);
+}
 
-  return iterator->second;
+void BlockReaderCache::AddNewBlockReader(
+    std::pair<SSTId, BlockOffset> block_info,
+    std::unique_ptr<BlockReader> block_reader) const {
+  AddNewBlockReaderThenGet(
+      block_info,
+      std::make_shared<LRUBlockItem>(block_info, std::move(block_reader)),
+      false /*add_then_get*/);
 }
 
-// NOT THREAD_SAFE
 std::shared_ptr<LRUBlockItem> BlockReaderCache::AddNewBlockReaderThenGet(
     std::pair<SSTId, BlockOffset> block_info,
     std::shared_ptr<LRUBlockItem> lru_block_item, bool add_then_get) const {
-  // Insert new block reader into cache
-  std::scoped_lock rwlock(mutex_);
-
-  if (block_reader_cache_.size() >= capacity_) {
-    if (!Evict()) {
-      return nullptr;
+  assert(lru_block_item);
+  const size_t charge = lru_block_item->GetCharge();
+
+  // Block MAYBE inserted already, then the cached one is returned
+  std::shared_ptr<LRUBlockItem> inserted_item =
+      GetShard(block_info)->Insert(block_info, lru_block_item, charge);
+  if (!inserted_item) {
+    // No block can be evicted, use block without caching it
+    if (add_then_get) {
+      lru_block_item->IncRef();
     }
+    return lru_block_item;
   }
 
-  bool success =
-      block_reader_cache_.insert({block_info, std::move(lru_block_item)})
-          .second;
+  if (!add_then_get) {
+    inserted_item->Unref();
+  }
 
-  // Get block reader that MAYBE inserted
-  auto iterator = block_reader_cache_.find(block_info);
+  return inserted_item;
+}
 
-  if (add_then_get) {
-    // Increase ref count if need to get
-    iterator->second->IncRef();
+db::ValueType
+BlockReaderCache::GetValue(std::string_view key, TxnId txn_id,
+                           std::pair<SSTId, BlockOffset> block_info,
+                           uint64_t block_size,
+                           const TableReader *const table_reader,
+                           db::PinnableValue *value, bool fill_cache) const {
+  assert(table_reader && value);
+  db::ValueType type;
+  std::string_view found_value;
+
+  std::shared_ptr<LRUBlockItem> lru_block_item = GetLRUBlockItem(block_info);
+  if (!lru_block_item) {
+    // Create new blockreader and add it into cache
+    std::unique_ptr<BlockReader> new_block_reader =
+        ReadBlock(block_info, block_size, table_reader);
+    if (!new_block_reader) {
+      return db::ValueType::kTooManyOpenFiles;
+    }
+
+    lru_block_item =
+        std::make_shared<LRUBlockItem>(block_info, std::move(new_block_reader));
+    if (fill_cache) {
+      lru_block_item = AddNewBlockReaderThenGet(
+          block_info, std::move(lru_block_item), true /*add_then_get*/);
+    } else {
+      // Block isn't cached, but it is released the same way as cached ones
+      lru_block_item->IncRef();
+    }
   }
 
-  if (iterator->second->GetRefCount() < 1) {
-    // This BlockReader should be put in free_list_
-    free_list_.push_back(block_info);
+  type = lru_block_item->GetBlockReader()->GetValue(key, txn_id, &found_value);
+  if (type == db::ValueType::PUT) {
+    // Value keeps block alive, even if block is evicted from cache
+    value->PinSlice(found_value, lru_block_item);
   }
 
-  return iterator->second;
+  lru_block_item->Unref();
+  return type;
 }
 
-// NOT THREAD-SAFE
-bool BlockReaderCache::Evict() const {
-  if (free_list_.empty() || block_reader_cache_.empty()) {
-    return false;
-  }
+void BlockReaderCache::MultiGetValue(
+    std::span<const std::string_view> keys, TxnId txn_id,
+    std::pair<SSTId, BlockOffset> block_info, uint64_t block_size,
+    const TableReader *const table_reader, std::span<db::GetStatus> statuses,
+    bool fill_cache) const {
+  assert(table_reader);
 
-  std::pair<SSTId, BlockOffset> block_info = free_list_.front();
-  assert(!free_list_.empty());
-  free_list_.pop_front();
-  auto iterator = block_reader_cache_.find(block_info);
+  std::shared_ptr<LRUBlockItem> lru_block_item = GetLRUBlockItem(block_info);
+  if (!lru_block_item) {
+    // Create new blockreader and add it into cache
+    std::unique_ptr<BlockReader> new_block_reader =
+        ReadBlock(block_info, block_size, table_reader);
+    if (!new_block_reader) {
+      for (auto &status : statuses) {
+        if (status.type == db::ValueType::NOT_FOUND) {
+          status.type = db::ValueType::kTooManyOpenFiles;
+        }
+      }
+      return;
+    }
 
-  while (iterator != block_reader_cache_.end() &&
-         iterator->second->GetRefCount() >= 1 && !free_list_.empty()) {
-    block_info = free_list_.front();
-    iterator = block_reader_cache_.find(block_info);
-    free_list_.pop_front();
+    lru_block_item =
+        std::make_shared<LRUBlockItem>(block_info, std::move(new_block_reader));
+    if (fill_cache) {
+      lru_block_item = AddNewBlockReaderThenGet(
+          block_info, std::move(lru_block_item), true /*add_then_get*/);
+    } else {
+      // Block isn't cached, but it is released the same way as cached ones
+      lru_block_item->IncRef();
+    }
   }
 
-  // Erase from cache
-  auto deleted = block_reader_cache_.erase(block_info);
-  return (deleted == 0) ? Evict() : true;
+  lru_block_item->GetBlockReader()->MultiGetValue(keys, txn_id, statuses);
+  lru_block_item->Unref();
 }
 
-void BlockReaderCache::AddVictim(
-    std::pair<SSTId, BlockOffset> block_info) const {
-  std::scoped_lock rwlock(mutex_);
-  free_list_.push_back(block_info);
-}
-
-void BlockReaderCache::ExecuteBgThread() const {
-  while (!shutdown_) {
-    {
-      std::unique_lock rwlock_bg(bg_mutex_);
-      bg_cv_.wait(rwlock_bg, [this]() {
-        return this->shutdown_ || !this->item_cache_queue_.empty() ||
-               !this->victim_queue_.empty();
-      });
-
-      if (this->shutdown_ && this->item_cache_queue_.empty() &&
-          this->victim_queue_.empty()) {
-        return;
-      }
-
-      while (!victim_queue_.empty()) {
-        std::shared_ptr<LRUBlockItem> item = victim_queue_.front();
-        victim_queue_.pop();
+std::unique_ptr<BlockReader> BlockReaderCache::GetFromSecondaryCache(
+    std::pair<SSTId, BlockOffset> block_info, uint64_t block_size) const {
+  if (!secondary_cache_) {
+    return nullptr;
+  }
 
-        item->Unref();
-      }
+  return secondary_cache_->Lookup(block_info, block_size);
+}
 
-      while (!item_cache_queue_.empty()) {
-        ItemCache item = item_cache_queue_.front();
-        item_cache_queue_.pop();
+std::shared_ptr<LRUIndexItem>
+BlockReaderCache::GetLRUIndexItem(SSTId table_id) const {
+  return GetIndexShard(table_id)->Lookup(table_id);
+}
 
-        AddNewBlockReaderThenGet(item.info, item.item, item.add_then_get);
-      }
-    }
+std::shared_ptr<LRUIndexItem> BlockReaderCache::AddNewIndexThenGet(
+    SSTId table_id, std::shared_ptr<LRUIndexItem> lru_index_item) const {
+  assert(lru_index_item);
+  const size_t charge = lru_index_item->GetCharge();
+
+  std::shared_ptr<LRUIndexItem> inserted_item =
+      GetIndexShard(table_id)->Insert(table_id, lru_index_item, charge);
+  if (!inserted_item) {
+    // No index can be evicted, use index without caching it
+    lru_index_item->IncRef();
+    return lru_index_item;
   }
+
+  return inserted_item;
 }
 
-db::GetStatus
-BlockReaderCache::GetValue(std::string_view key, TxnId txn_id,
-                           std::pair<SSTId, BlockOffset> block_info,
-                           uint64_t block_size,
-                           const TableReader *const table_reader) const {
-  assert(table_reader);
-  db::GetStatus status;
+std::vector<
+    std::pair<std::pair<SSTId, BlockOffset>, std::shared_ptr<LRUBlockItem>>>
+BlockReaderCache::GetResidentBlocks() const {
+  std::vector<
+      std::pair<std::pair<SSTId, BlockOffset>, std::shared_ptr<LRUBlockItem>>>
+      blocks;
+  for (const auto &shard : shards_) {
+    shard->ForEach([&blocks](const std::pair<SSTId, BlockOffset> &block_info,
+                             const std::shared_ptr<LRUBlockItem> &item) {
+      blocks.emplace_back(block_info, item);
+    });
+  }
 
-  std::shared_ptr<LRUBlockItem> lru_block_item = GetLRUBlockItem(block_info);
-  if (lru_block_item && lru_block_item->GetBlockReader()) {
-    // tablereader had already been in cache
-    status = lru_block_item->GetBlockReader()->GetValue(key, txn_id);
-    {
-      std::scoped_lock rwlock_bg(bg_mutex_);
-      victim_queue_.push(lru_block_item);
-      bg_cv_.notify_one();
-    }
+  return blocks;
+}
+
+size_t BlockReaderCache::GetCapacity() const { return capacity_; }
 
-    return status;
+size_t BlockReaderCache::GetUsage() const {
+  size_t usage = GetHighPriorityUsage();
+  for (const auto &shard : shards_) {
+    usage += shard->GetUsage();
   }
 
-  // Create new tablereader
-  std::unique_ptr<BlockReader> new_block_reader =
-      table_reader->CreateAndSetupDataForBlockReader(block_info.second,
-                                                     block_size);
-  if (!new_block_reader) {
-    status.type = db::ValueType::kTooManyOpenFiles;
-    return status;
+  return usage;
+}
+
+size_t BlockReaderCache::GetHighPriorityUsage() const {
+  size_t usage = 0;
+  for (const auto &index_shard : index_shards_) {
+    usage += index_shard->GetUsage();
   }
 
-  auto new_lru_block_item = std::make_shared<LRUBlockItem>(
-      block_info, std::move(new_block_reader), this);
-  status = new_lru_block_item->GetBlockReader()->GetValue(key, txn_id);
+  return usage;
+}
+
+const SecondaryBlockCache *BlockReaderCache::GetSecondaryCache() const {
+  return secondary_cache_.get();
+}
+
+uint64_t BlockReaderCache::BlockInfoHash::operator()(
+    std::pair<SSTId, BlockOffset> block_info) const {
+  return HashBlockInfo(block_info);
+}
+
+uint64_t BlockReaderCache::TableIdHash::operator()(SSTId table_id) const {
+  return HashBlockInfo({table_id, 0});
+}
+
+const BlockReaderCache::Shard *
+BlockReaderCache::GetShard(std::pair<SSTId, BlockOffset> block_info) const {
+  // Low bits of hash pick slot inside shard, so high bits pick shard
+  return shards_[(HashBlockInfo(block_info) >> 32) % shards_.size()].get();
+}
+
+const BlockReaderCache::IndexShard *
+BlockReaderCache::GetIndexShard(SSTId table_id) const {
+  return index_shards_[(HashBlockInfo({table_id, 0}) >> 32) %
+                       index_shards_.size()]
+      .get();
+}
 
-  {
-    std::scoped_lock rwlock_bg(bg_mutex_);
-    item_cache_queue_.push(
-        {block_info, new_lru_block_item, false /*need_to_get*/});
-    bg_cv_.notify_one();
+std::unique_ptr<BlockReader>
+BlockReaderCache::ReadBlock(std::pair<SSTId, BlockOffset> block_info,
+                            uint64_t block_size,
+                            const TableReader *const table_reader) const {
+  std::unique_ptr<BlockReader> block_reader =
+      GetFromSecondaryCache(block_info, block_size);
+  if (block_reader) {
+    return block_reader;
   }
 
-  return status;
+  return table_reader->CreateAndSetupDataForBlockReader(block_info.second,
+                                                        block_size);
 }
 
 } // namespace sstable
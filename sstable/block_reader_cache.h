@@ -2,41 +2,52 @@
 #define SSTABLE_BLOCK_READER_CACHE_H
 
 #include "common/macros.h"
+#include "db/pinnable_value.h"
 #include "db/status.h"
 #include "sstable/block_index.h"
+#include "sstable/clock_cache.h"
 
 // libC++
 #include <cassert>
-#include <condition_variable>
-#include <functional>
-#include <list>
-#include <map>
 #include <memory>
-#include <mutex>
-#include <queue>
-#include <shared_mutex>
+#include <span>
 #include <string_view>
-#include <thread>
-#include <unordered_map>
 #include <utility>
+#include <vector>
 
 namespace kvs {
 
-class ThreadPool;
-
 namespace sstable {
 
 class BlockReader;
 class LRUBlockItem;
-class LRUTableItem;
-class TableReaderCache;
+class LRUIndexItem;
+class SecondaryBlockCache;
 class TableReader;
 
+// Block cache shared by all tables. Capacity(in bytes) is split evenly among
+// shards, each block is charged for memory it holds(see
+// BlockReader::GetCharge()). A block always belongs to the same shard, chosen
+// by its identity (table id, block offset), so it is cached once and found
+// with a single lookup.
+// Each shard is a ClockCache with TinyLFU admission, insertion and eviction are
+// done by the thread that reads block, no background thread is involved. Once
+// a shard is full, blocks that are read once(e.g. by a scan) aren't admitted
+// in place of blocks that are read often.
+// Indexes of tables are kept in a high priority pool, that takes
+// high_priority_ratio of capacity. Data blocks can't evict them, and they are
+// always admitted.
+// If secondary cache is given, data blocks evicted from memory are written into
+// it, and blocks missing from memory are looked up in it before being read
+// from table.
 class BlockReaderCache {
 public:
-  BlockReaderCache(int capacity, const kvs::ThreadPool *const thread_pool);
+  // estimated_block_size is used to size hash tables of shards
+  BlockReaderCache(
+      size_t capacity, int total_shards, size_t estimated_block_size,
+      double high_priority_ratio,
+      std::unique_ptr<SecondaryBlockCache> secondary_cache = nullptr);
 
-  // ~BlockReaderCache() = default;
   ~BlockReaderCache();
 
   // No copy allowed
@@ -47,77 +58,110 @@ public:
   BlockReaderCache(BlockReaderCache &&) = delete;
   BlockReaderCache &operator=(BlockReaderCache &&) = delete;
 
+  // Return block with its ref count increased, caller MUST call Unref() once
+  // finished with it. nullptr if block isn't in cache
   std::shared_ptr<LRUBlockItem>
   GetLRUBlockItem(std::pair<SSTId, BlockOffset> lock_info) const;
 
+  // Check whether block is in cache, without taking a reference to it
+  bool Contains(std::pair<SSTId, BlockOffset> block_info) const;
+
+  // Add block that has been loaded by caller into cache
+  void AddNewBlockReader(std::pair<SSTId, BlockOffset> block_info,
+                         std::unique_ptr<BlockReader> block_reader) const;
+
+  // Return block that is in cache after insertion(which may have been added
+  // by another thread), with its ref count increased if add_then_get is set.
+  // If cache is full of blocks in use, lru_block_item is returned without
+  // being cached
   std::shared_ptr<LRUBlockItem>
   AddNewBlockReaderThenGet(std::pair<SSTId, BlockOffset> block_info,
-                           std::shared_ptr<LRUBlockItem> block_reader,
+                           std::shared_ptr<LRUBlockItem> lru_block_item,
                            bool add_then_get) const;
 
-  db::GetStatus GetValue(std::string_view key, TxnId txn_id,
+  // If type is PUT, value references data of block, which stays alive until
+  // value is released, even if block is evicted in the meantime. If block
+  // isn't in cache, it is read from disk, then added into cache only if
+  // fill_cache is set
+  db::ValueType GetValue(std::string_view key, TxnId txn_id,
                          std::pair<SSTId, BlockOffset> block_info,
                          uint64_t block_size,
-                         const TableReader *const table_reader) const;
-
-  void AddVictim(std::pair<SSTId, BlockOffset> block_info) const;
+                         const TableReader *const table_reader,
+                         db::PinnableValue *value, bool fill_cache) const;
+
+  // Fetch block once and look up all keys in it. keys MUST be sorted in
+  // ascending order
+  void MultiGetValue(std::span<const std::string_view> keys, TxnId txn_id,
+                     std::pair<SSTId, BlockOffset> block_info,
+                     uint64_t block_size, const TableReader *const table_reader,
+                     std::span<db::GetStatus> statuses, bool fill_cache) const;
+
+  // Read block from secondary cache, without adding it into memory. nullptr if
+  // secondary cache is disabled or block isn't in it
+  std::unique_ptr<BlockReader>
+  GetFromSecondaryCache(std::pair<SSTId, BlockOffset> block_info,
+                        uint64_t block_size) const;
+
+  // Return index of table with its ref count increased, caller MUST call
+  // Unref() once finished with it. nullptr if index isn't in cache
+  std::shared_ptr<LRUIndexItem> GetLRUIndexItem(SSTId table_id) const;
+
+  // Add index of table into high priority pool, then return index that is in
+  // cache with its ref count increased. If pool is full of indexes in use,
+  // lru_index_item is returned without being cached
+  std::shared_ptr<LRUIndexItem>
+  AddNewIndexThenGet(SSTId table_id,
+                     std::shared_ptr<LRUIndexItem> lru_index_item) const;
+
+  // Data blocks that are in cache at the moment. Returned items aren't
+  // referenced, they may be evicted meanwhile but stay alive
+  std::vector<std::pair<std::pair<SSTId, BlockOffset>,
+                        std::shared_ptr<LRUBlockItem>>>
+  GetResidentBlocks() const;
+
+  size_t GetCapacity() const;
+
+  // Total charge of blocks and indexes in all shards
+  size_t GetUsage() const;
+
+  // Total charge of indexes
+  size_t GetHighPriorityUsage() const;
+
+  // nullptr if secondary cache is disabled
+  const SecondaryBlockCache *GetSecondaryCache() const;
 
 private:
-  // NOT THREAD-SAFE
-  bool Evict() const;
-
-  // Background thread that
-  // add LRUBlockItem into cache
-  // or add LRUBlockItem into victim list
-  void ExecuteBgThread() const;
-
-  // Custom hash for pair<int, int>
-  struct pair_hash {
-    size_t operator()(const std::pair<SSTId, BlockOffset> &p) const noexcept {
-      // Combine the hashes of both sst id and block offset
-      return std::hash<uint64_t>()(p.first) ^
-             (std::hash<uint64_t>()(p.second) << 1);
-    }
+  struct BlockInfoHash {
+    uint64_t operator()(std::pair<SSTId, BlockOffset> block_info) const;
   };
 
-  struct pair_equal {
-    bool operator()(const std::pair<SSTId, BlockOffset> &a,
-                    const std::pair<SSTId, BlockOffset> &b) const noexcept {
-      return a.first == b.first && a.second == b.second;
-    }
+  struct TableIdHash {
+    uint64_t operator()(SSTId table_id) const;
   };
 
-  mutable std::unordered_map<std::pair<SSTId, BlockOffset>,
-                             std::shared_ptr<LRUBlockItem>, pair_hash,
-                             pair_equal>
-      block_reader_cache_;
-
-  const int capacity_;
+  using Shard =
+      ClockCache<std::pair<SSTId, BlockOffset>, LRUBlockItem, BlockInfoHash>;
 
-  mutable std::list<std::pair<SSTId, BlockOffset>> free_list_;
-
-  struct ItemCache {
-    std::pair<SSTId, BlockOffset> info;
-
-    std::shared_ptr<LRUBlockItem> item;
-
-    bool add_then_get;
-  };
+  using IndexShard = ClockCache<SSTId, LRUIndexItem, TableIdHash>;
 
-  mutable std::shared_mutex mutex_;
+  const Shard *GetShard(std::pair<SSTId, BlockOffset> block_info) const;
 
-  mutable std::queue<std::shared_ptr<LRUBlockItem>> victim_queue_;
+  const IndexShard *GetIndexShard(SSTId table_id) const;
 
-  mutable std::queue<ItemCache> item_cache_queue_;
+  // Look up block in secondary cache, then in table
+  std::unique_ptr<BlockReader>
+  ReadBlock(std::pair<SSTId, BlockOffset> block_info, uint64_t block_size,
+            const TableReader *const table_reader) const;
 
-  mutable std::mutex bg_mutex_;
+  const size_t capacity_;
 
-  mutable std::condition_variable bg_cv_;
+  // Declared before shards, so that it outlives their eviction callback
+  std::unique_ptr<SecondaryBlockCache> secondary_cache_;
 
-  std::atomic<bool> shutdown_;
+  std::vector<std::unique_ptr<Shard>> shards_;
 
-  // kvs::ThreadPool *thread_pool_;
-  const kvs::ThreadPool *const thread_pool_;
+  // High priority pool
+  std::vector<std::unique_ptr<IndexShard>> index_shards_;
 };
 
 } // namespace sstable
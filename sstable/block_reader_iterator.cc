@@ -18,13 +18,11 @@ BlockReaderIterator::BlockReaderIterator(
 BlockReaderIterator::~BlockReaderIterator() { lru_block_item_->Unref(); }
 
 std::optional<uint64_t> BlockReaderIterator::GetCurrentDataEntryOffset() {
-  if (current_offset_index_ < 0 ||
-      current_offset_index_ >=
-          block_reader_->data_entries_offset_info_.size()) {
+  if (!IsValid()) {
     return std::nullopt;
   }
 
-  return block_reader_->data_entries_offset_info_[current_offset_index_];
+  return block_reader_->GetDataEntryOffset(current_offset_index_);
 }
 
 std::string_view BlockReaderIterator::GetKey() {
@@ -33,10 +31,7 @@ std::string_view BlockReaderIterator::GetKey() {
     return std::string_view{};
   }
 
-  std::string_view key =
-      block_reader_->GetKeyFromDataEntry(data_entry_offset.value());
-
-  return key;
+  return block_reader_->GetKeyFromDataEntry(data_entry_offset.value());
 }
 
 std::string_view BlockReaderIterator::GetValue() {
@@ -45,10 +40,7 @@ std::string_view BlockReaderIterator::GetValue() {
     return std::string_view{};
   }
 
-  std::string_view value =
-      block_reader_->GetValueFromDataEntry(data_entry_offset.value());
-
-  return value;
+  return block_reader_->ParseDataEntry(data_entry_offset.value()).value;
 }
 
 db::ValueType BlockReaderIterator::GetType() {
@@ -57,7 +49,7 @@ db::ValueType BlockReaderIterator::GetType() {
     return db::ValueType::NOT_FOUND;
   }
 
-  return block_reader_->GetValueTypeFromDataEntry(data_entry_offset.value());
+  return block_reader_->ParseDataEntry(data_entry_offset.value()).type;
 }
 
 TxnId BlockReaderIterator::GetTransactionId() {
@@ -66,14 +58,11 @@ TxnId BlockReaderIterator::GetTransactionId() {
     return INVALID_TXN_ID;
   }
 
-  return block_reader_->GetTransactionIdFromDataEntry(
-      data_entry_offset.value());
+  return block_reader_->ParseDataEntry(data_entry_offset.value()).txn_id;
 }
 
 bool BlockReaderIterator::IsValid() {
-  return 0 <= current_offset_index_ &&
-         current_offset_index_ <
-             block_reader_->data_entries_offset_info_.size();
+  return current_offset_index_ < block_reader_->total_data_entries_;
 }
 
 void BlockReaderIterator::Next() { current_offset_index_++; }
@@ -90,9 +79,8 @@ void BlockReaderIterator::Seek(std::string_view key) {
 
   while (left < right) {
     int64_t mid = left + (right - left) / 2;
-    uint64_t data_entry_offset = block_reader_->data_entries_offset_info_[mid];
-    std::string_view key_found =
-        block_reader_->GetKeyFromDataEntry(data_entry_offset);
+    std::string_view key_found = block_reader_->GetKeyFromDataEntry(
+        block_reader_->GetDataEntryOffset(mid));
 
     if (key_found == key) {
       current_offset_index_ = mid;
@@ -115,7 +103,7 @@ void BlockReaderIterator::Seek(std::string_view key) {
 void BlockReaderIterator::SeekToFirst() { current_offset_index_ = 0; }
 
 void BlockReaderIterator::SeekToLast() {
-  current_offset_index_ = block_reader_->data_entries_offset_info_.size() - 1;
+  current_offset_index_ = block_reader_->total_data_entries_ - 1;
 }
 
 } // namespace sstable
@@ -0,0 +1,459 @@
+#ifndef SSTABLE_CLOCK_CACHE_H
+#define SSTABLE_CLOCK_CACHE_H
+
+#include "sstable/frequency_sketch.h"
+
+// libC++
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <functional>
+#include <memory>
+
+namespace kvs {
+
+namespace sstable {
+
+/*
+Lock-free cache with CLOCK eviction, built on a fixed-size open-addressed hash
+table. A hit only costs a few atomic operations on the slot that holds the
+item. Insertion and eviction are done inline by the calling thread.
+
+Slot's meta word(unit: bit)
+--------------------------------------------------------------
+| state (2) | clock countdown (2) |          readers (60)        |
+--------------------------------------------------------------
+state: kEmpty -> kConstruction -> kVisible -> kConstruction -> kEmpty
+Only the thread that moved a slot into kConstruction may touch its key/item.
+
+readers counts threads that are copying item out of slot. It is only held for
+a few instructions, and a slot can't be evicted while it is not zero. Whether
+item is in use after that is tracked by item itself(Item::GetRefCount()),
+items in use are never evicted.
+
+Each hit resets countdown to its max. Clock hand decreases it each time it
+passes over slot, and evicts items whose countdown reached 0.
+
+Each slot also counts entries whose probe sequence goes through it without
+ending there(displacements). A lookup stops at the first slot whose
+displacements is 0.
+
+With admission enabled(TinyLFU), accesses of keys are counted by a
+FrequencySketch. Once cache is full, a new item only replaces the victim chosen
+by clock hand if it has been accessed more often than victim, otherwise it
+isn't inserted. So that a scan of items that are read once can't flush items
+that are read again and again.
+
+Concurrent insertions of the same key may both succeed. Duplicates are
+harmless, lookups find one of them and the other one is evicted eventually.
+
+Item must provide IncRef() and GetRefCount(). Items returned by Lookup() and
+Insert() have their ref count increased, caller MUST release them by Unref().
+
+If given, evict_callback is called with each evicted item, by the thread that
+evicts it, once item is no longer reachable from cache.
+*/
+template <typename Key, typename Item, typename Hash> class ClockCache {
+public:
+  using EvictCallback =
+      std::function<void(const Key &key, std::shared_ptr<Item> item)>;
+
+  // capacity is in the same unit as charge given to Insert().
+  // estimated_entries decides size of hash table, which never grows
+  ClockCache(size_t capacity, size_t estimated_entries, bool admission,
+             EvictCallback evict_callback = nullptr);
+
+  ~ClockCache() = default;
+
+  // No copy allowed
+  ClockCache(const ClockCache &) = delete;
+  ClockCache &operator=(ClockCache &) = delete;
+
+  // No move allowed
+  ClockCache(ClockCache &&) = delete;
+  ClockCache &operator=(ClockCache &&) = delete;
+
+  // Return nullptr if key isn't in cache. Access is counted, whether key is
+  // found or not
+  std::shared_ptr<Item> Lookup(const Key &key) const;
+
+  // Check whether key is in cache, without taking a reference to item. Access
+  // isn't counted, it is only a probe before a real lookup
+  bool Contains(const Key &key) const;
+
+  // Return item that is in cache after insertion, which is the existing one if
+  // key had already been in cache. Return nullptr if item can't be inserted,
+  // because it is larger than capacity, every other item is in use or item
+  // isn't admitted
+  std::shared_ptr<Item> Insert(const Key &key, std::shared_ptr<Item> item,
+                               size_t charge) const;
+
+  // Remove all items whose key matches predicate, by walking the whole table.
+  // Items in use are skipped, they are evicted later like any other item.
+  // Eviction callback isn't called for removed items
+  void EraseIf(const std::function<bool(const Key &key)> &predicate) const;
+
+  // Call callback with each item in cache, by walking the whole table. Items
+  // aren't counted as accessed. Items inserted or evicted during the walk may
+  // be missed
+  void ForEach(const std::function<void(const Key &key,
+                                        const std::shared_ptr<Item> &item)>
+                   &callback) const;
+
+  size_t GetCapacity() const;
+
+  // Total charge of items in cache
+  size_t GetUsage() const;
+
+private:
+  static constexpr uint64_t kStateShift = 62;
+  static constexpr uint64_t kEmpty = 0;
+  static constexpr uint64_t kConstruction = uint64_t{1} << kStateShift;
+  static constexpr uint64_t kVisible = uint64_t{2} << kStateShift;
+  static constexpr uint64_t kStateMask = uint64_t{3} << kStateShift;
+
+  static constexpr uint64_t kCountdownShift = 60;
+  static constexpr uint64_t kOneCountdown = uint64_t{1} << kCountdownShift;
+  static constexpr uint64_t kCountdownMask = uint64_t{3} << kCountdownShift;
+
+  static constexpr uint64_t kOneReader = 1;
+  static constexpr uint64_t kReadersMask = kOneCountdown - 1;
+
+  struct Slot {
+    std::atomic<uint64_t> meta{kEmpty};
+
+    std::atomic<uint32_t> displacements{0};
+
+    Key key{};
+
+    std::shared_ptr<Item> item;
+
+    size_t charge{0};
+  };
+
+  // Return slot that holds key with its readers increased, nullptr if key
+  // isn't in cache
+  Slot *FindSlot(const Key &key, uint64_t hash) const;
+
+  // Index of i(th) slot in probe sequence of hash. Step is odd, so that
+  // sequence goes through every slot of table(size is power of 2)
+  uint64_t GetProbeIndex(uint64_t hash, uint64_t i) const;
+
+  // Run clock hand until an item is evicted to make room for item whose
+  // frequency is candidate_frequency. Return false if nothing can be evicted,
+  // or if victim is accessed more often than candidate
+  bool EvictOne(uint8_t candidate_frequency) const;
+
+  // Empty slot at index, which caller has moved into kConstruction. hash is
+  // hash of key in slot. Return key and item that slot held
+  std::pair<Key, std::shared_ptr<Item>> FreeSlot(uint64_t index,
+                                                 uint64_t hash) const;
+
+  const size_t capacity_;
+
+  const uint64_t table_size_;
+
+  // Max number of items, so that probe sequences stay short
+  const uint64_t max_occupancy_;
+
+  std::unique_ptr<Slot[]> slots_;
+
+  // nullptr if admission is disabled
+  std::unique_ptr<FrequencySketch> sketch_;
+
+  const EvictCallback evict_callback_;
+
+  mutable std::atomic<size_t> usage_;
+
+  mutable std::atomic<uint64_t> occupancy_;
+
+  mutable std::atomic<uint64_t> clock_hand_;
+};
+
+template <typename Key, typename Item, typename Hash>
+ClockCache<Key, Item, Hash>::ClockCache(size_t capacity,
+                                        size_t estimated_entries,
+                                        bool admission,
+                                        EvictCallback evict_callback)
+    : capacity_(capacity),
+      table_size_(std::bit_ceil(std::max<uint64_t>(
+          estimated_entries + estimated_entries / 2, 16))),
+      max_occupancy_(table_size_ - table_size_ / 8),
+      slots_(std::make_unique<Slot[]>(table_size_)),
+      sketch_(admission ? std::make_unique<FrequencySketch>(table_size_)
+                        : nullptr),
+      evict_callback_(std::move(evict_callback)), usage_(0), occupancy_(0),
+      clock_hand_(0) {}
+
+template <typename Key, typename Item, typename Hash>
+std::shared_ptr<Item> ClockCache<Key, Item, Hash>::Lookup(const Key &key) const {
+  const uint64_t hash = Hash{}(key);
+  if (sketch_) {
+    sketch_->Increment(hash);
+  }
+
+  Slot *slot = FindSlot(key, hash);
+  if (!slot) {
+    return nullptr;
+  }
+
+  std::shared_ptr<Item> item = slot->item;
+  item->IncRef();
+
+  slot->meta.fetch_sub(kOneReader, std::memory_order_release);
+  return item;
+}
+
+template <typename Key, typename Item, typename Hash>
+bool ClockCache<Key, Item, Hash>::Contains(const Key &key) const {
+  Slot *slot = FindSlot(key, Hash{}(key));
+  if (!slot) {
+    return false;
+  }
+
+  slot->meta.fetch_sub(kOneReader, std::memory_order_release);
+  return true;
+}
+
+template <typename Key, typename Item, typename Hash>
+std::shared_ptr<Item>
+ClockCache<Key, Item, Hash>::Insert(const Key &key, std::shared_ptr<Item> item,
+                                    size_t charge) const {
+  assert(item);
+
+  if (charge > capacity_) {
+    // Never fits, so nothing is evicted for it
+    return nullptr;
+  }
+
+  const uint64_t hash = Hash{}(key);
+  Slot *existing_slot = FindSlot(key, hash);
+  if (existing_slot) {
+    std::shared_ptr<Item> existing_item = existing_slot->item;
+    existing_item->IncRef();
+    existing_slot->meta.fetch_sub(kOneReader, std::memory_order_release);
+    return existing_item;
+  }
+
+  // Make room for new item. Concurrent insertions may exceed capacity a bit
+  const uint8_t frequency = sketch_ ? sketch_->Estimate(hash) : 0;
+  while (usage_.load(std::memory_order_relaxed) + charge > capacity_ ||
+         occupancy_.load(std::memory_order_relaxed) >= max_occupancy_) {
+    if (!EvictOne(frequency)) {
+      return nullptr;
+    }
+  }
+  usage_.fetch_add(charge, std::memory_order_relaxed);
+  occupancy_.fetch_add(1, std::memory_order_relaxed);
+
+  for (uint64_t i = 0; i < table_size_; i++) {
+    Slot &slot = slots_[GetProbeIndex(hash, i)];
+
+    uint64_t meta = kEmpty;
+    if (!slot.meta.compare_exchange_strong(meta, kConstruction,
+                                           std::memory_order_acquire)) {
+      // Entry goes through this slot
+      slot.displacements.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+
+    slot.key = key;
+    slot.item = item;
+    slot.charge = charge;
+    item->IncRef();
+
+    // Publish. Readers that are checking slot in the meantime are kept
+    slot.meta.fetch_add(kVisible - kConstruction + kCountdownMask,
+                        std::memory_order_release);
+    return item;
+  }
+
+  // No free slot, which can only happen if occupancy_ was exceeded by
+  // concurrent insertions. Undo everything
+  for (uint64_t i = 0; i < table_size_; i++) {
+    slots_[GetProbeIndex(hash, i)].displacements.fetch_sub(
+        1, std::memory_order_relaxed);
+  }
+  usage_.fetch_sub(charge, std::memory_order_relaxed);
+  occupancy_.fetch_sub(1, std::memory_order_relaxed);
+
+  return nullptr;
+}
+
+template <typename Key, typename Item, typename Hash>
+size_t ClockCache<Key, Item, Hash>::GetCapacity() const {
+  return capacity_;
+}
+
+template <typename Key, typename Item, typename Hash>
+size_t ClockCache<Key, Item, Hash>::GetUsage() const {
+  return usage_.load(std::memory_order_relaxed);
+}
+
+template <typename Key, typename Item, typename Hash>
+typename ClockCache<Key, Item, Hash>::Slot *
+ClockCache<Key, Item, Hash>::FindSlot(const Key &key, uint64_t hash) const {
+  for (uint64_t i = 0; i < table_size_; i++) {
+    Slot &slot = slots_[GetProbeIndex(hash, i)];
+
+    if ((slot.meta.load(std::memory_order_acquire) & kStateMask) == kVisible) {
+      // While readers isn't 0, slot can't be evicted
+      uint64_t meta =
+          slot.meta.fetch_add(kOneReader, std::memory_order_acq_rel);
+      if ((meta & kStateMask) == kVisible && slot.key == key) {
+        // Hit. Item gets more time before being evicted
+        slot.meta.fetch_or(kCountdownMask, std::memory_order_relaxed);
+        return &slot;
+      }
+
+      slot.meta.fetch_sub(kOneReader, std::memory_order_release);
+    }
+
+    if (slot.displacements.load(std::memory_order_acquire) == 0) {
+      // No entry goes further than this slot
+      return nullptr;
+    }
+  }
+
+  return nullptr;
+}
+
+template <typename Key, typename Item, typename Hash>
+uint64_t ClockCache<Key, Item, Hash>::GetProbeIndex(uint64_t hash,
+                                                    uint64_t i) const {
+  return (hash + i * ((hash >> 32) | 1)) & (table_size_ - 1);
+}
+
+template <typename Key, typename Item, typename Hash>
+bool ClockCache<Key, Item, Hash>::EvictOne(uint8_t candidate_frequency) const {
+  // Each slot is passed at most as many times as its max countdown before
+  // being evicted, unless it is in use
+  const uint64_t max_steps = 4 * table_size_;
+  for (uint64_t step = 0; step < max_steps; step++) {
+    const uint64_t index =
+        clock_hand_.fetch_add(1, std::memory_order_relaxed) & (table_size_ - 1);
+    Slot &slot = slots_[index];
+
+    uint64_t meta = slot.meta.load(std::memory_order_acquire);
+    if ((meta & kStateMask) != kVisible || (meta & kReadersMask) != 0) {
+      continue;
+    }
+
+    if ((meta & kCountdownMask) != 0) {
+      slot.meta.compare_exchange_strong(meta, meta - kOneCountdown,
+                                        std::memory_order_relaxed);
+      continue;
+    }
+
+    // Take slot exclusively. Fail if a reader comes in the meantime
+    if (!slot.meta.compare_exchange_strong(meta, kConstruction,
+                                           std::memory_order_acquire)) {
+      continue;
+    }
+
+    if (slot.item->GetRefCount() > 0) {
+      // In use, give it back with a full countdown
+      slot.meta.fetch_add(kVisible - kConstruction + kCountdownMask,
+                          std::memory_order_release);
+      continue;
+    }
+
+    const uint64_t hash = Hash{}(slot.key);
+    if (sketch_ && candidate_frequency <= sketch_->Estimate(hash)) {
+      // Victim is more valuable than candidate, keep it
+      slot.meta.fetch_add(kVisible - kConstruction, std::memory_order_release);
+      return false;
+    }
+
+    // Item is released after slot is freed
+    auto [key, item] = FreeSlot(index, hash);
+    if (evict_callback_) {
+      evict_callback_(key, std::move(item));
+    }
+
+    return true;
+  }
+
+  return false;
+}
+
+template <typename Key, typename Item, typename Hash>
+void ClockCache<Key, Item, Hash>::EraseIf(
+    const std::function<bool(const Key &key)> &predicate) const {
+  for (uint64_t index = 0; index < table_size_; index++) {
+    Slot &slot = slots_[index];
+
+    uint64_t meta = slot.meta.load(std::memory_order_acquire);
+    if ((meta & kStateMask) != kVisible || (meta & kReadersMask) != 0) {
+      continue;
+    }
+
+    // Take slot exclusively. Fail if a reader comes in the meantime
+    if (!slot.meta.compare_exchange_strong(meta, kConstruction,
+                                           std::memory_order_acquire)) {
+      continue;
+    }
+
+    if (!predicate(slot.key) || slot.item->GetRefCount() > 0) {
+      // Give it back as it was
+      slot.meta.fetch_add(kVisible - kConstruction + (meta & kCountdownMask),
+                          std::memory_order_release);
+      continue;
+    }
+
+    FreeSlot(index, Hash{}(slot.key));
+  }
+}
+
+template <typename Key, typename Item, typename Hash>
+void ClockCache<Key, Item, Hash>::ForEach(
+    const std::function<void(const Key &key,
+                             const std::shared_ptr<Item> &item)> &callback)
+    const {
+  for (uint64_t index = 0; index < table_size_; index++) {
+    Slot &slot = slots_[index];
+    if ((slot.meta.load(std::memory_order_acquire) & kStateMask) != kVisible) {
+      continue;
+    }
+
+    // While readers isn't 0, slot can't be evicted
+    uint64_t meta = slot.meta.fetch_add(kOneReader, std::memory_order_acq_rel);
+    if ((meta & kStateMask) == kVisible) {
+      callback(slot.key, slot.item);
+    }
+    slot.meta.fetch_sub(kOneReader, std::memory_order_release);
+  }
+}
+
+template <typename Key, typename Item, typename Hash>
+std::pair<Key, std::shared_ptr<Item>>
+ClockCache<Key, Item, Hash>::FreeSlot(uint64_t index, uint64_t hash) const {
+  Slot &slot = slots_[index];
+  std::shared_ptr<Item> item = std::move(slot.item);
+  Key key = std::move(slot.key);
+  const size_t charge = slot.charge;
+
+  // Entries before this slot in probe sequence of key don't have to be passed
+  // over anymore
+  for (uint64_t i = 0; i < table_size_; i++) {
+    const uint64_t probe_index = GetProbeIndex(hash, i);
+    if (probe_index == index) {
+      break;
+    }
+    slots_[probe_index].displacements.fetch_sub(1, std::memory_order_relaxed);
+  }
+  slot.key = Key{};
+
+  slot.meta.fetch_sub(kConstruction, std::memory_order_release);
+  usage_.fetch_sub(charge, std::memory_order_relaxed);
+  occupancy_.fetch_sub(1, std::memory_order_relaxed);
+
+  return {std::move(key), std::move(item)};
+}
+
+} // namespace sstable
+
+} // namespace kvs
+
+#endif // SSTABLE_CLOCK_CACHE_H
\ No newline at end of file
@@ -0,0 +1,70 @@
+#include "sstable/frequency_sketch.h"
+
+// libC++
+#include <algorithm>
+#include <bit>
+
+namespace {
+
+// Odd multipliers, one for each row of sketch
+constexpr uint64_t kSeeds[] = {0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL,
+                               0x165667B19E3779F9ULL, 0xD6E8FEB86659FD93ULL};
+
+} // namespace
+
+namespace kvs {
+
+namespace sstable {
+
+FrequencySketch::FrequencySketch(size_t estimated_entries)
+    : width_(std::bit_ceil(std::max<size_t>(estimated_entries, 64))),
+      sample_size_(kSampleFactor * width_),
+      counters_(std::make_unique<std::atomic<uint8_t>[]>(kDepth * width_)),
+      additions_(0) {}
+
+void FrequencySketch::Increment(uint64_t hash) const {
+  bool added = false;
+  for (int row = 0; row < kDepth; row++) {
+    std::atomic<uint8_t> &counter = counters_[GetIndex(hash, row)];
+    uint8_t count = counter.load(std::memory_order_relaxed);
+    if (count < kMaxCount) {
+      counter.store(count + 1, std::memory_order_relaxed);
+      added = true;
+    }
+  }
+
+  if (added &&
+      additions_.fetch_add(1, std::memory_order_relaxed) + 1 == sample_size_) {
+    Reset();
+  }
+}
+
+uint8_t FrequencySketch::Estimate(uint64_t hash) const {
+  uint8_t frequency = kMaxCount;
+  for (int row = 0; row < kDepth; row++) {
+    frequency = std::min(
+        frequency,
+        counters_[GetIndex(hash, row)].load(std::memory_order_relaxed));
+  }
+
+  return frequency;
+}
+
+size_t FrequencySketch::GetIndex(uint64_t hash, int row) const {
+  // width_ is power of 2, high bits of product are the best mixed ones
+  return row * width_ +
+         ((hash * kSeeds[row]) >> (64 - std::countr_zero(width_)));
+}
+
+void FrequencySketch::Reset() const {
+  for (size_t i = 0; i < kDepth * width_; i++) {
+    counters_[i].store(counters_[i].load(std::memory_order_relaxed) / 2,
+                       std::memory_order_relaxed);
+  }
+
+  additions_.store(sample_size_ / 2, std::memory_order_relaxed);
+}
+
+} // namespace sstable
+
+} // namespace kvs
\ No newline at end of file
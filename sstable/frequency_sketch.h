@@ -0,0 +1,71 @@
+#ifndef SSTABLE_FREQUENCY_SKETCH_H
+#define SSTABLE_FREQUENCY_SKETCH_H
+
+#include "common/macros.h"
+
+// libC++
+#include <atomic>
+#include <memory>
+
+namespace kvs {
+
+namespace sstable {
+
+/*
+Count-min sketch that estimates how often a key(given by its 64-bit hash) has
+been accessed recently. Used by TinyLFU admission of ClockCache: a new entry
+only replaces a victim if it is accessed more often than victim.
+
+Each key is counted in kDepth rows, estimate is the min of its counters.
+Counters saturate at kMaxCount. Once kSampleFactor * width accesses have been
+counted, all counters are halved, so that frequencies of old accesses decay.
+
+Updates are relaxed and may be lost under contention, which only makes
+estimates a bit lower.
+*/
+class FrequencySketch {
+public:
+  // estimated_entries is the number of entries that cache can hold
+  explicit FrequencySketch(size_t estimated_entries);
+
+  ~FrequencySketch() = default;
+
+  // No copy allowed
+  FrequencySketch(const FrequencySketch &) = delete;
+  FrequencySketch &operator=(FrequencySketch &) = delete;
+
+  // No move allowed
+  FrequencySketch(FrequencySketch &&) = delete;
+  FrequencySketch &operator=(FrequencySketch &&) = delete;
+
+  void Increment(uint64_t hash) const;
+
+  uint8_t Estimate(uint64_t hash) const;
+
+private:
+  static constexpr int kDepth = 4;
+
+  static constexpr uint8_t kMaxCount = 15;
+
+  static constexpr uint64_t kSampleFactor = 10;
+
+  size_t GetIndex(uint64_t hash, int row) const;
+
+  // Halve all counters
+  void Reset() const;
+
+  const size_t width_;
+
+  const uint64_t sample_size_;
+
+  // kDepth rows of width_ counters
+  std::unique_ptr<std::atomic<uint8_t>[]> counters_;
+
+  mutable std::atomic<uint64_t> additions_;
+};
+
+} // namespace sstable
+
+} // namespace kvs
+
+#endif // SSTABLE_FREQUENCY_SKETCH_H
\ No newline at end of file
@@ -10,24 +10,25 @@ namespace kvs {
 namespace sstable {
 
 LRUBlockItem::LRUBlockItem(std::pair<SSTId, BlockOffset> block_info,
-                           std::unique_ptr<BlockReader> block_reader,
-                           const BlockReaderCache *const cache)
+                           std::unique_ptr<BlockReader> block_reader)
     : ref_count_(0), table_id_(block_info.first),
-      block_offset_(block_info.second), block_reader_(std::move(block_reader)),
-      cache_(cache) {}
+      block_offset_(block_info.second), block_reader_(std::move(block_reader)) {}
 
 void LRUBlockItem::IncRef() const {
   ref_count_.fetch_add(1, std::memory_order_relaxed);
 }
 
 void LRUBlockItem::Unref() const {
-  if (ref_count_.fetch_sub(1, std::memory_order_acq_rel) == 1 && cache_) {
-    cache_->AddVictim({table_id_, block_offset_});
-  }
+  ref_count_.fetch_sub(1, std::memory_order_acq_rel);
 }
 
 uint64_t LRUBlockItem::GetRefCount() const { return ref_count_.load(); }
 
+size_t LRUBlockItem::GetCharge() const {
+  return sizeof(LRUBlockItem) +
+         (block_reader_ ? block_reader_->GetCharge() : 0);
+}
+
 const BlockReader *LRUBlockItem::GetBlockReader() const {
   return block_reader_.get();
 }
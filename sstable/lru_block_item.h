@@ -15,14 +15,12 @@ namespace kvs {
 
 namespace sstable {
 
-class BlockReaderCache;
 class BlockReader;
 
 class LRUBlockItem {
 public:
   LRUBlockItem(std::pair<SSTId, BlockOffset> block_info,
-               std::unique_ptr<BlockReader> block_reader,
-               const BlockReaderCache *const cache_);
+               std::unique_ptr<BlockReader> block_reader);
 
   ~LRUBlockItem() = default;
 
@@ -36,13 +34,17 @@ public:
 
   void IncRef() const;
 
-  // It must be called each time an operation is finished
+  // It must be called each time an operation is finished. Block that isn't
+  // referenced anymore can be evicted by cache
   void Unref() const;
 
   const BlockReader *GetBlockReader() const;
 
   uint64_t GetRefCount() const;
 
+  // Bytes charged against capacity of cache that block belongs to
+  size_t GetCharge() const;
+
 private:
   mutable std::atomic<int64_t> ref_count_;
 
@@ -51,8 +53,6 @@ private:
   BlockOffset block_offset_;
 
   std::unique_ptr<BlockReader> block_reader_;
-
-  const BlockReaderCache *cache_;
 };
 
 } // namespace sstable
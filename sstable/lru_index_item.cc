@@ -0,0 +1,38 @@
+#include "sstable/lru_index_item.h"
+
+#include "sstable/block_index.h"
+
+namespace kvs {
+
+namespace sstable {
+
+LRUIndexItem::LRUIndexItem(SSTId table_id, std::vector<BlockIndex> block_index)
+    : ref_count_(0), table_id_(table_id), block_index_(std::move(block_index)),
+      charge_(sizeof(LRUIndexItem) +
+              block_index_.capacity() * sizeof(BlockIndex)) {
+  for (const auto &block : block_index_) {
+    charge_ += block.GetSmallestKey().size() + block.GetLargestKey().size();
+  }
+}
+
+LRUIndexItem::~LRUIndexItem() = default;
+
+void LRUIndexItem::IncRef() const {
+  ref_count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void LRUIndexItem::Unref() const {
+  ref_count_.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+uint64_t LRUIndexItem::GetRefCount() const { return ref_count_.load(); }
+
+size_t LRUIndexItem::GetCharge() const { return charge_; }
+
+const std::vector<BlockIndex> &LRUIndexItem::GetBlockIndex() const {
+  return block_index_;
+}
+
+} // namespace sstable
+
+} // namespace kvs
\ No newline at end of file
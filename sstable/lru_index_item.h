@@ -0,0 +1,60 @@
+#ifndef SSTABLE_LRU_INDEX_ITEM_H
+#define SSTABLE_LRU_INDEX_ITEM_H
+
+#include "common/macros.h"
+
+// libC++
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace kvs {
+
+namespace sstable {
+
+class BlockIndex;
+
+// Decoded index(meta section) of a table, cached in high priority pool of
+// BlockReaderCache
+class LRUIndexItem {
+public:
+  LRUIndexItem(SSTId table_id, std::vector<BlockIndex> block_index);
+
+  ~LRUIndexItem();
+
+  // No copy allowed
+  LRUIndexItem(const LRUIndexItem &) = delete;
+  LRUIndexItem &operator=(LRUIndexItem &) = delete;
+
+  // No move allowed
+  LRUIndexItem(LRUIndexItem &&) = delete;
+  LRUIndexItem &operator=(LRUIndexItem &&) = delete;
+
+  void IncRef() const;
+
+  // It must be called each time an operation is finished. Index that isn't
+  // referenced anymore can be evicted by cache
+  void Unref() const;
+
+  uint64_t GetRefCount() const;
+
+  // Bytes charged against capacity of cache
+  size_t GetCharge() const;
+
+  const std::vector<BlockIndex> &GetBlockIndex() const;
+
+private:
+  mutable std::atomic<int64_t> ref_count_;
+
+  SSTId table_id_;
+
+  std::vector<BlockIndex> block_index_;
+
+  size_t charge_;
+};
+
+} // namespace sstable
+
+} // namespace kvs
+
+#endif // SSTABLE_LRU_INDEX_ITEM_H
\ No newline at end of file
@@ -10,10 +10,9 @@ namespace kvs {
 namespace sstable {
 
 LRUTableItem::LRUTableItem(SSTId table_id,
-                           std::unique_ptr<TableReader> table_reader,
-                           const TableReaderCache *const cache)
+                           std::unique_ptr<TableReader> table_reader)
     : ref_count_(0), table_id_(table_id),
-      table_reader_(std::move(table_reader)), cache_(cache) {}
+      table_reader_(std::move(table_reader)) {}
 
 uint64_t LRUTableItem::GetRefCount() const { return ref_count_.load(); }
 
@@ -22,9 +21,7 @@ void LRUTableItem::IncRef() const {
 }
 
 void LRUTableItem::Unref() const {
-  if (ref_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
-    cache_->AddVictim(table_id_);
-  }
+  ref_count_.fetch_sub(1, std::memory_order_acq_rel);
 }
 
 const TableReader *LRUTableItem::GetTableReader() const {
@@ -20,8 +20,7 @@ class TableReader;
 
 class LRUTableItem {
 public:
-  LRUTableItem(SSTId table_id, std::unique_ptr<TableReader> table_reader,
-               const TableReaderCache *const cache_);
+  LRUTableItem(SSTId table_id, std::unique_ptr<TableReader> table_reader);
 
   ~LRUTableItem() = default;
 
@@ -37,7 +36,8 @@ public:
 
   void IncRef() const;
 
-  // It must be called each time an operation is finished
+  // It must be called each time an operation is finished. Table that isn't
+  // referenced anymore can be evicted by cache
   void Unref() const;
 
   const TableReader *GetTableReader() const;
@@ -50,8 +50,6 @@ private:
   SSTId table_id_;
 
   std::unique_ptr<TableReader> table_reader_;
-
-  const TableReaderCache *const cache_;
 };
 
 } // namespace sstable
@@ -0,0 +1,216 @@
+#include "sstable/secondary_block_cache.h"
+
+#include "io/linux_file.h"
+#include "sstable/block_reader.h"
+#include "sstable/lru_block_item.h"
+#include "sstable/table_reader.h"
+
+// libC++
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Blocks evicted while this many bytes are waiting to be written are dropped
+constexpr size_t kMaxPendingBytes = 64 * 1024 * 1024; // 64MB
+
+} // namespace
+
+namespace kvs {
+
+namespace sstable {
+
+std::unique_ptr<SecondaryBlockCache>
+CreateSecondaryBlockCache(std::string filename, size_t capacity) {
+  auto secondary_block_cache =
+      std::make_unique<SecondaryBlockCache>(std::move(filename), capacity);
+  if (!secondary_block_cache->Open()) {
+    return nullptr;
+  }
+
+  return secondary_block_cache;
+}
+
+SecondaryBlockCache::SecondaryBlockCache(std::string filename,
+                                         size_t capacity)
+    : filename_(std::move(filename)), capacity_(capacity), usage_(0),
+      write_offset_(0), pending_bytes_(0),
+      writer_(std::make_unique<kvs::ThreadPool>(1)) {
+  assert(capacity_ > 0);
+}
+
+SecondaryBlockCache::~SecondaryBlockCache() {
+  // Stop writer before files are closed
+  writer_.reset();
+}
+
+bool SecondaryBlockCache::Open() {
+  // Blocks written by previous run can't be located anymore
+  std::error_code ec;
+  fs::remove(filename_, ec);
+  if (ec) {
+    std::cerr << "Can't remove old secondary cache file " << filename_
+              << std::endl;
+    return false;
+  }
+
+  write_file_object_ = std::make_unique<io::LinuxWriteOnlyFile>(filename_);
+  if (!write_file_object_->Open()) {
+    write_file_object_.reset();
+    return false;
+  }
+
+  read_file_object_ = std::make_unique<io::LinuxReadOnlyFile>(filename_);
+  if (!read_file_object_->Open()) {
+    read_file_object_.reset();
+    return false;
+  }
+
+  // Each lookup reads a single block
+  read_file_object_->Hint(io::AccessPattern::kRandom);
+  return true;
+}
+
+void SecondaryBlockCache::Insert(
+    std::pair<SSTId, BlockOffset> block_info,
+    std::shared_ptr<LRUBlockItem> lru_block_item) const {
+  assert(lru_block_item);
+  const size_t block_size = lru_block_item->GetBlockReader()->GetData().size();
+  if (block_size > capacity_ || Contains(block_info)) {
+    return;
+  }
+
+  if (pending_bytes_.fetch_add(block_size, std::memory_order_relaxed) +
+          block_size >
+      kMaxPendingBytes) {
+    // Writer can't keep up, drop block
+    pending_bytes_.fetch_sub(block_size, std::memory_order_relaxed);
+    return;
+  }
+
+  writer_->Schedule(kvs::TaskPriority::kLow,
+                    [this, block_info, lru_block_item]() {
+                      Write(block_info, lru_block_item);
+                    });
+}
+
+std::unique_ptr<BlockReader>
+SecondaryBlockCache::Lookup(std::pair<SSTId, BlockOffset> block_info,
+                            BlockSize block_size) const {
+  Entry entry;
+  {
+    std::shared_lock rlock(mutex_);
+    auto it = entries_.find(block_info);
+    if (it == entries_.end() || it->second.size != block_size) {
+      return nullptr;
+    }
+    entry = it->second;
+  }
+
+  auto block_reader_data = std::make_unique<BlockReaderData>(block_size);
+  ssize_t bytes_read =
+      read_file_object_->RandomRead(block_reader_data->buffer, entry.offset);
+  if (bytes_read != static_cast<ssize_t>(block_size)) {
+    return nullptr;
+  }
+
+  {
+    // Entry is removed before its data is overwritten. If it is still there,
+    // data that has been read is valid
+    std::shared_lock rlock(mutex_);
+    auto it = entries_.find(block_info);
+    if (it == entries_.end() || it->second.offset != entry.offset) {
+      return nullptr;
+    }
+  }
+
+  return SetupDataForBlockReader(std::move(block_reader_data));
+}
+
+bool SecondaryBlockCache::Contains(
+    std::pair<SSTId, BlockOffset> block_info) const {
+  std::shared_lock rlock(mutex_);
+  return entries_.contains(block_info);
+}
+
+size_t SecondaryBlockCache::GetCapacity() const { return capacity_; }
+
+size_t SecondaryBlockCache::GetUsage() const {
+  std::shared_lock rlock(mutex_);
+  return usage_;
+}
+
+void SecondaryBlockCache::WaitForPendingWrites() const {
+  while (pending_bytes_.load(std::memory_order_relaxed) > 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+void SecondaryBlockCache::Write(
+    std::pair<SSTId, BlockOffset> block_info,
+    std::shared_ptr<LRUBlockItem> lru_block_item) const {
+  std::span<const Byte> data = lru_block_item->GetBlockReader()->GetData();
+
+  if (write_offset_ + data.size() > capacity_) {
+    // Wrap around, oldest blocks are overwritten first
+    write_offset_ = 0;
+  }
+  const uint64_t offset = write_offset_;
+
+  {
+    std::scoped_lock rwlock(mutex_);
+    if (entries_.contains(block_info)) {
+      // Block has been queued more than once
+      pending_bytes_.fetch_sub(data.size(), std::memory_order_relaxed);
+      return;
+    }
+    EvictRange(offset, data.size());
+  }
+
+  ssize_t bytes_written = write_file_object_->Append(data, offset);
+  if (bytes_written == static_cast<ssize_t>(data.size())) {
+    std::scoped_lock rwlock(mutex_);
+    entries_[block_info] = {offset, data.size()};
+    entries_by_offset_[offset] = block_info;
+    usage_ += data.size();
+    write_offset_ += data.size();
+  }
+
+  pending_bytes_.fetch_sub(data.size(), std::memory_order_relaxed);
+}
+
+void SecondaryBlockCache::EvictRange(uint64_t offset, uint64_t size) const {
+  // First block that may overlap range is the one starting before it
+  auto it = entries_by_offset_.upper_bound(offset);
+  if (it != entries_by_offset_.begin()) {
+    it--;
+  }
+
+  while (it != entries_by_offset_.end() && it->first < offset + size) {
+    auto entry = entries_.find(it->second);
+    assert(entry != entries_.end());
+    if (entry->second.offset + entry->second.size <= offset) {
+      // Ends before range
+      it++;
+      continue;
+    }
+
+    usage_ -= entry->second.size;
+    entries_.erase(entry);
+    it = entries_by_offset_.erase(it);
+  }
+}
+
+uint64_t SecondaryBlockCache::BlockInfoHash::operator()(
+    std::pair<SSTId, BlockOffset> block_info) const {
+  uint64_t hash = block_info.first * 0x9E3779B97F4A7C15ULL ^ block_info.second;
+  return hash ^ (hash >> 32);
+}
+
+} // namespace sstable
+
+} // namespace kvs
\ No newline at end of file
@@ -0,0 +1,133 @@
+#ifndef SSTABLE_SECONDARY_BLOCK_CACHE_H
+#define SSTABLE_SECONDARY_BLOCK_CACHE_H
+
+#include "common/macros.h"
+#include "common/thread_pool.h"
+#include "io/base_file.h"
+
+// libC++
+#include <atomic>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+namespace kvs {
+
+namespace sstable {
+
+class BlockReader;
+class LRUBlockItem;
+
+/*
+Second tier of block cache, stored in a single file on a fast local device.
+Blocks evicted from BlockReaderCache are written into it, and a block missing
+from memory is looked up in it before being read from SST file.
+
+File is a ring log of capacity bytes: blocks are appended one after another,
+and once end of file is reached, writing wraps around to its beginning,
+overwriting the oldest blocks. Location of each block is kept in memory only,
+file is recreated each time cache is opened.
+
+Writes are done by a single background thread. Evicting thread only queues
+block, which is kept alive until it is written. Blocks are dropped instead of
+queued if too many bytes are already waiting to be written.
+
+Entries of blocks that are about to be overwritten are removed from index
+before writing. A lookup checks that its entry is still there after reading,
+otherwise data it has read may have been overwritten.
+*/
+class SecondaryBlockCache {
+public:
+  SecondaryBlockCache(std::string filename, size_t capacity);
+
+  ~SecondaryBlockCache();
+
+  // No copy allowed
+  SecondaryBlockCache(const SecondaryBlockCache &) = delete;
+  SecondaryBlockCache &operator=(SecondaryBlockCache &) = delete;
+
+  // No move allowed
+  SecondaryBlockCache(SecondaryBlockCache &&) = delete;
+  SecondaryBlockCache &operator=(SecondaryBlockCache &&) = delete;
+
+  // Create cache file, replacing the one left by previous run
+  bool Open();
+
+  // Queue block to be written into cache file
+  void Insert(std::pair<SSTId, BlockOffset> block_info,
+              std::shared_ptr<LRUBlockItem> lru_block_item) const;
+
+  // nullptr if block isn't in cache, or can't be read
+  std::unique_ptr<BlockReader>
+  Lookup(std::pair<SSTId, BlockOffset> block_info, BlockSize block_size) const;
+
+  bool Contains(std::pair<SSTId, BlockOffset> block_info) const;
+
+  size_t GetCapacity() const;
+
+  // Total size of blocks in cache file
+  size_t GetUsage() const;
+
+  // For testing. Block until all queued blocks are written
+  void WaitForPendingWrites() const;
+
+private:
+  struct BlockInfoHash {
+    uint64_t operator()(std::pair<SSTId, BlockOffset> block_info) const;
+  };
+
+  // Location of block in cache file
+  struct Entry {
+    uint64_t offset;
+
+    BlockSize size;
+  };
+
+  // Run by background thread
+  void Write(std::pair<SSTId, BlockOffset> block_info,
+             std::shared_ptr<LRUBlockItem> lru_block_item) const;
+
+  // Remove entries of blocks that overlap [offset, offset + size) of file.
+  // mutex_ MUST be held
+  void EvictRange(uint64_t offset, uint64_t size) const;
+
+  const std::string filename_;
+
+  const size_t capacity_;
+
+  std::unique_ptr<io::WriteOnlyFile> write_file_object_;
+
+  std::unique_ptr<io::ReadOnlyFile> read_file_object_;
+
+  mutable std::shared_mutex mutex_;
+
+  mutable std::unordered_map<std::pair<SSTId, BlockOffset>, Entry,
+                             BlockInfoHash>
+      entries_;
+
+  // Blocks in cache file, ordered by their offset in file
+  mutable std::map<uint64_t, std::pair<SSTId, BlockOffset>> entries_by_offset_;
+
+  mutable size_t usage_;
+
+  // Offset in file where next block is written. Only touched by background
+  // thread
+  mutable uint64_t write_offset_;
+
+  mutable std::atomic<size_t> pending_bytes_;
+
+  // Single thread, so that blocks are written in order
+  std::unique_ptr<kvs::ThreadPool> writer_;
+};
+
+// Return nullptr if cache file can't be created
+std::unique_ptr<SecondaryBlockCache>
+CreateSecondaryBlockCache(std::string filename, size_t capacity);
+
+} // namespace sstable
+
+} // namespace kvs
+
+#endif // SSTABLE_SECONDARY_BLOCK_CACHE_H
\ No newline at end of file
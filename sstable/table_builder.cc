@@ -229,6 +229,10 @@ uint64_t TableBuilder::GetFileSize() const { return current_offset_ + 1; }
 
 uint64_t TableBuilder::GetDataSize() const { return data_size_; }
 
+TxnId TableBuilder::GetMinTxnId() const { return min_txnid_; }
+
+TxnId TableBuilder::GetMaxTxnId() const { return max_txnid_; }
+
 std::string_view TableBuilder::GetFilename() const { return filename_; }
 
 } // namespace sstable
@@ -106,6 +106,10 @@ public:
 
   uint64_t GetDataSize() const;
 
+  TxnId GetMinTxnId() const;
+
+  TxnId GetMaxTxnId() const;
+
 private:
   void EncodeExtraInfo();
 
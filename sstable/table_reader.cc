@@ -1,25 +1,16 @@
 #include "sstable/table_reader.h"
 
+#include "io/io_uring.h"
 #include "io/linux_file.h"
+#include "io/prefetch_buffer.h"
 #include "sstable/block_index.h"
 #include "sstable/block_reader.h"
 #include "sstable/block_reader_cache.h"
+#include "sstable/lru_index_item.h"
 #include "sstable/lru_table_item.h"
 
-namespace {
-
-uint64_t GetDataEntryOffset(uint64_t offset_section, int entry_index,
-                            std::span<const kvs::Byte> buffer) {
-  // Starting offset of offset entry at index (entry_index) (th)
-  uint64_t offset_entry = offset_section + entry_index * 2 * sizeof(uint64_t);
-
-  const uint64_t data_entry_offset =
-      *reinterpret_cast<const uint64_t *>(&buffer[offset_entry]);
-
-  return data_entry_offset;
-}
-
-} // namespace
+// libC++
+#include <algorithm>
 
 namespace kvs {
 constexpr int kDefaultExtraInfoSize = 40; // Bytes
@@ -29,24 +20,109 @@ namespace kvs {
 
 namespace sstable {
 
-std::unique_ptr<TableReader>
-CreateAndSetupDataForTableReader(std::string &&filename, SSTId table_id,
-                                 uint64_t file_size) {
+std::unique_ptr<TableReader> CreateAndSetupDataForTableReader(
+    std::string &&filename, SSTId table_id, uint64_t file_size, bool use_mmap,
+    const BlockReaderCache *const block_reader_cache, bool pin_index) {
   auto table_reader_data = std::make_unique<TableReaderData>();
 
   table_reader_data->filename = std::move(filename);
   table_reader_data->table_id = table_id;
   table_reader_data->file_size = file_size;
-  table_reader_data->read_file_object =
-      std::make_unique<io::LinuxReadOnlyFile>(table_reader_data->filename);
+  if (use_mmap) {
+    table_reader_data->read_file_object =
+        std::make_unique<io::LinuxMmapReadOnlyFile>(
+            table_reader_data->filename);
+  } else {
+    table_reader_data->read_file_object =
+        std::make_unique<io::LinuxReadOnlyFile>(table_reader_data->filename);
+  }
   if (!table_reader_data->read_file_object->Open()) {
     return nullptr;
   }
 
+  if (use_mmap) {
+    // Mapped tables serve point lookups, kernel readahead only wastes memory
+    table_reader_data->read_file_object->Hint(io::AccessPattern::kRandom);
+  }
+
   // Decode block index
   DecodeExtraInfo(table_reader_data.get());
 
-  return std::make_unique<TableReader>(std::move(table_reader_data));
+  return std::make_unique<TableReader>(std::move(table_reader_data),
+                                       block_reader_cache, pin_index);
+}
+
+BlockReads::BlockReads() = default;
+
+BlockReads::~BlockReads() = default;
+
+BlockReads::BlockReads(BlockReads &&) = default;
+
+BlockReads &BlockReads::operator=(BlockReads &&) = default;
+
+std::vector<std::unique_ptr<BlockReader>>
+CreateAndSetupDataForBlockReaders(std::span<const BlockToRead> blocks) {
+  BlockReads reads;
+  PrepareBlockReads(blocks, &reads);
+  io::MultiRead(reads.requests);
+  FinishBlockReads(&reads);
+
+  return std::move(reads.block_readers);
+}
+
+void PrepareBlockReads(std::span<const BlockToRead> blocks,
+                       BlockReads *reads) {
+  assert(reads);
+  reads->block_readers.resize(blocks.size());
+
+  for (size_t i = 0; i < blocks.size(); i++) {
+    const TableReader *table_reader = blocks[i].table_reader;
+    assert(table_reader);
+    if (table_reader->mapping_) {
+      // No IO is needed
+      reads->block_readers[i] = table_reader->CreateAndSetupDataForBlockReader(
+          blocks[i].offset, blocks[i].size);
+      continue;
+    }
+
+    reads->blocks_data.push_back(
+        std::make_unique<BlockReaderData>(blocks[i].size));
+    reads->requests.push_back({table_reader->read_file_object_.get(),
+                               blocks[i].offset,
+                               reads->blocks_data.back()->buffer});
+    reads->requests_block_index.push_back(i);
+  }
+}
+
+void FinishBlockReads(BlockReads *reads) {
+  assert(reads);
+  for (size_t i = 0; i < reads->requests.size(); i++) {
+    if (reads->requests[i].result < 0) {
+      continue;
+    }
+
+    reads->block_readers[reads->requests_block_index[i]] =
+        SetupDataForBlockReader(std::move(reads->blocks_data[i]));
+  }
+}
+
+std::unique_ptr<BlockReader>
+SetupDataForBlockReader(std::unique_ptr<BlockReaderData> block_reader_data) {
+  std::span<const Byte> block_data = block_reader_data->GetData();
+
+  int64_t last_block_offset = block_data.size() - 1;
+  // 16 last bytes of lock contain metadata info(num entries + starting offset
+  // of offset section)
+  block_reader_data->total_data_entries = *reinterpret_cast<const uint64_t *>(
+      &block_data[last_block_offset - 15]);
+  block_reader_data->offset_section = *reinterpret_cast<const uint64_t *>(
+      &block_data[last_block_offset - 7]);
+
+  // Offset entries aren't decoded here. BlockReader reads them directly from
+  // block's data when they are needed
+
+  // Create new blockreader
+  return std::make_unique<BlockReader>(std::move(block_reader_data));
 }
 
 void DecodeExtraInfo(TableReaderData *table_reader_data) {
@@ -63,13 +139,13 @@ void DecodeExtraInfo(TableReaderData *table_reader_data) {
   }
 
   // first 8 bytes contains info of total block entries in table
-  uint64_t total_block_entries =
+  table_reader_data->total_block_entries =
       *reinterpret_cast<uint64_t *>(&extra_info_buffer[0]);
   // byte 8 - 15 contains starting offset of meta section
-  uint64_t starting_meta_section_offset =
+  table_reader_data->meta_section_offset =
       *reinterpret_cast<uint64_t *>(&extra_info_buffer[8]);
   // byte 16 - 23 contains length of meta section
-  uint64_t meta_section_length =
+  table_reader_data->meta_section_length =
       *reinterpret_cast<uint64_t *>(&extra_info_buffer[16]);
   // byte 24- 31 contains min transaction id
   table_reader_data->min_transaction_id =
@@ -78,28 +154,34 @@ void DecodeExtraInfo(TableReaderData *table_reader_data) {
   table_reader_data->max_transaction_id =
       *reinterpret_cast<uint64_t *>(&extra_info_buffer[32]);
 
-  // Fill block index info into block_index_
-  FetchBlockIndexInfo(total_block_entries, starting_meta_section_offset,
-                      meta_section_length, table_reader_data);
+  // Fill block index info into block_index
+  FetchBlockIndexInfo(table_reader_data->total_block_entries,
+                      table_reader_data->meta_section_offset,
+                      table_reader_data->meta_section_length,
+                      table_reader_data->read_file_object.get(),
+                      &table_reader_data->block_index);
 }
 
-void FetchBlockIndexInfo(uint64_t total_block_entries,
+bool FetchBlockIndexInfo(uint64_t total_block_entries,
                          uint64_t starting_meta_section_offset,
                          uint64_t meta_section_length,
-                         TableReaderData *table_reader_data) {
+                         io::ReadOnlyFile *read_file_object,
+                         std::vector<BlockIndex> *block_index) {
   assert(total_block_entries > 0 && total_block_entries < ULLONG_MAX);
   assert(starting_meta_section_offset > 0 &&
          starting_meta_section_offset < ULLONG_MAX);
   assert(meta_section_length > 0 && meta_section_length < ULLONG_MAX);
 
   std::vector<Byte> block_index_buffer(meta_section_length, 0);
-  ssize_t bytes_read = table_reader_data->read_file_object->RandomRead(
-      block_index_buffer, starting_meta_section_offset);
+  ssize_t bytes_read =
+      read_file_object->RandomRead(block_index_buffer,
+                                   starting_meta_section_offset);
   if (bytes_read < 0) {
-    return;
+    return false;
   }
 
   uint64_t starting_offset = 0;
+  block_index->reserve(total_block_entries);
 
   for (int i = 0; i < total_block_entries; i++) {
     // First 4 bytes contain info smallest key length
@@ -149,101 +231,339 @@ void FetchBlockIndexInfo(uint64_t total_block_entries,
     starting_offset += sizeof(uint64_t);
 
     // Cache block index info
-    table_reader_data->block_index.emplace_back(
-        block_smallest_key, block_largest_key, block_starting_offset,
-        block_length);
+    block_index->emplace_back(block_smallest_key, block_largest_key,
+                              block_starting_offset, block_length);
   }
+
+  return true;
 }
 
-TableReader::TableReader(std::unique_ptr<TableReaderData> table_reader_data)
+TableReader::TableReader(std::unique_ptr<TableReaderData> table_reader_data,
+                         const BlockReaderCache *const block_reader_cache,
+                         bool pin_index)
     : filename_(std::move(table_reader_data->filename)),
       table_id_(table_reader_data->table_id),
       file_size_(table_reader_data->file_size),
       min_transaction_id_(table_reader_data->min_transaction_id),
       max_transaction_id_(table_reader_data->max_transaction_id),
-      block_index_(std::move(table_reader_data->block_index)),
-      read_file_object_(std::move(table_reader_data->read_file_object)) {}
+      total_block_entries_(table_reader_data->total_block_entries),
+      meta_section_offset_(table_reader_data->meta_section_offset),
+      meta_section_length_(table_reader_data->meta_section_length),
+      read_file_object_(std::move(table_reader_data->read_file_object)),
+      block_reader_cache_(block_reader_cache),
+      mapping_(read_file_object_->GetMapping()) {
+  auto lru_index_item = std::make_shared<LRUIndexItem>(
+      table_id_, std::move(table_reader_data->block_index));
+
+  if (!block_reader_cache_) {
+    // Index is owned by table
+    lru_index_item->IncRef();
+    pinned_index_ = std::move(lru_index_item);
+    return;
+  }
 
-db::GetStatus
+  // Index is charged against block cache. If it is pinned, the ref held by
+  // table prevents it from being evicted
+  std::shared_ptr<LRUIndexItem> cached_index_item =
+      block_reader_cache_->AddNewIndexThenGet(table_id_,
+                                              std::move(lru_index_item));
+  if (pin_index) {
+    pinned_index_ = std::move(cached_index_item);
+  } else {
+    cached_index_item->Unref();
+  }
+}
+
+TableReader::~TableReader() {
+  if (pinned_index_) {
+    pinned_index_->Unref();
+  }
+}
+
+std::shared_ptr<LRUIndexItem> TableReader::GetIndex() const {
+  if (pinned_index_) {
+    pinned_index_->IncRef();
+    return pinned_index_;
+  }
+
+  std::shared_ptr<LRUIndexItem> lru_index_item =
+      block_reader_cache_->GetLRUIndexItem(table_id_);
+  if (lru_index_item) {
+    return lru_index_item;
+  }
+
+  // Index has been evicted, read it again from file
+  std::vector<BlockIndex> block_index;
+  if (!FetchBlockIndexInfo(total_block_entries_, meta_section_offset_,
+                           meta_section_length_, read_file_object_.get(),
+                           &block_index)) {
+    return nullptr;
+  }
+
+  return block_reader_cache_->AddNewIndexThenGet(
+      table_id_,
+      std::make_shared<LRUIndexItem>(table_id_, std::move(block_index)));
+}
+
+db::ValueType
 TableReader::GetValue(std::string_view key, TxnId txn_id,
                       const sstable::BlockReaderCache *const block_reader_cache,
-                      const TableReader *const table_reader) const {
-  auto [block_offset, block_size] = GetBlockOffsetAndSize(key);
+                      const TableReader *const table_reader,
+                      db::PinnableValue *value, bool fill_cache) const {
+  std::shared_ptr<LRUIndexItem> lru_index_item = GetIndex();
+  if (!lru_index_item) {
+    return db::ValueType::kTooManyOpenFiles;
+  }
+  const std::vector<BlockIndex> &block_index = lru_index_item->GetBlockIndex();
+
+  db::ValueType type = db::ValueType::NOT_FOUND;
 
-  if (block_reader_cache) {
-    // BlockCache is enabled
-    return block_reader_cache->GetValue(key, txn_id, {table_id_, block_offset},
-                                        block_size, table_reader);
+  // Versions of the same key can span many consecutive blocks. If no visible
+  // version is found in a block ending with key, continue with next block
+  for (size_t index = FindBlock(block_index, key); index < block_index.size();
+       index++) {
+    if (block_index[index].GetSmallestKey() > key) {
+      break;
+    }
+
+    BlockOffset block_offset = block_index[index].GetBlockStartOffset();
+    BlockSize block_size = block_index[index].GetBlockSize();
+
+    if (block_reader_cache) {
+      // BlockCache is enabled
+      type = block_reader_cache->GetValue(
+          key, txn_id, {table_id_, block_offset}, block_size, table_reader,
+          value, fill_cache);
+    } else {
+      // Create new blockreader. It is owned by value if value is found in it
+      std::shared_ptr<BlockReader> new_block_reader =
+          table_reader->CreateAndSetupDataForBlockReader(block_offset,
+                                                         block_size);
+      if (!new_block_reader) {
+        type = db::ValueType::kTooManyOpenFiles;
+        break;
+      }
+
+      std::string_view found_value;
+      type = new_block_reader->GetValue(key, txn_id, &found_value);
+      if (type == db::ValueType::PUT) {
+        value->PinSlice(found_value, std::move(new_block_reader));
+      }
+    }
+
+    if (type != db::ValueType::NOT_FOUND ||
+        block_index[index].GetLargestKey() != key) {
+      break;
+    }
+  }
+
+  lru_index_item->Unref();
+  return type;
+}
+
+void TableReader::MultiGetValue(
+    std::span<const std::string_view> keys, TxnId txn_id,
+    const sstable::BlockReaderCache *const block_reader_cache,
+    const TableReader *const table_reader, std::span<db::GetStatus> statuses,
+    bool fill_cache) const {
+  assert(keys.size() == statuses.size());
+
+  // Keys in range [begin, end) are in block at index
+  struct BlockKeys {
+    size_t index;
+
+    size_t begin;
+
+    size_t end;
+
+    // Set if block isn't in memory and has been read from secondary cache or
+    // from disk
+    bool read_from_disk;
+
+    std::unique_ptr<BlockReader> block_reader;
+  };
+
+  std::shared_ptr<LRUIndexItem> lru_index_item = GetIndex();
+  if (!lru_index_item) {
+    for (auto &status : statuses) {
+      if (status.type == db::ValueType::NOT_FOUND) {
+        status.type = db::ValueType::kTooManyOpenFiles;
+      }
+    }
+    return;
+  }
+  const std::vector<BlockIndex> &block_index = lru_index_item->GetBlockIndex();
+
+  std::vector<BlockKeys> blocks;
+  size_t begin = 0;
+  while (begin < keys.size()) {
+    const size_t index = FindBlock(block_index, keys[begin]);
+    std::string_view block_largest_key = block_index[index].GetLargestKey();
+    size_t end = begin + 1;
+    while (end < keys.size() && keys[end] <= block_largest_key) {
+      end++;
+    }
+
+    if (std::any_of(statuses.begin() + begin, statuses.begin() + end,
+                    [](const db::GetStatus &status) {
+                      return status.type == db::ValueType::NOT_FOUND;
+                    })) {
+      blocks.push_back({index, begin, end, false, nullptr});
+    }
+    begin = end;
+  }
+
+  // Blocks missing from cache are read from disk together
+  std::vector<BlockToRead> blocks_to_read;
+  for (auto &block : blocks) {
+    BlockOffset block_offset = block_index[block.index].GetBlockStartOffset();
+    if (block_reader_cache &&
+        block_reader_cache->Contains({table_id_, block_offset})) {
+      continue;
+    }
+
+    block.read_from_disk = true;
+    if (block_reader_cache) {
+      block.block_reader = block_reader_cache->GetFromSecondaryCache(
+          {table_id_, block_offset}, block_index[block.index].GetBlockSize());
+      if (block.block_reader) {
+        continue;
+      }
+    }
+
+    blocks_to_read.push_back(
+        {table_reader, block_offset, block_index[block.index].GetBlockSize()});
+  }
+
+  std::vector<std::unique_ptr<BlockReader>> block_readers =
+      CreateAndSetupDataForBlockReaders(blocks_to_read);
+  for (size_t i = 0, j = 0; i < blocks.size(); i++) {
+    if (blocks[i].read_from_disk && !blocks[i].block_reader) {
+      blocks[i].block_reader = std::move(block_readers[j++]);
+    }
   }
 
-  // Create new tablereader
-  auto new_block_reader =
-      table_reader->CreateAndSetupDataForBlockReader(block_offset, block_size);
-  if (!new_block_reader) {
-    db::GetStatus status;
-    status.type = db::ValueType::kTooManyOpenFiles;
-    return status;
+  for (auto &block : blocks) {
+    std::span<const std::string_view> block_keys =
+        keys.subspan(block.begin, block.end - block.begin);
+    std::span<db::GetStatus> block_statuses =
+        statuses.subspan(block.begin, block.end - block.begin);
+
+    BlockOffset block_offset = block_index[block.index].GetBlockStartOffset();
+    BlockSize block_size = block_index[block.index].GetBlockSize();
+
+    if (!block.read_from_disk) {
+      // BlockCache is enabled and block is in cache
+      block_reader_cache->MultiGetValue(
+          block_keys, txn_id, {table_id_, block_offset}, block_size,
+          table_reader, block_statuses, fill_cache);
+    } else if (block.block_reader) {
+      block.block_reader->MultiGetValue(block_keys, txn_id, block_statuses);
+      if (block_reader_cache && fill_cache) {
+        block_reader_cache->AddNewBlockReader({table_id_, block_offset},
+                                              std::move(block.block_reader));
+      }
+    } else {
+      for (auto &status : block_statuses) {
+        if (status.type == db::ValueType::NOT_FOUND) {
+          status.type = db::ValueType::kTooManyOpenFiles;
+        }
+      }
+      continue;
+    }
+
+    // Only the last key of block can have older versions in next blocks
+    if (block_keys.back() == block_index[block.index].GetLargestKey() &&
+        block_statuses.back().type == db::ValueType::NOT_FOUND) {
+      db::PinnableValue value;
+      block_statuses.back().type =
+          GetValue(block_keys.back(), txn_id, block_reader_cache, table_reader,
+                   &value, fill_cache);
+      if (block_statuses.back().type == db::ValueType::PUT) {
+        block_statuses.back().value = value.ToString();
+      }
+    }
   }
 
-  return new_block_reader->GetValue(key, txn_id);
+  lru_index_item->Unref();
 }
 
-std::pair<BlockOffset, BlockSize>
+std::optional<std::pair<BlockOffset, BlockSize>>
 TableReader::GetBlockOffsetAndSize(std::string_view key) const {
+  std::shared_ptr<LRUIndexItem> lru_index_item = GetIndex();
+  if (!lru_index_item) {
+    return std::nullopt;
+  }
+  const std::vector<BlockIndex> &block_index = lru_index_item->GetBlockIndex();
+
+  size_t index = FindBlock(block_index, key);
+
+  BlockOffset block_offset = block_index[index].GetBlockStartOffset();
+  BlockSize block_size = block_index[index].GetBlockSize();
+
+  lru_index_item->Unref();
+  return std::make_pair(block_offset, block_size);
+}
+
+size_t TableReader::FindBlock(const std::vector<BlockIndex> &block_index,
+                              std::string_view key) {
   // Find the block that have smallest largest key that >= key
   int64_t left = 0;
-  int64_t right = block_index_.size() - 1;
+  int64_t right = block_index.size() - 1;
 
   while (left < right) {
     int64_t mid = left + (right - left) / 2;
-    if (block_index_[mid].GetLargestKey() >= key) {
+    if (block_index[mid].GetLargestKey() >= key) {
       right = mid;
     } else {
       left = mid + 1;
     }
   }
 
-  BlockOffset block_offset = block_index_[right].GetBlockStartOffset();
-  BlockSize block_size = block_index_[right].GetBlockSize();
-
-  return {block_offset, block_size};
+  return right;
 }
 
-std::unique_ptr<BlockReader>
-TableReader::CreateAndSetupDataForBlockReader(BlockOffset offset,
-                                              uint64_t block_size) const {
+std::unique_ptr<BlockReader> TableReader::CreateAndSetupDataForBlockReader(
+    BlockOffset offset, uint64_t block_size,
+    io::PrefetchBuffer *prefetch_buffer) const {
   if (offset < 0) {
     return nullptr;
   }
 
+  if (mapping_) {
+    // Zero-copy, block reader is a view over mapped file
+    if (offset + block_size > file_size_) {
+      return nullptr;
+    }
+
+    return SetupDataForBlockReader(
+        std::make_unique<BlockReaderData>(mapping_, offset, block_size));
+  }
+
   auto block_reader_data = std::make_unique<BlockReaderData>(block_size);
+  if (prefetch_buffer) {
+    if (!prefetch_buffer->Read(read_file_object_.get(), offset,
+                               block_reader_data->buffer)) {
+      return nullptr;
+    }
+
+    return SetupDataForBlockReader(std::move(block_reader_data));
+  }
+
   ssize_t bytes_read =
       read_file_object_->RandomRead(block_reader_data->buffer, offset);
   if (bytes_read < 0) {
     return nullptr;
   }
 
-  int64_t last_block_offset = block_reader_data->buffer.size() - 1;
-  // 16 last bytes of lock contain metadata info(num entries + starting offset
-  // of offset section)
-  block_reader_data->total_data_entries = *reinterpret_cast<uint64_t *>(
-      &block_reader_data->buffer[last_block_offset - 15]);
-  block_reader_data->offset_section = *reinterpret_cast<uint64_t *>(
-      &block_reader_data->buffer[last_block_offset - 7]);
-
-  for (uint64_t i = 0; i < block_reader_data->total_data_entries; i++) {
-    block_reader_data->data_entries_offset_info.emplace_back(GetDataEntryOffset(
-        block_reader_data->offset_section, i, block_reader_data->buffer));
-  }
-
-  // Create new blockreader
-  return std::make_unique<BlockReader>(std::move(block_reader_data));
+  return SetupDataForBlockReader(std::move(block_reader_data));
 }
 
 uint64_t TableReader::GetFileSize() const { return file_size_; }
 
 const std::vector<BlockIndex> &TableReader::GetBlockIndex() const {
-  return block_index_;
+  assert(pinned_index_);
+  return pinned_index_->GetBlockIndex();
 }
 
 } // namespace sstable
@@ -2,12 +2,14 @@
 #define SSTABLE_TABLE_READER_H
 
 #include "common/macros.h"
+#include "db/pinnable_value.h"
 #include "db/status.h"
 #include "io/linux_file.h"
 
 // libC++
 #include <cassert>
 #include <memory>
+#include <optional>
 #include <span>
 #include <string>
 #include <vector>
@@ -15,15 +17,18 @@
 namespace kvs {
 
 namespace io {
+class PrefetchBuffer;
 class ReadOnlyFile;
-}
+} // namespace io
 
 namespace sstable {
 class BlockIndex;
 class BlockReaderCache;
 class BlockReaderData;
 class BlockReader;
+class LRUIndexItem;
 class LRUTableItem;
+class TableReader;
 
 /*
 SST data format
@@ -72,16 +77,66 @@ struct TableReaderData {
 
   TxnId max_transaction_id;
 
+  // Location of index(meta section) in file
+  uint64_t total_block_entries;
+
+  uint64_t meta_section_offset;
+
+  uint64_t meta_section_length;
+
   std::vector<BlockIndex> block_index;
 
   std::unique_ptr<io::ReadOnlyFile> read_file_object;
 };
 
+// Block to be loaded by CreateAndSetupDataForBlockReaders
+struct BlockToRead {
+  const TableReader *table_reader;
+
+  BlockOffset offset;
+
+  BlockSize size;
+};
+
+// Reads done by CreateAndSetupDataForBlockReaders. They are prepared and
+// finished separately, so that caller can issue them itself(e.g. without
+// blocking, through io::IoCompletionQueue)
+struct BlockReads {
+  BlockReads();
+
+  ~BlockReads();
+
+  // No copy allowed
+  BlockReads(const BlockReads &) = delete;
+  BlockReads &operator=(BlockReads &) = delete;
+
+  // Move constructor/assignment
+  BlockReads(BlockReads &&);
+  BlockReads &operator=(BlockReads &&);
+
+  // One per block. Blocks that need no IO are set by PrepareBlockReads, others
+  // by FinishBlockReads. Block that can't be loaded is left as nullptr
+  std::vector<std::unique_ptr<BlockReader>> block_readers;
+
+  // Reads to issue, data of each one goes into its buffer in blocks_data
+  std::vector<io::ReadRequest> requests;
+
+  std::vector<std::unique_ptr<BlockReaderData>> blocks_data;
+
+  // Index in blocks of each read request
+  std::vector<size_t> requests_block_index;
+};
+
+// If block cache is given, index of table lives in its high priority pool,
+// and is read again from file once it is evicted. Index is pinned(kept for as
+// long as table is open) if pin_index is set, or if there is no block cache.
 class TableReader {
 public:
-  explicit TableReader(std::unique_ptr<TableReaderData> table_reader_data);
+  TableReader(std::unique_ptr<TableReaderData> table_reader_data,
+              const BlockReaderCache *const block_reader_cache,
+              bool pin_index);
 
-  ~TableReader() = default;
+  ~TableReader();
 
   // No copy allowed
   TableReader(const TableReader &) = delete;
@@ -91,25 +146,55 @@ public:
   TableReader(TableReader &&) = delete;
   TableReader &operator=(TableReader &&) = delete;
 
-  db::GetStatus
+  // Return newest version of key whose txn_id <= given txn_id. If type is
+  // PUT, value pins block that contains it instead of copying it. If
+  // fill_cache is false, blocks read from disk aren't added into
+  // block_reader_cache
+  db::ValueType
   GetValue(std::string_view key, TxnId txn_id,
            const sstable::BlockReaderCache *const block_reader_cache,
-           const TableReader *const table_reader) const;
+           const TableReader *const table_reader, db::PinnableValue *value,
+           bool fill_cache) const;
+
+  // keys MUST be sorted in ascending order. Keys are grouped by block, so
+  // that each block is fetched once, and blocks missing from cache are read
+  // from disk in a single batch. Only keys whose status is still NOT_FOUND
+  // are looked up
+  void MultiGetValue(std::span<const std::string_view> keys, TxnId txn_id,
+                     const sstable::BlockReaderCache *const block_reader_cache,
+                     const TableReader *const table_reader,
+                     std::span<db::GetStatus> statuses, bool fill_cache) const;
+
+  // If table is memory mapped, block reader is a view over mapping. Otherwise,
+  // if prefetch_buffer is given, block is read through it instead of directly
+  // from file
+  std::unique_ptr<BlockReader> CreateAndSetupDataForBlockReader(
+      BlockOffset offset, uint64_t block_size,
+      io::PrefetchBuffer *prefetch_buffer = nullptr) const;
+
+  // Offset and size of the block that may contain key. std::nullopt if index
+  // can't be read
+  std::optional<std::pair<BlockOffset, BlockSize>>
+  GetBlockOffsetAndSize(std::string_view key) const;
 
-  std::unique_ptr<BlockReader>
-  CreateAndSetupDataForBlockReader(BlockOffset offset,
-                                   uint64_t block_size) const;
+  // Return index with its ref count increased, caller MUST call Unref() once
+  // finished with it. nullptr if index isn't in cache and can't be read
+  std::shared_ptr<LRUIndexItem> GetIndex() const;
 
   uint64_t GetFileSize() const;
 
   friend class TableReaderIterator;
 
-  // For testing
+  friend void PrepareBlockReads(std::span<const BlockToRead> blocks,
+                                BlockReads *reads);
+
+  // For testing. Index MUST be pinned
   const std::vector<BlockIndex> &GetBlockIndex() const;
 
 private:
-  std::pair<BlockOffset, BlockSize>
-  GetBlockOffsetAndSize(std::string_view key) const;
+  // Find index of the first block whose largest key >= key
+  static size_t FindBlock(const std::vector<BlockIndex> &block_index,
+                          std::string_view key);
 
   const std::string filename_;
 
@@ -124,23 +209,58 @@ private:
   // Max transaction id contained in SST
   const TxnId max_transaction_id_;
 
-  // Contain starting offset and size of each block in table
-  // It is not const, because const object prevent moveable
-  std::vector<BlockIndex> block_index_;
+  const uint64_t total_block_entries_;
+
+  const uint64_t meta_section_offset_;
+
+  const uint64_t meta_section_length_;
 
   std::unique_ptr<io::ReadOnlyFile> read_file_object_;
+
+  // nullptr if block cache is disabled
+  const BlockReaderCache *const block_reader_cache_;
+
+  // Contain starting offset and size of each block in table. nullptr if index
+  // isn't pinned, then it is looked up in block cache
+  std::shared_ptr<LRUIndexItem> pinned_index_;
+
+  // Whole table mapped into memory. nullptr if table isn't read through mmap
+  const std::shared_ptr<const Byte> mapping_;
 };
 
-std::unique_ptr<TableReader>
-CreateAndSetupDataForTableReader(std::string &&filename, SSTId table_id,
-                                 uint64_t file_size);
+// If use_mmap is set, whole table is mapped into memory and blocks are read
+// without being copied. See TableReader for block_reader_cache and pin_index
+std::unique_ptr<TableReader> CreateAndSetupDataForTableReader(
+    std::string &&filename, SSTId table_id, uint64_t file_size,
+    bool use_mmap = false,
+    const BlockReaderCache *const block_reader_cache = nullptr,
+    bool pin_index = false);
+
+// Load blocks, that may belong to different tables, with a single batch of
+// reads. Block that can't be loaded is returned as nullptr
+std::vector<std::unique_ptr<BlockReader>>
+CreateAndSetupDataForBlockReaders(std::span<const BlockToRead> blocks);
+
+// Split version of CreateAndSetupDataForBlockReaders. Tables of blocks MUST be
+// kept open until reads are finished
+void PrepareBlockReads(std::span<const BlockToRead> blocks, BlockReads *reads);
+
+// Set up blocks whose reads have been issued
+void FinishBlockReads(BlockReads *reads);
+
+// Decode metadata of block whose data has already been read into buffer
+std::unique_ptr<BlockReader>
+SetupDataForBlockReader(std::unique_ptr<BlockReaderData> block_reader_data);
 
 void DecodeExtraInfo(TableReaderData *table_reader_data);
 
-void FetchBlockIndexInfo(uint64_t total_block_entries,
+// Read and decode index(meta section) of table. Return false if it can't be
+// read
+bool FetchBlockIndexInfo(uint64_t total_block_entries,
                          uint64_t starting_meta_section_offset,
                          uint64_t meta_section_length,
-                         TableReaderData *table_reader_data);
+                         io::ReadOnlyFile *read_file_object,
+                         std::vector<BlockIndex> *block_index);
 
 } // namespace sstable
 
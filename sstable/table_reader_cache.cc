@@ -1,10 +1,11 @@
 #include "sstable/table_reader_cache.h"
 
-#include "common/thread_pool.h"
 #include "db/config.h"
 #include "db/db_impl.h"
+#include "io/io_uring.h"
 #include "sstable/block_reader.h"
 #include "sstable/block_reader_cache.h"
+#include "sstable/lru_block_item.h"
 #include "sstable/lru_table_item.h"
 #include "sstable/table_reader.h"
 
@@ -12,159 +13,223 @@ namespace kvs {
 
 namespace sstable {
 
-TableReaderCache::TableReaderCache(const db::DBImpl *db,
-                                   const kvs::ThreadPool *const thread_pool)
-    : shutdown_(false), capacity_(db->GetConfig()->GetTotalTablesCache()),
-      db_(db), thread_pool_(thread_pool) {
-  assert(db_ && thread_pool_);
-  thread_pool_->Enqueue(&TableReaderCache::ExecuteBgThread, this);
-}
-
-TableReaderCache::~TableReaderCache() {
-  shutdown_.store(true);
-
-  bg_cv_.notify_one();
+TableReaderCache::TableReaderCache(const db::DBImpl *db)
+    : db_(db), table_readers_cache_(db->GetConfig()->GetTotalTablesCache(),
+                                    db->GetConfig()->GetTotalTablesCache(),
+                                    true /*admission*/) {
+  assert(db_);
 }
 
 std::shared_ptr<LRUTableItem>
 TableReaderCache::GetLRUTableItem(SSTId table_id) const {
-  std::shared_lock rlock(mutex_);
-  auto iterator = table_readers_cache_.find(table_id);
-  if (iterator == table_readers_cache_.end()) {
-    return nullptr;
-  }
-
-  // Increase ref count
-  iterator->second->IncRef();
-
-  return iterator->second;
+  return table_readers_cache_.Lookup(table_id);
 }
 
 std::shared_ptr<LRUTableItem> TableReaderCache::AddNewTableReaderThenGet(
     SSTId table_id, std::shared_ptr<LRUTableItem> lru_table_item,
     bool add_then_get) const {
-  std::scoped_lock rwlock(mutex_);
-  if (table_readers_cache_.size() >= capacity_) {
-    Evict();
+  assert(lru_table_item);
+
+  // Table MAYBE inserted already, then the cached one is returned
+  std::shared_ptr<LRUTableItem> inserted_item =
+      table_readers_cache_.Insert(table_id, lru_table_item, 1 /*charge*/);
+  if (!inserted_item) {
+    // No table can be evicted, use table without caching it
+    if (add_then_get) {
+      lru_table_item->IncRef();
+    }
+    return lru_table_item;
+  }
+
+  if (!add_then_get) {
+    inserted_item->Unref();
   }
 
-  bool success =
-      table_readers_cache_.insert({table_id, std::move(lru_table_item)}).second;
+  return inserted_item;
+}
 
-  // Get block reader that MAYBE inserted
-  auto iterator = table_readers_cache_.find(table_id);
+std::unique_ptr<TableReader>
+TableReaderCache::CreateTableReader(SSTId table_id, uint64_t file_size,
+                                    int level) const {
+  std::string filename = db_->GetDBPath() + std::to_string(table_id) + ".sst";
 
-  if (add_then_get) {
-    // Increase ref count if need to get
-    iterator->second->IncRef();
+  // Indexes of L0 tables are read by almost every lookup, keep them pinned
+  return CreateAndSetupDataForTableReader(
+      std::move(filename), table_id, file_size,
+      db_->GetConfig()->IsMmapReadEnabled(level), db_->GetBlockReaderCache(),
+      level == 0 /*pin_index*/);
+}
+
+bool TableReaderCache::OpenTable(SSTId table_id, uint64_t file_size,
+                                 int level) const {
+  if (table_readers_cache_.Contains(table_id)) {
+    return true;
   }
 
-  if (iterator->second->GetRefCount() < 1) {
-    // This TableReader should be put in free_list_
-    free_list_.push_back(table_id);
+  auto new_table_reader = CreateTableReader(table_id, file_size, level);
+  if (!new_table_reader) {
+    return false;
   }
 
-  return iterator->second;
+  AddNewTableReaderThenGet(
+      table_id,
+      std::make_shared<LRUTableItem>(table_id, std::move(new_table_reader)),
+      false /*add_then_get*/);
+
+  return true;
 }
 
-// NOT THREAD-SAFE
-void TableReaderCache::Evict() const {
-  if (free_list_.empty() || table_readers_cache_.empty()) {
-    return;
+db::ValueType TableReaderCache::GetValue(
+    std::string_view key, TxnId txn_id, SSTId table_id, uint64_t file_size,
+    int level, const sstable::BlockReaderCache *const block_reader_cache,
+    db::PinnableValue *value, bool fill_cache) const {
+  std::shared_ptr<LRUTableItem> lru_table_item = GetLRUTableItem(table_id);
+  if (!lru_table_item) {
+    // if table hadn't been in cache, create new table and load into cache
+    auto new_table_reader = CreateTableReader(table_id, file_size, level);
+    if (!new_table_reader) {
+      return db::ValueType::kTooManyOpenFiles;
+    }
+
+    lru_table_item = AddNewTableReaderThenGet(
+        table_id,
+        std::make_shared<LRUTableItem>(table_id, std::move(new_table_reader)),
+        true /*add_then_get*/);
   }
 
-  SSTId table_id = free_list_.front();
-  while (!free_list_.empty() && !table_readers_cache_.empty()) {
-    table_id = free_list_.front();
-    auto iterator = table_readers_cache_.find(table_id);
-    free_list_.pop_front();
+  db::ValueType type = lru_table_item->GetTableReader()->GetValue(
+      key, txn_id, block_reader_cache, lru_table_item->GetTableReader(),
+      value, fill_cache);
+
+  lru_table_item->Unref();
+  return type;
+}
 
-    if (iterator != table_readers_cache_.end() &&
-        iterator->second->ref_count_.load() < 1) {
-      table_readers_cache_.erase(table_id);
+void TableReaderCache::MultiGetValue(
+    std::span<const std::string_view> keys, TxnId txn_id, SSTId table_id,
+    uint64_t file_size, int level,
+    const sstable::BlockReaderCache *const block_reader_cache,
+    std::span<db::GetStatus> statuses, bool fill_cache) const {
+  std::shared_ptr<LRUTableItem> lru_table_item = GetLRUTableItem(table_id);
+  if (!lru_table_item) {
+    // if table hadn't been in cache, create new table and load into cache
+    auto new_table_reader = CreateTableReader(table_id, file_size, level);
+    if (!new_table_reader) {
+      for (auto &status : statuses) {
+        if (status.type == db::ValueType::NOT_FOUND) {
+          status.type = db::ValueType::kTooManyOpenFiles;
+        }
+      }
+      return;
     }
+
+    lru_table_item = AddNewTableReaderThenGet(
+        table_id,
+        std::make_shared<LRUTableItem>(table_id, std::move(new_table_reader)),
+        true /*add_then_get*/);
   }
+
+  lru_table_item->GetTableReader()->MultiGetValue(
+      keys, txn_id, block_reader_cache, lru_table_item->GetTableReader(),
+      statuses, fill_cache);
+
+  lru_table_item->Unref();
 }
 
-void TableReaderCache::AddVictim(SSTId table_id) const {
-  std::scoped_lock rwlock(mutex_);
-  free_list_.push_back(table_id);
+PendingBlocks::~PendingBlocks() {
+  for (auto &lru_table_item : lru_table_items) {
+    lru_table_item->Unref();
+  }
 }
 
-void TableReaderCache::ExecuteBgThread() const {
-  while (!shutdown_) {
-    {
-      std::unique_lock rwlock_bg(bg_mutex_);
-      bg_cv_.wait(rwlock_bg, [this]() {
-        return this->shutdown_ || !this->item_cache_queue_.empty() ||
-               !this->victim_queue_.empty();
-      });
-
-      if (this->shutdown_ && this->item_cache_queue_.empty() &&
-          this->victim_queue_.empty()) {
-        return;
-      }
+void TableReaderCache::PrefetchBlocks(
+    std::string_view key, std::span<const std::pair<SSTId, uint64_t>> tables,
+    int level, const sstable::BlockReaderCache *const block_reader_cache) const {
+  std::unique_ptr<PendingBlocks> pending =
+      StartPrefetch(key, tables, level, block_reader_cache);
+  io::MultiRead(pending->reads.requests);
+  FinishPrefetch(pending.get(), block_reader_cache);
+}
 
-      while (!victim_queue_.empty()) {
-        std::shared_ptr<LRUTableItem> item = victim_queue_.front();
-        victim_queue_.pop();
+std::unique_ptr<PendingBlocks> TableReaderCache::StartPrefetch(
+    std::string_view key, std::span<const std::pair<SSTId, uint64_t>> tables,
+    int level,
+    const sstable::BlockReaderCache *const block_reader_cache) const {
+  assert(block_reader_cache);
+
+  auto pending = std::make_unique<PendingBlocks>();
+  std::vector<BlockToRead> blocks_to_read;
 
-        item->Unref();
+  for (const auto &[table_id, file_size] : tables) {
+    std::shared_ptr<LRUTableItem> lru_table_item = GetLRUTableItem(table_id);
+    if (!lru_table_item) {
+      auto new_table_reader = CreateTableReader(table_id, file_size, level);
+      if (!new_table_reader) {
+        continue;
       }
 
-      while (!item_cache_queue_.empty()) {
-        ItemCache item = item_cache_queue_.front();
-        item_cache_queue_.pop();
+      lru_table_item = AddNewTableReaderThenGet(
+          table_id,
+          std::make_shared<LRUTableItem>(table_id, std::move(new_table_reader)),
+          true /*add_then_get*/);
+    }
+    pending->lru_table_items.push_back(lru_table_item);
 
-        AddNewTableReaderThenGet(item.table_id, item.item, item.add_then_get);
-      }
+    const TableReader *table_reader = lru_table_item->GetTableReader();
+    auto block_info = table_reader->GetBlockOffsetAndSize(key);
+    if (!block_info) {
+      continue;
     }
-  }
-}
 
-db::GetStatus TableReaderCache::GetValue(
-    std::string_view key, TxnId txn_id, SSTId table_id, uint64_t file_size,
-    const sstable::BlockReaderCache *const block_reader_cache) const {
-  db::GetStatus status;
+    auto [block_offset, block_size] = *block_info;
+    if (block_reader_cache->Contains({table_id, block_offset})) {
+      continue;
+    }
 
-  std::shared_ptr<LRUTableItem> lru_table_item = GetLRUTableItem(table_id);
-  if (lru_table_item && lru_table_item->GetTableReader()) {
-    // if table reader had already been in cache
-    status = lru_table_item->table_reader_->GetValue(
-        key, txn_id, block_reader_cache, lru_table_item->GetTableReader());
-    {
-      std::scoped_lock rwlock_bg(bg_mutex_);
-      victim_queue_.push(lru_table_item);
-      bg_cv_.notify_one();
+    std::unique_ptr<BlockReader> block_reader =
+        block_reader_cache->GetFromSecondaryCache({table_id, block_offset},
+                                                  block_size);
+    if (block_reader) {
+      // No IO on table is needed
+      block_reader_cache->AddNewBlockReader({table_id, block_offset},
+                                            std::move(block_reader));
+      continue;
     }
 
-    return status;
+    pending->blocks_info.push_back({table_id, block_offset});
+    blocks_to_read.push_back({table_reader, block_offset, block_size});
   }
 
-  // if table hadn't been in cache, create new table and load into cache
-  std::string filename = db_->GetDBPath() + std::to_string(table_id) + ".sst";
+  PrepareBlockReads(blocks_to_read, &pending->reads);
 
-  // Create new table reader
-  auto new_table_reader = CreateAndSetupDataForTableReader(std::move(filename),
-                                                           table_id, file_size);
-  if (!new_table_reader) {
-    status.type = db::ValueType::kTooManyOpenFiles;
-    return status;
-  }
+  return pending;
+}
 
-  auto new_lru_table_item = std::make_shared<LRUTableItem>(
-      table_id, std::move(new_table_reader), this);
-  status = new_lru_table_item->GetTableReader()->GetValue(
-      key, txn_id, block_reader_cache, new_lru_table_item->GetTableReader());
+void TableReaderCache::FinishPrefetch(
+    PendingBlocks *pending,
+    const sstable::BlockReaderCache *const block_reader_cache) const {
+  assert(pending && block_reader_cache);
+
+  FinishBlockReads(&pending->reads);
+  std::vector<std::unique_ptr<BlockReader>> &block_readers =
+      pending->reads.block_readers;
+  for (size_t i = 0; i < block_readers.size(); i++) {
+    if (!block_readers[i]) {
+      continue;
+    }
 
-  {
-    std::scoped_lock rwlock_bg(bg_mutex_);
-    item_cache_queue_.push(
-        {table_id, new_lru_table_item, false /*need_to_get*/});
-    bg_cv_.notify_one();
+    block_reader_cache->AddNewBlockReaderThenGet(
+        pending->blocks_info[i],
+        std::make_shared<LRUBlockItem>(pending->blocks_info[i],
+                                       std::move(block_readers[i])),
+        false /*add_then_get*/);
   }
+}
 
-  return status;
+uint64_t TableReaderCache::TableIdHash::operator()(SSTId table_id) const {
+  // Table ids are sequential, spread them over the whole table
+  uint64_t hash = table_id * 0x9E3779B97F4A7C15ULL;
+  return hash ^ (hash >> 32);
 }
 
 } // namespace sstable
@@ -2,24 +2,21 @@
 #define SSTABLE_TABLE_READER_CACHE_H
 
 #include "common/macros.h"
+#include "db/pinnable_value.h"
 #include "db/status.h"
 #include "sstable/block_index.h"
+#include "sstable/clock_cache.h"
+#include "sstable/table_reader.h"
 
 // libC++
-#include <condition_variable>
-#include <list>
 #include <memory>
-#include <mutex>
-#include <queue>
-#include <shared_mutex>
+#include <span>
 #include <string_view>
-#include <thread>
-#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace kvs {
 
-class ThreadPool;
-
 namespace db {
 class DBImpl;
 } // namespace db
@@ -30,12 +27,37 @@ class BlockReaderCache;
 class LRUTableItem;
 class TableReader;
 
+// Blocks of a prefetch that have to be read from disk. Tables they belong to
+// are kept open until it is destroyed
+struct PendingBlocks {
+  PendingBlocks() = default;
+
+  ~PendingBlocks();
+
+  // No copy allowed
+  PendingBlocks(const PendingBlocks &) = delete;
+  PendingBlocks &operator=(PendingBlocks &) = delete;
+
+  // No move allowed
+  PendingBlocks(PendingBlocks &&) = delete;
+  PendingBlocks &operator=(PendingBlocks &&) = delete;
+
+  std::vector<std::shared_ptr<LRUTableItem>> lru_table_items;
+
+  // Cache key of each block in reads
+  std::vector<std::pair<SSTId, BlockOffset>> blocks_info;
+
+  BlockReads reads;
+};
+
+// Cache of opened tables. Each table is charged 1, so capacity is the max
+// number of tables kept open. Tables are added and evicted inline by the thread
+// that opens them, with TinyLFU admission(see ClockCache).
 class TableReaderCache {
 public:
-  TableReaderCache(const db::DBImpl *db,
-                   const kvs::ThreadPool *const thread_pool);
+  explicit TableReaderCache(const db::DBImpl *db);
 
-  ~TableReaderCache();
+  ~TableReaderCache() = default;
 
   // No copy allowed
   TableReaderCache(const TableReaderCache &) = delete;
@@ -45,56 +67,74 @@ public:
   TableReaderCache(TableReaderCache &&) = delete;
   TableReaderCache &operator=(TableReaderCache &&) = delete;
 
-  db::GetStatus
+  // level is the level table belongs to. It decides whether table is read
+  // through mmap. If fill_cache is false, blocks read from disk aren't added
+  // into block_reader_cache
+  db::ValueType
   GetValue(std::string_view key, TxnId txn_id, SSTId table_id,
-           uint64_t file_size,
-           const sstable::BlockReaderCache *const block_reader_cache) const;
-
+           uint64_t file_size, int level,
+           const sstable::BlockReaderCache *const block_reader_cache,
+           db::PinnableValue *value, bool fill_cache) const;
+
+  // Look up all keys in table. keys MUST be sorted in ascending order
+  void MultiGetValue(std::span<const std::string_view> keys, TxnId txn_id,
+                     SSTId table_id, uint64_t file_size, int level,
+                     const sstable::BlockReaderCache *const block_reader_cache,
+                     std::span<db::GetStatus> statuses, bool fill_cache) const;
+
+  // Read blocks that may contain key from all given tables(table id, file
+  // size) at level with a single batch of reads, then add them into
+  // block_reader_cache. So that tables can be probed one after another without
+  // waiting for disk each time
+  void PrefetchBlocks(
+      std::string_view key, std::span<const std::pair<SSTId, uint64_t>> tables,
+      int level,
+      const sstable::BlockReaderCache *const block_reader_cache) const;
+
+  // PrefetchBlocks() split in two, so that caller can issue reads itself
+  // (e.g. without blocking). StartPrefetch() adds blocks that need no IO into
+  // block_reader_cache, and returns reads of other ones. Once caller has
+  // issued pending->reads.requests, FinishPrefetch() adds their blocks into
+  // block_reader_cache
+  std::unique_ptr<PendingBlocks> StartPrefetch(
+      std::string_view key, std::span<const std::pair<SSTId, uint64_t>> tables,
+      int level,
+      const sstable::BlockReaderCache *const block_reader_cache) const;
+
+  void FinishPrefetch(
+      PendingBlocks *pending,
+      const sstable::BlockReaderCache *const block_reader_cache) const;
+
+  // Open table and load its index into cache, unless table is in cache
+  // already. Return false if table can't be opened
+  bool OpenTable(SSTId table_id, uint64_t file_size, int level) const;
+
+  // Return table that is in cache after insertion(which may have been added
+  // by another thread), with its ref count increased if add_then_get is set.
+  // If cache is full of tables in use, lru_table_item is returned without
+  // being cached
   std::shared_ptr<LRUTableItem>
   AddNewTableReaderThenGet(SSTId table_id,
                            std::shared_ptr<LRUTableItem> lru_table_item,
                            bool add_then_get) const;
 
+  // Return table with its ref count increased, caller MUST call Unref() once
+  // finished with it. nullptr if table isn't in cache
   std::shared_ptr<LRUTableItem> GetLRUTableItem(SSTId table_id) const;
 
-  void AddVictim(SSTId table_id) const;
-
 private:
-  // NOT THREAD-SAFE
-  void Evict() const;
+  // Open table that isn't in cache
+  std::unique_ptr<TableReader> CreateTableReader(SSTId table_id,
+                                                 uint64_t file_size,
+                                                 int level) const;
 
-  void ExecuteBgThread() const;
-
-  const int capacity_;
-
-  mutable std::unordered_map<SSTId, std::shared_ptr<LRUTableItem>>
-      table_readers_cache_;
-
-  mutable std::list<SSTId> free_list_;
-
-  mutable std::shared_mutex mutex_;
-
-  mutable std::mutex bg_mutex_;
-
-  mutable std::condition_variable bg_cv_;
-
-  struct ItemCache {
-    SSTId table_id;
-
-    std::shared_ptr<LRUTableItem> item;
-
-    bool add_then_get;
+  struct TableIdHash {
+    uint64_t operator()(SSTId table_id) const;
   };
 
-  mutable std::queue<std::shared_ptr<LRUTableItem>> victim_queue_;
-
-  mutable std::queue<ItemCache> item_cache_queue_;
-
-  std::atomic<bool> shutdown_;
-
   const db::DBImpl *const db_;
 
-  const ThreadPool *const thread_pool_;
+  ClockCache<SSTId, LRUTableItem, TableIdHash> table_readers_cache_;
 };
 
 } // namespace sstable
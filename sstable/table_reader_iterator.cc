@@ -1,9 +1,12 @@
 #include "sstable/table_reader_iterator.h"
 
+#include "io/base_file.h"
 #include "sstable/block_reader.h"
 #include "sstable/block_reader_cache.h"
 #include "sstable/block_reader_iterator.h"
+#include "sstable/block_index.h"
 #include "sstable/lru_block_item.h"
+#include "sstable/lru_index_item.h"
 #include "sstable/lru_table_item.h"
 #include "sstable/table_reader.h"
 
@@ -12,15 +15,30 @@ namespace kvs {
 namespace sstable {
 
 TableReaderIterator::TableReaderIterator(
-    const std::vector<std::unique_ptr<BlockReaderCache>> &block_reader_cache,
-    std::shared_ptr<LRUTableItem> lru_table_item)
+    const BlockReaderCache *const block_reader_cache,
+    std::shared_ptr<LRUTableItem> lru_table_item, bool for_compaction)
     : block_reader_iterator_(nullptr), current_block_offset_index_(0),
-      lru_table_item_(lru_table_item), block_reader_cache_(block_reader_cache) {
+      lru_table_item_(lru_table_item), block_reader_cache_(block_reader_cache),
+      prefetch_buffer_(for_compaction ? io::kDefaultCompactionReadaheadSize
+                                      : io::kDefaultInitialReadaheadSize,
+                       for_compaction ? io::kDefaultCompactionReadaheadSize
+                                      : io::kDefaultMaxReadaheadSize) {
   table_reader_ = lru_table_item_->GetTableReader();
   assert(table_reader_);
+  lru_index_item_ = table_reader_->GetIndex();
+
+  if (for_compaction) {
+    // Table is read from begin to end once, then deleted
+    table_reader_->read_file_object_->Hint(io::AccessPattern::kSequential);
+  }
 }
 
-TableReaderIterator::~TableReaderIterator() { lru_table_item_->Unref(); }
+TableReaderIterator::~TableReaderIterator() {
+  if (lru_index_item_) {
+    lru_index_item_->Unref();
+  }
+  lru_table_item_->Unref();
+}
 
 std::string_view TableReaderIterator::GetKey() {
   return block_reader_iterator_->GetKey();
@@ -39,8 +57,9 @@ TxnId TableReaderIterator::GetTransactionId() {
 }
 
 bool TableReaderIterator::IsValid() {
-  return 0 <= current_block_offset_index_ &&
-         current_block_offset_index_ < table_reader_->block_index_.size();
+  return lru_index_item_ && 0 <= current_block_offset_index_ &&
+         current_block_offset_index_ <
+             lru_index_item_->GetBlockIndex().size();
 }
 
 void TableReaderIterator::Next() {
@@ -90,11 +109,21 @@ void TableReaderIterator::Prev() {
 }
 
 void TableReaderIterator::Seek(std::string_view key) {
+  if (!lru_index_item_) {
+    return;
+  }
+
   // Find the block that have smallest largest key that >= key
-  CreateNewBlockReaderIterator(table_reader_->GetBlockOffsetAndSize(key));
+  current_block_offset_index_ =
+      TableReader::FindBlock(lru_index_item_->GetBlockIndex(), key);
+  CreateNewBlockReaderIterator(GetBlockOffsetAndSizeBaseOnIndex());
 }
 
 void TableReaderIterator::SeekToFirst() {
+  if (!lru_index_item_) {
+    return;
+  }
+
   current_block_offset_index_ = 0;
 
   CreateNewBlockReaderIterator(GetBlockOffsetAndSizeBaseOnIndex());
@@ -102,7 +131,11 @@ void TableReaderIterator::SeekToFirst() {
 }
 
 void TableReaderIterator::SeekToLast() {
-  current_block_offset_index_ = table_reader_->block_index_.size() - 1;
+  if (!lru_index_item_) {
+    return;
+  }
+
+  current_block_offset_index_ = lru_index_item_->GetBlockIndex().size() - 1;
 
   CreateNewBlockReaderIterator(GetBlockOffsetAndSizeBaseOnIndex());
   block_reader_iterator_->SeekToLast();
@@ -110,11 +143,10 @@ void TableReaderIterator::SeekToLast() {
 
 std::pair<BlockOffset, BlockSize>
 TableReaderIterator::GetBlockOffsetAndSizeBaseOnIndex() {
-  BlockOffset block_offset =
-      table_reader_->block_index_[current_block_offset_index_]
-          .GetBlockStartOffset();
-  BlockSize block_size =
-      table_reader_->block_index_[current_block_offset_index_].GetBlockSize();
+  const BlockIndex &block_index =
+      lru_index_item_->GetBlockIndex()[current_block_offset_index_];
+  BlockOffset block_offset = block_index.GetBlockStartOffset();
+  BlockSize block_size = block_index.GetBlockSize();
 
   return {block_offset, block_size};
 }
@@ -122,28 +154,32 @@ TableReaderIterator::GetBlockOffsetAndSizeBaseOnIndex() {
 void TableReaderIterator::CreateNewBlockReaderIterator(
     std::pair<BlockOffset, BlockSize> block_info) {
   SSTId table_id = table_reader_->table_id_;
-  for (int i = 0; i < block_reader_cache_.size(); i++) {
+  std::unique_ptr<BlockReader> new_block_reader;
+  if (block_reader_cache_) {
     // Look up block in cache
     std::shared_ptr<LRUBlockItem> block_reader =
-        block_reader_cache_[i]->GetLRUBlockItem({table_id, block_info.first});
+        block_reader_cache_->GetLRUBlockItem({table_id, block_info.first});
     if (block_reader) {
       // if had already been in cache
       block_reader_iterator_.reset(new BlockReaderIterator(block_reader));
       return;
     }
+
+    new_block_reader = block_reader_cache_->GetFromSecondaryCache(
+        {table_id, block_info.first}, block_info.second);
   }
 
-  // If not, create new blockreader and load data from disk
-  std::unique_ptr<BlockReader> new_block_reader =
-      table_reader_->CreateAndSetupDataForBlockReader(block_info.first,
-                                                      block_info.second);
+  // If not, create new blockreader and load data through prefetch buffer
+  if (!new_block_reader) {
+    new_block_reader = table_reader_->CreateAndSetupDataForBlockReader(
+        block_info.first, block_info.second, &prefetch_buffer_);
+  }
   if (!new_block_reader) {
     return;
   }
 
   auto new_lru_block_item = std::make_shared<LRUBlockItem>(
-      std::make_pair(table_id, block_info.first), std::move(new_block_reader),
-      nullptr /*BlockReaderCache*/);
+      std::make_pair(table_id, block_info.first), std::move(new_block_reader));
 
   block_reader_iterator_.reset(new BlockReaderIterator(new_lru_block_item));
 }
@@ -3,10 +3,12 @@
 
 #include "common/base_iterator.h"
 #include "common/macros.h"
+#include "io/prefetch_buffer.h"
 
 // libC++
 #include <cassert>
 #include <memory>
+#include <vector>
 
 namespace kvs {
 
@@ -15,14 +17,16 @@ namespace sstable {
 class BlockReaderCache;
 class BlockReaderIterator;
 class LRUBlockItem;
+class LRUIndexItem;
 class LRUTableItem;
 class TableReader;
 
 class TableReaderIterator : public kvs::BaseIterator {
 public:
   TableReaderIterator(
-      const std::vector<std::unique_ptr<BlockReaderCache>> &block_reader_cache,
-      std::shared_ptr<LRUTableItem> lru_table_item);
+      const BlockReaderCache *const block_reader_cache,
+      std::shared_ptr<LRUTableItem> lru_table_item,
+      bool for_compaction = false);
 
   ~TableReaderIterator();
 
@@ -65,13 +69,22 @@ private:
 
   std::unique_ptr<BlockReaderIterator> block_reader_iterator_;
 
-  const std::vector<std::unique_ptr<BlockReaderCache>> &block_reader_cache_;
+  // nullptr if block cache is disabled
+  const BlockReaderCache *const block_reader_cache_;
 
   std::shared_ptr<LRUTableItem> lru_table_item_;
 
   const TableReader *table_reader_;
 
+  // Index of table is held for as long as iterator is alive, so that it can't
+  // be evicted from block cache. nullptr if index can't be read
+  std::shared_ptr<LRUIndexItem> lru_index_item_;
+
   std::vector<std::shared_ptr<LRUBlockItem>> list_lru_blocks_;
+
+  // Blocks that aren't in cache are read through it. Readahead grows on
+  // sequential access, except for compaction that uses a fixed large one
+  io::PrefetchBuffer prefetch_buffer_;
 };
 
 } // namespace sstable
@@ -10,12 +10,16 @@
 #include "sstable/block_builder.h"
 #include "sstable/block_index.h"
 #include "sstable/block_reader.h"
+#include "sstable/block_reader_cache.h"
 #include "sstable/block_reader_iterator.h"
 #include "sstable/lru_block_item.h"
+#include "sstable/lru_index_item.h"
+#include "sstable/secondary_block_cache.h"
 #include "sstable/table_builder.h"
 #include "sstable/table_reader.h"
 
 // libC++
+#include <algorithm>
 #include <cmath>
 #include <filesystem>
 #include <memory>
@@ -40,7 +44,8 @@ bool CompareVersionFilesWithDirectoryFiles(const db::DBImpl *db) {
     num_sst_files_info += sst_file_info.size();
   }
 
-  return (num_sst_files == num_sst_files_info + 1 /*include manifest file*/)
+  return (num_sst_files ==
+          num_sst_files_info + 2 /*include MANIFEST and CURRENT files*/)
              ? true
              : false;
 }
@@ -186,6 +191,108 @@ TEST(BlockTest, EdgeCasesEncode) {
   EXPECT_TRUE(std::ranges::equal(block->GetExtraView(), extra_encoded));
 }
 
+TEST(BlockTest, ParseDataEntries) {
+  struct Entry {
+    std::string key;
+    std::string value;
+    TxnId txn_id;
+    db::ValueType type;
+  };
+
+  // Sorted by (key asc, txn_id desc), as blocks are written
+  const std::vector<Entry> entries = {
+      {"apple", "value2", 20, db::ValueType::PUT},
+      {"apple", "value1", 10, db::ValueType::PUT},
+      {"banana", "", 15, db::ValueType::DELETED},
+      {"cherry", "", 12, db::ValueType::PUT},
+      {"grape", "green", 30, db::ValueType::PUT},
+  };
+
+  sstable::BlockBuilder block;
+  for (const auto &entry : entries) {
+    // DELETED entry has no value at all, PUT entry may have an empty one
+    block.AddEntry(entry.key,
+                   entry.type == db::ValueType::PUT ? entry.value
+                                                    : std::string_view(),
+                   entry.txn_id, entry.type);
+  }
+  block.EncodeExtraInfo();
+
+  // Block as it is read from table
+  auto read_block = [&block]() {
+    auto block_reader_data = std::make_unique<sstable::BlockReaderData>(
+        block.GetDataView().size() + block.GetOffsetView().size() +
+        block.GetExtraView().size());
+    auto out = block_reader_data->buffer.begin();
+    out = std::ranges::copy(block.GetDataView(), out).out;
+    out = std::ranges::copy(block.GetOffsetView(), out).out;
+    std::ranges::copy(block.GetExtraView(), out);
+    return sstable::SetupDataForBlockReader(std::move(block_reader_data));
+  };
+
+  std::unique_ptr<sstable::BlockReader> block_reader = read_block();
+  ASSERT_TRUE(block_reader);
+
+  // Every field of every entry is decoded
+  auto iterator = std::make_unique<sstable::BlockReaderIterator>(
+      std::make_shared<sstable::LRUBlockItem>(std::make_pair(0, 0),
+                                              read_block()));
+  size_t index = 0;
+  for (iterator->SeekToFirst(); iterator->IsValid(); iterator->Next()) {
+    ASSERT_LT(index, entries.size());
+    EXPECT_EQ(iterator->GetKey(), entries[index].key);
+    EXPECT_EQ(iterator->GetValue(), entries[index].value);
+    EXPECT_EQ(iterator->GetType(), entries[index].type);
+    EXPECT_EQ(iterator->GetTransactionId(), entries[index].txn_id);
+    index++;
+  }
+  EXPECT_EQ(index, entries.size());
+
+  std::string_view value;
+
+  // First entry of block
+  EXPECT_EQ(block_reader->GetValue("apple", kMaxTxnId, &value),
+            db::ValueType::PUT);
+  EXPECT_EQ(value, "value2");
+  EXPECT_EQ(block_reader->GetValue("apple", 15, &value), db::ValueType::PUT);
+  EXPECT_EQ(value, "value1");
+  EXPECT_EQ(block_reader->GetValue("apple", 5, &value),
+            db::ValueType::NOT_FOUND);
+
+  EXPECT_EQ(block_reader->GetValue("banana", kMaxTxnId, &value),
+            db::ValueType::DELETED);
+  EXPECT_EQ(block_reader->GetValue("cherry", kMaxTxnId, &value),
+            db::ValueType::PUT);
+  EXPECT_TRUE(value.empty());
+
+  // Last entry of block
+  EXPECT_EQ(block_reader->GetValue("grape", kMaxTxnId, &value),
+            db::ValueType::PUT);
+  EXPECT_EQ(value, "green");
+  EXPECT_EQ(block_reader->GetValue("grape", 29, &value),
+            db::ValueType::NOT_FOUND);
+
+  // Misses before first entry, between entries and after last entry
+  for (std::string_view key : {"aaa", "apples", "blueberry", "zebra"}) {
+    EXPECT_EQ(block_reader->GetValue(key, kMaxTxnId, &value),
+              db::ValueType::NOT_FOUND);
+  }
+
+  const std::vector<std::string_view> keys = {"aaa",    "apple", "blueberry",
+                                              "cherry", "grape", "zebra"};
+  std::vector<db::GetStatus> statuses(keys.size());
+  block_reader->MultiGetValue(keys, kMaxTxnId, statuses);
+  EXPECT_EQ(statuses[0].type, db::ValueType::NOT_FOUND);
+  EXPECT_EQ(statuses[1].type, db::ValueType::PUT);
+  EXPECT_EQ(statuses[1].value.value(), "value2");
+  EXPECT_EQ(statuses[2].type, db::ValueType::NOT_FOUND);
+  EXPECT_EQ(statuses[3].type, db::ValueType::PUT);
+  EXPECT_EQ(statuses[3].value.value(), "");
+  EXPECT_EQ(statuses[4].type, db::ValueType::PUT);
+  EXPECT_EQ(statuses[4].value.value(), "green");
+  EXPECT_EQ(statuses[5].type, db::ValueType::NOT_FOUND);
+}
+
 TEST(BlockTest, BlockReaderIterator) {
   auto db = std::make_unique<db::DBImpl>(true /*is_testing*/);
   db->LoadDB("test");
@@ -224,10 +331,8 @@ TEST(BlockTest, BlockReaderIterator) {
   std::this_thread::sleep_for(std::chrono::milliseconds(1000));
   EXPECT_TRUE(CompareVersionFilesWithDirectoryFiles(db.get()));
 
-  const std::vector<std::vector<std::shared_ptr<db::SSTMetadata>>>
-      sst_metadata = db->GetVersionManager()
-                         ->GetLatestVersion()
-                         ->GetImmutableSSTMetadata();
+  const std::vector<db::LevelFiles> sst_metadata =
+      db->GetVersionManager()->GetLatestVersion()->GetImmutableSSTMetadata();
   EXPECT_EQ(sst_metadata.size(), db->GetConfig()->GetSSTNumLvels());
 
   for (int level = 0; level < sst_metadata.size(); level++) {
@@ -257,12 +362,8 @@ TEST(BlockTest, BlockReaderIterator) {
         table_reader->CreateAndSetupDataForBlockReader(block_offset,
                                                        block_size);
 
-    const std::vector<std::unique_ptr<sstable::BlockReaderCache>> &block_cache =
-        db->GetBlockReaderCache();
-
     auto lru_block_item = std::make_shared<sstable::LRUBlockItem>(
-        std::make_pair(block_offset, block_size), std::move(block_reader),
-        block_cache[0].get() /*Just choose random blockcache*/);
+        std::make_pair(block_offset, block_size), std::move(block_reader));
 
     auto iterator =
         std::make_unique<sstable::BlockReaderIterator>(lru_block_item);
@@ -307,4 +408,269 @@ TEST(BlockTest, BlockReaderIterator) {
   ClearAllSstFiles(db.get());
 }
 
+TEST(BlockTest, BlockCacheByteCapacity) {
+  auto db = std::make_unique<db::DBImpl>(true /*is_testing*/);
+  db->LoadDB("test");
+
+  const int nums_elem = 100000;
+  for (int i = 0; i < nums_elem; i++) {
+    db->Put("key" + std::to_string(i), "value" + std::to_string(i));
+  }
+  db->ForceFlushMemTable();
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+
+  const auto &sst_metadata = db->GetVersionManager()
+                                 ->GetLatestVersion()
+                                 ->GetImmutableSSTMetadata();
+  ASSERT_EQ(sst_metadata[0].size(), 1);
+  const SSTId table_id = sst_metadata[0][0]->table_id;
+
+  std::unique_ptr<sstable::TableReader> table_reader =
+      sstable::CreateAndSetupDataForTableReader(
+          db->GetDBPath() + std::to_string(table_id) + ".sst", table_id,
+          sst_metadata[0][0]->file_size);
+  ASSERT_TRUE(table_reader);
+  const std::vector<sstable::BlockIndex> &block_index =
+      table_reader->GetBlockIndex();
+  ASSERT_GT(block_index.size(), 100);
+
+  std::vector<std::shared_ptr<sstable::LRUBlockItem>> items;
+  size_t total_charge = 0;
+  for (const auto &block : block_index) {
+    std::pair<SSTId, BlockOffset> block_info{table_id,
+                                             block.GetBlockStartOffset()};
+    auto block_reader = table_reader->CreateAndSetupDataForBlockReader(
+        block.GetBlockStartOffset(), block.GetBlockSize());
+    ASSERT_TRUE(block_reader);
+    items.push_back(std::make_shared<sstable::LRUBlockItem>(
+        block_info, std::move(block_reader)));
+    total_charge += items.back()->GetCharge();
+  }
+
+  const int total_shards = 4;
+  sstable::BlockReaderCache cache(total_charge / 2, total_shards,
+                                  total_charge / block_index.size(),
+                                  0.1 /*high_priority_ratio*/);
+
+  // First block is in use, so it can't be evicted
+  const std::pair<SSTId, BlockOffset> pinned_block{
+      table_id, block_index[0].GetBlockStartOffset()};
+  std::shared_ptr<sstable::LRUBlockItem> pinned_item =
+      cache.AddNewBlockReaderThenGet(pinned_block, items[0],
+                                     true /*add_then_get*/);
+  ASSERT_TRUE(pinned_item);
+
+  for (size_t i = 1; i < block_index.size(); i++) {
+    cache.AddNewBlockReaderThenGet(
+        {table_id, block_index[i].GetBlockStartOffset()}, items[i],
+        false /*add_then_get*/);
+  }
+
+  // Usage never goes above capacity, no matter how many blocks are added
+  EXPECT_GT(cache.GetUsage(), 0);
+  EXPECT_LE(cache.GetUsage(), cache.GetCapacity());
+  EXPECT_TRUE(cache.Contains(pinned_block));
+
+  // Blocks are found with a single lookup, and the same block is always in the
+  // same shard
+  size_t total_cached_blocks = 0;
+  for (size_t i = 0; i < block_index.size(); i++) {
+    const std::pair<SSTId, BlockOffset> block_info{
+        table_id, block_index[i].GetBlockStartOffset()};
+    if (!cache.Contains(block_info)) {
+      continue;
+    }
+
+    total_cached_blocks++;
+    std::shared_ptr<sstable::LRUBlockItem> item =
+        cache.GetLRUBlockItem(block_info);
+    ASSERT_TRUE(item);
+    EXPECT_EQ(item.get(), items[i].get());
+  }
+  EXPECT_GT(total_cached_blocks, 0);
+  EXPECT_LT(total_cached_blocks, block_index.size());
+
+  ClearAllSstFiles(db.get());
+}
+
+TEST(BlockTest, IndexInHighPriorityPool) {
+  auto db = std::make_unique<db::DBImpl>(true /*is_testing*/);
+  db->LoadDB("test");
+
+  const int nums_elem = 100000;
+  for (int i = 0; i < nums_elem; i++) {
+    db->Put("key" + std::to_string(i), "value" + std::to_string(i));
+  }
+  db->ForceFlushMemTable();
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+
+  const auto &sst_metadata = db->GetVersionManager()
+                                 ->GetLatestVersion()
+                                 ->GetImmutableSSTMetadata();
+  ASSERT_EQ(sst_metadata[0].size(), 1);
+  const SSTId table_id = sst_metadata[0][0]->table_id;
+  const uint64_t file_size = sst_metadata[0][0]->file_size;
+  const std::string filename =
+      db->GetDBPath() + std::to_string(table_id) + ".sst";
+
+  sstable::BlockReaderCache cache(64 * 1024 * 1024 /*capacity*/,
+                                  4 /*total_shards*/, 4096,
+                                  0.1 /*high_priority_ratio*/);
+
+  auto check_values = [&](const sstable::TableReader *table_reader) {
+    for (int i = 0; i < nums_elem; i += 997) {
+      db::PinnableValue value;
+      EXPECT_EQ(table_reader->GetValue("key" + std::to_string(i), kMaxTxnId,
+                                       &cache, table_reader, &value,
+                                       true /*fill_cache*/),
+                db::ValueType::PUT);
+      EXPECT_EQ(value.GetView(), "value" + std::to_string(i));
+    }
+  };
+
+  {
+    // Index isn't pinned, table holds no ref on it once lookups are done
+    std::unique_ptr<sstable::TableReader> table_reader =
+        sstable::CreateAndSetupDataForTableReader(
+            std::string(filename), table_id, file_size, false /*use_mmap*/,
+            &cache, false /*pin_index*/);
+    ASSERT_TRUE(table_reader);
+    EXPECT_GT(cache.GetHighPriorityUsage(), 0);
+    EXPECT_LE(cache.GetHighPriorityUsage(), cache.GetUsage());
+
+    check_values(table_reader.get());
+
+    std::shared_ptr<sstable::LRUIndexItem> lru_index_item =
+        cache.GetLRUIndexItem(table_id);
+    ASSERT_TRUE(lru_index_item);
+    EXPECT_EQ(lru_index_item->GetRefCount(), 1);
+    lru_index_item->Unref();
+  }
+
+  {
+    // Index is pinned for as long as table is open
+    std::unique_ptr<sstable::TableReader> table_reader =
+        sstable::CreateAndSetupDataForTableReader(
+            std::string(filename), table_id, file_size, false /*use_mmap*/,
+            &cache, true /*pin_index*/);
+    ASSERT_TRUE(table_reader);
+    EXPECT_GT(table_reader->GetBlockIndex().size(), 0);
+
+    std::shared_ptr<sstable::LRUIndexItem> lru_index_item =
+        cache.GetLRUIndexItem(table_id);
+    ASSERT_TRUE(lru_index_item);
+    EXPECT_EQ(lru_index_item->GetRefCount(), 2);
+    lru_index_item->Unref();
+
+    check_values(table_reader.get());
+  }
+
+  {
+    // High priority pool can't hold any index, it is read from file on each
+    // lookup
+    sstable::BlockReaderCache no_index_cache(4096 /*capacity*/,
+                                             1 /*total_shards*/, 4096,
+                                             0 /*high_priority_ratio*/);
+    std::unique_ptr<sstable::TableReader> table_reader =
+        sstable::CreateAndSetupDataForTableReader(
+            std::string(filename), table_id, file_size, false /*use_mmap*/,
+            &no_index_cache, false /*pin_index*/);
+    ASSERT_TRUE(table_reader);
+    EXPECT_EQ(no_index_cache.GetHighPriorityUsage(), 0);
+    EXPECT_FALSE(no_index_cache.GetLRUIndexItem(table_id));
+
+    check_values(table_reader.get());
+  }
+
+  ClearAllSstFiles(db.get());
+}
+
+TEST(BlockTest, SecondaryBlockCache) {
+  auto db = std::make_unique<db::DBImpl>(true /*is_testing*/);
+  db->LoadDB("test");
+
+  const int nums_elem = 100000;
+  for (int i = 0; i < nums_elem; i++) {
+    db->Put("key" + std::to_string(i), "value" + std::to_string(i));
+  }
+  db->ForceFlushMemTable();
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+
+  const auto &sst_metadata = db->GetVersionManager()
+                                 ->GetLatestVersion()
+                                 ->GetImmutableSSTMetadata();
+  ASSERT_EQ(sst_metadata[0].size(), 1);
+  const SSTId table_id = sst_metadata[0][0]->table_id;
+
+  std::unique_ptr<sstable::TableReader> table_reader =
+      sstable::CreateAndSetupDataForTableReader(
+          db->GetDBPath() + std::to_string(table_id) + ".sst", table_id,
+          sst_metadata[0][0]->file_size);
+  ASSERT_TRUE(table_reader);
+  const std::vector<sstable::BlockIndex> &block_index =
+      table_reader->GetBlockIndex();
+  ASSERT_GT(block_index.size(), 100);
+
+  // Memory only holds a few blocks, secondary cache holds half of them
+  const size_t block_size = block_index[0].GetBlockSize();
+  const size_t secondary_capacity = block_size * block_index.size() / 2;
+  std::unique_ptr<sstable::SecondaryBlockCache> secondary_cache =
+      sstable::CreateSecondaryBlockCache(db->GetDBPath() + "secondary.cache",
+                                         secondary_capacity);
+  ASSERT_TRUE(secondary_cache);
+  sstable::BlockReaderCache cache(block_size * 8 /*capacity*/,
+                                  1 /*total_shards*/, block_size,
+                                  0 /*high_priority_ratio*/,
+                                  std::move(secondary_cache));
+  const sstable::SecondaryBlockCache *secondary = cache.GetSecondaryCache();
+  ASSERT_TRUE(secondary);
+
+  auto check_values = [&]() {
+    for (int i = 0; i < nums_elem; i += 101) {
+      db::PinnableValue value;
+      EXPECT_EQ(table_reader->GetValue("key" + std::to_string(i), kMaxTxnId,
+                                       &cache, table_reader.get(), &value,
+                                       true /*fill_cache*/),
+                db::ValueType::PUT);
+      EXPECT_EQ(value.GetView(), "value" + std::to_string(i));
+    }
+  };
+
+  // Blocks evicted from memory are written into secondary cache
+  check_values();
+  secondary->WaitForPendingWrites();
+  EXPECT_GT(secondary->GetUsage(), 0);
+  EXPECT_LE(secondary->GetUsage(), secondary->GetCapacity());
+
+  // Blocks in secondary cache are the same as blocks in table
+  size_t total_secondary_blocks = 0;
+  for (const auto &block : block_index) {
+    std::unique_ptr<sstable::BlockReader> block_reader =
+        cache.GetFromSecondaryCache({table_id, block.GetBlockStartOffset()},
+                                    block.GetBlockSize());
+    if (!block_reader) {
+      continue;
+    }
+
+    total_secondary_blocks++;
+    std::unique_ptr<sstable::BlockReader> table_block_reader =
+        table_reader->CreateAndSetupDataForBlockReader(
+            block.GetBlockStartOffset(), block.GetBlockSize());
+    ASSERT_TRUE(table_block_reader);
+    EXPECT_TRUE(std::ranges::equal(block_reader->GetData(),
+                                   table_block_reader->GetData()));
+  }
+  EXPECT_GT(total_secondary_blocks, 0);
+
+  // Once file is full, oldest blocks are overwritten
+  for (int round = 0; round < 3; round++) {
+    check_values();
+  }
+  secondary->WaitForPendingWrites();
+  EXPECT_LE(secondary->GetUsage(), secondary->GetCapacity());
+  check_values();
+
+  ClearAllSstFiles(db.get());
+}
+
 } // namespace kvs
\ No newline at end of file
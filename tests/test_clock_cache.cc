@@ -0,0 +1,280 @@
+#include <gtest/gtest.h>
+
+#include "sstable/clock_cache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace kvs {
+
+namespace sstable {
+
+namespace {
+
+class TestItem {
+public:
+  explicit TestItem(int value) : ref_count_(0), value_(value) {}
+
+  void IncRef() const { ref_count_.fetch_add(1); }
+
+  void Unref() const { ref_count_.fetch_sub(1); }
+
+  uint64_t GetRefCount() const { return ref_count_.load(); }
+
+  int GetValue() const { return value_; }
+
+private:
+  mutable std::atomic<int64_t> ref_count_;
+
+  int value_;
+};
+
+struct IntHash {
+  uint64_t operator()(int key) const {
+    return static_cast<uint64_t>(key) * 0x9E3779B97F4A7C15ULL;
+  }
+};
+
+using TestCache = ClockCache<int, TestItem, IntHash>;
+
+} // namespace
+
+TEST(ClockCacheTest, BasicOperations) {
+  TestCache cache(100 /*capacity*/, 100 /*estimated_entries*/,
+                  false /*admission*/);
+
+  EXPECT_FALSE(cache.Lookup(1));
+  EXPECT_FALSE(cache.Contains(1));
+
+  std::shared_ptr<TestItem> item =
+      cache.Insert(1, std::make_shared<TestItem>(10), 1 /*charge*/);
+  ASSERT_TRUE(item);
+  EXPECT_EQ(item->GetRefCount(), 1);
+  item->Unref();
+
+  EXPECT_TRUE(cache.Contains(1));
+  EXPECT_EQ(cache.GetUsage(), 1);
+
+  // Inserting an existing key returns the cached item
+  std::shared_ptr<TestItem> existing_item =
+      cache.Insert(1, std::make_shared<TestItem>(20), 1 /*charge*/);
+  ASSERT_TRUE(existing_item);
+  EXPECT_EQ(existing_item->GetValue(), 10);
+  EXPECT_EQ(cache.GetUsage(), 1);
+  existing_item->Unref();
+
+  std::shared_ptr<TestItem> found_item = cache.Lookup(1);
+  ASSERT_TRUE(found_item);
+  EXPECT_EQ(found_item->GetValue(), 10);
+  EXPECT_EQ(found_item->GetRefCount(), 1);
+  found_item->Unref();
+
+  // Item larger than whole cache is rejected without evicting anything
+  EXPECT_FALSE(cache.Insert(2, std::make_shared<TestItem>(30), 101));
+  EXPECT_TRUE(cache.Contains(1));
+  EXPECT_EQ(cache.GetUsage(), 1);
+}
+
+TEST(ClockCacheTest, EvictUnreferencedItems) {
+  const int capacity = 64;
+  TestCache cache(capacity, capacity, false /*admission*/);
+
+  // Item in use is never evicted
+  std::shared_ptr<TestItem> pinned_item =
+      cache.Insert(0, std::make_shared<TestItem>(0), 1 /*charge*/);
+  ASSERT_TRUE(pinned_item);
+
+  for (int i = 1; i < capacity * 10; i++) {
+    std::shared_ptr<TestItem> item =
+        cache.Insert(i, std::make_shared<TestItem>(i), 1 /*charge*/);
+    ASSERT_TRUE(item);
+    item->Unref();
+    EXPECT_LE(cache.GetUsage(), capacity);
+  }
+
+  EXPECT_TRUE(cache.Contains(0));
+  EXPECT_TRUE(cache.Contains(capacity * 10 - 1));
+  pinned_item->Unref();
+
+  // Cache is full of items in use, new item can't be inserted
+  TestCache small_cache(2 /*capacity*/, 2 /*estimated_entries*/,
+                        false /*admission*/);
+  auto item1 = small_cache.Insert(1, std::make_shared<TestItem>(1), 1);
+  auto item2 = small_cache.Insert(2, std::make_shared<TestItem>(2), 1);
+  ASSERT_TRUE(item1 && item2);
+  EXPECT_FALSE(small_cache.Insert(3, std::make_shared<TestItem>(3), 1));
+
+  // Once released, item can be evicted
+  item1->Unref();
+  auto item3 = small_cache.Insert(3, std::make_shared<TestItem>(3), 1);
+  ASSERT_TRUE(item3);
+  EXPECT_FALSE(small_cache.Contains(1));
+  EXPECT_TRUE(small_cache.Contains(2));
+  item2->Unref();
+  item3->Unref();
+}
+
+TEST(ClockCacheTest, ScanResistantAdmission) {
+  const int capacity = 64;
+  const int total_hot_keys = capacity / 2;
+  TestCache cache(capacity, capacity, true /*admission*/);
+
+  auto get = [&cache](int key) {
+    std::shared_ptr<TestItem> item = cache.Lookup(key);
+    if (!item) {
+      item = cache.Insert(key, std::make_shared<TestItem>(key), 1 /*charge*/);
+    }
+
+    if (item) {
+      item->Unref();
+    }
+  };
+
+  // Hot keys are read again and again
+  for (int round = 0; round < 10; round++) {
+    for (int key = 0; key < total_hot_keys; key++) {
+      get(key);
+    }
+  }
+
+  // Each key of scan is read once
+  for (int key = capacity; key < capacity * 4; key++) {
+    get(key);
+    EXPECT_LE(cache.GetUsage(), capacity);
+  }
+
+  // Frequencies are estimated, so a few hot keys may lose to scan keys whose
+  // counters collide with theirs
+  int total_hot_keys_kept = 0;
+  for (int key = 0; key < total_hot_keys; key++) {
+    total_hot_keys_kept += cache.Contains(key);
+  }
+  EXPECT_GE(total_hot_keys_kept, total_hot_keys * 9 / 10);
+
+  // Without admission, scan flushes hot keys out of cache
+  TestCache lru_cache(capacity, capacity, false /*admission*/);
+  for (int key = 0; key < total_hot_keys; key++) {
+    lru_cache.Insert(key, std::make_shared<TestItem>(key), 1)->Unref();
+  }
+  for (int key = capacity; key < capacity * 4; key++) {
+    lru_cache.Insert(key, std::make_shared<TestItem>(key), 1)->Unref();
+  }
+
+  int total_hot_keys_left = 0;
+  for (int key = 0; key < total_hot_keys; key++) {
+    total_hot_keys_left += lru_cache.Contains(key);
+  }
+  EXPECT_LT(total_hot_keys_left, total_hot_keys);
+}
+
+TEST(ClockCacheTest, ContainsIsNotCountedAsAccess) {
+  const int capacity = 16;
+  TestCache cache(capacity, capacity, true /*admission*/);
+  for (int key = 0; key < capacity; key++) {
+    cache.Insert(key, std::make_shared<TestItem>(key), 1 /*charge*/)->Unref();
+    cache.Lookup(key)->Unref();
+  }
+
+  // Probing a missing key many times doesn't make it more valuable than items
+  // that are really read
+  const int cold_key = capacity;
+  for (int i = 0; i < 20; i++) {
+    EXPECT_FALSE(cache.Contains(cold_key));
+  }
+  EXPECT_FALSE(
+      cache.Insert(cold_key, std::make_shared<TestItem>(cold_key), 1));
+
+  for (int key = 0; key < capacity; key++) {
+    EXPECT_TRUE(cache.Contains(key));
+  }
+}
+
+TEST(ClockCacheTest, EvictCallback) {
+  const int capacity = 16;
+  std::vector<int> evicted_keys;
+  TestCache cache(capacity, capacity, false /*admission*/,
+                  [&evicted_keys](const int &key,
+                                  std::shared_ptr<TestItem> item) {
+                    EXPECT_EQ(item->GetValue(), key);
+                    EXPECT_EQ(item->GetRefCount(), 0);
+                    evicted_keys.push_back(key);
+                  });
+
+  for (int i = 0; i < capacity * 4; i++) {
+    cache.Insert(i, std::make_shared<TestItem>(i), 1 /*charge*/)->Unref();
+  }
+
+  // Each item that doesn't fit anymore is handed to callback once
+  EXPECT_EQ(evicted_keys.size(), capacity * 3);
+  for (int key : evicted_keys) {
+    EXPECT_FALSE(cache.Contains(key));
+  }
+}
+
+TEST(ClockCacheTest, ForEach) {
+  const int capacity = 16;
+  TestCache cache(capacity, capacity, false /*admission*/);
+  for (int i = 0; i < capacity; i++) {
+    cache.Insert(i, std::make_shared<TestItem>(i), 1 /*charge*/)->Unref();
+  }
+
+  std::vector<int> keys;
+  cache.ForEach([&keys](const int &key, const std::shared_ptr<TestItem> &item) {
+    EXPECT_EQ(item->GetValue(), key);
+    keys.push_back(key);
+  });
+
+  std::sort(keys.begin(), keys.end());
+  ASSERT_EQ(keys.size(), capacity);
+  for (int i = 0; i < capacity; i++) {
+    EXPECT_EQ(keys[i], i);
+  }
+}
+
+TEST(ClockCacheTest, ConcurrentLookupAndInsert) {
+  const int capacity = 256;
+  const int total_keys = 1024;
+  const int total_threads = 8;
+  const int nums_ops = 20000;
+  TestCache cache(capacity, capacity, true /*admission*/);
+
+  std::atomic<int> wrong_values{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < total_threads; t++) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < nums_ops; i++) {
+        const int key = (i * 7 + t * 131) % total_keys;
+        std::shared_ptr<TestItem> item = cache.Lookup(key);
+        if (!item) {
+          item = cache.Insert(key, std::make_shared<TestItem>(key),
+                              1 /*charge*/);
+        }
+
+        if (!item) {
+          continue;
+        }
+
+        if (item->GetValue() != key) {
+          wrong_values.fetch_add(1);
+        }
+        item->Unref();
+      }
+    });
+  }
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(wrong_values.load(), 0);
+  // Concurrent insertions may go above capacity a bit, but not further than
+  // one item per thread
+  EXPECT_LE(cache.GetUsage(), capacity + total_threads);
+}
+
+} // namespace sstable
+
+} // namespace kvs
\ No newline at end of file
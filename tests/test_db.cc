@@ -1,15 +1,27 @@
 #include <gtest/gtest.h>
 
+#include "common/executor.h"
+#include "common/task.h"
+#include "common/thread_pool.h"
 #include "db/config.h"
 #include "db/db_impl.h"
 #include "db/memtable.h"
+#include "db/memtable_iterator.h"
+#include "db/row_cache.h"
 #include "db/skiplist.h"
+#include "db/skiplist_iterator.h"
+#include "db/version_edit.h"
 #include "db/version_manager.h"
+#include "sstable/block_reader_cache.h"
+#include "sstable/lru_table_item.h"
+#include "sstable/table_reader_cache.h"
 
 // libC++
 #include <chrono>
 #include <filesystem>
+#include <fstream>
 #include <memory>
+#include <unordered_set>
 
 // posix API
 #include <sys/resource.h>
@@ -631,6 +643,637 @@ TEST(DBTest, MultipleDB) {
   ClearAllSstFiles(db2.get());
 }
 
+TEST(DBTest, ConcurrentPutUniqueSequenceNumber) {
+  auto db = std::make_unique<db::DBImpl>(true /*is_testing*/);
+  db->LoadDB("test_sequence");
+
+  const int nums_elem_each_thread = 2000;
+  const int num_threads = 8;
+  const int total_elems = nums_elem_each_thread * num_threads;
+
+  std::latch all_writes_done(num_threads);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back(PutOp, db.get(), nums_elem_each_thread, i,
+                         std::ref(all_writes_done));
+  }
+  all_writes_done.wait();
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // Every write must be published, and no sequence number is reused
+  EXPECT_EQ(db->GetLastVisibleSequence(), total_elems);
+
+  std::unordered_set<TxnId> txn_ids;
+  auto iterator = std::make_unique<MemTableIterator>(db->GetCurrentMemtable());
+  for (iterator->SeekToFirst(); iterator->IsValid(); iterator->Next()) {
+    EXPECT_TRUE(txn_ids.insert(iterator->GetTransactionId()).second);
+    EXPECT_LE(iterator->GetTransactionId(), total_elems);
+  }
+  EXPECT_EQ(txn_ids.size(), total_elems);
+
+  GetStatus status;
+  for (int i = 0; i < total_elems; i++) {
+    status = db->Get("key" + std::to_string(i));
+    EXPECT_EQ(status.type, ValueType::PUT);
+    EXPECT_EQ(status.value.value(), "value" + std::to_string(i));
+  }
+
+  ClearAllSstFiles(db.get());
+}
+
+TEST(DBTest, SnapshotRead) {
+  auto db = std::make_unique<db::DBImpl>(true /*is_testing*/);
+  db->LoadDB("test_snapshot");
+
+  const int nums_elem = 1000;
+  for (int i = 0; i < nums_elem; i++) {
+    db->Put("key" + std::to_string(i), "old_value" + std::to_string(i));
+  }
+
+  const Snapshot *snapshot = db->GetSnapshot();
+  EXPECT_EQ(snapshot->GetSequenceNumber(), nums_elem);
+
+  for (int i = 0; i < nums_elem; i++) {
+    if (i % 2 == 0) {
+      db->Put("key" + std::to_string(i), "new_value" + std::to_string(i));
+    } else {
+      db->Delete("key" + std::to_string(i));
+    }
+  }
+  db->Put("new_key", "new_value");
+
+  ReadOptions options;
+  options.snapshot = snapshot;
+
+  auto check_reads = [&]() {
+    GetStatus status;
+    for (int i = 0; i < nums_elem; i++) {
+      std::string key = "key" + std::to_string(i);
+
+      // Snapshot still sees old state
+      status = db->Get(options, key);
+      EXPECT_EQ(status.type, ValueType::PUT);
+      EXPECT_EQ(status.value.value(), "old_value" + std::to_string(i));
+
+      // Latest state sees new writes
+      status = db->Get(key);
+      if (i % 2 == 0) {
+        EXPECT_EQ(status.type, ValueType::PUT);
+        EXPECT_EQ(status.value.value(), "new_value" + std::to_string(i));
+      } else {
+        EXPECT_EQ(status.type, ValueType::DELETED);
+      }
+    }
+
+    EXPECT_NE(db->Get(options, "new_key").type, ValueType::PUT);
+    EXPECT_EQ(db->Get("new_key").type, ValueType::PUT);
+  };
+
+  // Read from memtable
+  check_reads();
+
+  // Read from SST
+  db->ForceFlushMemTable();
+  std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+  EXPECT_TRUE(db->GetImmutableMemTables().empty());
+  check_reads();
+
+  db->ReleaseSnapshot(snapshot);
+  ClearAllSstFiles(db.get());
+}
+
+TEST(DBTest, MultiGet) {
+  auto db = std::make_unique<db::DBImpl>(true /*is_testing*/);
+  db->LoadDB("test_multiget");
+
+  // First half of keys is flushed to SST, second half stays in memtable
+  const int nums_elem = 20000;
+  for (int i = 0; i < nums_elem / 2; i++) {
+    db->Put("key" + std::to_string(i), "value" + std::to_string(i));
+  }
+  db->ForceFlushMemTable();
+  std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+  EXPECT_TRUE(db->GetImmutableMemTables().empty());
+
+  const Snapshot *snapshot = db->GetSnapshot();
+  for (int i = nums_elem / 2; i < nums_elem; i++) {
+    db->Put("key" + std::to_string(i), "value" + std::to_string(i));
+  }
+  for (int i = 0; i < nums_elem; i += 10) {
+    db->Delete("key" + std::to_string(i));
+  }
+
+  // Unsorted keys, with duplicates and keys that never exist
+  std::vector<std::string> keys;
+  for (int i = nums_elem + 100; i >= 0; i -= 7) {
+    keys.push_back("key" + std::to_string(i));
+  }
+  keys.push_back("key7");
+  keys.push_back("not_existed_key");
+  std::vector<std::string_view> keys_view(keys.begin(), keys.end());
+
+  std::vector<GetStatus> statuses = db->MultiGet(keys_view);
+  ASSERT_EQ(statuses.size(), keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    GetStatus status = db->Get(keys[i]);
+    EXPECT_EQ(statuses[i].type, status.type);
+    EXPECT_EQ(statuses[i].value, status.value);
+  }
+
+  ReadOptions options;
+  options.snapshot = snapshot;
+  statuses = db->MultiGet(keys_view, options);
+  ASSERT_EQ(statuses.size(), keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    GetStatus status = db->Get(options, keys[i]);
+    EXPECT_EQ(statuses[i].type, status.type);
+    EXPECT_EQ(statuses[i].value, status.value);
+  }
+
+  db->ReleaseSnapshot(snapshot);
+  ClearAllSstFiles(db.get());
+}
+
+TEST(DBTest, PinnedGet) {
+  auto db = std::make_unique<db::DBImpl>(true /*is_testing*/);
+  db->LoadDB("test_pinned_get");
+
+  // Values are large enough to never fit in a short string
+  const int nums_elem = 1000;
+  const std::string value_suffix(1024, 'v');
+  for (int i = 0; i < nums_elem; i++) {
+    db->Put("key" + std::to_string(i), std::to_string(i) + value_suffix);
+  }
+  db->Delete("key0");
+
+  auto check_reads = [&]() {
+    ReadOptions options;
+    PinnableValue value;
+    EXPECT_EQ(db->Get(options, "key0", &value), ValueType::DELETED);
+    EXPECT_TRUE(value.GetView().empty());
+    EXPECT_EQ(db->Get(options, "not_existed_key", &value),
+              ValueType::NOT_FOUND);
+
+    for (int i = 1; i < nums_elem; i++) {
+      std::string key = "key" + std::to_string(i);
+      ASSERT_EQ(db->Get(options, key, &value), ValueType::PUT);
+      EXPECT_TRUE(value.IsPinned());
+      EXPECT_EQ(value.GetView(), std::to_string(i) + value_suffix);
+      EXPECT_EQ(value.GetView(), db->Get(key).value.value());
+    }
+
+    // Value stays valid after being moved
+    ASSERT_EQ(db->Get(options, "key1", &value), ValueType::PUT);
+    PinnableValue moved_value = std::move(value);
+    EXPECT_EQ(moved_value.GetView(), "1" + value_suffix);
+    EXPECT_TRUE(value.GetView().empty());
+  };
+
+  // Read from memtable
+  check_reads();
+
+  // Read from SST
+  db->ForceFlushMemTable();
+  std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+  EXPECT_TRUE(db->GetImmutableMemTables().empty());
+  check_reads();
+
+  ClearAllSstFiles(db.get());
+}
+
+TEST(DBTest, ReadWithoutFillingCache) {
+  auto db = std::make_unique<db::DBImpl>(true /*is_testing*/);
+  db->LoadDB("test_fill_cache");
+
+  const int nums_elem = 10000;
+  for (int i = 0; i < nums_elem; i++) {
+    db->Put("key" + std::to_string(i), "value" + std::to_string(i));
+  }
+  db->ForceFlushMemTable();
+  std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+  EXPECT_TRUE(db->GetImmutableMemTables().empty());
+
+  const sstable::BlockReaderCache *block_cache = db->GetBlockReaderCache();
+  ASSERT_TRUE(block_cache);
+  // Indexes are loaded into cache when tables are opened, only data blocks are
+  // counted
+  auto get_data_usage = [block_cache]() {
+    return block_cache->GetUsage() - block_cache->GetHighPriorityUsage();
+  };
+  const size_t usage = get_data_usage();
+
+  // Blocks read by scan aren't added into cache
+  ReadOptions options;
+  options.fill_cache = false;
+  for (int i = 0; i < nums_elem; i++) {
+    GetStatus status = db->Get(options, "key" + std::to_string(i));
+    ASSERT_EQ(status.type, ValueType::PUT);
+    EXPECT_EQ(status.value, "value" + std::to_string(i));
+  }
+  EXPECT_EQ(get_data_usage(), usage);
+
+  std::vector<std::string> keys;
+  for (int i = 0; i < nums_elem; i += 10) {
+    keys.push_back("key" + std::to_string(i));
+  }
+  std::vector<std::string_view> keys_view(keys.begin(), keys.end());
+  for (const auto &status : db->MultiGet(keys_view, options)) {
+    EXPECT_EQ(status.type, ValueType::PUT);
+  }
+  EXPECT_EQ(get_data_usage(), usage);
+
+  // Default reads fill cache
+  EXPECT_EQ(db->Get(ReadOptions{}, "key0").value, "value0");
+  EXPECT_GT(get_data_usage(), usage);
+
+  ClearAllSstFiles(db.get());
+}
+
+TEST(DBTest, RowCache) {
+  auto db = std::make_unique<db::DBImpl>(true /*is_testing*/);
+  db->LoadDB("test_row_cache");
+
+  const RowCache *row_cache = db->GetRowCache();
+  ASSERT_TRUE(row_cache);
+
+  const int nums_elem = 1000;
+  for (int i = 0; i < nums_elem; i++) {
+    db->Put("key" + std::to_string(i), "old_value" + std::to_string(i));
+  }
+  db->ForceFlushMemTable();
+  std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+  EXPECT_TRUE(db->GetImmutableMemTables().empty());
+
+  // First read fills row cache, second one is served from it
+  for (int round = 0; round < 2; round++) {
+    for (int i = 0; i < nums_elem; i++) {
+      GetStatus status = db->Get("key" + std::to_string(i));
+      ASSERT_EQ(status.type, ValueType::PUT);
+      EXPECT_EQ(status.value.value(), "old_value" + std::to_string(i));
+    }
+    EXPECT_EQ(db->Get("missing_key").type, ValueType::NOT_FOUND);
+  }
+  EXPECT_GT(row_cache->GetUsage(), 0);
+
+  // Entries of older table don't hide newer versions in newer table
+  for (int i = 0; i < nums_elem; i++) {
+    if (i % 2 == 0) {
+      db->Put("key" + std::to_string(i), "new_value" + std::to_string(i));
+    } else {
+      db->Delete("key" + std::to_string(i));
+    }
+  }
+  db->ForceFlushMemTable();
+  std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+  EXPECT_TRUE(db->GetImmutableMemTables().empty());
+
+  for (int round = 0; round < 2; round++) {
+    for (int i = 0; i < nums_elem; i++) {
+      GetStatus status = db->Get("key" + std::to_string(i));
+      if (i % 2 == 0) {
+        ASSERT_EQ(status.type, ValueType::PUT);
+        EXPECT_EQ(status.value.value(), "new_value" + std::to_string(i));
+      } else {
+        EXPECT_EQ(status.type, ValueType::DELETED);
+      }
+    }
+  }
+
+  // Entries of tables deleted by a version edit are erased once no version
+  // refers to those tables anymore
+  const int num_levels = db->GetConfig()->GetSSTNumLvels();
+  auto version_edit = std::make_unique<db::VersionEdit>(num_levels);
+  std::set<SSTId> table_ids;
+  for (const auto &level : db->GetVersionManager()
+                               ->GetLatestVersion()
+                               ->GetImmutableSSTMetadata()) {
+    for (const auto &sst : level) {
+      table_ids.insert(sst->table_id);
+      version_edit->RemoveFiles(sst->table_id, sst->level);
+    }
+  }
+  ASSERT_EQ(table_ids.size(), 2);
+  for (SSTId table_id : table_ids) {
+    EXPECT_TRUE(row_cache->Contains(table_id, "key0"));
+  }
+
+  ASSERT_TRUE(db->LogAndApply(std::move(version_edit)));
+  for (int i = 0; i < 100 && row_cache->GetUsage() > 0; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  for (SSTId table_id : table_ids) {
+    for (int i = 0; i < nums_elem; i++) {
+      EXPECT_FALSE(row_cache->Contains(table_id, "key" + std::to_string(i)));
+    }
+  }
+  EXPECT_EQ(row_cache->GetUsage(), 0);
+
+  ClearAllSstFiles(db.get());
+}
+
+TEST(DBTest, WarmOpenTables) {
+  auto db = std::make_unique<db::DBImpl>(true /*is_testing*/);
+  db->LoadDB("test_warm_open");
+  ASSERT_TRUE(db->GetConfig()->IsWarmOpenEnabled());
+
+  const int nums_elem = 1000;
+  const int total_tables = 3;
+  for (int table = 0; table < total_tables; table++) {
+    for (int i = 0; i < nums_elem; i++) {
+      db->Put("key" + std::to_string(i),
+              "value" + std::to_string(table * nums_elem + i));
+    }
+    db->ForceFlushMemTable();
+    std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+  }
+  EXPECT_TRUE(db->GetImmutableMemTables().empty());
+
+  // Reopen, tables are opened before any lookup
+  db = std::make_unique<db::DBImpl>(true /*is_testing*/);
+  db->LoadDB("test_warm_open");
+  db->WaitForWarmOpen();
+
+  std::vector<SSTId> table_ids;
+  for (const auto &level : db->GetVersionManager()
+                               ->GetLatestVersion()
+                               ->GetImmutableSSTMetadata()) {
+    for (const auto &sst : level) {
+      table_ids.push_back(sst->table_id);
+    }
+  }
+  ASSERT_EQ(table_ids.size(), total_tables);
+  auto [total_opened_tables, total_warm_open_tables] =
+      db->GetWarmOpenProgress();
+  EXPECT_EQ(total_opened_tables, total_tables);
+  EXPECT_EQ(total_warm_open_tables, total_tables);
+
+  for (SSTId table_id : table_ids) {
+    auto lru_table_item = db->GetTableReaderCache()->GetLRUTableItem(table_id);
+    ASSERT_TRUE(lru_table_item);
+    lru_table_item->Unref();
+  }
+
+  for (int i = 0; i < nums_elem; i++) {
+    GetStatus status = db->Get("key" + std::to_string(i));
+    ASSERT_EQ(status.type, ValueType::PUT);
+    EXPECT_EQ(status.value.value(),
+              "value" + std::to_string((total_tables - 1) * nums_elem + i));
+  }
+
+  ClearAllSstFiles(db.get());
+}
+
+TEST(DBTest, BlockCacheDump) {
+  auto db = std::make_unique<db::DBImpl>(true /*is_testing*/);
+  db->LoadDB("test_block_cache_dump");
+  ASSERT_TRUE(db->GetBlockReaderCache());
+
+  const int nums_elem = 1000;
+  for (int i = 0; i < nums_elem; i++) {
+    db->Put("key" + std::to_string(i), "value" + std::to_string(i));
+  }
+  db->ForceFlushMemTable();
+  std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+  EXPECT_TRUE(db->GetImmutableMemTables().empty());
+
+  // Read every block once
+  for (int i = 0; i < nums_elem; i++) {
+    ASSERT_EQ(db->Get("key" + std::to_string(i)).type, ValueType::PUT);
+  }
+
+  std::vector<std::pair<SSTId, BlockOffset>> dumped_blocks;
+  for (const auto &[block_info, lru_block_item] :
+       db->GetBlockReaderCache()->GetResidentBlocks()) {
+    dumped_blocks.push_back(block_info);
+  }
+  ASSERT_FALSE(dumped_blocks.empty());
+
+  const std::string dump_path = db->GetDBPath() + "BLOCK_CACHE_DUMP";
+  for (bool with_contents : {false, true}) {
+    ASSERT_TRUE(db->DumpBlockCache(with_contents));
+    ASSERT_TRUE(fs::exists(dump_path));
+
+    // Reopen, dumped blocks are loaded back before any lookup
+    db = std::make_unique<db::DBImpl>(true /*is_testing*/);
+    db->LoadDB("test_block_cache_dump");
+    EXPECT_EQ(db->WaitForBlockCacheReload(), dumped_blocks.size());
+    EXPECT_FALSE(fs::exists(dump_path));
+
+    for (const auto &block_info : dumped_blocks) {
+      EXPECT_TRUE(db->GetBlockReaderCache()->Contains(block_info));
+    }
+
+    for (int i = 0; i < nums_elem; i++) {
+      GetStatus status = db->Get("key" + std::to_string(i));
+      ASSERT_EQ(status.type, ValueType::PUT);
+      EXPECT_EQ(status.value.value(), "value" + std::to_string(i));
+    }
+  }
+
+  // Blocks of tables that no longer exist are skipped
+  ASSERT_TRUE(db->DumpBlockCache(true /*with_contents*/));
+  const std::vector<Byte> dump = [&dump_path]() {
+    std::ifstream dump_file(dump_path, std::ios::binary);
+    return std::vector<Byte>(std::istreambuf_iterator<char>(dump_file), {});
+  }();
+  ClearAllSstFiles(db.get());
+  db.reset();
+  {
+    std::ofstream dump_file(dump_path, std::ios::binary);
+    dump_file.write(reinterpret_cast<const char *>(dump.data()), dump.size());
+  }
+
+  db = std::make_unique<db::DBImpl>(true /*is_testing*/);
+  db->LoadDB("test_block_cache_dump");
+  EXPECT_EQ(db->WaitForBlockCacheReload(), 0);
+
+  ClearAllSstFiles(db.get());
+}
+
+TEST(DBTest, BackgroundThreads) {
+  auto db = std::make_unique<db::DBImpl>(true /*is_testing*/);
+  db->LoadDB("test_background_threads");
+  const auto total_flush_threads = db->GetConfig()->GetTotalFlushThreads();
+  const auto total_bg_threads = db->GetConfig()->GetTotalBackGroundThreads();
+
+  // Limits are clamped to threads created on open
+  db->SetBackgroundThreads(100, 100);
+  auto [active_flush_threads, active_bg_threads] =
+      db->GetActiveBackgroundThreads();
+  EXPECT_EQ(active_flush_threads, total_flush_threads);
+  EXPECT_EQ(active_bg_threads, total_bg_threads);
+
+  // Flushes still finish with a single flush worker
+  db->SetBackgroundThreads(1, 1);
+  std::tie(active_flush_threads, active_bg_threads) =
+      db->GetActiveBackgroundThreads();
+  EXPECT_EQ(active_flush_threads, 1);
+  EXPECT_EQ(active_bg_threads, 1);
+
+  const int nums_elem = 1000;
+  const int total_tables = 3;
+  for (int table = 0; table < total_tables; table++) {
+    for (int i = 0; i < nums_elem; i++) {
+      db->Put("key" + std::to_string(i),
+              "value" + std::to_string(table * nums_elem + i));
+    }
+    db->ForceFlushMemTable();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+  EXPECT_TRUE(db->GetImmutableMemTables().empty());
+
+  for (int i = 0; i < nums_elem; i++) {
+    GetStatus status = db->Get("key" + std::to_string(i));
+    ASSERT_EQ(status.type, ValueType::PUT);
+    EXPECT_EQ(status.value.value(),
+              "value" + std::to_string((total_tables - 1) * nums_elem + i));
+  }
+
+  ClearAllSstFiles(db.get());
+}
+
+TEST(DBTest, SuperVersionConcurrentReads) {
+  auto db = std::make_unique<db::DBImpl>(true /*is_testing*/);
+  db->LoadDB("test_super_version");
+
+  const int nums_elem = 9000;
+  const int total_readers = 4;
+  // Keys below it have been written, and must be found by any read
+  std::atomic<int> total_written(0);
+  std::atomic<bool> stop(false);
+  std::atomic<int> total_missed(0);
+
+  std::vector<std::thread> readers;
+  for (int reader = 0; reader < total_readers; reader++) {
+    readers.emplace_back([&db, &total_written, &stop, &total_missed, reader]() {
+      int i = reader;
+      while (!stop.load()) {
+        const int written = total_written.load();
+        if (written == 0) {
+          continue;
+        }
+
+        const int index = i++ % written;
+        GetStatus status = db->Get("key" + std::to_string(index));
+        if (status.type != ValueType::PUT ||
+            status.value.value() != "value" + std::to_string(index)) {
+          total_missed.fetch_add(1);
+        }
+      }
+    });
+  }
+
+  // Memtables are switched and flushed while readers are running
+  for (int i = 0; i < nums_elem; i++) {
+    db->Put("key" + std::to_string(i), "value" + std::to_string(i));
+    total_written.store(i + 1);
+    if (i % (nums_elem / 3) == 0) {
+      db->ForceFlushMemTable();
+    }
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+
+  stop = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(total_missed.load(), 0);
+  EXPECT_TRUE(db->GetImmutableMemTables().empty());
+
+  std::vector<std::string> keys;
+  for (int i = 0; i < nums_elem; i += 3) {
+    keys.push_back("key" + std::to_string(i));
+  }
+  std::vector<std::string_view> keys_view(keys.begin(), keys.end());
+  std::vector<GetStatus> statuses = db->MultiGet(keys_view);
+  for (size_t i = 0; i < keys.size(); i++) {
+    ASSERT_EQ(statuses[i].type, ValueType::PUT);
+    EXPECT_EQ(statuses[i].value.value(), "value" + std::to_string(i * 3));
+  }
+
+  ClearAllSstFiles(db.get());
+}
+
+TEST(DBTest, AsyncReadsAndWrites) {
+  // Async calls are resumed on pool, which MUST outlive DB
+  kvs::ThreadPool thread_pool(2);
+  auto db = std::make_unique<db::DBImpl>(true /*is_testing*/);
+  db->LoadDB("test_async");
+  db->SetExecutor(std::make_shared<ThreadPoolExecutor>(&thread_pool));
+
+  const int nums_elem = 10000;
+  std::vector<std::string> keys;
+  for (int i = 0; i < nums_elem; i++) {
+    keys.push_back("key" + std::to_string(i));
+  }
+
+  // Writers of different threads are committed in groups
+  const int total_writers = 4;
+  std::vector<std::thread> writers;
+  for (int writer = 0; writer < total_writers; writer++) {
+    writers.emplace_back([&db, &keys, writer]() {
+      for (int i = writer; i < nums_elem; i += total_writers) {
+        const std::string value = "value" + std::to_string(i);
+        SyncWait(db->AsyncPut(keys[i], value));
+      }
+    });
+  }
+  for (auto &writer : writers) {
+    writer.join();
+  }
+  db->ForceFlushMemTable();
+  std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+  EXPECT_TRUE(db->GetImmutableMemTables().empty());
+
+  const sstable::BlockReaderCache *block_cache = db->GetBlockReaderCache();
+  ASSERT_TRUE(block_cache);
+  const size_t usage =
+      block_cache->GetUsage() - block_cache->GetHighPriorityUsage();
+
+  // Lookups of this thread are all in flight together
+  std::vector<Task<GetStatus>> lookups;
+  for (int i = 0; i < nums_elem; i += 3) {
+    lookups.push_back(db->AsyncGet(ReadOptions{}, keys[i]));
+  }
+  std::vector<GetStatus> statuses = SyncWait(WhenAll(std::move(lookups)));
+  for (size_t i = 0; i < statuses.size(); i++) {
+    ASSERT_EQ(statuses[i].type, ValueType::PUT);
+    EXPECT_EQ(statuses[i].value.value(), "value" + std::to_string(i * 3));
+  }
+  // Blocks missed by lookups have been loaded into block cache
+  EXPECT_GT(block_cache->GetUsage() - block_cache->GetHighPriorityUsage(),
+            usage);
+
+  // Answered by memtable
+  SyncWait(db->AsyncDelete(keys[0]));
+  EXPECT_EQ(SyncWait(db->AsyncGet(ReadOptions{}, keys[0])).type,
+            ValueType::DELETED);
+  EXPECT_EQ(SyncWait(db->AsyncGet(ReadOptions{}, "not_existed_key")).type,
+            ValueType::NOT_FOUND);
+
+  std::vector<std::string_view> keys_view;
+  for (int i = nums_elem - 1; i >= 0; i -= 7) {
+    keys_view.push_back(keys[i]);
+  }
+  keys_view.push_back(keys[0]);
+  keys_view.push_back("not_existed_key");
+  ReadOptions options;
+  options.fill_cache = false;
+  std::vector<GetStatus> async_statuses =
+      SyncWait(db->AsyncMultiGet(keys_view, options));
+  statuses = db->MultiGet(keys_view);
+  ASSERT_EQ(async_statuses.size(), keys_view.size());
+  for (size_t i = 0; i < keys_view.size(); i++) {
+    EXPECT_EQ(async_statuses[i].type, statuses[i].type);
+    EXPECT_EQ(async_statuses[i].value, statuses[i].value);
+  }
+
+  ClearAllSstFiles(db.get());
+}
+
 } // namespace db
 
-} // namespace kvs
\ No newline at end of file
+} // namespace kvs
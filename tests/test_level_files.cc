@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+
+#include "db/level_files.h"
+
+// libC++
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace kvs {
+
+namespace db {
+
+namespace {
+
+// Key ranges of files don't overlap, i-th file covers keys [key<i>0, key<i>9]
+std::shared_ptr<SSTMetadata> MakeFile(SSTId table_id, int index, int level) {
+  char key[16];
+  std::snprintf(key, sizeof(key), "key%06d", index);
+  return std::make_shared<SSTMetadata>(
+      table_id, level, 1000 /*file_size*/, std::string(key) + "0",
+      std::string(key) + "9", std::to_string(table_id) + ".sst");
+}
+
+std::vector<SSTId> GetTableIds(const LevelFiles &files) {
+  std::vector<SSTId> table_ids;
+  for (const auto &file : files) {
+    table_ids.push_back(file->table_id);
+  }
+
+  return table_ids;
+}
+
+} // namespace
+
+TEST(LevelFilesTest, SortedLevel) {
+  const int total_files = 1000;
+  std::vector<std::shared_ptr<SSTMetadata>> files;
+  for (int i = total_files - 1; i >= 0; i--) {
+    files.push_back(MakeFile(i + 1, i, 1 /*level*/));
+  }
+
+  const LevelFiles level =
+      LevelFiles().Apply(files, {} /*removed*/, true /*sorted*/);
+  ASSERT_EQ(level.size(), total_files);
+  for (int i = 0; i < total_files; i++) {
+    EXPECT_EQ(level[i]->table_id, i + 1);
+  }
+
+  char key[16];
+  for (int i = 0; i < total_files; i++) {
+    std::snprintf(key, sizeof(key), "key%06d5", i);
+    std::shared_ptr<SSTMetadata> file = level.FindFile(key);
+    ASSERT_TRUE(file);
+    EXPECT_EQ(file->table_id, i + 1);
+  }
+  EXPECT_FALSE(level.FindFile("a"));
+  // Between key ranges of first and second file
+  EXPECT_FALSE(level.FindFile("key000000a"));
+  EXPECT_FALSE(level.FindFile("z"));
+  EXPECT_FALSE(LevelFiles().FindFile("key0000005"));
+}
+
+TEST(LevelFilesTest, NewListSharesUntouchedChunks) {
+  const int total_files = 1000;
+  std::vector<std::shared_ptr<SSTMetadata>> files;
+  for (int i = 0; i < total_files; i++) {
+    // Leave gaps, so that new files can be added between existing ones
+    files.push_back(MakeFile(i + 1, i * 2, 1 /*level*/));
+  }
+  const LevelFiles old_level =
+      LevelFiles().Apply(files, {} /*removed*/, true /*sorted*/);
+
+  // Replace the file in the middle by two new ones, like a compaction does
+  const int middle = total_files / 2;
+  const LevelFiles new_level = old_level.Apply(
+      {MakeFile(total_files + 1, middle * 2, 1),
+       MakeFile(total_files + 2, middle * 2 + 1, 1)},
+      {files[middle]}, true /*sorted*/);
+
+  // Old list is unchanged
+  EXPECT_EQ(old_level.size(), total_files);
+  EXPECT_EQ(old_level[middle]->table_id, middle + 1);
+
+  ASSERT_EQ(new_level.size(), total_files + 1);
+  EXPECT_EQ(new_level[middle]->table_id, total_files + 1);
+  EXPECT_EQ(new_level[middle + 1]->table_id, total_files + 2);
+  EXPECT_TRUE(std::is_sorted(
+      new_level.begin(), new_level.end(), [](const auto &a, const auto &b) {
+        return a->smallest_key < b->smallest_key;
+      }));
+
+  // Files far from the change live in the same chunks for both lists
+  EXPECT_EQ(&old_level[0], &new_level[0]);
+  EXPECT_EQ(&old_level[total_files - 1], &new_level[total_files]);
+  EXPECT_NE(&old_level[middle], &new_level[middle]);
+}
+
+TEST(LevelFilesTest, UnsortedLevelKeepsOrder) {
+  LevelFiles level;
+  EXPECT_TRUE(level.empty());
+  EXPECT_EQ(level.begin(), level.end());
+
+  // Files of level 0 are added one flush at a time
+  std::vector<std::shared_ptr<SSTMetadata>> files;
+  for (int i = 0; i < 200; i++) {
+    files.push_back(MakeFile(i + 1, 200 - i, 0 /*level*/));
+    level = level.Apply({files.back()}, {} /*removed*/, false /*sorted*/);
+  }
+
+  std::vector<SSTId> expected_table_ids;
+  for (int i = 0; i < 200; i++) {
+    expected_table_ids.push_back(i + 1);
+  }
+  EXPECT_EQ(GetTableIds(level), expected_table_ids);
+
+  // Compaction removes oldest files
+  level = level.Apply({} /*added*/,
+                      std::vector<std::shared_ptr<SSTMetadata>>(
+                          files.begin(), files.begin() + 150),
+                      false /*sorted*/);
+  expected_table_ids.erase(expected_table_ids.begin(),
+                           expected_table_ids.begin() + 150);
+  EXPECT_EQ(GetTableIds(level), expected_table_ids);
+
+  level = level.Apply({} /*added*/,
+                      std::vector<std::shared_ptr<SSTMetadata>>(
+                          files.begin() + 150, files.end()),
+                      false /*sorted*/);
+  EXPECT_TRUE(level.empty());
+  EXPECT_EQ(level.size(), 0);
+}
+
+} // namespace db
+
+} // namespace kvs
\ No newline at end of file
@@ -2,11 +2,15 @@
 
 #include "db/config.h"
 #include "db/db_impl.h"
+#include "db/manifest.h"
+#include "db/version.h"
 #include "db/version_edit.h"
+#include "db/version_manager.h"
 #include "io/linux_file.h"
 
 // libC++
 #include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <memory>
 #include <thread>
@@ -40,9 +44,12 @@ TEST(VersionTest, BasicEncodeManifest) {
     std::string smallest_key = "key" + std::to_string(i + 1);
     std::string largest_key = "key" + std::to_string((i + 1) * 100000);
     std::string filename = std::to_string(table_id) + ".sst";
+    TxnId min_txn_id = i * 10 + 1;
+    TxnId max_txn_id = (i + 1) * 10;
 
     version_edit->AddNewFiles(table_id, level, file_size, smallest_key,
-                              largest_key, std::move(filename));
+                              largest_key, std::move(filename), min_txn_id,
+                              max_txn_id);
   }
 
   const int num_deleted_files = 2;
@@ -58,28 +65,218 @@ TEST(VersionTest, BasicEncodeManifest) {
   version_edit->SetSequenceNumber(4);
   db->AddChangesToManifest(version_edit.get());
 
-  std::string expected =
-      R"({"next_table_id":6,"sequence_number":4,"new_files":[)"
-      R"({"id":2,"level":0,"size":200000,"smallest_key":"key2","largest_key":"key200000"},)"
-      R"({"id":1,"level":1,"size":100000,"smallest_key":"key1","largest_key":"key100000"},)"
-      R"({"id":3,"level":1,"size":300000,"smallest_key":"key3","largest_key":"key300000"}],)"
-      R"("delete_files":[)"
-      R"({"id":4,"level":0},)"
-      R"({"id":5,"level":1}]})";
+  const std::string manifest_path = db->GetManifestPath();
+  DynamicBuffer data(fs::file_size(manifest_path), 0);
+  auto read_manifest_object =
+      std::make_unique<io::LinuxReadOnlyFile>(manifest_path);
+  read_manifest_object->Open();
+  EXPECT_EQ(read_manifest_object->RandomRead(data, 0 /*offset*/), data.size());
+
+  std::optional<uint32_t> format_version = DecodeManifestHeader(data);
+  ASSERT_TRUE(format_version);
+  EXPECT_EQ(*format_version, kManifestFormatVersion);
+
+  // First record is written when MANIFEST is created
+  uint64_t offset = kManifestHeaderSize;
+  VersionEdit initial_record(config->GetSSTNumLvels());
+  ASSERT_EQ(ReadManifestRecord(data, &offset, db->GetDBPath(),
+                               &initial_record),
+            ManifestReadStatus::kOk);
+
+  VersionEdit decoded(config->GetSSTNumLvels());
+  ASSERT_EQ(ReadManifestRecord(data, &offset, db->GetDBPath(), &decoded),
+            ManifestReadStatus::kOk);
+  EXPECT_EQ(ReadManifestRecord(data, &offset, db->GetDBPath(), &decoded),
+            ManifestReadStatus::kEndOfFile);
 
+  EXPECT_EQ(decoded.GetNextTableId(), 6);
+  EXPECT_EQ(decoded.GetSequenceNumber(), 4);
+  EXPECT_EQ(decoded.GetImmutableDeletedFiles(),
+            version_edit->GetImmutableDeletedFiles());
+
+  const auto &expected_files = version_edit->GetImmutableNewFiles();
+  const auto &decoded_files = decoded.GetImmutableNewFiles();
+  ASSERT_EQ(decoded_files.size(), expected_files.size());
+  for (int level = 0; level < expected_files.size(); level++) {
+    ASSERT_EQ(decoded_files[level].size(), expected_files[level].size());
+    for (int i = 0; i < expected_files[level].size(); i++) {
+      const auto &expected = expected_files[level][i];
+      const auto &actual = decoded_files[level][i];
+      EXPECT_EQ(actual->table_id, expected->table_id);
+      EXPECT_EQ(actual->level, expected->level);
+      EXPECT_EQ(actual->file_size, expected->file_size);
+      EXPECT_EQ(actual->smallest_key, expected->smallest_key);
+      EXPECT_EQ(actual->largest_key, expected->largest_key);
+      EXPECT_EQ(actual->min_txn_id, expected->min_txn_id);
+      EXPECT_EQ(actual->max_txn_id, expected->max_txn_id);
+      EXPECT_EQ(actual->filename, db->GetDBPath() +
+                                      std::to_string(expected->table_id) +
+                                      ".sst");
+    }
+  }
+
+  ClearAllSstFiles(db.get());
+}
+
+TEST(VersionTest, MigrateJsonManifest) {
+  const std::string db_path =
+      std::make_unique<DBImpl>(true /*is_testing*/)->GetConfig()
+          ->GetSavedDataPath() +
+      "test/";
+  fs::create_directories(db_path);
+
+  // MANIFEST written as JSON records, table 3 is added then deleted, table 2
+  // was written before txn id range was tracked
+  std::string legacy_manifest =
+      R"({"next_table_id":3,"sequence_number":8,"new_files":[)"
+      R"({"id":1,"level":0,"size":1000,"smallest_key":"key1","largest_key":"key9","min_txn_id":5,"max_txn_id":8}]})"
+      R"({"next_table_id":4,"sequence_number":8,"new_files":[)"
+      R"({"id":2,"level":0,"size":1000,"smallest_key":"key1","largest_key":"key9"},)"
+      R"({"id":3,"level":1,"size":1000,"smallest_key":"key1","largest_key":"key9"}]})"
+      R"({"next_table_id":4,"sequence_number":9,"delete_files":[{"id":3,"level":1}]})";
+  auto manifest_object =
+      std::make_unique<io::LinuxAppendOnlyFile>(db_path + "MANIFEST");
+  manifest_object->Open();
+  manifest_object->Append(std::span<const Byte>(
+      reinterpret_cast<const Byte *>(legacy_manifest.data()),
+      legacy_manifest.size()));
+  manifest_object->Flush();
+  manifest_object.reset();
+
+  auto check_recovered = [](const DBImpl *db) {
+    const auto &sst_metadata =
+        db->GetVersionManager()->GetLatestVersion()->GetImmutableSSTMetadata();
+    ASSERT_EQ(sst_metadata[0].size(), 2);
+    EXPECT_TRUE(sst_metadata[1].empty());
+    for (const auto &sst : sst_metadata[0]) {
+      if (sst->table_id == 1) {
+        EXPECT_EQ(sst->min_txn_id, 5);
+        EXPECT_EQ(sst->max_txn_id, 8);
+      } else {
+        EXPECT_EQ(sst->min_txn_id, 0);
+        EXPECT_EQ(sst->max_txn_id, kMaxTxnId);
+      }
+    }
+    EXPECT_EQ(db->GetLastVisibleSequence(), 9);
+  };
+
+  auto db = std::make_unique<DBImpl>(true /*is_testing*/);
+  ASSERT_TRUE(db->LoadDB("test"));
+  check_recovered(db.get());
+  EXPECT_EQ(db->GetNextSSTId(), 4);
+
+  // MANIFEST is replaced by a binary one that CURRENT points to, the same
+  // state is recovered from it
+  EXPECT_FALSE(fs::exists(db_path + "MANIFEST"));
+  EXPECT_TRUE(fs::exists(db_path + "CURRENT"));
+  DynamicBuffer header(kManifestHeaderSize, 0);
   auto read_manifest_object =
-      std::make_unique<io::LinuxReadOnlyFile>(db->GetDBPath() + "MANIFEST");
+      std::make_unique<io::LinuxReadOnlyFile>(db->GetManifestPath());
   read_manifest_object->Open();
+  read_manifest_object->RandomRead(header, 0 /*offset*/);
+  EXPECT_TRUE(DecodeManifestHeader(header));
+  read_manifest_object.reset();
+
+  db = std::make_unique<DBImpl>(true /*is_testing*/);
+  ASSERT_TRUE(db->LoadDB("test"));
+  check_recovered(db.get());
+
+  ClearAllSstFiles(db.get());
+}
+
+TEST(VersionTest, RecoverBinaryKeysAndTornRecord) {
+  auto db = std::make_unique<DBImpl>(true /*is_testing*/);
+  ASSERT_TRUE(db->LoadDB("test"));
+  const std::string manifest_path = db->GetManifestPath();
+
+  // Keys can contain any byte
+  const std::string smallest_key("a\0\"b\xff", 5);
+  const std::string largest_key("z\n\0}", 4);
+  auto version_edit =
+      std::make_unique<VersionEdit>(db->GetConfig()->GetSSTNumLvels());
+  version_edit->AddNewFiles(1 /*table_id*/, 0 /*level*/, 1000 /*file_size*/,
+                            smallest_key, largest_key, "1.sst");
+  version_edit->SetNextTableId(2);
+  version_edit->SetSequenceNumber(3);
+  ASSERT_TRUE(db->AddChangesToManifest(version_edit.get()));
+  db.reset();
+  const uint64_t valid_size = fs::file_size(manifest_path);
+
+  // Crash in the middle of appending next record
+  DynamicBuffer torn_record;
+  VersionEdit next_record(1);
+  next_record.RemoveFiles(1 /*sst_id*/, 0 /*level*/);
+  EncodeManifestRecord(&next_record, &torn_record);
+  torn_record.resize(torn_record.size() - 1);
+  auto manifest_object =
+      std::make_unique<io::LinuxAppendOnlyFile>(manifest_path);
+  manifest_object->Open();
+  manifest_object->Append(torn_record);
+  manifest_object->Flush();
+  manifest_object.reset();
+
+  db = std::make_unique<DBImpl>(true /*is_testing*/);
+  ASSERT_TRUE(db->LoadDB("test"));
+  EXPECT_EQ(fs::file_size(manifest_path), valid_size);
+
+  const auto &sst_metadata =
+      db->GetVersionManager()->GetLatestVersion()->GetImmutableSSTMetadata();
+  ASSERT_EQ(sst_metadata[0].size(), 1);
+  EXPECT_EQ(sst_metadata[0][0]->smallest_key, smallest_key);
+  EXPECT_EQ(sst_metadata[0][0]->largest_key, largest_key);
+  EXPECT_EQ(db->GetLastVisibleSequence(), 3);
+
+  ClearAllSstFiles(db.get());
+}
+
+TEST(VersionTest, ManifestRollover) {
+  auto db = std::make_unique<DBImpl>(true /*is_testing*/);
+  ASSERT_TRUE(db->LoadDB("test"));
+  const int num_levels = db->GetConfig()->GetSSTNumLvels();
+  const uint64_t max_manifest_file_size =
+      db->GetConfig()->GetMaxManifestFileSize();
+  const std::string first_manifest_path = db->GetManifestPath();
+
+  // Each edit replaces the only table of level 1 by a new one, until MANIFEST
+  // is rolled over
+  SSTId table_id = 1;
+  while (db->GetManifestPath() == first_manifest_path) {
+    ASSERT_LT(table_id, max_manifest_file_size);
+    auto version_edit = std::make_unique<VersionEdit>(num_levels);
+    version_edit->AddNewFiles(table_id, 1 /*level*/, 1000 /*file_size*/,
+                              "key1", "key9",
+                              std::to_string(table_id) + ".sst");
+    if (table_id > 1) {
+      version_edit->RemoveFiles(table_id - 1, 1 /*level*/);
+    }
+    version_edit->SetNextTableId(table_id + 1);
+    version_edit->SetSequenceNumber(table_id);
+    ASSERT_TRUE(db->LogAndApply(std::move(version_edit)));
+    table_id++;
+  }
+  const SSTId last_table_id = table_id - 1;
+
+  // New MANIFEST only holds a snapshot of live tables and the last edit
+  const std::string manifest_path = db->GetManifestPath();
+  EXPECT_FALSE(fs::exists(first_manifest_path));
+  EXPECT_LT(fs::file_size(manifest_path), max_manifest_file_size / 10);
+
+  std::ifstream current_file(db->GetDBPath() + "CURRENT");
+  std::string manifest_name;
+  std::getline(current_file, manifest_name);
+  EXPECT_EQ(db->GetDBPath() + manifest_name, manifest_path);
 
-  std::vector<Byte> read_buffer(expected.size(), 0);
-  uint64_t offset = 0;
-  std::string encoded_result;
+  // Reopen
+  db = std::make_unique<DBImpl>(true /*is_testing*/);
+  ASSERT_TRUE(db->LoadDB("test"));
+  EXPECT_EQ(db->GetManifestPath(), manifest_path);
 
-  ssize_t bytes_read = read_manifest_object->RandomRead(read_buffer, offset);
-  encoded_result.append(reinterpret_cast<const char *>(read_buffer.data()),
-                        read_buffer.size());
+  const auto &sst_metadata =
+      db->GetVersionManager()->GetLatestVersion()->GetImmutableSSTMetadata();
+  ASSERT_EQ(sst_metadata[1].size(), 1);
+  EXPECT_EQ(sst_metadata[1][0]->table_id, last_table_id);
+  EXPECT_EQ(db->GetNextSSTId(), last_table_id + 1);
 
-  EXPECT_EQ(encoded_result, expected);
   ClearAllSstFiles(db.get());
 }
 
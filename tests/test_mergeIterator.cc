@@ -48,7 +48,8 @@ bool CompareVersionFilesWithDirectoryFiles(const db::DBImpl *db) {
     num_sst_files_info += sst_file_info.size();
   }
 
-  return (num_sst_files == num_sst_files_info + 1 /*include manifest file*/)
+  return (num_sst_files ==
+          num_sst_files_info + 2 /*include MANIFEST and CURRENT files*/)
              ? true
              : false;
 }
@@ -107,10 +108,8 @@ TEST(TableTest, MergeIterator) {
   std::this_thread::sleep_for(std::chrono::milliseconds(1000));
   EXPECT_TRUE(CompareVersionFilesWithDirectoryFiles(db.get()));
 
-  const std::vector<std::vector<std::shared_ptr<db::SSTMetadata>>>
-      sst_metadata = db->GetVersionManager()
-                         ->GetLatestVersion()
-                         ->GetImmutableSSTMetadata();
+  const std::vector<db::LevelFiles> sst_metadata =
+      db->GetVersionManager()->GetLatestVersion()->GetImmutableSSTMetadata();
   EXPECT_EQ(sst_metadata.size(), db->GetConfig()->GetSSTNumLvels());
 
   for (int level = 0; level < sst_metadata.size(); level++) {
@@ -125,8 +124,7 @@ TEST(TableTest, MergeIterator) {
   std::vector<std::shared_ptr<sstable::LRUTableItem>> lru_table_items;
   std::vector<std::unique_ptr<sstable::TableReaderIterator>>
       table_reader_iterators;
-  const std::vector<std::unique_ptr<sstable::BlockReaderCache>> &block_cache =
-      db->GetBlockReaderCache();
+  const sstable::BlockReaderCache *block_cache = db->GetBlockReaderCache();
 
   for (int i = 0; i < sst_metadata[0].size(); i++) {
     std::string filename =
@@ -138,8 +136,7 @@ TEST(TableTest, MergeIterator) {
 
     // Mock LRU table item
     auto lru_table_item = std::make_shared<sstable::LRUTableItem>(
-        sst_metadata[0][i]->table_id /*table_id*/, std::move(table_reader),
-        db->GetTableReaderCache());
+        sst_metadata[0][i]->table_id /*table_id*/, std::move(table_reader));
 
     auto iterator = std::make_unique<sstable::TableReaderIterator>(
         block_cache, lru_table_item);
@@ -5,8 +5,11 @@
 #include "db/status.h"
 
 #include <algorithm>
+#include <atomic>
 #include <memory>
+#include <thread>
 #include <unordered_set>
+#include <vector>
 
 namespace kvs {
 
@@ -55,6 +58,66 @@ TEST(SkipListTest, DuplicatePut) {
   EXPECT_TRUE(skip_list->Get("k1", 0).type == db::ValueType::PUT);
 }
 
+TEST(SkipListTest, MultiVersionGet) {
+  auto skip_list = std::make_unique<db::SkipList>();
+
+  // Versions are inserted out of order on purpose
+  skip_list->Put("k1", "v1", 1);
+  skip_list->Put("k1", "v3", 3);
+  skip_list->Delete("k1", 5);
+  skip_list->Put("k1", "v2", 2);
+  skip_list->Put("k0", "v0", 4);
+  skip_list->Put("k2", "v2", 4);
+
+  // Each read sees newest version whose txn_id <= read txn_id
+  EXPECT_TRUE(skip_list->Get("k1", 0).type == db::ValueType::NOT_FOUND);
+  EXPECT_EQ(skip_list->Get("k1", 1).value, "v1");
+  EXPECT_EQ(skip_list->Get("k1", 2).value, "v2");
+  EXPECT_EQ(skip_list->Get("k1", 3).value, "v3");
+  EXPECT_EQ(skip_list->Get("k1", 4).value, "v3");
+  EXPECT_TRUE(skip_list->Get("k1", 5).type == db::ValueType::DELETED);
+  EXPECT_TRUE(skip_list->Get("k1", 100).type == db::ValueType::DELETED);
+  EXPECT_TRUE(skip_list->Get("k2", 3).type == db::ValueType::NOT_FOUND);
+
+  // Iterator returns versions of the same key from newest to oldest
+  std::vector<TxnId> txn_ids;
+  auto iter = std::make_unique<db::SkipListIterator>(skip_list.get());
+  for (iter->Seek("k1"); iter->IsValid() && iter->GetKey() == "k1";
+       iter->Next()) {
+    txn_ids.push_back(iter->GetTransactionId());
+  }
+  EXPECT_EQ(txn_ids, std::vector<TxnId>({5, 3, 2, 1}));
+}
+
+TEST(SkipListTest, MultiGet) {
+  auto skip_list = std::make_unique<db::SkipList>();
+
+  const int num_keys = 1000;
+  for (int i = 0; i < num_keys; i++) {
+    skip_list->Put("key" + std::to_string(i), "old" + std::to_string(i), 1);
+    if (i % 2 == 0) {
+      skip_list->Put("key" + std::to_string(i), "new" + std::to_string(i), 2);
+    }
+  }
+
+  std::vector<std::string> keys;
+  for (int i = 0; i < num_keys + 10; i += 3) {
+    keys.push_back("key" + std::to_string(i));
+  }
+  std::sort(keys.begin(), keys.end());
+  std::vector<std::string_view> keys_view(keys.begin(), keys.end());
+
+  for (TxnId txn_id : {0, 1, 2}) {
+    std::vector<GetStatus> statuses(keys.size());
+    skip_list->MultiGet(keys_view, txn_id, statuses);
+    for (size_t i = 0; i < keys.size(); i++) {
+      GetStatus status = skip_list->Get(keys[i], txn_id);
+      EXPECT_EQ(statuses[i].type, status.type);
+      EXPECT_EQ(statuses[i].value, status.value);
+    }
+  }
+}
+
 TEST(SkipListTest, BatchOperations) {
   auto skip_list = std::make_unique<db::SkipList>();
   const int num_keys = 100000;
@@ -269,6 +332,51 @@ TEST(SkipListTest, Iterator) {
   }
 }
 
+TEST(SkipListTest, ConcurrentReadsWithSingleWriter) {
+  auto skip_list = std::make_unique<db::SkipList>();
+
+  const int num_keys = 100000;
+  const int num_readers = 4;
+  std::atomic<int> num_written{0};
+
+  // Readers go through skiplist without lock while writer inserts
+  std::vector<std::thread> readers;
+  for (int r = 0; r < num_readers; r++) {
+    readers.emplace_back([&skip_list, &num_written, num_keys]() {
+      while (num_written.load(std::memory_order_acquire) < num_keys) {
+        const int written = num_written.load(std::memory_order_acquire);
+        for (int i = std::max(0, written - 100); i < written; i++) {
+          GetStatus status = skip_list->Get("key" + std::to_string(i), i);
+          ASSERT_EQ(status.type, db::ValueType::PUT);
+          EXPECT_EQ(status.value.value(), "value" + std::to_string(i));
+        }
+
+        std::string_view previous_key;
+        auto iter = std::make_unique<db::SkipListIterator>(skip_list.get());
+        int count = 0;
+        for (iter->SeekToFirst(); iter->IsValid() && count < 100;
+             iter->Next(), count++) {
+          EXPECT_LE(previous_key, iter->GetKey());
+          previous_key = iter->GetKey();
+        }
+      }
+    });
+  }
+
+  for (int i = 0; i < num_keys; i++) {
+    skip_list->Put("key" + std::to_string(i), "value" + std::to_string(i), i);
+    num_written.store(i + 1, std::memory_order_release);
+  }
+  for (auto &reader : readers) {
+    reader.join();
+  }
+
+  for (int i = 0; i < num_keys; i++) {
+    EXPECT_EQ(skip_list->Get("key" + std::to_string(i), kMaxTxnId).value,
+              "value" + std::to_string(i));
+  }
+}
+
 } // namespace db
 
 } // namespace kvs
@@ -8,6 +8,7 @@
 #include "db/version.h"
 #include "db/version_manager.h"
 #include "io/linux_file.h"
+#include "io/prefetch_buffer.h"
 #include "sstable/block_builder.h"
 #include "sstable/block_index.h"
 #include "sstable/block_reader.h"
@@ -47,7 +48,8 @@ bool CompareVersionFilesWithDirectoryFiles(const db::DBImpl *db) {
     num_sst_files_info += sst_file_info.size();
   }
 
-  return (num_sst_files == num_sst_files_info + 1 /*include manifest file*/)
+  return (num_sst_files ==
+          num_sst_files_info + 2 /*include MANIFEST and CURRENT files*/)
              ? true
              : false;
 }
@@ -177,9 +179,8 @@ TEST(TableTest, CreateTable) {
   db->ForceFlushMemTable();
   std::this_thread::sleep_for(std::chrono::milliseconds(1000));
 
-  const std::vector<std::vector<std::shared_ptr<db::SSTMetadata>>>
-      &level_sst_info =
-          db->GetVersionManager()->GetLatestVersion()->GetSSTMetadata();
+  const std::vector<db::LevelFiles> &level_sst_info =
+      db->GetVersionManager()->GetLatestVersion()->GetSSTMetadata();
   EXPECT_EQ(level_sst_info[0].size(), 1);
 
   EXPECT_EQ(level_sst_info[0][0]->smallest_key, smallest_key);
@@ -229,9 +230,8 @@ TEST(TableTest, BasicTableReader) {
   SSTId table_id = 1;
   std::string filename = db->GetDBPath() + std::to_string(table_id) + ".sst";
 
-  const std::vector<std::vector<std::shared_ptr<db::SSTMetadata>>>
-      &version_sst_metadata =
-          db->GetVersionManager()->GetLatestVersion()->GetSSTMetadata();
+  const std::vector<db::LevelFiles> &version_sst_metadata =
+      db->GetVersionManager()->GetLatestVersion()->GetSSTMetadata();
 
   EXPECT_EQ(
       db->GetVersionManager()->GetLatestVersion()->GetSSTMetadata()[0].size(),
@@ -254,6 +254,199 @@ TEST(TableTest, BasicTableReader) {
   ClearAllSstFiles(db.get());
 }
 
+TEST(TableTest, BatchedBlockReads) {
+  auto db = std::make_unique<db::DBImpl>(true /*is_testing*/);
+  db->LoadDB("test");
+  const db::Config *const config = db->GetConfig();
+  const int nums_elems = 10000000;
+
+  size_t memtable_size = 0;
+  std::string key, value;
+  for (int i = 0; i < nums_elems; i++) {
+    key = "key" + std::to_string(i);
+    value = "value" + std::to_string(i);
+
+    db->Put(key, value, 0 /*txn_id*/);
+    memtable_size += key.size() + value.size();
+    if (memtable_size >= config->GetPerMemTableSizeLimit()) {
+      break;
+    }
+  }
+
+  // Force creating a new sst
+  db->ForceFlushMemTable();
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+
+  SSTId table_id = 1;
+  std::string filename = db->GetDBPath() + std::to_string(table_id) + ".sst";
+  const std::vector<db::LevelFiles> &version_sst_metadata =
+      db->GetVersionManager()->GetLatestVersion()->GetSSTMetadata();
+  ASSERT_EQ(version_sst_metadata[0].size(), 1);
+
+  auto table_reader = CreateAndSetupDataForTableReader(
+      std::move(filename), table_id, version_sst_metadata[0][0]->file_size);
+  const std::vector<BlockIndex> &block_index = table_reader->GetBlockIndex();
+  ASSERT_GT(block_index.size(), 1);
+
+  // Read every block with a single batch, in reverse order
+  std::vector<BlockToRead> blocks_to_read;
+  for (auto it = block_index.rbegin(); it != block_index.rend(); it++) {
+    blocks_to_read.push_back(
+        {table_reader.get(), it->GetBlockStartOffset(), it->GetBlockSize()});
+  }
+
+  std::vector<std::unique_ptr<BlockReader>> block_readers =
+      CreateAndSetupDataForBlockReaders(blocks_to_read);
+  ASSERT_EQ(block_readers.size(), block_index.size());
+
+  for (size_t i = 0; i < block_index.size(); i++) {
+    const BlockIndex &bi = block_index[block_index.size() - 1 - i];
+    ASSERT_TRUE(block_readers[i]);
+
+    // Must be the same as block read by a blocking read
+    auto block_reader = table_reader->CreateAndSetupDataForBlockReader(
+        bi.GetBlockStartOffset(), bi.GetBlockSize());
+    for (std::string_view block_key :
+         {bi.GetSmallestKey(), bi.GetLargestKey()}) {
+      std::string_view batched_value;
+      std::string_view blocking_value;
+      EXPECT_EQ(block_readers[i]->GetValue(block_key, kMaxTxnId,
+                                           &batched_value),
+                db::ValueType::PUT);
+      EXPECT_EQ(block_reader->GetValue(block_key, kMaxTxnId, &blocking_value),
+                db::ValueType::PUT);
+      EXPECT_EQ(batched_value, blocking_value);
+    }
+  }
+
+  ClearAllSstFiles(db.get());
+}
+
+TEST(TableTest, PrefetchBufferReadahead) {
+  auto db = std::make_unique<db::DBImpl>(true /*is_testing*/);
+  db->LoadDB("test");
+  const db::Config *const config = db->GetConfig();
+  const int nums_elems = 10000000;
+
+  size_t memtable_size = 0;
+  std::string key, value;
+  for (int i = 0; i < nums_elems; i++) {
+    key = "key" + std::to_string(i);
+    value = "value" + std::to_string(i);
+
+    db->Put(key, value, 0 /*txn_id*/);
+    memtable_size += key.size() + value.size();
+    if (memtable_size >= config->GetPerMemTableSizeLimit()) {
+      break;
+    }
+  }
+
+  // Force creating a new sst
+  db->ForceFlushMemTable();
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+
+  SSTId table_id = 1;
+  std::string filename = db->GetDBPath() + std::to_string(table_id) + ".sst";
+  const std::vector<db::LevelFiles> &version_sst_metadata =
+      db->GetVersionManager()->GetLatestVersion()->GetSSTMetadata();
+  ASSERT_EQ(version_sst_metadata[0].size(), 1);
+
+  auto table_reader = CreateAndSetupDataForTableReader(
+      std::string(filename), table_id, version_sst_metadata[0][0]->file_size);
+  const std::vector<BlockIndex> &block_index = table_reader->GetBlockIndex();
+
+  auto file = std::make_unique<io::LinuxReadOnlyFile>(filename);
+  ASSERT_TRUE(file->Open());
+
+  io::PrefetchBuffer prefetch_buffer(io::kDefaultInitialReadaheadSize,
+                                     io::kDefaultMaxReadaheadSize);
+  std::vector<Byte> prefetched, expected;
+  for (const auto &bi : block_index) {
+    prefetched.resize(bi.GetBlockSize());
+    expected.resize(bi.GetBlockSize());
+
+    ASSERT_TRUE(prefetch_buffer.Read(file.get(), bi.GetBlockStartOffset(),
+                                     prefetched));
+    ASSERT_EQ(file->RandomRead(expected, bi.GetBlockStartOffset()),
+              expected.size());
+    EXPECT_EQ(prefetched, expected);
+  }
+
+  // Blocks are read sequentially, readahead must have grown up to max
+  EXPECT_EQ(prefetch_buffer.GetReadaheadSize(), io::kDefaultMaxReadaheadSize);
+
+  // Random access resets readahead
+  const BlockIndex &first_block = block_index.front();
+  prefetched.resize(first_block.GetBlockSize());
+  ASSERT_TRUE(prefetch_buffer.Read(file.get(),
+                                   first_block.GetBlockStartOffset(),
+                                   prefetched));
+  EXPECT_EQ(prefetch_buffer.GetReadaheadSize(),
+            io::kDefaultInitialReadaheadSize);
+
+  ClearAllSstFiles(db.get());
+}
+
+TEST(TableTest, MmapTableReader) {
+  auto db = std::make_unique<db::DBImpl>(true /*is_testing*/);
+  db->LoadDB("test");
+  const db::Config *const config = db->GetConfig();
+  const int nums_elems = 10000000;
+
+  size_t memtable_size = 0;
+  std::vector<std::pair<std::string, std::string>> list_key_value;
+  for (int i = 0; i < nums_elems; i++) {
+    std::string key = "key" + std::to_string(i);
+    std::string value = "value" + std::to_string(i);
+
+    db->Put(key, value, 0 /*txn_id*/);
+    memtable_size += key.size() + value.size();
+    list_key_value.push_back({std::move(key), std::move(value)});
+    if (memtable_size >= config->GetPerMemTableSizeLimit()) {
+      break;
+    }
+  }
+
+  // Force creating a new sst
+  db->ForceFlushMemTable();
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+
+  SSTId table_id = 1;
+  std::string filename = db->GetDBPath() + std::to_string(table_id) + ".sst";
+  const std::vector<db::LevelFiles> &version_sst_metadata =
+      db->GetVersionManager()->GetLatestVersion()->GetSSTMetadata();
+  ASSERT_EQ(version_sst_metadata[0].size(), 1);
+
+  auto table_reader = CreateAndSetupDataForTableReader(
+      std::string(filename), table_id, version_sst_metadata[0][0]->file_size,
+      true /*use_mmap*/);
+  ASSERT_TRUE(table_reader);
+
+  for (size_t i = 0; i < list_key_value.size(); i += 97) {
+    db::PinnableValue value;
+    EXPECT_EQ(table_reader->GetValue(list_key_value[i].first, kMaxTxnId,
+                                     nullptr /*block_reader_cache*/,
+                                     table_reader.get(), &value,
+                                     true /*fill_cache*/),
+              db::ValueType::PUT);
+    EXPECT_EQ(value.GetView(), list_key_value[i].second);
+  }
+
+  // Block readers keep mapping alive after table reader is destroyed
+  const BlockIndex &first_block = table_reader->GetBlockIndex().front();
+  std::string smallest_key(first_block.GetSmallestKey());
+  auto block_reader = table_reader->CreateAndSetupDataForBlockReader(
+      first_block.GetBlockStartOffset(), first_block.GetBlockSize());
+  ASSERT_TRUE(block_reader);
+  table_reader.reset();
+
+  std::string_view value;
+  EXPECT_EQ(block_reader->GetValue(smallest_key, kMaxTxnId, &value),
+            db::ValueType::PUT);
+
+  ClearAllSstFiles(db.get());
+}
+
 TEST(TableTest, TableReaderIterator) {
   auto db = std::make_unique<db::DBImpl>(true /*is_testing*/);
   db->LoadDB("test");
@@ -298,10 +491,8 @@ TEST(TableTest, TableReaderIterator) {
   std::this_thread::sleep_for(std::chrono::milliseconds(1000));
   EXPECT_TRUE(CompareVersionFilesWithDirectoryFiles(db.get()));
 
-  const std::vector<std::vector<std::shared_ptr<db::SSTMetadata>>>
-      sst_metadata = db->GetVersionManager()
-                         ->GetLatestVersion()
-                         ->GetImmutableSSTMetadata();
+  const std::vector<db::LevelFiles> sst_metadata =
+      db->GetVersionManager()->GetLatestVersion()->GetImmutableSSTMetadata();
   EXPECT_EQ(sst_metadata.size(), db->GetConfig()->GetSSTNumLvels());
 
   for (int level = 0; level < sst_metadata.size(); level++) {
@@ -319,7 +510,7 @@ TEST(TableTest, TableReaderIterator) {
           std::move(filename), 1 /*sst_id*/, sst_metadata[0][0]->file_size);
   // Mock LRU table item
   auto lru_table_item = std::make_shared<LRUTableItem>(
-      1 /*table_id*/, std::move(table_reader), db->GetTableReaderCache());
+      1 /*table_id*/, std::move(table_reader));
 
   auto iterator = std::make_unique<sstable::TableReaderIterator>(
       db->GetBlockReaderCache(), lru_table_item);
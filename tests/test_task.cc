@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+
+#include "common/executor.h"
+#include "common/task.h"
+#include "common/thread_pool.h"
+
+#include <atomic>
+#include <coroutine>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace kvs {
+
+namespace {
+
+// Suspend coroutine, then resume it through executor from another thread, as
+// completion of a disk read does
+struct ResumeOnOtherThread {
+  bool await_ready() const { return false; }
+
+  void await_suspend(std::coroutine_handle<> handle) {
+    std::thread([this, handle]() { executor->Execute(handle); }).detach();
+  }
+
+  void await_resume() const {}
+
+  Executor *executor;
+};
+
+Task<int> Square(int value, Executor *executor) {
+  if (value % 2 == 0) {
+    // Completes inline
+    co_return value * value;
+  }
+
+  co_await ResumeOnOtherThread{executor};
+  co_return value * value;
+}
+
+Task<int> SumOfSquares(int total, Executor *executor) {
+  int sum = 0;
+  for (int i = 0; i < total; i++) {
+    sum += co_await Square(i, executor);
+  }
+  co_return sum;
+}
+
+Task<> SetFlag(std::atomic<bool> *flag) {
+  flag->store(true);
+  co_return;
+}
+
+Task<> Fail() {
+  throw std::runtime_error("failed");
+  co_return;
+}
+
+} // namespace
+
+TEST(TaskTest, SyncWait) {
+  InlineExecutor executor;
+  EXPECT_EQ(SyncWait(Square(4, &executor)), 16);
+  EXPECT_EQ(SyncWait(Square(5, &executor)), 25);
+  EXPECT_EQ(SyncWait(SumOfSquares(100, &executor)), 328350);
+
+  // Task only runs once it is awaited
+  std::atomic<bool> started(false);
+  Task<> task = SetFlag(&started);
+  EXPECT_FALSE(started.load());
+  SyncWait(std::move(task));
+  EXPECT_TRUE(started.load());
+
+  EXPECT_THROW(SyncWait(Fail()), std::runtime_error);
+}
+
+TEST(TaskTest, WhenAllKeepsOrder) {
+  ThreadPool thread_pool(4);
+  ThreadPoolExecutor executor(&thread_pool);
+
+  const int total_tasks = 1000;
+  std::vector<Task<int>> tasks;
+  for (int i = 0; i < total_tasks; i++) {
+    tasks.push_back(Square(i, &executor));
+  }
+
+  std::vector<int> results = SyncWait(WhenAll(std::move(tasks)));
+  ASSERT_EQ(results.size(), total_tasks);
+  for (int i = 0; i < total_tasks; i++) {
+    EXPECT_EQ(results[i], i * i);
+  }
+
+  EXPECT_TRUE(SyncWait(WhenAll(std::vector<Task<int>>())).empty());
+}
+
+} // namespace kvs
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+
+#include "common/thread_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <latch>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace kvs {
+
+TEST(ThreadPoolTest, HigherPriorityGoesFirst) {
+  std::vector<TaskPriority> order;
+  std::mutex mutex;
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  std::latch started(1);
+
+  {
+    ThreadPool thread_pool(1);
+    // Keep the only worker busy until all jobs are scheduled
+    thread_pool.Schedule(TaskPriority::kHigh, [&]() {
+      started.count_down();
+      released.wait();
+    });
+    started.wait();
+
+    for (TaskPriority priority :
+         {TaskPriority::kLow, TaskPriority::kCompaction,
+          TaskPriority::kL0Compaction, TaskPriority::kHigh}) {
+      thread_pool.Schedule(priority, [&, priority]() {
+        std::scoped_lock lock(mutex);
+        order.push_back(priority);
+      });
+    }
+    release.set_value();
+  }
+
+  EXPECT_EQ(order, std::vector<TaskPriority>(
+                       {TaskPriority::kHigh, TaskPriority::kL0Compaction,
+                        TaskPriority::kCompaction, TaskPriority::kLow}));
+}
+
+TEST(ThreadPoolTest, IdleWorkersStealJobs) {
+  constexpr int kTotalJobs = 1000;
+  std::atomic<int> total_done(0);
+  std::latch all_done(kTotalJobs);
+
+  ThreadPool thread_pool(4);
+  // All subtasks are pushed to deque of the worker running this job, while
+  // that worker is waiting for them
+  thread_pool.Schedule(TaskPriority::kHigh, [&]() {
+    for (int i = 0; i < kTotalJobs; i++) {
+      thread_pool.Schedule(TaskPriority::kHigh, [&]() {
+        total_done.fetch_add(1);
+        all_done.count_down();
+      });
+    }
+    all_done.wait();
+  });
+
+  all_done.wait();
+  EXPECT_EQ(total_done.load(), kTotalJobs);
+}
+
+TEST(ThreadPoolTest, EnqueueReturnsResult) {
+  ThreadPool thread_pool(2);
+  std::vector<std::future<int>> results;
+  for (int i = 0; i < 100; i++) {
+    results.push_back(thread_pool.Enqueue(
+        TaskPriority::kLow, [](int a, int b) { return a * b; }, i, 2));
+  }
+
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(results[i].get(), i * 2);
+  }
+}
+
+TEST(ThreadPoolTest, ServiceDoesNotOccupyWorkers) {
+  std::atomic<bool> stop(false);
+  std::atomic<bool> service_stopped(false);
+
+  {
+    ThreadPool thread_pool(1);
+    thread_pool.StartService([&]() {
+      while (!stop.load()) {
+        std::this_thread::yield();
+      }
+      service_stopped = true;
+    });
+
+    // The only worker is still free while service is running
+    EXPECT_EQ(thread_pool.Enqueue(TaskPriority::kLow, []() { return 1; }).get(),
+              1);
+
+    stop = true;
+  }
+
+  EXPECT_TRUE(service_stopped.load());
+}
+
+TEST(ThreadPoolTest, RemainingJobsFinishOnShutdown) {
+  constexpr int kTotalJobs = 500;
+  std::atomic<int> total_done(0);
+
+  {
+    ThreadPool thread_pool(3);
+    for (int i = 0; i < kTotalJobs; i++) {
+      thread_pool.Schedule(static_cast<TaskPriority>(i % 4),
+                           [&]() { total_done.fetch_add(1); });
+    }
+  }
+
+  EXPECT_EQ(total_done.load(), kTotalJobs);
+}
+
+TEST(ThreadPoolTest, JobsScheduleFollowUpsOnShutdown) {
+  std::atomic<int> total_done(0);
+
+  ThreadPool thread_pool(2);
+  for (int i = 0; i < 10; i++) {
+    thread_pool.Schedule(TaskPriority::kHigh, [&]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      thread_pool.Schedule(TaskPriority::kLow,
+                           [&]() { total_done.fetch_add(1); });
+    });
+  }
+  thread_pool.Shutdown();
+
+  EXPECT_EQ(total_done.load(), 10);
+  EXPECT_THROW(thread_pool.Schedule(TaskPriority::kLow, []() {}),
+               std::runtime_error);
+}
+
+TEST(ThreadPoolTest, MaxActiveThreads) {
+  std::set<std::thread::id> workers;
+  std::mutex mutex;
+
+  ThreadPool thread_pool(4);
+  thread_pool.SetMaxActiveThreads(0);
+  EXPECT_EQ(thread_pool.GetMaxActiveThreads(), 1);
+
+  std::vector<std::future<void>> results;
+  for (int i = 0; i < 100; i++) {
+    results.push_back(thread_pool.Enqueue(TaskPriority::kLow, [&]() {
+      std::scoped_lock lock(mutex);
+      workers.insert(std::this_thread::get_id());
+    }));
+  }
+  for (auto &result : results) {
+    result.get();
+  }
+  EXPECT_EQ(workers.size(), 1);
+
+  // A job scheduled while the only active worker sleeps wakes it up
+  for (int i = 0; i < 20; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    std::future<void> result = thread_pool.Enqueue(TaskPriority::kLow, []() {});
+    ASSERT_EQ(result.wait_for(std::chrono::seconds(1)),
+              std::future_status::ready);
+  }
+
+  thread_pool.SetMaxActiveThreads(100);
+  EXPECT_EQ(thread_pool.GetMaxActiveThreads(), thread_pool.GetTotalThreads());
+}
+
+} // namespace kvs
\ No newline at end of file
@@ -5,12 +5,19 @@
 #include "db/db_impl.h"
 #include "db/version.h"
 #include "db/version_manager.h"
+#include "io/linux_file.h"
+#include "sstable/block_builder.h"
+#include "sstable/block_index.h"
+#include "sstable/table_builder.h"
 
 // libC++
 #include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <memory>
 #include <thread>
+#include <tuple>
+#include <vector>
 
 namespace fs = std::filesystem;
 
@@ -33,7 +40,8 @@ bool CompareVersionFilesWithDirectoryFiles(const DBImpl *db) {
     num_sst_files_info += sst_file_info.size();
   }
 
-  return (num_sst_files == num_sst_files_info + 1 /*include manifest file*/)
+  return (num_sst_files ==
+          num_sst_files_info + 2 /*include MANIFEST and CURRENT files*/)
              ? true
              : false;
 }
@@ -129,7 +137,7 @@ TEST(VersionTest, GetFromSST) {
     key = "key" + std::to_string(i);
     value = "value" + std::to_string(i);
 
-    status = version->Get(key, 0 /*txn_id*/);
+    status = version->Get(key, kMaxTxnId);
     EXPECT_EQ(status.type, db::ValueType::PUT);
     EXPECT_EQ(status.value.value(), value);
   }
@@ -205,7 +213,7 @@ TEST(VersionTest, ConcurrentPutSingleGet) {
     key = "key" + std::to_string(i);
     value = "value" + std::to_string(i);
 
-    status = version->Get(key, 0 /*txn_id*/);
+    status = version->Get(key, kMaxTxnId);
     EXPECT_EQ(status.type, ValueType::PUT);
     EXPECT_EQ(status.value.value(), value);
   }
@@ -250,7 +258,7 @@ TEST(VersionTest, FreeObsoleteVersions) {
     for (size_t i = 0; i < nums_elem; i++) {
       key = "key" + std::to_string(nums_elem * index + i);
       value = "value" + std::to_string(nums_elem * index + i);
-      status = version->Get(key, 0 /*txn_id*/);
+      status = version->Get(key, kMaxTxnId);
 
       EXPECT_TRUE(status.type == ValueType::PUT ||
                   status.type == ValueType::NOT_FOUND ||
@@ -295,6 +303,94 @@ TEST(VersionTest, FreeObsoleteVersions) {
   ClearAllSstFiles(db.get());
 }
 
+TEST(VersionTest, ReclaimObsoleteFiles) {
+  auto db = std::make_unique<DBImpl>(true /*is_testing*/);
+  ASSERT_TRUE(db->LoadDB("test_reclaim"));
+  const int num_levels = db->GetConfig()->GetSSTNumLvels();
+  const std::string old_file = db->GetDBPath() + "1.sst";
+  const std::string new_file = db->GetDBPath() + "2.sst";
+  std::ofstream(old_file).put('1');
+  std::ofstream(new_file).put('2');
+
+  auto version_edit = std::make_unique<VersionEdit>(num_levels);
+  version_edit->AddNewFiles(1 /*table_id*/, 1 /*level*/, 1 /*file_size*/,
+                            "key1", "key9", std::string(old_file));
+  ASSERT_TRUE(db->LogAndApply(std::move(version_edit)));
+
+  // Reader keeps version that still contains old file
+  const Version *old_version =
+      db->GetVersionManager()->AcquireLatestVersion();
+  ASSERT_TRUE(old_version);
+
+  version_edit = std::make_unique<VersionEdit>(num_levels);
+  version_edit->AddNewFiles(2 /*table_id*/, 1 /*level*/, 1 /*file_size*/,
+                            "key1", "key9", std::string(new_file));
+  version_edit->RemoveFiles(1 /*sst_id*/, 1 /*level*/);
+  ASSERT_TRUE(db->LogAndApply(std::move(version_edit)));
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  EXPECT_EQ(db->GetVersionManager()->GetVersions().size(), 1);
+  EXPECT_TRUE(fs::exists(old_file));
+
+  // Old version and its file are freed together once reader leaves
+  old_version->DecreaseRefCount();
+  for (int i = 0; i < 100 && fs::exists(old_file); i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  EXPECT_EQ(db->GetVersionManager()->GetVersions().size(), 0);
+  EXPECT_FALSE(fs::exists(old_file));
+  EXPECT_TRUE(fs::exists(new_file));
+
+  ClearAllSstFiles(db.get());
+}
+
+TEST(VersionTest, Level0NewestMemTableFirst) {
+  auto db = std::make_unique<DBImpl>(true /*is_testing*/);
+  ASSERT_TRUE(db->LoadDB("test_lvl0_order"));
+  const int num_levels = db->GetConfig()->GetSSTNumLvels();
+
+  // Two memtables holding same key are flushed in one job. Older memtable's
+  // SST is built last, so it takes larger table_id
+  const std::vector<std::tuple<SSTId, std::string, TxnId>> memtables = {
+      {1001 /*table_id*/, "old_value", 1 /*txn_id*/},
+      {1000 /*table_id*/, "new_value", 2 /*txn_id*/}};
+
+  auto version_edit = std::make_unique<VersionEdit>(num_levels);
+  for (const auto &[table_id, value, txn_id] : memtables) {
+    std::string filename = db->GetDBPath() + std::to_string(table_id) + ".sst";
+    sstable::TableBuilder new_sst(std::string(filename), db->GetConfig());
+    ASSERT_TRUE(new_sst.Open());
+    new_sst.AddEntry("key", value, txn_id, ValueType::PUT);
+    new_sst.Finish();
+    version_edit->AddNewFiles(table_id, 0 /*level*/, new_sst.GetFileSize(),
+                              new_sst.GetSmallestKey(), new_sst.GetLargestKey(),
+                              std::move(filename), new_sst.GetMinTxnId(),
+                              new_sst.GetMaxTxnId());
+  }
+  ASSERT_TRUE(db->LogAndApply(std::move(version_edit)));
+
+  const Version *version = db->GetVersionManager()->AcquireLatestVersion();
+  ASSERT_TRUE(version);
+
+  GetStatus status = version->Get("key", kMaxTxnId);
+  ASSERT_EQ(status.type, ValueType::PUT);
+  EXPECT_EQ(status.value.value(), "new_value");
+
+  // Older snapshot still sees older memtable
+  status = version->Get("key", 1 /*txn_id*/);
+  ASSERT_EQ(status.type, ValueType::PUT);
+  EXPECT_EQ(status.value.value(), "old_value");
+
+  const std::vector<std::string_view> keys = {"key"};
+  std::vector<GetStatus> statuses(keys.size());
+  version->MultiGet(keys, kMaxTxnId, statuses, true /*fill_cache*/);
+  ASSERT_EQ(statuses[0].type, ValueType::PUT);
+  EXPECT_EQ(statuses[0].value.value(), "new_value");
+
+  version->DecreaseRefCount();
+  ClearAllSstFiles(db.get());
+}
+
 } // namespace db
 
 } // namespace kvs
\ No newline at end of file